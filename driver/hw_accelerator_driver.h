@@ -59,10 +59,23 @@ int hw_driver_is_hwsecured(bool*);
 /* Get all three version nbs of the IP (major, minor & patch) */
 int hw_driver_get_version_tags(uint32_t*, uint32_t*, uint32_t*);
 
+/* Get random bytes from the TRNG of the IP (e.g for ECDSA nonces)
+ *
+ * Served from the raw entropy source. An error is returned (and 'out'
+ * wiped) if the TRNG is starved or fails the driver's continuous health
+ * test.
+ */
+int hw_driver_get_random(uint8_t *out, uint32_t out_sz);
+
 /* Set the curve parameters a, b, p and q */
 int hw_driver_set_curve(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint32_t b_sz,
 			const uint8_t *p, uint32_t p_sz, const uint8_t *q, uint32_t q_sz);
 
+/* Nb of calls to hw_driver_set_curve() which loaded the curve in the IP
+ * & nb of those which were no-ops (the IP already holding the same curve)
+ */
+int hw_driver_get_curve_stats(uint32_t* nb_loaded, uint32_t* nb_skipped);
+
 /* Activate the blinding for scalar multiplication */
 int hw_driver_enable_blinding_and_set_size(uint32_t blinding_size);
 
@@ -180,12 +193,101 @@ typedef struct {
 	uint32_t* nb_xr1;
 	uint32_t* nb_yr1;
 	uint32_t* nb_zr01;
-	/* A huge char buffer to printf all required infos. */
-	char* msg;
-	uint32_t msgsz;
-	uint32_t msgsz_max;
+	/* Sink receiving the binary trace records (see KP_TRACE_REC_* below),
+	 * exactly one complete record per call. If the sink returns a non-zero
+	 * value, subsequent records are dropped (the [k]P run still completes).
+	 */
+	int (*sink)(void* arg, const uint8_t* rec, uint32_t sz);
+	void* sink_arg;
 } kp_trace_info_t;
 
+/* Binary format of the [k]P trace stream.
+ *
+ * Each record starts with a 4-byte header:
+ *   byte 0     record type (KP_TRACE_REC_*)
+ *   byte 1     type-dependent argument
+ *   bytes 2-3  size of the payload in bytes, little-endian
+ * followed by the payload. All multi-byte fields are little-endian.
+ *
+ *   KP_TRACE_REC_HDR   arg = KP_TRACE_VERSION
+ *                      payload: u32 KP_TRACE_MAGIC, u16 nn, u16 ww, u16 w, u16 0
+ *   KP_TRACE_REC_MSG   arg = KP_TRACE_MSG_* (fixed progress message), no payload
+ *   KP_TRACE_REC_STEP  arg = KP_TRACE_EVT_* (what the halted step corresponds to)
+ *                      payload: u16 pc, u8 state, u8 flags (KP_TRACE_FLG_*),
+ *                               u16 jnbbit, u16 0
+ *   KP_TRACE_REC_LGNB  arg = KP_TRACE_NB_*, payload: the w limbs of the large
+ *                      number, least significant first, 4 bytes each
+ *   KP_TRACE_REC_SAME  arg = KP_TRACE_NB_*, no payload (value of the large
+ *                      number is the one last sent in a KP_TRACE_REC_LGNB)
+ *   KP_TRACE_REC_END   payload: u32 nb of debug steps
+ *
+ * Only the steps printed by the former text view are recorded, and large
+ * numbers are only transmitted in full when they changed. Offline rendering
+ * of the text view is done by kp_trace_decode() (driver/linux/kp_trace_decode.c,
+ * also built as standalone tool 'kp-trace-decode').
+ */
+#define KP_TRACE_MAGIC        0x544b5049    /* "IPKT" */
+#define KP_TRACE_VERSION      1
+#define KP_TRACE_REC_HDR_SZ   4
+#define KP_TRACE_REC_MAX_SZ   (KP_TRACE_REC_HDR_SZ + 4096)
+
+#define KP_TRACE_REC_HDR      0
+#define KP_TRACE_REC_MSG      1
+#define KP_TRACE_REC_STEP     2
+#define KP_TRACE_REC_LGNB     3
+#define KP_TRACE_REC_SAME     4
+#define KP_TRACE_REC_END      5
+
+#define KP_TRACE_MSG_SETBKPT   0
+#define KP_TRACE_MSG_RUN       1
+#define KP_TRACE_MSG_POLL      2
+#define KP_TRACE_MSG_HALTED    3
+#define KP_TRACE_MSG_STEPPING  4
+#define KP_TRACE_MSG_RESUME    5
+
+#define KP_TRACE_EVT_ALPHA          0
+#define KP_TRACE_EVT_PHI01          1
+#define KP_TRACE_EVT_LAMBDA         2
+#define KP_TRACE_EVT_SETUP1         3
+#define KP_TRACE_EVT_SETUP2         4
+#define KP_TRACE_EVT_AFTER_ZADDC    5
+#define KP_TRACE_EVT_AFTER_ZADDU    6
+#define KP_TRACE_EVT_SUBP_COZ       7
+#define KP_TRACE_EVT_SUBP_DONE      8
+#define KP_TRACE_EVT_EXIT           9
+#define KP_TRACE_EVT_ZADD_VOID      10
+#define KP_TRACE_EVT_ZDBL_NA_IN     11
+#define KP_TRACE_EVT_ZDBL_NA_OUT    12
+#define KP_TRACE_EVT_PRE_ZADDU_OUT  13
+#define KP_TRACE_EVT_ZADDU_OUT      14
+#define KP_TRACE_EVT_KAPMSK         15
+#define KP_TRACE_EVT_KAPPMSK        16
+#define KP_TRACE_EVT_PHIMSK         17
+
+#define KP_TRACE_FLG_R0Z    (((uint8_t)0x1) << 0)
+#define KP_TRACE_FLG_R1Z    (((uint8_t)0x1) << 1)
+#define KP_TRACE_FLG_KAP    (((uint8_t)0x1) << 2)
+#define KP_TRACE_FLG_KAPP   (((uint8_t)0x1) << 3)
+#define KP_TRACE_FLG_ZU     (((uint8_t)0x1) << 4)
+#define KP_TRACE_FLG_ZC     (((uint8_t)0x1) << 5)
+
+#define KP_TRACE_NB_XR0       0
+#define KP_TRACE_NB_YR0       1
+#define KP_TRACE_NB_XR1       2
+#define KP_TRACE_NB_YR1       3
+#define KP_TRACE_NB_ZR01      4
+#define KP_TRACE_NB_ALPHA     5
+#define KP_TRACE_NB_PHI0      6
+#define KP_TRACE_NB_PHI1      7
+#define KP_TRACE_NB_LAMBDA    8
+#define KP_TRACE_NB_KAP0MSK   9
+#define KP_TRACE_NB_KAP1MSK   10
+#define KP_TRACE_NB_KAPP0MSK  11
+#define KP_TRACE_NB_KAPP1MSK  12
+#define KP_TRACE_NB_PHI0MSK   13
+#define KP_TRACE_NB_PHI1MSK   14
+#define KP_TRACE_NB_NB        15
+
 typedef struct {
 	/* "AXI" */
 	uint32_t aximin;
@@ -214,11 +316,6 @@ typedef struct {
 	uint32_t rawstarv;
 } trng_diagcnt_t;
 
-/* The size of the statically allocated buffer that field
- * 'msgsz_max' of struct 'kp_trace_info_t' above should not
- * exceed. */
-#define KP_TRACE_PRINTF_SZ   (16*1024*1024)    /* 16 MB */
-
 /* Return (out_x, out_y) = scalar * (x, y) */
 int hw_driver_mul(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
 		  const uint8_t *scalar, uint32_t scalar_sz,
@@ -228,6 +325,20 @@ int hw_driver_mul(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_
 /* Set the small scalar size in the hardware */
 int hw_driver_set_small_scalar_size(uint32_t bit_sz);
 
+/* Options of hw_driver_mul_ext() (argument 'flags') */
+#define HW_DRIVER_MUL_PUBLIC_SCALAR  (1UL << 0)  /* Scalar is public: its bit length sets the small scalar size */
+
+/* Same as hw_driver_mul() with options */
+int hw_driver_mul_ext(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+		  const uint8_t *scalar, uint32_t scalar_sz,
+		  uint8_t *out_x, uint32_t *out_x_sz, uint8_t *out_y, uint32_t *out_y_sz,
+		  uint32_t flags, uint32_t* kp_time, uint32_t* zmask, kp_trace_info_t* ktrc);
+
+/* Check that [q](x, y) is the null point, q being the order of the current
+ * curve (as set by hw_driver_set_curve()). Only a flag is returned. */
+int hw_driver_check_order(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+			  bool* in_subgroup);
+
 /* To get hardware capabilities from the IP */
 int hw_driver_get_capabilities(bool* secure, bool* shuffle, bool* nndyn, bool* axi64, uint32_t* nnmax);
 
@@ -243,6 +354,160 @@ int hw_driver_get_capabilities(bool* secure, bool* shuffle, bool* nndyn, bool* a
 int hw_driver_is_hw_secure(bool*);   /* if HW secure, the bool. pted to by arg-ptr is set to TRUE. */
 int hw_driver_is_hw_unsecure(bool*); /* if HW secure, the bool. pted to by arg-ptr is set to FALSE. */
 
+/* Pipelined [k]P (IP synthesized with 'shadow' = TRUE in ecc_customize.vhd)
+ *
+ * hw_driver_mul_queue() uploads the operands of a [k]P computation into
+ * the shadow slots of the IP - which is possible while the previous one
+ * is still running - and queues the computation. hw_driver_mul_collect()
+ * waits for the oldest computation to end and returns its result, which
+ * lets the IP start the queued one right away.
+ *
+ * At most one computation may be in flight and one queued behind it.
+ * The input point cannot be the point at infinity. Curve parameters must
+ * not be changed while a computation is in flight or queued.
+ */
+int hw_driver_shadow_is_supported(bool* shadow);
+
+int hw_driver_mul_queue(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+			const uint8_t *scalar, uint32_t scalar_sz);
+
+int hw_driver_mul_collect(uint8_t *out_x, uint32_t *out_x_sz, uint8_t *out_y, uint32_t *out_y_sz,
+			  uint32_t* kp_time);
+
+/* Hardware command queue (IP synthesized with 'cmdqdepth' > 0 in ecc_customize.vhd)
+ *
+ * Point operations pushed with hw_driver_cmdq_push() are executed by the
+ * IP back to back, without waiting for software in between. They operate
+ * on the operands currently held by the IP (the same ones as for the
+ * nominal API), so all operands of a sequence (e.g PT_CHK, PT_KP, PT_NEG)
+ * must be written beforehand. The completion of each command is reported
+ * by a record popped with hw_driver_cmdq_pop_result(), in the order the
+ * commands were pushed.
+ */
+/* Bits of the status of a command (argument 'status' of hw_driver_cmdq_pop_result()) */
+#define HW_DRIVER_CMDQ_ST_YES       (1UL << 0)   /* Answer of a PT_CHK, PT_EQU or PT_OPP command */
+#define HW_DRIVER_CMDQ_ST_INF       (1UL << 1)   /* Result is the point at infinity */
+#define HW_DRIVER_CMDQ_ST_ERR       (1UL << 2)   /* Command was refused by the IP */
+
+int hw_driver_cmdq_is_supported(bool* cmdq);
+
+/* Depth of the queue, nb of commands pending & nb of completion records to pop */
+int hw_driver_cmdq_status(uint32_t* depth, uint32_t* occupancy, uint32_t* nb_results);
+
+/* Push a command (fails if the queue is full) */
+int hw_driver_cmdq_push(ip_ecc_command cmd, uint32_t* id);
+
+/* Pop the oldest completion record ('valid' is set to 0 if there is none) */
+int hw_driver_cmdq_pop_result(int* valid, uint32_t* id, uint32_t* status);
+
+/* Resume the queue after a command ended in error */
+int hw_driver_cmdq_resume(void);
+
+/* Discard all pending commands & completion records */
+int hw_driver_cmdq_flush(void);
+
+/* Performance counters (IP synthesized with 'perfcnt' = TRUE in ecc_customize.vhd)
+ *
+ * Free-running 32-bit counters of clock cycles (they wrap around, so only
+ * differences between two snapshots are meaningful). They are available in
+ * HW secure mode too, as the IP only lets them be seen between operations.
+ */
+typedef struct {
+	uint32_t kp;          /* Cycles busy computing [k]P */
+	uint32_t pt_add;      /* Cycles busy computing PT_ADD */
+	uint32_t pt_dbl;      /* Cycles busy computing PT_DBL */
+	uint32_t pt_chk;      /* Cycles busy computing PT_CHK */
+	uint32_t pt_neg;      /* Cycles busy computing PT_NEG */
+	uint32_t pt_equ;      /* Cycles busy computing PT_EQU */
+	uint32_t pt_opp;      /* Cycles busy computing PT_OPP */
+	uint32_t trng_stall;  /* Cycles where a client of the TRNG waited for random */
+	uint32_t mty;         /* Cycles computing Montgomery constants & new prime size signals */
+	uint32_t axi;         /* Cycles with an AXI-lite transfer in progress */
+	uint32_t mm_used;     /* Montgomery multiplier-cycles used (FPREDC in progress) */
+	uint32_t mm_avail;    /* Montgomery multiplier-cycles available while computing */
+	uint32_t cycles;      /* Total nb of cycles */
+	uint32_t kp_setup;    /* [k]P cycles before the main loop (check, blinding, setup) */
+	uint32_t kp_ladder;   /* [k]P cycles in the main loop (Co-Z ladder) */
+	uint32_t kp_exit;     /* [k]P cycles after the main loop (subtractP, exit) */
+} hw_driver_perf_counters_t;
+
+/* To know if the IP was synthesized with performance counters */
+int hw_driver_perf_is_supported(bool* perf);
+
+/* Get a consistent snapshot of all performance counters */
+int hw_driver_get_perf_counters(hw_driver_perf_counters_t* perf);
+
+/* Reset all performance counters to 0 */
+int hw_driver_clear_perf_counters(void);
+
+/* Co-simulation backend (driver compiled with -DWITH_EC_HW_COSIM, the IP
+ * being simulated by sim/ecc_cosim.vhd): nb of register reads & writes
+ * issued by the driver and nb of IP clock cycles simulated so far
+ */
+#if defined(WITH_EC_HW_COSIM)
+int hw_driver_cosim_stats(uint64_t* nbrd, uint64_t* nbwr, uint64_t* cycles);
+#endif
+
+/* Descriptor-ring DMA (IP synthesized with 'dma' = TRUE in ecc_customize.vhd)
+ *
+ * Software owns a ring of 2^log2sz job descriptors (each one made of 8 words
+ * of the IP AXI data width) in memory reachable by the IP AXI4 master port,
+ * as well as the curve, input & output blocks referenced by descriptors.
+ * Large numbers in these blocks are stored in 'slots' of hw_driver_dma_slot_size()
+ * bytes, and must be accessed using hw_driver_dma_put_bignum() and
+ * hw_driver_dma_get_bignum().
+ *
+ * While the DMA is started the IP registers cannot be accessed (but for the
+ * DMA ones) and the nominal API above must not be used.
+ */
+typedef struct {
+	void *ring;           /* Virtual address of the descriptor ring */
+	uint32_t ring_bus;    /* Bus address of the descriptor ring (as seen by the IP) */
+	uint32_t log2sz;      /* The ring holds 2^log2sz descriptors */
+	uint32_t prod;        /* Producer index (nb of descriptors posted so far) */
+	uint32_t cons;        /* Consumer index (last value read from the hardware) */
+} hw_driver_dma_ring_t;
+
+/* Flags of a DMA job (argument 'flags' of hw_driver_dma_post()) */
+#define HW_DRIVER_DMA_P_INF         (1UL << 8)   /* First input point is the point at infinity */
+#define HW_DRIVER_DMA_Q_INF         (1UL << 9)   /* Second input point is the point at infinity */
+#define HW_DRIVER_DMA_LOAD_CURVE    (1UL << 12)  /* Load curve parameters before the job */
+#define HW_DRIVER_DMA_IRQ           (1UL << 13)  /* Raise an interrupt when the job is done */
+
+/* Bits of the status of a DMA job (argument 'status' of hw_driver_dma_poll()) */
+#define HW_DRIVER_DMA_ST_DONE       (1UL << 0)
+#define HW_DRIVER_DMA_ST_YES        (1UL << 1)   /* Answer of a PT_CHK, PT_EQU or PT_OPP job */
+#define HW_DRIVER_DMA_ST_INF        (1UL << 2)   /* Result is the point at infinity */
+#define HW_DRIVER_DMA_ST_ERR        (1UL << 3)   /* Bits 16-31 then hold the IP error bits */
+
+/* To know if the IP was synthesized with the descriptor-ring DMA */
+int hw_driver_dma_is_supported(bool* dma);
+
+/* Size in bytes of a slot (large number) in the curve, input & output blocks */
+int hw_driver_dma_slot_size(uint32_t* slot_sz);
+
+/* Initialize the ring and start the DMA engine */
+int hw_driver_dma_start(hw_driver_dma_ring_t* r, void* ring, uint32_t ring_bus, uint32_t log2sz,
+		        bool irq);
+
+/* Stop the DMA engine (software gets back access to the IP registers) */
+int hw_driver_dma_stop(void);
+
+/* Write (resp. read) a large number into (resp. from) slot 'slot' of a memory block */
+int hw_driver_dma_put_bignum(void* blk, uint32_t slot, const uint8_t *a, uint32_t a_sz);
+int hw_driver_dma_get_bignum(const void* blk, uint32_t slot, uint8_t *a, uint32_t a_sz);
+
+/* Post a job in the ring (fails if the ring is full) */
+int hw_driver_dma_post(hw_driver_dma_ring_t* r, ip_ecc_command cmd, uint32_t flags,
+		       uint32_t curve_bus, uint32_t in_bus, uint32_t out_bus, uint32_t* idx);
+
+/* Get the status of job 'idx' ('done' is set to 0 if the job is still pending) */
+int hw_driver_dma_poll(hw_driver_dma_ring_t* r, uint32_t idx, int* done, uint32_t* status);
+
+/* Get the result of a [k]P job from its output block, unmasked with the token */
+int hw_driver_dma_get_kp_result(void* out_blk, uint8_t *out_x, uint32_t *out_x_sz,
+				uint8_t *out_y, uint32_t *out_y_sz);
+
 /******************
  *    DEBUG API   *    (meaning: IP was synthesized with 'hwsecure' = FALSE in ecc_customize.vhd)
  *******************/
@@ -483,6 +748,41 @@ int hw_driver_get_xyshuf_perms_DBG(uint8_t*, uint8_t*, uint8_t*, uint8_t*,
  * (only in HW unsecure mode) */
 int hw_driver_get_trng_diagnostics_DBG(trng_diagcnt_t*);
 
+/* Microcode execution trace (IP synthesized with 'tracedepth' > 0 in
+ * ecc_customize.vhd, only in HW unsecure mode).
+ *
+ * The IP records one entry per microcode instruction it decodes, until its
+ * trace RAM is full (further instructions are then dropped & the overflow
+ * flag is raised).
+ */
+#define HW_DRIVER_TRACE_CL_NOP     0 /* NOP */
+#define HW_DRIVER_TRACE_CL_ARITH   1 /* arithmetic, other than below */
+#define HW_DRIVER_TRACE_CL_REDC    2 /* Montgomery multiplication (FPREDC) */
+#define HW_DRIVER_TRACE_CL_TPAR    3 /* test of parity (TESTPAR) */
+#define HW_DRIVER_TRACE_CL_BRANCH  4 /* jump (conditional or not) */
+#define HW_DRIVER_TRACE_CL_CALL    5 /* call to a routine */
+#define HW_DRIVER_TRACE_CL_RET     6 /* return from a routine */
+#define HW_DRIVER_TRACE_CL_STOP    7 /* instruction ending the program */
+
+typedef struct {
+	uint16_t pc;      /* Address of the instruction in microcode */
+	uint8_t cls;      /* Class of instruction (HW_DRIVER_TRACE_CL_*) */
+	bool taken;       /* Whether the branch was taken (branch classes only) */
+	uint32_t cycle;   /* Decode time, in cycles since the first entry */
+} hw_driver_trace_entry_t;
+
+/* Clear the trace & start recording */
+int hw_driver_trace_start_DBG(void);
+
+/* Stop recording (recorded entries are kept) */
+int hw_driver_trace_stop_DBG(void);
+
+/* Get the nb of recorded entries, the depth of the trace & the overflow flag */
+int hw_driver_trace_status_DBG(uint32_t* nb, uint32_t* depth, bool* ovf);
+
+/* Read back at most 'max' recorded entries (nb of entries read in 'nb') */
+int hw_driver_trace_drain_DBG(hw_driver_trace_entry_t* buf, uint32_t max, uint32_t* nb);
+
 /* Attack features: set a specific level of side-channel resistance */
 int hw_driver_attack_set_level(int level);
 
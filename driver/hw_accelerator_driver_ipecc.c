@@ -96,7 +96,14 @@ err:
  * depending on the IP configuration.
  */
 
+#if defined(WITH_EC_HW_COSIM)
 #if defined(WITH_EC_HW_ACCELERATOR_WORD64)
+#error "WITH_EC_HW_COSIM only supports a 32-bit AXI interface (see sim/ecc_cosim.vhd)"
+#endif
+/* Co-simulation: each access is sent to the simulated IP */
+#define IPECC_GET_REG(reg)		(hw_driver_cosim_read((volatile void*)(reg)))
+#define IPECC_SET_REG(reg, val)		(hw_driver_cosim_write((volatile void*)(reg), (uint32_t)(val)))
+#elif defined(WITH_EC_HW_ACCELERATOR_WORD64)
 /* In 64 bits, reverse words endianness */
 #define IPECC_GET_REG(reg)	((*((ip_ecc_word*)((reg)))) & 0xffffffff)
 #define IPECC_SET_REG(reg, val)	\
@@ -166,6 +173,7 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_W_CTRL_WRITE_NB		(((uint32_t)0x1) << 16)
 #define IPECC_W_CTRL_READ_NB		(((uint32_t)0x1) << 17)
 #define IPECC_W_CTRL_WRITE_K		(((uint32_t)0x1) << 18)
+#define IPECC_W_CTRL_SHADOW		(((uint32_t)0x1) << 19)
 #define IPECC_W_CTRL_NBADDR_MSK		(0xfff)
 #define IPECC_W_CTRL_NBADDR_POS		(20)
 
@@ -212,6 +220,34 @@ static volatile uint64_t *ipecc_baddr = NULL;
 /* no field here: action is performed simply by writing to the
    register address, whatever the value written */
 
+/* Fields for W_DMA_CTRL */
+#define IPECC_W_DMA_CTRL_EN       (((uint32_t)0x1) << 0)
+#define IPECC_W_DMA_CTRL_IRQ_EN   (((uint32_t)0x1) << 4)
+#define IPECC_W_DMA_CTRL_RESET    (((uint32_t)0x1) << 8)
+
+/* Fields for W_DMA_RING_CFG */
+#define IPECC_W_DMA_RING_CFG_LOG2SZ_POS   (0)
+#define IPECC_W_DMA_RING_CFG_LOG2SZ_MSK   (0xf)
+#define IPECC_W_DMA_RING_CFG_NBW_POS      (16)
+#define IPECC_W_DMA_RING_CFG_NBW_MSK      (0xfff)
+
+/* Fields for W_DMA_PROD */
+#define IPECC_W_DMA_PROD_POS   (0)
+#define IPECC_W_DMA_PROD_MSK   (0xfff)
+
+/* Fields for W_CMDQ_PUSH */
+/* These are the same as the command bits of W_CTRL (see above) */
+
+/* Fields for W_CMDQ_CTRL */
+#define IPECC_W_CMDQ_CTRL_FLUSH    (((uint32_t)0x1) << 0)
+#define IPECC_W_CMDQ_CTRL_RESUME   (((uint32_t)0x1) << 1)
+
+/* Fields for W_PERF_CTRL */
+#define IPECC_W_PERF_CTRL_SEL_POS   (0)
+#define IPECC_W_PERF_CTRL_SEL_MSK   (0xf)
+#define IPECC_W_PERF_CTRL_CLR       (((uint32_t)0x1) << 8)
+#define IPECC_W_PERF_CTRL_FRZ       (((uint32_t)0x1) << 9)
+
 /* Fields for W_DBG_HALT */
 #define IPECC_W_DBG_HALT_DO_HALT   (((uint32_t)0x1) << 0)
 
@@ -341,6 +377,11 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_W_ATK_DIVMM_FACTOR_POS     (16)
 #define IPECC_W_ATK_DIVMM_FACTOR_MASK    (0xfffe)
 
+/* Fields for IPECC_W_DBG_TRACE_CTRL */
+#define IPECC_W_DBG_TRACE_CTRL_EN    (((uint32_t)0x1) << 0)
+#define IPECC_W_DBG_TRACE_CTRL_CLR   (((uint32_t)0x1) << 4)
+#define IPECC_W_DBG_TRACE_CTRL_RWD   (((uint32_t)0x1) << 8)
+
 /* Fields for R_STATUS */
 #define IPECC_R_STATUS_BUSY	   (((uint32_t)0x1) << 0)
 #define IPECC_R_STATUS_KP	   (((uint32_t)0x1) << 4)
@@ -354,17 +395,85 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_R_STATUS_R0_IS_NULL   (((uint32_t)0x1) << 12)
 #define IPECC_R_STATUS_R1_IS_NULL   (((uint32_t)0x1) << 13)
 #define IPECC_R_STATUS_TOKEN_GEN      (((uint32_t)0x1) << 14)
+#define IPECC_R_STATUS_KP_QUEUED      (((uint32_t)0x1) << 15)
 #define IPECC_R_STATUS_ERRID_MSK	(0xffff)
 #define IPECC_R_STATUS_ERRID_POS	(16)
 
 /* Fields for R_CAPABILITIES */
 #define IPECC_R_CAPABILITIES_DBG_N_PROD   (((uint32_t)0x1) << 0)
 #define IPECC_R_CAPABILITIES_SHF   (((uint32_t)0x1) << 4)
+#define IPECC_R_CAPABILITIES_CMDQ   (((uint32_t)0x1) << 5)
+#define IPECC_R_CAPABILITIES_PERF   (((uint32_t)0x1) << 6)
 #define IPECC_R_CAPABILITIES_NNDYN   (((uint32_t)0x1) << 8)
 #define IPECC_R_CAPABILITIES_W64   (((uint32_t)0x1) << 9)
+#define IPECC_R_CAPABILITIES_DMA   (((uint32_t)0x1) << 10)
+#define IPECC_R_CAPABILITIES_SHADOW   (((uint32_t)0x1) << 11)
 #define IPECC_R_CAPABILITIES_NNMAX_MSK	(0xfffff)
 #define IPECC_R_CAPABILITIES_NNMAX_POS	(12)
 
+/* Fields for R_DMA_STATUS */
+#define IPECC_R_DMA_STATUS_EN        (((uint32_t)0x1) << 0)
+#define IPECC_R_DMA_STATUS_RUNNING   (((uint32_t)0x1) << 1)
+#define IPECC_R_DMA_STATUS_BUS_ERR   (((uint32_t)0x1) << 2)
+#define IPECC_R_DMA_STATUS_CPU_FBD   (((uint32_t)0x1) << 3)
+#define IPECC_R_DMA_STATUS_CONS_POS  (16)
+#define IPECC_R_DMA_STATUS_CONS_MSK  (0xfff)
+
+/* Fields for R_CMDQ_STATUS */
+#define IPECC_R_CMDQ_STATUS_OCC_POS     (0)
+#define IPECC_R_CMDQ_STATUS_OCC_MSK     (0xff)
+#define IPECC_R_CMDQ_STATUS_DEPTH_POS   (8)
+#define IPECC_R_CMDQ_STATUS_DEPTH_MSK   (0xff)
+#define IPECC_R_CMDQ_STATUS_NBRES_POS   (16)
+#define IPECC_R_CMDQ_STATUS_NBRES_MSK   (0xff)
+#define IPECC_R_CMDQ_STATUS_OVF      (((uint32_t)0x1) << 30)
+#define IPECC_R_CMDQ_STATUS_HALTED   (((uint32_t)0x1) << 31)
+
+/* Fields for R_CMDQ_RESULT */
+#define IPECC_R_CMDQ_RESULT_ID_POS   (0)
+#define IPECC_R_CMDQ_RESULT_ID_MSK   (0xff)
+#define IPECC_R_CMDQ_RESULT_VALID     (((uint32_t)0x1) << 8)
+#define IPECC_R_CMDQ_RESULT_YES       (((uint32_t)0x1) << 9)
+#define IPECC_R_CMDQ_RESULT_R1_NULL   (((uint32_t)0x1) << 10)
+#define IPECC_R_CMDQ_RESULT_ERR       (((uint32_t)0x1) << 11)
+#define IPECC_R_CMDQ_RESULT_OP_POS   (16)
+#define IPECC_R_CMDQ_RESULT_OP_MSK   (0x7f)
+
+/* Fields for R_RANDOM_CNT */
+#define IPECC_R_RANDOM_CNT_IRN_POS   (0)
+#define IPECC_R_RANDOM_CNT_IRN_MSK   (0xffff)
+#define IPECC_R_RANDOM_CNT_NBW_POS   (16)
+#define IPECC_R_RANDOM_CNT_NBW_MSK   (0xff)
+#define IPECC_R_RANDOM_CNT_RDY   (((uint32_t)0x1) << 31)
+
+/* Indexes of performance counters (field SEL of W_PERF_CTRL) */
+#define IPECC_PERF_KP           (0)
+#define IPECC_PERF_PT_ADD       (1)
+#define IPECC_PERF_PT_DBL       (2)
+#define IPECC_PERF_PT_CHK       (3)
+#define IPECC_PERF_PT_NEG       (4)
+#define IPECC_PERF_PT_EQU       (5)
+#define IPECC_PERF_PT_OPP       (6)
+#define IPECC_PERF_TRNG_STALL   (7)
+#define IPECC_PERF_MTY          (8)
+#define IPECC_PERF_AXI          (9)
+#define IPECC_PERF_MM_USED      (10)
+#define IPECC_PERF_MM_AVAIL     (11)
+#define IPECC_PERF_CYCLES       (12)
+#define IPECC_PERF_KP_SETUP     (13)
+#define IPECC_PERF_KP_LADDER    (14)
+#define IPECC_PERF_KP_EXIT      (15)
+
+/* Layout of DMA job descriptors (offsets in words, see ecc_dma.vhd) */
+#define IPECC_DMA_DESC_CMD      (0)
+#define IPECC_DMA_DESC_CURVE    (1)
+#define IPECC_DMA_DESC_IN       (2)
+#define IPECC_DMA_DESC_OUT      (3)
+#define IPECC_DMA_DESC_STATUS   (4)
+#define IPECC_DMA_DESC_WORDS    (8)
+/* Slots in the blocks pointed to by words CURVE, IN & OUT of a descriptor */
+#define IPECC_DMA_SLOT_OUT_TOKEN   (2)
+
 /* Fields for R_HW_VERSION */
 #define IPECC_R_HW_VERSION_MAJOR_POS    (24)
 #define IPECC_R_HW_VERSION_MAJOR_MSK    (0xff)
@@ -483,6 +592,23 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_R_DBG_XYSHF_PERM_Y1_NEXT_POS (14)
 #define IPECC_R_DBG_XYSHF_PERM_Y1_NEXT_MSK (0x3)
 
+/* Fields for R_DBG_TRACE_STATUS */
+#define IPECC_R_DBG_TRACE_STS_CNT_POS    (0)
+#define IPECC_R_DBG_TRACE_STS_CNT_MSK    (0xffffff)
+#define IPECC_R_DBG_TRACE_STS_LOGD_POS   (24)
+#define IPECC_R_DBG_TRACE_STS_LOGD_MSK   (0x1f)
+#define IPECC_R_DBG_TRACE_STS_EN         (((uint32_t)0x1) << 30)
+#define IPECC_R_DBG_TRACE_STS_OVF        (((uint32_t)0x1) << 31)
+
+/* Fields of trace entries read from R_DBG_TRACE_DATA */
+#define IPECC_DBG_TRACE_PC_POS      (0)
+#define IPECC_DBG_TRACE_PC_MSK      (0xfff)
+#define IPECC_DBG_TRACE_CLASS_POS   (12)
+#define IPECC_DBG_TRACE_CLASS_MSK   (0x7)
+#define IPECC_DBG_TRACE_TAKEN       (((uint32_t)0x1) << 15)
+#define IPECC_DBG_TRACE_TIME_POS    (16)
+#define IPECC_DBG_TRACE_TIME_MSK    (0xffff)
+
 
 /*************************************************************
  * Low-level macros: actions involving a direct write or read
@@ -577,6 +703,21 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_EXEC_PT_OPP() (IPECC_SET_REG(IPECC_W_CTRL, IPECC_W_CTRL_PT_OPP))
 #define IPECC_EXEC_PT_NEG() (IPECC_SET_REG(IPECC_W_CTRL, IPECC_W_CTRL_PT_NEG))
 
+/* Queue a [k]P computation on the operands held in the shadow slots
+ * (it is started by the IP as soon as the result of the current one,
+ * if any, has been read back, and the token has been read).
+ */
+#define IPECC_QUEUE_PT_KP() \
+	(IPECC_SET_REG(IPECC_W_CTRL, IPECC_W_CTRL_SHADOW | IPECC_W_CTRL_PT_KP))
+
+/* Is a [k]P computation queued and not yet started? */
+#define IPECC_IS_KP_QUEUED() \
+	(!!(IPECC_GET_REG(IPECC_R_STATUS) & IPECC_R_STATUS_KP_QUEUED))
+
+#define IPECC_KP_QUEUED_WAIT() do { \
+	while(IPECC_GET_REG(IPECC_R_STATUS) & IPECC_R_STATUS_KP_QUEUED){}; \
+} while(0)
+
 /* On curve/equality/opposition flags handling
  */
 #define IPECC_GET_ONCURVE() (!!(IPECC_GET_REG(IPECC_R_STATUS) & IPECC_R_STATUS_YES))
@@ -634,6 +775,18 @@ static volatile uint64_t *ipecc_baddr = NULL;
 	IPECC_SET_REG(IPECC_W_WRITE_DATA, val); \
 } while(0)
 
+/* Same as IPECC_SET_WRITE_ADDR() but targeting the shadow slot of
+ * the big number (only k, XR1 & YR1 have one). Subsequent writes to
+ * W_WRITE_DATA fill the slot, even if the IP is busy computing.
+ */
+#define IPECC_SET_SHADOW_WRITE_ADDR(addr, scal) do { \
+	ip_ecc_word val = 0; \
+	val |= IPECC_W_CTRL_SHADOW | IPECC_W_CTRL_WRITE_NB; \
+	val |= ((scal) ? IPECC_W_CTRL_WRITE_K : 0); \
+	val |= ((addr & IPECC_W_CTRL_NBADDR_MSK) << IPECC_W_CTRL_NBADDR_POS); \
+	IPECC_SET_REG(IPECC_W_CTRL, val); \
+} while(0)
+
 /*
  * Actions involving registers W_R[01]_NULL & R_STATUS
  * ***************************************************
@@ -930,6 +1083,154 @@ static volatile uint64_t *ipecc_baddr = NULL;
 #define IPECC_IS_HW_SECURE() \
 	(!(IPECC_GET_REG(IPECC_R_CAPABILITIES) & IPECC_R_CAPABILITIES_DBG_N_PROD))
 
+/* To know if the IP hardware was synthesized with
+ * the descriptor-ring DMA engine ('dma' = TRUE).
+ */
+#define IPECC_IS_DMA_SUPPORTED() \
+	(!!(IPECC_GET_REG(IPECC_R_CAPABILITIES) & IPECC_R_CAPABILITIES_DMA))
+
+/* To know if the IP hardware was synthesized with
+ * shadow operand slots ('shadow' = TRUE).
+ */
+#define IPECC_IS_SHADOW_SUPPORTED() \
+	(!!(IPECC_GET_REG(IPECC_R_CAPABILITIES) & IPECC_R_CAPABILITIES_SHADOW))
+
+/* To know if the IP hardware was synthesized with
+ * a hardware command queue ('cmdqdepth' > 0).
+ */
+#define IPECC_IS_CMDQ_SUPPORTED() \
+	(!!(IPECC_GET_REG(IPECC_R_CAPABILITIES) & IPECC_R_CAPABILITIES_CMDQ))
+
+/*
+ * Actions using registers W_CMDQ_* & R_CMDQ_*
+ * (hardware command queue handling)
+ * *******************************************
+ */
+/* Push a command (same bits as for W_CTRL) into the queue */
+#define IPECC_CMDQ_PUSH(cmd) do { \
+	IPECC_SET_REG(IPECC_W_CMDQ_PUSH, (cmd)); \
+} while (0)
+
+/* Discard all pending commands & completion records */
+#define IPECC_CMDQ_FLUSH() do { \
+	IPECC_SET_REG(IPECC_W_CMDQ_CTRL, IPECC_W_CMDQ_CTRL_FLUSH); \
+} while (0)
+
+/* Resume the dispatch of commands after one ended in error */
+#define IPECC_CMDQ_RESUME() do { \
+	IPECC_SET_REG(IPECC_W_CMDQ_CTRL, IPECC_W_CMDQ_CTRL_RESUME); \
+} while (0)
+
+#define IPECC_CMDQ_GET_STATUS() (IPECC_GET_REG(IPECC_R_CMDQ_STATUS))
+
+#define IPECC_CMDQ_STATUS_OCC(st) \
+	(((st) >> IPECC_R_CMDQ_STATUS_OCC_POS) & IPECC_R_CMDQ_STATUS_OCC_MSK)
+#define IPECC_CMDQ_STATUS_DEPTH(st) \
+	(((st) >> IPECC_R_CMDQ_STATUS_DEPTH_POS) & IPECC_R_CMDQ_STATUS_DEPTH_MSK)
+#define IPECC_CMDQ_STATUS_NBRES(st) \
+	(((st) >> IPECC_R_CMDQ_STATUS_NBRES_POS) & IPECC_R_CMDQ_STATUS_NBRES_MSK)
+
+/* Pop the oldest completion record (bit VALID is clear if there is none) */
+#define IPECC_CMDQ_POP_RESULT() (IPECC_GET_REG(IPECC_R_CMDQ_RESULT))
+
+/* To know if the IP hardware was synthesized with
+ * performance counters ('perfcnt' = TRUE).
+ */
+#define IPECC_IS_PERF_SUPPORTED() \
+	(!!(IPECC_GET_REG(IPECC_R_CAPABILITIES) & IPECC_R_CAPABILITIES_PERF))
+
+/*
+ * Actions using registers W_PERF_CTRL & R_PERF_DATA
+ * (performance counters)
+ * *************************************************
+ */
+/* Select counter 'idx' (and freeze the copy of counters readable
+ * by software if 'frz' is not 0) */
+#define IPECC_PERF_SELECT(idx, frz) do { \
+	IPECC_SET_REG(IPECC_W_PERF_CTRL, \
+			(((idx) & IPECC_W_PERF_CTRL_SEL_MSK) << IPECC_W_PERF_CTRL_SEL_POS) \
+			| ((frz) ? IPECC_W_PERF_CTRL_FRZ : 0)); \
+} while (0)
+
+/* Clear all counters */
+#define IPECC_PERF_CLEAR() do { \
+	IPECC_SET_REG(IPECC_W_PERF_CTRL, IPECC_W_PERF_CTRL_CLR); \
+} while (0)
+
+/* Read the selected counter */
+#define IPECC_PERF_GET() (IPECC_GET_REG(IPECC_R_PERF_DATA))
+
+/*
+ * Actions using registers W_DMA_* & R_DMA_STATUS
+ * (descriptor-ring DMA handling)
+ * **********************************************
+ */
+/* Stop the engine and reset the producer & consumer indexes */
+#define IPECC_DMA_RESET() do { \
+	IPECC_SET_REG(IPECC_W_DMA_CTRL, IPECC_W_DMA_CTRL_RESET); \
+} while (0)
+
+/* Set the bus address of the ring, its size (2^log2sz descriptors)
+ * and the nb of words of each large number slot */
+#define IPECC_DMA_CONFIGURE(base, log2sz, nbw) do { \
+	IPECC_SET_REG(IPECC_W_DMA_RING_BASE, (base)); \
+	IPECC_SET_REG(IPECC_W_DMA_RING_CFG, \
+			(((log2sz) & IPECC_W_DMA_RING_CFG_LOG2SZ_MSK) << IPECC_W_DMA_RING_CFG_LOG2SZ_POS) \
+			| (((nbw) & IPECC_W_DMA_RING_CFG_NBW_MSK) << IPECC_W_DMA_RING_CFG_NBW_POS)); \
+} while (0)
+
+#define IPECC_DMA_ENABLE(irq) do { \
+	IPECC_SET_REG(IPECC_W_DMA_CTRL, IPECC_W_DMA_CTRL_EN | ((irq) ? IPECC_W_DMA_CTRL_IRQ_EN : 0)); \
+} while (0)
+
+#define IPECC_DMA_DISABLE() do { \
+	IPECC_SET_REG(IPECC_W_DMA_CTRL, 0); \
+} while (0)
+
+#define IPECC_DMA_SET_PROD(idx) do { \
+	IPECC_SET_REG(IPECC_W_DMA_PROD, ((idx) & IPECC_W_DMA_PROD_MSK) << IPECC_W_DMA_PROD_POS); \
+} while (0)
+
+#define IPECC_DMA_GET_CONS() \
+	((IPECC_GET_REG(IPECC_R_DMA_STATUS) >> IPECC_R_DMA_STATUS_CONS_POS) \
+	 & IPECC_R_DMA_STATUS_CONS_MSK)
+
+#define IPECC_DMA_IS_RUNNING() \
+	(!!(IPECC_GET_REG(IPECC_R_DMA_STATUS) & IPECC_R_DMA_STATUS_RUNNING))
+
+#define IPECC_DMA_IS_BUS_ERR() \
+	(!!(IPECC_GET_REG(IPECC_R_DMA_STATUS) & IPECC_R_DMA_STATUS_BUS_ERR))
+
+/* Memory barriers between descriptor accesses in system memory and
+ * accesses to the DMA registers: the write barrier makes descriptor
+ * words visible to the engine before the producer index is bumped, the
+ * read barrier keeps status words from being read before the consumer
+ * index they go with (the engine may fetch from outside the inner
+ * shareable domain of the CPU, hence the full-system 'dmb sy') */
+#if defined(__arm__) || defined(__aarch64__)
+#define IPECC_DMA_WMB() do { \
+	__asm__ __volatile__("dmb sy" ::: "memory"); \
+} while (0)
+#else
+#define IPECC_DMA_WMB() do { \
+	__sync_synchronize(); \
+} while (0)
+#endif
+#define IPECC_DMA_RMB() IPECC_DMA_WMB()
+
+/* Wait until the engine is done with the job it might be processing */
+#define IPECC_DMA_RUNNING_WAIT() do { \
+	while(IPECC_DMA_IS_RUNNING()) {}; \
+} while (0)
+
+/* Actions using registers R_RANDOM & R_RANDOM_CNT
+ * ***********************************************
+ */
+#define IPECC_GET_RANDOM_CNT() (IPECC_GET_REG(IPECC_R_RANDOM_CNT))
+
+/* Pop one random word */
+#define IPECC_GET_RANDOM() (IPECC_GET_REG(IPECC_R_RANDOM))
+
 /* Actions using register R_HW_VERSION
  * ***********************************
  */
@@ -1717,6 +2018,33 @@ static volatile uint64_t *ipecc_baddr = NULL;
 	((IPECC_GET_REG(IPECC_R_DBG_XYSHUF_PERM) >> IPECC_R_DBG_XYSHF_PERM_Y1_NEXT_POS) \
 	 & IPECC_R_DBG_XYSHF_PERM_Y1_NEXT_MSK)
 
+/* Actions involving registers W_DBG_TRACE_CTRL, R_DBG_TRACE_STATUS
+ * & R_DBG_TRACE_DATA (microcode execution trace)
+ * *****************************************************************
+ */
+/* Enable (en = 1) or stop (en = 0) recording, optionally clearing the
+ * trace (clr = 1) and/or rewinding the read pointer (rwd = 1) */
+#define IPECC_DBG_TRACE_CTRL(en, clr, rwd) do { \
+	IPECC_SET_REG(IPECC_W_DBG_TRACE_CTRL, \
+			((en) ? IPECC_W_DBG_TRACE_CTRL_EN : 0) \
+			| ((clr) ? IPECC_W_DBG_TRACE_CTRL_CLR : 0) \
+			| ((rwd) ? IPECC_W_DBG_TRACE_CTRL_RWD : 0)); \
+} while (0)
+
+#define IPECC_DBG_TRACE_GET_STATUS() (IPECC_GET_REG(IPECC_R_DBG_TRACE_STATUS))
+
+#define IPECC_DBG_TRACE_STATUS_CNT(sts) \
+	(((sts) >> IPECC_R_DBG_TRACE_STS_CNT_POS) & IPECC_R_DBG_TRACE_STS_CNT_MSK)
+
+/* Depth of the trace RAM (0 if the IP was synthesized w/o it) */
+#define IPECC_DBG_TRACE_STATUS_DEPTH(sts) \
+	((((sts) >> IPECC_R_DBG_TRACE_STS_LOGD_POS) & IPECC_R_DBG_TRACE_STS_LOGD_MSK) \
+	 ? (((uint32_t)0x1) << (((sts) >> IPECC_R_DBG_TRACE_STS_LOGD_POS) \
+			 & IPECC_R_DBG_TRACE_STS_LOGD_MSK)) : 0)
+
+/* Each read pops one entry */
+#define IPECC_DBG_TRACE_GET_DATA() (IPECC_GET_REG(IPECC_R_DBG_TRACE_DATA))
+
 /*
  * The pseudo TRNG device (HW unsecure mode only)
  */
@@ -4279,110 +4607,211 @@ static void get_exp_flags(kp_exp_flags_t* flg)
 	flg->jnbbit = (dbg_exp_flags >> IPECC_R_DBG_EXP_FLAGS_JNBBIT_POS) & IPECC_R_DBG_EXP_FLAGS_JNBBIT_MSK;
 }
 
-static void kp_trace_msg_append(kp_trace_info_t* ktrc, const char* fmt, ...)
-{
-#if 0
-	uint32_t msglen;
+/* Record buffer for the binary [k]P trace stream (see KP_TRACE_REC_* in
+ * hw_accelerator_driver.h). Its payload part is sized for large numbers
+ * up to 32768 bits.
+ */
+static uint8_t kp_trace_rec[KP_TRACE_REC_MAX_SZ];
+/* Set once the sink refused a record. */
+static bool kp_trace_dropped;
+/* One bit per KP_TRACE_NB_* id, set once the number was sent in full. */
+static uint32_t kp_trace_nb_sent;
+/* One bit per address of large number, set if the microcode may have
+ * written it since it was last read back.
+ */
+static uint32_t kp_trace_nb_dirty;
+/* Nb of limbs of large numbers & stride between two of them in the
+ * memory of large numbers (see ip_ecc_read_limb()).
+ */
+static uint32_t kp_trace_w, kp_trace_n;
+
+#ifdef DEBUG_ECC_IRAM_LGNB_WR_INIT
+/* Large numbers each opcode may write (generated by the assembler). */
+static const uint32_t kp_trace_lgnb_wr[DEBUG_ECC_IRAM_NB_OPCODES] = DEBUG_ECC_IRAM_LGNB_WR_INIT;
 #endif
-	static bool overflow = false;
-	va_list ap;
-#ifdef KP_TRACE_CONSOLE
-	int sz;
 
-	sz = ktrc->msgsz;
+/* Large numbers the opcode at address 'pc' may write (all of them if
+ * the microcode was assembled without the table).
+ */
+static inline uint32_t kp_trace_lgnb_written(uint32_t pc)
+{
+#ifdef DEBUG_ECC_IRAM_LGNB_WR_INIT
+	if (pc < DEBUG_ECC_IRAM_NB_OPCODES) {
+		return kp_trace_lgnb_wr[pc];
+	}
+#else
+	(void)pc;
 #endif
+	return 0xffffffff;
+}
 
-	if (overflow == false) {
-		/* We can sprintf now that we know we won't overflow the statically
-		 * allocated trace log buffer.
-		 */
-		va_start(ap, fmt);
-		ktrc->msgsz += vsprintf(ktrc->msg + ktrc->msgsz, fmt, ap);
-		va_end(ap);
-		if (ktrc->msgsz > ktrc->msgsz_max - 32) {
-			if (overflow == false) {
-				printf("%sWarning! About to reach max allocated size for [k]P trace buffer!..."
-						" Losing subsequent trace logs%s\n\r", KUNK, KNRM);
-				overflow = true;
-			}
-			return;
+static inline void kp_trace_put16(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t)(v & 0xff);
+	p[1] = (uint8_t)((v >> 8) & 0xff);
+}
+
+static inline void kp_trace_put32(uint8_t* p, uint32_t v)
+{
+	kp_trace_put16(p, v & 0xffff);
+	kp_trace_put16(p + 2, (v >> 16) & 0xffff);
+}
+
+/* Send the record whose payload (of 'sz' bytes) was already written
+ * in kp_trace_rec[] to the sink of the caller.
+ */
+static void kp_trace_emit(kp_trace_info_t* ktrc, uint32_t type, uint32_t arg, uint32_t sz)
+{
+	kp_trace_rec[0] = (uint8_t)type;
+	kp_trace_rec[1] = (uint8_t)arg;
+	kp_trace_put16(kp_trace_rec + 2, sz);
+	if ((kp_trace_dropped == false) && (ktrc->sink != NULL)) {
+		if (ktrc->sink(ktrc->sink_arg, kp_trace_rec, KP_TRACE_REC_HDR_SZ + sz)) {
+			printf("%sWarning! [k]P trace sink refused a record..."
+					" Losing subsequent trace records%s\n\r", KUNK, KNRM);
+			kp_trace_dropped = true;
+		}
+	}
+}
+
+static inline void kp_trace_msg(kp_trace_info_t* ktrc, uint32_t msg)
+{
+	kp_trace_emit(ktrc, KP_TRACE_REC_MSG, msg, 0);
+}
+
+/* Read the exception flags into 'flg' and trace the step. */
+static void kp_trace_step(kp_trace_info_t* ktrc, uint32_t evt, uint32_t dbgpc,
+		uint32_t dbgstate, kp_exp_flags_t* flg)
+{
+	uint8_t* p = kp_trace_rec + KP_TRACE_REC_HDR_SZ;
+
+	get_exp_flags(flg);
+	kp_trace_put16(p, dbgpc);
+	p[2] = (uint8_t)dbgstate;
+	p[3] = (flg->r0z ? KP_TRACE_FLG_R0Z : 0) | (flg->r1z ? KP_TRACE_FLG_R1Z : 0)
+		| (flg->kap ? KP_TRACE_FLG_KAP : 0) | (flg->kapp ? KP_TRACE_FLG_KAPP : 0)
+		| (flg->zu ? KP_TRACE_FLG_ZU : 0) | (flg->zc ? KP_TRACE_FLG_ZC : 0);
+	kp_trace_put16(p + 4, flg->jnbbit);
+	kp_trace_put16(p + 6, 0);
+	kp_trace_emit(ktrc, KP_TRACE_REC_STEP, evt, 8);
+}
+
+/* Read all limbs of large number 'lgnb' into 'nb' and trace it, in full
+ * only if its value changed since it was last sent.
+ *
+ * Large numbers the microcode did not write since they were last read
+ * are not read back again (the IP being halted, limbs are read with
+ * no further check, see ip_ecc_read_word_from_lgnbmem()).
+ */
+static void kp_trace_read_lgnb(kp_trace_info_t* ktrc, uint32_t id, uint32_t lgnb, uint32_t* nb)
+{
+	uint32_t i, limb;
+	bool changed;
+
+	changed = (kp_trace_nb_sent & (((uint32_t)0x1) << id)) ? false : true;
+	if ((changed == false) && (!(kp_trace_nb_dirty & (((uint32_t)0x1) << lgnb)))) {
+		kp_trace_emit(ktrc, KP_TRACE_REC_SAME, id, 0);
+		return;
+	}
+	for (i = 0; i < kp_trace_w; i++) {
+		IPECC_DBG_SET_FP_READ_ADDR((lgnb * kp_trace_n) + i);
+		IPECC_DBG_POLL_UNTIL_FP_READ_DATA_AVAIL();
+		limb = IPECC_DBG_GET_FP_READ_DATA();
+		if (limb != nb[i]) {
+			changed = true;
 		}
-#ifdef KP_TRACE_CONSOLE
-		log_print(ktrc->msg + sz);
+		nb[i] = limb;
+		kp_trace_put32(kp_trace_rec + KP_TRACE_REC_HDR_SZ + (4 * i), limb);
+	}
+	kp_trace_nb_dirty &= ~(((uint32_t)0x1) << lgnb);
+	if (changed) {
+		kp_trace_nb_sent |= (((uint32_t)0x1) << id);
+		kp_trace_emit(ktrc, KP_TRACE_REC_LGNB, id, 4 * kp_trace_w);
 	} else {
-		/*
-		 * The trace buffer has overflowed. Print to the console instead.
-		 */
-		va_start(ap, fmt);
-		log_print(fmt, ap);
-		va_end(ap);
-#endif
+		kp_trace_emit(ktrc, KP_TRACE_REC_SAME, id, 0);
 	}
 }
 
-void print_all_limbs_of_number(kp_trace_info_t* ktrc, const char* msg, uint32_t *nb)
+static inline void ip_read_and_trace_xyr0(kp_trace_info_t* ktrc)
 {
-  int32_t i;
-  kp_trace_msg_append(ktrc, "%s", msg);
-  for (i = IPECC_DBG_GET_W() - 1; i >= 0; i--) {
-    kp_trace_msg_append(ktrc, "%0*x", DIV(IPECC_DBG_GET_WW(), 4), nb[i]);
-  }
+	kp_trace_read_lgnb(ktrc, KP_TRACE_NB_XR0, IPECC_LARGE_NB_XR0_ADDR, ktrc->nb_xr0);
+	kp_trace_read_lgnb(ktrc, KP_TRACE_NB_YR0, IPECC_LARGE_NB_YR0_ADDR, ktrc->nb_yr0);
 }
 
-static inline void ip_read_and_print_xyr0(kp_trace_info_t* ktrc, kp_exp_flags_t* flg)
+static inline void ip_read_and_trace_xyr1(kp_trace_info_t* ktrc)
 {
-	ip_debug_read_all_limbs(IPECC_LARGE_NB_XR0_ADDR, ktrc->nb_xr0);
-	ip_debug_read_all_limbs(IPECC_LARGE_NB_YR0_ADDR, ktrc->nb_yr0);
-	print_all_limbs_of_number(ktrc, "[VHD-CMP-SAGE]     @ 4   XR0 = 0x", ktrc->nb_xr0);
-	if (flg->r0z) { kp_trace_msg_append(ktrc, " but R0 = 0"); } kp_trace_msg_append(ktrc, "\n\r");
-	print_all_limbs_of_number(ktrc, "[VHD-CMP-SAGE]     @ 5   YR0 = 0x", ktrc->nb_yr0);
-	if (flg->r0z) { kp_trace_msg_append(ktrc, " but R0 = 0"); } kp_trace_msg_append(ktrc, "\n\r");
+	kp_trace_read_lgnb(ktrc, KP_TRACE_NB_XR1, IPECC_LARGE_NB_XR1_ADDR, ktrc->nb_xr1);
+	kp_trace_read_lgnb(ktrc, KP_TRACE_NB_YR1, IPECC_LARGE_NB_YR1_ADDR, ktrc->nb_yr1);
 }
 
-static inline void ip_read_and_print_xyr1(kp_trace_info_t* ktrc, kp_exp_flags_t* flg)
+static inline void ip_read_and_trace_zr01(kp_trace_info_t* ktrc)
 {
-	ip_debug_read_all_limbs(IPECC_LARGE_NB_XR1_ADDR, ktrc->nb_xr1);
-	ip_debug_read_all_limbs(IPECC_LARGE_NB_YR1_ADDR, ktrc->nb_yr1);
-	print_all_limbs_of_number(ktrc, "[VHD-CMP-SAGE]     @ 6   XR1 = 0x", ktrc->nb_xr1);
-	if (flg->r1z) { kp_trace_msg_append(ktrc, " but R1 = 0"); } kp_trace_msg_append(ktrc, "\n\r");
-	print_all_limbs_of_number(ktrc, "[VHD-CMP-SAGE]     @ 7   YR1 = 0x", ktrc->nb_yr1);
-	if (flg->r1z) { kp_trace_msg_append(ktrc, " but R1 = 0"); } kp_trace_msg_append(ktrc, "\n\r");
+	kp_trace_read_lgnb(ktrc, KP_TRACE_NB_ZR01, IPECC_LARGE_NB_ZR01_ADDR, ktrc->nb_zr01);
 }
 
-static inline void ip_read_and_print_zr01(kp_trace_info_t* ktrc)
+static inline void ip_read_and_trace_r01(kp_trace_info_t* ktrc)
 {
-	ip_debug_read_all_limbs(IPECC_LARGE_NB_ZR01_ADDR, ktrc->nb_zr01);
-	print_all_limbs_of_number(ktrc, "[VHD-CMP-SAGE]     @ 26 ZR01 = 0x", ktrc->nb_zr01);
-	kp_trace_msg_append(ktrc, "\n");
+	ip_read_and_trace_xyr0(ktrc);
+	ip_read_and_trace_xyr1(ktrc);
+	ip_read_and_trace_zr01(ktrc);
 }
 
 static int kp_debug_trace(kp_trace_info_t* ktrc)
 {
-	uint32_t dbgpc, dbgstate;
+	uint32_t dbgpc, dbgstate, dbgstatus;
 	kp_exp_flags_t flags;
+	uint8_t* p;
 
 	if (ktrc == NULL) {
 		printf("Error: calling kp_debug_trace() with a null kp_trace_info_t pointer!\n\r");
 		goto err;
 	}
 
+	if ((4 * IPECC_DBG_GET_W()) > (KP_TRACE_REC_MAX_SZ - KP_TRACE_REC_HDR_SZ)) {
+		printf("Error in kp_debug_trace(): nn is too large for the trace record buffer\n\r");
+		goto err;
+	}
+
+	if (IPECC_DBG_GET_WW() > 32) {
+		printf("Error in kp_debug_trace(): limbs larger than 32 bits are not supported\n\r");
+		goto err;
+	}
+
+	kp_trace_w = IPECC_DBG_GET_W();
+	if (ge_pow_of_2(DIV(IPECC_GET_NN_MAX() + 4, IPECC_DBG_GET_WW()), &kp_trace_n)) {
+		goto err;
+	}
+
+	kp_trace_dropped = false;
+	kp_trace_nb_sent = 0;
+	kp_trace_nb_dirty = 0xffffffff;
+
+	/* Stream header */
+	p = kp_trace_rec + KP_TRACE_REC_HDR_SZ;
+	kp_trace_put32(p, KP_TRACE_MAGIC);
+	kp_trace_put16(p + 4, IPECC_GET_NN());
+	kp_trace_put16(p + 6, IPECC_DBG_GET_WW());
+	kp_trace_put16(p + 8, IPECC_DBG_GET_W());
+	kp_trace_put16(p + 10, 0);
+	kp_trace_emit(ktrc, KP_TRACE_REC_HDR, KP_TRACE_VERSION, 12);
+
 	/* Set first breakpoint on the first instruction
 	 * of routine .checkoncurveL of the microcode.
 	 */
-	kp_trace_msg_append(ktrc, "Setting first breakpoint (on .checkoncurveL)\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_SETBKPT);
 	ip_ecc_set_breakpoint(DEBUG_ECC_IRAM_CHKCURVE_OP1_ADDR, 0);
 
 	/* Transmit the [k]P run command to the IP. */
-	kp_trace_msg_append(ktrc, "Running [k]P\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_RUN);
 	IPECC_EXEC_PT_KP();
 
 	/* Poll register R_DBG_STATUS until it shows IP is halted
 	 * in HW unsecure mode.
 	 */
-	kp_trace_msg_append(ktrc, "Polling until debug halt\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_POLL);
 	IPECC_POLL_UNTIL_DEBUG_HALTED();
 
-	kp_trace_msg_append(ktrc, "IP is halted\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_HALTED);
 	/* IPECC IS HALTED */
 	/* Get the PC & state from IPECC_R_DBG_STATUS */
 	dbgpc = IPECC_GET_PC();
@@ -4401,7 +4830,7 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 		goto err;
 	}
 
-	kp_trace_msg_append(ktrc, "Starting step-by-step execution\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_STEPPING);
 
 	/*
 	 * Step-by-step loop
@@ -4412,64 +4841,47 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 		 */
 		IPECC_SINGLE_STEP();
 		/*
-		 * Poll register R_DBG_STATUS until it shows IP is halted
-		 * in HW unsecure mode.
+		 * The opcode PC pointed to was executed: large numbers
+		 * it may have written need to be read back again.
 		 */
-		IPECC_POLL_UNTIL_DEBUG_HALTED();
-		ktrc->nb_steps++;
+		kp_trace_nb_dirty |= kp_trace_lgnb_written(dbgpc);
 		/*
-		 * Get current value of PC & state.
+		 * Poll register R_DBG_STATUS until it shows IP is halted
+		 * in HW unsecure mode, and get current value of PC & state
+		 * from the same read of the register.
 		 */
-		dbgpc = IPECC_GET_PC();
-		dbgstate = IPECC_GET_FSM_STATE();
+		do {
+			dbgstatus = IPECC_GET_REG(IPECC_R_DBG_STATUS);
+		} while (!(dbgstatus & IPECC_R_DBG_STATUS_HALTED));
+		ktrc->nb_steps++;
+		dbgpc = (dbgstatus >> IPECC_R_DBG_STATUS_PC_POS) & IPECC_R_DBG_STATUS_PC_MSK;
+		dbgstate = (dbgstatus >> IPECC_R_DBG_STATUS_STATE_POS) & IPECC_R_DBG_STATUS_STATE_MSK;
 		/*
-		 * Get exception flags from register R_DBG_EXP_FLAGS
+		 * (exception flags from register R_DBG_EXP_FLAGS are only
+		 * read on the steps traced below, see kp_trace_step()).
 		 */
-		get_exp_flags(&flags);
 
 		switch (dbgpc) {
 
 			case DEBUG_ECC_IRAM_RANDOM_ALPHA_ADDR:
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				kp_trace_msg_append(ktrc, "%sGetting alpha%s\n\r", KUNK, KNRM);
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_ALF_ADDR, ktrc->alpha);
+				kp_trace_step(ktrc, KP_TRACE_EVT_ALPHA, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_ALPHA, IPECC_LARGE_NB_ALF_ADDR, ktrc->alpha);
 				ktrc->alpha_valid = true;
-				kp_trace_msg_append(ktrc, "%s", KUNK);
-				print_all_limbs_of_number(ktrc, "alf = 0x", ktrc->alpha);
-				kp_trace_msg_append(ktrc, "%s\n\r", KNRM);
 				break;
 
 			case DEBUG_ECC_IRAM_RANDOM_PHI01_ADDR:
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				kp_trace_msg_append(ktrc, "%sGetting phi0 & phi1%s\n\r", KUNK, KNRM);
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_PHI0_ADDR, ktrc->phi0);
+				kp_trace_step(ktrc, KP_TRACE_EVT_PHI01, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_PHI0, IPECC_LARGE_NB_PHI0_ADDR, ktrc->phi0);
 				ktrc->phi0_valid = true;
-				kp_trace_msg_append(ktrc, "%s", KUNK);
-				print_all_limbs_of_number(ktrc, "phi0 = 0x", ktrc->phi0);
-				kp_trace_msg_append(ktrc, "%s\n\r", KNRM);
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_PHI1_ADDR, ktrc->phi1);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_PHI1, IPECC_LARGE_NB_PHI1_ADDR, ktrc->phi1);
 				ktrc->phi1_valid = true;
-				kp_trace_msg_append(ktrc, "%s", KUNK);
-				print_all_limbs_of_number(ktrc, "phi1 = 0x", ktrc->phi1);
-				kp_trace_msg_append(ktrc, "%s\n\r", KNRM);
 				break;
 
 			case DEBUG_ECC_IRAM_RANDOM_LAMBDA_ADDR:
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				if (flags.jnbbit == 1) {
-					kp_trace_msg_append(ktrc, "%sGetting lambda (aka first Z-mask)%s\n\r", KUNK, KNRM);
-				} else {
-					kp_trace_msg_append(ktrc, "%sGetting periodic Z-remask%s\n\r", KUNK, KNRM);
-				}
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_LAMBDA_ADDR, ktrc->lambda);
+				/* (lambda, aka first Z-mask, if jnbbit == 1, periodic Z-remask otherwise) */
+				kp_trace_step(ktrc, KP_TRACE_EVT_LAMBDA, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_LAMBDA, IPECC_LARGE_NB_LAMBDA_ADDR, ktrc->lambda);
 				ktrc->lambda_valid = true;
-				kp_trace_msg_append(ktrc, "%s", KUNK);
-				if (flags.jnbbit == 1) {
-					print_all_limbs_of_number(ktrc, "lambda = 0x", ktrc->lambda);
-				} else {
-					print_all_limbs_of_number(ktrc, "Z-remask = 0x", ktrc->lambda);
-				}
-				kp_trace_msg_append(ktrc, "%s\n\r", KNRM);
 				break;
 
 			case DEBUG_ECC_IRAM_ZADDU_OP1_ADDR:
@@ -4480,14 +4892,8 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 					/* We're still in setup (so we're about to compute
 					 * (2P,P) -> (3P,P) using a call to ZADDU operator.
 					 */
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of setup, "
-							"R0 <- [2]P), R1 <- [P])\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_SETUP1, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
@@ -4495,24 +4901,14 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				/* 1st instruction of .itohL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_ITOH) {
+					get_exp_flags(&flags);
 					if (flags.jnbbit == 1) {
-						kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-						kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (second part of setup, "
-								"[3]P <- [2]P + P by ZADDU completed)\n");
-						/* read values of [XY]R[01] and flags r0z and r1z */
-						ip_read_and_print_xyr0(ktrc, &flags);
-						ip_read_and_print_xyr1(ktrc, &flags);
-						ip_read_and_print_zr01(ktrc);
+						/* Second part of setup, [3]P <- [2]P + P by ZADDU completed */
+						kp_trace_step(ktrc, KP_TRACE_EVT_SETUP2, dbgpc, dbgstate, &flags);
 					} else {
-						kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-						kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates after ZADDC of BIT %d "
-								"(kap%d = %d,  kap'%d = %d)\n",
-								flags.jnbbit, flags.jnbbit, flags.kap, flags.jnbbit, flags.kapp);
-						/* read values of [XY]R[01] and flags r0z and r1z */
-						ip_read_and_print_xyr0(ktrc, &flags);
-						ip_read_and_print_xyr1(ktrc, &flags);
-						ip_read_and_print_zr01(ktrc);
+						kp_trace_step(ktrc, KP_TRACE_EVT_AFTER_ZADDC, dbgpc, dbgstate, &flags);
 					}
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
@@ -4520,14 +4916,8 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				/* 1st instruction of .pre_zaddcL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_ZADDC) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates after ZADDU of BIT %d "
-							"(kap%d = %d,  kap'%d = %d)\n",
-							flags.jnbbit, flags.jnbbit, flags.kap, flags.jnbbit, flags.kapp);
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_AFTER_ZADDU, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
@@ -4535,56 +4925,19 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				/* 1st instruction of .subtractPL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_SUBTRACTP) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates after ZADDC of BIT %d "
-							"(kap%d = %d,  kap'%d = %d)\n",
-							flags.jnbbit, flags.jnbbit, flags.kap, flags.jnbbit, flags.kapp);
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_AFTER_ZADDC, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
 			case DEBUG_ECC_IRAM_ZADDC_OP1_ADDR: /* PC_ZADDC_FIRST */
-				/* 1st instruction of .zaddcL
-				 */
-				if (dbgstate == IPECC_DEBUG_STATE_SUBTRACTP) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of subtractP, "
-							"[k + 1 - (k mod 2)]P & P made Co-Z)\n");
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
-				}
-				break;
-
 			case DEBUG_ECC_IRAM_ZDBL_OP1_ADDR: /* PC_ZDBL_FIRST */
-				/* 1st instruction of .zdblL
-				 */
-				if (dbgstate == IPECC_DEBUG_STATE_SUBTRACTP) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of subtractP, "
-							"[k + 1 - (k mod 2)]P & P made Co-Z)\n");
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
-				}
-				break;
-
 			case DEBUG_ECC_IRAM_ZNEGC_OP1_ADDR: /* PC_ZNEGC_FIRST */
-				/* 1st instruction of .znegcL
+				/* 1st instruction of .zaddcL, .zdblL or .znegcL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_SUBTRACTP) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of subtractP, "
-							"[k + 1 - (k mod 2)]P & P made Co-Z)\n");
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_SUBP_COZ, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
@@ -4592,11 +4945,8 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				/* 1st instruction of .exitL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_EXIT) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R1 coordinates (second part of subtractP, "
-							"cond. sub. [k + 1 - (k mod 2)]P - P completed)\n");
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr1(ktrc, &flags);
+					kp_trace_step(ktrc, KP_TRACE_EVT_SUBP_DONE, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_xyr1(ktrc);
 				}
 				break;
 
@@ -4604,48 +4954,30 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				/* 1st instruction of .chkcurveL
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_EXIT) {
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R1 coordinates (after exit routine, "
-							"end of computation, result is in R1 if not null)\n");
-					/* read values of [XY]R[01] and flags r0z and r1z */
-					ip_read_and_print_xyr1(ktrc, &flags);
+					kp_trace_step(ktrc, KP_TRACE_EVT_EXIT, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_xyr1(ktrc);
 				}
 				break;
 
 			case DEBUG_ECC_IRAM_ZADD_VOID_ADDR:
 				/* Only instruction of .zadd_voidL
 				 */
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (in .zadd_voidL)\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-				ip_read_and_print_xyr0(ktrc, &flags);
-				ip_read_and_print_xyr1(ktrc, &flags);
-				ip_read_and_print_zr01(ktrc);
+				kp_trace_step(ktrc, KP_TRACE_EVT_ZADD_VOID, dbgpc, dbgstate, &flags);
+				ip_read_and_trace_r01(ktrc);
 				break;
 
 			case DEBUG_ECC_IRAM_ZDBL_NOT_ALWAYS_OP1_ADDR:
 				/* 1st instruction of .zdbl_not_alwaysL
 				 */
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (entrance of .zdbl_not_alwaysL)\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-				ip_read_and_print_xyr0(ktrc, &flags);
-				ip_read_and_print_xyr1(ktrc, &flags);
-				ip_read_and_print_zr01(ktrc);
+				kp_trace_step(ktrc, KP_TRACE_EVT_ZDBL_NA_IN, dbgpc, dbgstate, &flags);
+				ip_read_and_trace_r01(ktrc);
 				break;
 
 			case DEBUG_ECC_IRAM_ZDBL_NOT_ALWAYS_OPLAST_ADDR:
 				/* Last instruction of .zdbl_not_alwaysL
 				 */
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .zdbl_not_alwaysL)\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-				ip_read_and_print_xyr0(ktrc, &flags);
-				ip_read_and_print_xyr1(ktrc, &flags);
-				ip_read_and_print_zr01(ktrc);
+				kp_trace_step(ktrc, KP_TRACE_EVT_ZDBL_NA_OUT, dbgpc, dbgstate, &flags);
+				ip_read_and_trace_r01(ktrc);
 				break;
 
 			case DEBUG_ECC_IRAM_PRE_ZADDU_LAST_ADDR:
@@ -4653,13 +4985,8 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_ZADDU)
 				{
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .pre_zadduL)\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_PRE_ZADDU_OUT, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
@@ -4668,47 +4995,36 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 				 */
 				if (dbgstate == IPECC_DEBUG_STATE_ZADDU)
 				{
-					kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-					kp_trace_msg_append(ktrc, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .zadduL)\n");
-					/* Read values of [XY]R[01] and flags r0z and r1z.
-					 */
-					ip_read_and_print_xyr0(ktrc, &flags);
-					ip_read_and_print_xyr1(ktrc, &flags);
-					ip_read_and_print_zr01(ktrc);
+					kp_trace_step(ktrc, KP_TRACE_EVT_ZADDU_OUT, dbgpc, dbgstate, &flags);
+					ip_read_and_trace_r01(ktrc);
 				}
 				break;
 
 			case DEBUG_ECC_IRAM_RANDOM_KAPMSK_ADDR:
 				/* Read kap0msk & kap1msk */
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_KAP0MSK_ADDR, ktrc->kap0msk);
+				kp_trace_step(ktrc, KP_TRACE_EVT_KAPMSK, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_KAP0MSK, IPECC_LARGE_NB_KAP0MSK_ADDR, ktrc->kap0msk);
 				ktrc->kap0msk_valid = true;
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_KAP1MSK_ADDR, ktrc->kap1msk);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_KAP1MSK, IPECC_LARGE_NB_KAP1MSK_ADDR, ktrc->kap1msk);
 				ktrc->kap1msk_valid = true;
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				print_all_limbs_of_number(ktrc, "  kap0msk  = 0x", ktrc->kap0msk); kp_trace_msg_append(ktrc, "\n\r");
-				print_all_limbs_of_number(ktrc, "  kap1msk  = 0x", ktrc->kap1msk); kp_trace_msg_append(ktrc, "\n\r");
 				break;
 
 			case DEBUG_ECC_IRAM_RANDOM_KAPPMSK_ADDR:
 				/* Read kapP0msk & kapP1msk */
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_KAPP0MSK_ADDR, ktrc->kapP0msk);
+				kp_trace_step(ktrc, KP_TRACE_EVT_KAPPMSK, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_KAPP0MSK, IPECC_LARGE_NB_KAPP0MSK_ADDR, ktrc->kapP0msk);
 				ktrc->kapP0msk_valid = true;
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_KAPP1MSK_ADDR, ktrc->kapP1msk);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_KAPP1MSK, IPECC_LARGE_NB_KAPP1MSK_ADDR, ktrc->kapP1msk);
 				ktrc->kapP1msk_valid = true;
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				print_all_limbs_of_number(ktrc, "  kapP0msk  = 0x", ktrc->kapP0msk); kp_trace_msg_append(ktrc, "\n\r");
-				print_all_limbs_of_number(ktrc, "  kapP1msk  = 0x", ktrc->kapP1msk); kp_trace_msg_append(ktrc, "\n\r");
 				break;
 
 			case DEBUG_ECC_IRAM_RANDOM_PHIMSK_ADDR:
 				/* Read phi0msk & phi1msk */
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_PHI0MSK_ADDR, ktrc->phi0msk);
+				kp_trace_step(ktrc, KP_TRACE_EVT_PHIMSK, dbgpc, dbgstate, &flags);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_PHI0MSK, IPECC_LARGE_NB_PHI0MSK_ADDR, ktrc->phi0msk);
 				ktrc->phi0msk_valid = true;
-				ip_debug_read_all_limbs(IPECC_LARGE_NB_PHI1MSK_ADDR, ktrc->phi1msk);
+				kp_trace_read_lgnb(ktrc, KP_TRACE_NB_PHI1MSK, IPECC_LARGE_NB_PHI1MSK_ADDR, ktrc->phi1msk);
 				ktrc->phi1msk_valid = true;
-				kp_trace_msg_append(ktrc, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, dbgpc, KNRM, KYEL, str_ipecc_state(dbgstate), KNRM);
-				print_all_limbs_of_number(ktrc, "  phi0msk  = 0x", ktrc->phi0msk); kp_trace_msg_append(ktrc, "\n\r");
-				print_all_limbs_of_number(ktrc, "  phi1msk  = 0x", ktrc->phi1msk); kp_trace_msg_append(ktrc, "\n\r");
 				break;
 
 			default:
@@ -4725,9 +5041,10 @@ static int kp_debug_trace(kp_trace_info_t* ktrc)
 
 	} while (1);
 
-	kp_trace_msg_append(ktrc, "%d debug steps for this [k]P computation.\n", ktrc->nb_steps);
+	kp_trace_put32(kp_trace_rec + KP_TRACE_REC_HDR_SZ, ktrc->nb_steps);
+	kp_trace_emit(ktrc, KP_TRACE_REC_END, 0, 4);
 
-	kp_trace_msg_append(ktrc, "Removing breakpoint & resuming.\n\r");
+	kp_trace_msg(ktrc, KP_TRACE_MSG_RESUME);
 	IPECC_REMOVE_BREAKPOINT(0);
 	IPECC_RESUME();
 
@@ -5214,45 +5531,189 @@ err:
 	return -1;
 }
 
-#if 0
-/* Function to get the random output of the RAW FIFO */
-static inline int ip_ecc_get_random(uint8_t *out, uint32_t out_sz)
+/* Nb of random words that can be read from R_RANDOM without waiting:
+ * the one the IP keeps ready, plus the ones it can gather from its FIFO
+ * of TRNG internal random numbers (each word being made of NBW of them).
+ */
+static inline uint32_t ip_ecc_get_random_avail(void)
 {
-	uint32_t read = 0, addr;
-	uint8_t bit;
+	uint32_t cnt, nbw;
 
-	/* Wait until the IP is not busy */
-	IPECC_BUSY_WAIT();
+	cnt = IPECC_GET_RANDOM_CNT();
+	nbw = (cnt >> IPECC_R_RANDOM_CNT_NBW_POS) & IPECC_R_RANDOM_CNT_NBW_MSK;
+	if(nbw == 0){
+		return 0;
+	}
+
+	return ((cnt & IPECC_R_RANDOM_CNT_RDY) ? 1 : 0)
+		+ (((cnt >> IPECC_R_RANDOM_CNT_IRN_POS) & IPECC_R_RANDOM_CNT_IRN_MSK) / nbw);
+}
+
+/* Max nb of consecutive reads of R_RANDOM_CNT showing no random word
+ * available before ip_ecc_get_random() gives up (quite arbitrary, this
+ * is only meant to catch a starved or broken TRNG).
+ */
+#define IPECC_RANDOM_WATCHDOG  0x1000000U
+
+/* Continuous health test on the words read from R_RANDOM: a word with
+ * all bits equal, or equal to the previous one, is taken as the sign of
+ * a stuck or failing source (for a healthy one, the odds of a false
+ * alarm are about 2^-31 per 32-bit word).
+ */
+static inline int ip_ecc_random_health_ok(uint64_t w, uint64_t prev, uint32_t first)
+{
+	uint64_t ones = (sizeof(ip_ecc_word) == 8) ? 0xffffffffffffffffULL : 0xffffffffULL;
 
-	/* Read in a loop the asked size */
-	while(read != (8 * out_sz)){
-		uint32_t i;
-		/* Wait until our FIFO is full */
-		IPECC_TRNG_RAW_FIFO_FULL_BUSY_WAIT();
-		/* Read all our data */
-		addr = 0;
-		for(i = 0; i < IPECC_GET_TRNG_RAW_SZ(); i++){
-			IPECC_TRNG_READ_FIFO_RAW(addr, &bit);
-			if((read % 8) == 0){
-				out[(read / 8)] = 0;
+	if((w == 0) || (w == ones)){
+		return 0;
+	}
+	if((!first) && (w == prev)){
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Function to get random bytes from the TRNG (internal random numbers,
+ * one word of the AXI data width per read of R_RANDOM).
+ *
+ * Words are read in bursts of the size the IP reports as available, so
+ * the throughput is the one of the TRNG. Bytes of the last word which
+ * are not needed are discarded: no random material is kept in the
+ * driver from one call to the next.
+ *
+ * An error is returned if no random word becomes available for
+ * IPECC_RANDOM_WATCHDOG polls in a row, or if a word fails the health
+ * test of ip_ecc_random_health_ok() (the bytes already written to 'out'
+ * are then wiped).
+ */
+static inline int ip_ecc_get_random(uint8_t *out, uint32_t out_sz)
+{
+	uint32_t read = 0, avail, watchdog = 0, i, first = 1;
+	uint64_t w = 0, prev = 0;
+
+	while(read < out_sz){
+		avail = ip_ecc_get_random_avail();
+		if(avail){
+			watchdog = 0;
+		}
+		else if(++watchdog == IPECC_RANDOM_WATCHDOG){
+			log_print("In ip_ecc_get_random(): Error, no random available from the TRNG\n\r");
+			goto err;
+		}
+		while((avail) && (read < out_sz)){
+			w = (uint64_t)IPECC_GET_RANDOM();
+			if(!ip_ecc_random_health_ok(w, prev, first)){
+				log_print("In ip_ecc_get_random(): Error, TRNG failed the health test\n\r");
+				goto err;
 			}
-			out[(read / 8)] |= (bit << (read % 8));
-			addr++;
-			read++;
-			if(read == (8 * out_sz)){
-				break;
+			first = 0;
+			prev = w;
+			for(i = 0; (i < sizeof(ip_ecc_word)) && (read < out_sz); i++){
+				out[read++] = (uint8_t)((w >> (8 * i)) & 0xff);
 			}
+			avail--;
 		}
 	}
+	w = prev = 0;
+
+	/* Check for error */
+	if(ip_ecc_check_error(NULL)){
+		goto err;
+	}
 
 	return 0;
 err:
+	w = prev = 0;
+	for(i = 0; i < read; i++){
+		out[i] = 0;
+	}
 	return -1;
 }
-#endif
 
 static volatile uint8_t hw_driver_setup_state = 0;
 
+/* Copy of the curve parameters currently loaded in the IP, so that a call
+ * to hw_driver_set_curve() with the very same parameters (and sizes) can
+ * be turned into a no-op, sparing the transfers and the computation of the
+ * Montgomery constants by the IP. An exact copy rather than a hash is kept
+ * so that a collision can never leave the IP with another curve than the
+ * one asked for. Parameters larger than IPECC_CURVE_CACHE_MAX_SZ bytes are
+ * simply never cached.
+ */
+#define IPECC_CURVE_CACHE_MAX_SZ  1024
+
+typedef struct {
+	bool valid;
+	uint32_t a_sz;
+	uint32_t b_sz;
+	uint32_t p_sz;
+	uint32_t q_sz;
+	uint8_t a[IPECC_CURVE_CACHE_MAX_SZ];
+	uint8_t b[IPECC_CURVE_CACHE_MAX_SZ];
+	uint8_t p[IPECC_CURVE_CACHE_MAX_SZ];
+	uint8_t q[IPECC_CURVE_CACHE_MAX_SZ];
+} ip_ecc_curve_cache_t;
+
+static ip_ecc_curve_cache_t ip_ecc_curve_cache = { .valid = false };
+static uint32_t ip_ecc_curve_nb_loaded = 0;
+static uint32_t ip_ecc_curve_nb_skipped = 0;
+
+static inline void ip_ecc_curve_cache_invalidate(void)
+{
+	ip_ecc_curve_cache.valid = false;
+}
+
+/* Is the value of 'nn' in the IP still the one set along with a curve
+ * whose p & q are p_sz & q_sz bytes long? (without support for dynamic
+ * 'nn', the IP always keeps its maximum, see ip_ecc_set_nn_bit_size())
+ */
+static inline bool ip_ecc_curve_cache_nn_ok(uint32_t p_sz, uint32_t q_sz)
+{
+	if(!IPECC_IS_DYNAMIC_NN_SUPPORTED()){
+		return true;
+	}
+	return (ip_ecc_get_nn_bit_size() == (8 * ((p_sz > q_sz) ? p_sz : q_sz)));
+}
+
+/* Is the curve (a, b, p, q) the one currently loaded in the IP? */
+static inline bool ip_ecc_curve_cache_hit(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint32_t b_sz,
+					 const uint8_t *p, uint32_t p_sz, const uint8_t *q, uint32_t q_sz)
+{
+	ip_ecc_curve_cache_t *c = &ip_ecc_curve_cache;
+
+	if((!c->valid) || (c->a_sz != a_sz) || (c->b_sz != b_sz) || (c->p_sz != p_sz) || (c->q_sz != q_sz)){
+		return false;
+	}
+	/* Value of 'nn' in the IP must also still be the one set along with the curve */
+	if(!ip_ecc_curve_cache_nn_ok(p_sz, q_sz)){
+		return false;
+	}
+	return (memcmp(c->p, p, p_sz) == 0) && (memcmp(c->a, a, a_sz) == 0)
+		&& (memcmp(c->b, b, b_sz) == 0) && (memcmp(c->q, q, q_sz) == 0);
+}
+
+static inline void ip_ecc_curve_cache_set(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint32_t b_sz,
+					  const uint8_t *p, uint32_t p_sz, const uint8_t *q, uint32_t q_sz)
+{
+	ip_ecc_curve_cache_t *c = &ip_ecc_curve_cache;
+
+	if((a_sz > IPECC_CURVE_CACHE_MAX_SZ) || (b_sz > IPECC_CURVE_CACHE_MAX_SZ)
+			|| (p_sz > IPECC_CURVE_CACHE_MAX_SZ) || (q_sz > IPECC_CURVE_CACHE_MAX_SZ)){
+		c->valid = false;
+		return;
+	}
+	memcpy(c->a, a, a_sz);
+	memcpy(c->b, b, b_sz);
+	memcpy(c->p, p, p_sz);
+	memcpy(c->q, q, q_sz);
+	c->a_sz = a_sz;
+	c->b_sz = b_sz;
+	c->p_sz = p_sz;
+	c->q_sz = q_sz;
+	c->valid = true;
+}
+
 static inline int driver_setup(void)
 {
 	bool hw_unsecure;
@@ -5264,6 +5725,7 @@ static inline int driver_setup(void)
 		}
 		/* Reset the IP for a clean state */
 		IPECC_SOFT_RESET();
+		ip_ecc_curve_cache_invalidate();
 
 		/* Enable TRNG post-processing
 		 *
@@ -5304,6 +5766,7 @@ int hw_driver_reset(void)
 {
 	/* Reset the IP for a clean state */
 	IPECC_SOFT_RESET();
+	ip_ecc_curve_cache_invalidate();
 
 	return 0;
 }
@@ -5363,6 +5826,26 @@ err:
 	return -1;
 }
 
+/* Get 'out_sz' random bytes from the TRNG of the IP
+ * (e.g to be used as ECDSA nonces).
+ *
+ * These are the raw bits of the entropy source (ecc_trng_pp only
+ * reformats them), checked by the health test & watchdog of
+ * ip_ecc_get_random().
+ */
+int hw_driver_get_random(uint8_t *out, uint32_t out_sz)
+{
+	if(driver_setup()){
+		goto err;
+	}
+	if(ip_ecc_get_random(out, out_sz)){
+		goto err;
+	}
+	return 0;
+err:
+	return -1;
+}
+
 /* To halt the IP - This freezes execution of microcode
  *
  * (only allowed in HW unsecure mode, otherwise an error
@@ -5667,6 +6150,9 @@ int hw_driver_patch_one_opcode_DBG(uint32_t address, uint32_t opcode_msb, uint32
 		goto err;
 	}
 
+	/* The microcode patched may overwrite the curve parameters */
+	ip_ecc_curve_cache_invalidate();
+
 	/* call to low-level routine */
 	ip_ecc_patch_one_opcode(address, opcode_msb, opcode_lsb, opsz);
 
@@ -5691,6 +6177,9 @@ int hw_driver_patch_microcode_DBG(uint32_t* buf, uint32_t nbops, uint32_t opsz)
 		goto err;
 	}
 
+	/* The microcode patched may overwrite the curve parameters */
+	ip_ecc_curve_cache_invalidate();
+
 	/* call to low-level routine */
 	if (ip_ecc_patch_microcode(buf, nbops, opsz)) {
 		goto err;
@@ -6034,6 +6523,9 @@ int hw_driver_write_word_in_lgnbmem_DBG(uint32_t addr, uint32_t limb)
 		goto err;
 	}
 
+	/* The large nb written may be one of the curve parameters */
+	ip_ecc_curve_cache_invalidate();
+
 	/* call to low-level routine */
 	if (ip_ecc_write_word_in_lgnbmem(addr, limb)){
 		goto err;
@@ -6092,6 +6584,9 @@ int hw_driver_write_limb_DBG(int32_t i, uint32_t j, uint32_t limb)
 		goto err;
 	}
 
+	/* The large nb written may be one of the curve parameters */
+	ip_ecc_curve_cache_invalidate();
+
 	/* call to low-level routine */
 	if (ip_ecc_write_limb(i, j, limb)){
 		goto err;
@@ -6155,6 +6650,9 @@ int hw_driver_write_largenb_DBG(uint32_t i, uint32_t* limbs)
 		goto err;
 	}
 
+	/* The large nb written may be one of the curve parameters */
+	ip_ecc_curve_cache_invalidate();
+
 	/* call to low-level routine */
 	if (ip_ecc_write_largenb(i, limbs)){
 		goto err;
@@ -7015,9 +7513,9 @@ err:
 }
 
 
-/* To get all the TRNG diagnostic infos in one API call
+/* Clear the microcode execution trace & start recording
  */
-int hw_driver_get_trng_diagnostics_DBG(trng_diagcnt_t* tdg)
+int hw_driver_trace_start_DBG(void)
 {
 	if(driver_setup()){
 		goto err;
@@ -7029,25 +7527,151 @@ int hw_driver_get_trng_diagnostics_DBG(trng_diagcnt_t* tdg)
 		goto err;
 	}
 
-	/* Call to low level equivalent function */
-	if (ip_ecc_get_trng_diagnostics(tdg)){
+	if (IPECC_DBG_TRACE_STATUS_DEPTH(IPECC_DBG_TRACE_GET_STATUS()) == 0) {
+		log_print("In hw_driver_trace_start_DBG(): IP has no trace RAM\n\r");
 		goto err;
 	}
 
+	IPECC_DBG_TRACE_CTRL(1, 1, 0);
+
 	return 0;
 err:
 	return -1;
 }
 
-int hw_driver_attack_enable_nnrndsf(void)
+/* Stop recording the microcode execution trace (the entries
+ * already recorded are kept)
+ */
+int hw_driver_trace_stop_DBG(void)
 {
 	if(driver_setup()){
 		goto err;
 	}
-	if (ip_ecc_attack_enable_nnrndsf()){
+
+	/* Test HW unsecure capability */
+	if (IPECC_IS_HW_SECURE())
+	{
 		goto err;
 	}
-	return 0;
+
+	IPECC_DBG_TRACE_CTRL(0, 0, 0);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Get the state of the microcode execution trace
+ */
+int hw_driver_trace_status_DBG(uint32_t* nb, uint32_t* depth, bool* ovf)
+{
+	uint32_t sts;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	/* Test HW unsecure capability */
+	if (IPECC_IS_HW_SECURE())
+	{
+		goto err;
+	}
+
+	sts = IPECC_DBG_TRACE_GET_STATUS();
+	*nb = IPECC_DBG_TRACE_STATUS_CNT(sts);
+	*depth = IPECC_DBG_TRACE_STATUS_DEPTH(sts);
+	*ovf = (sts & IPECC_R_DBG_TRACE_STS_OVF) ? true : false;
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Read back (from the first one) at most 'max' entries of the microcode
+ * execution trace into 'buf', the nb of entries actually read being
+ * returned in 'nb'.
+ *
+ * The 16-bit time-stamp of entries recorded by the IP is unwrapped here
+ * into a nb of cycles elapsed since the first entry (this assumes no two
+ * consecutive entries are more than 65535 cycles apart, which holds as
+ * no microcode instruction lasts that long).
+ */
+int hw_driver_trace_drain_DBG(hw_driver_trace_entry_t* buf, uint32_t max, uint32_t* nb)
+{
+	uint32_t sts, i, n, e;
+	uint16_t t, tprev = 0;
+	uint32_t cycle = 0;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	/* Test HW unsecure capability */
+	if (IPECC_IS_HW_SECURE())
+	{
+		goto err;
+	}
+
+	sts = IPECC_DBG_TRACE_GET_STATUS();
+	n = IPECC_DBG_TRACE_STATUS_CNT(sts);
+	if (n > max) {
+		n = max;
+	}
+	/* Rewind the read pointer (recording state is left unchanged) */
+	IPECC_DBG_TRACE_CTRL(sts & IPECC_R_DBG_TRACE_STS_EN, 0, 1);
+
+	for (i = 0; i < n; i++) {
+		e = IPECC_DBG_TRACE_GET_DATA();
+		t = (uint16_t)((e >> IPECC_DBG_TRACE_TIME_POS) & IPECC_DBG_TRACE_TIME_MSK);
+		if (i) {
+			cycle += (uint16_t)(t - tprev);
+		}
+		tprev = t;
+		buf[i].pc = (uint16_t)((e >> IPECC_DBG_TRACE_PC_POS) & IPECC_DBG_TRACE_PC_MSK);
+		buf[i].cls = (uint8_t)((e >> IPECC_DBG_TRACE_CLASS_POS) & IPECC_DBG_TRACE_CLASS_MSK);
+		buf[i].taken = (e & IPECC_DBG_TRACE_TAKEN) ? true : false;
+		buf[i].cycle = cycle;
+	}
+	*nb = n;
+
+	return 0;
+err:
+	return -1;
+}
+
+/* To get all the TRNG diagnostic infos in one API call
+ */
+int hw_driver_get_trng_diagnostics_DBG(trng_diagcnt_t* tdg)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	/* Test HW unsecure capability */
+	if (IPECC_IS_HW_SECURE())
+	{
+		goto err;
+	}
+
+	/* Call to low level equivalent function */
+	if (ip_ecc_get_trng_diagnostics(tdg)){
+		goto err;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+int hw_driver_attack_enable_nnrndsf(void)
+{
+	if(driver_setup()){
+		goto err;
+	}
+	if (ip_ecc_attack_enable_nnrndsf()){
+		goto err;
+	}
+	return 0;
 err:
 	return -1;
 }
@@ -7102,6 +7726,11 @@ err:
  * disengageable by software. In this situation, since every scalar
  * multiplication will be run by the IP with active blinding, 'q'
  * and 'q_sz' arguments should be rigorously set.
+ *
+ * Note: the call is a no-op if the IP already holds the very same curve
+ * (same values and sizes of the four parameters) from the last call, in
+ * which case only the value of 'nn' in the IP is read back. Calling
+ * hw_driver_reset() forces the next call to reload the curve.
  */
 int hw_driver_set_curve(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint32_t b_sz,
        		        const uint8_t *p, uint32_t p_sz, const uint8_t *q, uint32_t q_sz)
@@ -7109,6 +7738,14 @@ int hw_driver_set_curve(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint3
 	if(driver_setup()){
 		goto err;
 	}
+	/* Nothing to do if the IP already holds this very curve */
+	if(ip_ecc_curve_cache_hit(a, a_sz, b, b_sz, p, p_sz, q, q_sz)){
+		ip_ecc_curve_nb_skipped++;
+		return 0;
+	}
+	/* (until all parameters are written, the IP holds none of the curves) */
+	ip_ecc_curve_cache_invalidate();
+
 	/* We set the dynamic NN size value to be the max
 	 * of P and Q size
 	 */
@@ -7136,12 +7773,26 @@ int hw_driver_set_curve(const uint8_t *a, uint32_t a_sz, const uint8_t *b, uint3
 	if(ip_ecc_write_bignum(q, q_sz, EC_HW_REG_Q)){
 		goto err;
 	}
+	ip_ecc_curve_cache_set(a, a_sz, b, b_sz, p, p_sz, q, q_sz);
+	ip_ecc_curve_nb_loaded++;
 
 	return 0;
 err:
 	return -1;
 }
 
+/* Nb of calls to hw_driver_set_curve() which actually loaded the curve
+ * in the IP, and nb of those which were skipped because the IP already
+ * held the same curve.
+ */
+int hw_driver_get_curve_stats(uint32_t* nb_loaded, uint32_t* nb_skipped)
+{
+	(*nb_loaded) = ip_ecc_curve_nb_loaded;
+	(*nb_skipped) = ip_ecc_curve_nb_skipped;
+
+	return 0;
+}
+
 /* Activate the blinding for scalar multiplication.
  *
  * Argument 'blinding_size' must be given in bits, and must be
@@ -7760,6 +8411,42 @@ err:
 	return -1;
 }
 
+/* Return the effective bit length of a big-endian large number
+ * (0 if it is null).
+ *
+ * This is NOT constant time, hence it must only be used on
+ * public data.
+ */
+static inline uint32_t ip_ecc_bit_len(const uint8_t *a, uint32_t a_sz)
+{
+	uint32_t i, nbbits;
+	uint8_t msb;
+
+	for(i = 0; (i < a_sz) && (a[i] == 0); i++){};
+	if(i == a_sz){
+		return 0;
+	}
+	nbbits = 8 * (a_sz - i);
+	for(msb = a[i]; !(msb & 0x80); msb <<= 1){
+		nbbits--;
+	}
+
+	return nbbits;
+}
+
+/* Set the small scalar size of the IP to the bit length of the
+ * public scalar 'k' (the IP requires it to be >= 3). Nothing
+ * is done if 'k' is not shorter than 'nn'.
+ */
+static inline void ip_ecc_set_public_scalar_size(const uint8_t *k, uint32_t k_sz)
+{
+	uint32_t k_bits = ip_ecc_bit_len(k, k_sz);
+
+	if(k_bits < ip_ecc_get_nn_bit_size()){
+		IPECC_SET_SMALL_SCALAR_SIZE((k_bits < 3) ? 3 : k_bits);
+	}
+}
+
 /* Return (out_x, out_y) = scalar * (x, y), i.e perform the scalar 
  * multiplication of the input point by the input scalar.
  *
@@ -7773,6 +8460,25 @@ int hw_driver_mul(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_
                   const uint8_t *scalar, uint32_t scalar_sz,
                   uint8_t *out_x, uint32_t *out_x_sz, uint8_t *out_y, uint32_t *out_y_sz,
 									uint32_t* kp_time, uint32_t* zmask, kp_trace_info_t* ktrc)
+{
+	return hw_driver_mul_ext(x, x_sz, y, y_sz, scalar, scalar_sz, out_x, out_x_sz,
+			out_y, out_y_sz, 0, kp_time, zmask, ktrc);
+}
+
+/* Same as hw_driver_mul() with options given by argument 'flags'
+ * (HW_DRIVER_MUL_* in <hw_accelerator_driver.h>).
+ *
+ * With HW_DRIVER_MUL_PUBLIC_SCALAR the effective bit length of the
+ * scalar is derived by the driver (in non constant time) and set as
+ * the small scalar size of the IP along with the upload of the
+ * operands, so that the computation only spends the iterations it
+ * needs (see hw_driver_set_small_scalar_size()). This is left to
+ * the IP nominal size when the scalar is not shorter than 'nn'.
+ */
+int hw_driver_mul_ext(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+                  const uint8_t *scalar, uint32_t scalar_sz,
+                  uint8_t *out_x, uint32_t *out_x_sz, uint8_t *out_y, uint32_t *out_y_sz,
+                  uint32_t flags, uint32_t* kp_time, uint32_t* zmask, kp_trace_info_t* ktrc)
 {
 	int inf_r0, inf_r1;
 	uint32_t nn_sz;
@@ -7783,7 +8489,7 @@ int hw_driver_mul(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_
 	uint8_t token[4096] = {0, }; /* Heck, a whole page? Yes indeed. */
 
 	if(driver_setup()){
-		log_print("In hw_driver_mul(): Error in driver_setup()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in driver_setup()\n\r");
 		goto err;
 	}
 
@@ -7795,82 +8501,87 @@ int hw_driver_mul(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_
 	 * allocated to the token on the stack.
 	 */
 	if(ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size()) > 4096){
-		log_print("In hw_driver_mul(): Error in ip_ecc_nn_bytes_from_bits_sz()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_nn_bytes_from_bits_sz()\n\r");
 		goto err;
 	}
 
 	/* Preserve our inf flags in a constant time fashion */
 	if(ip_ecc_get_r0_inf(&inf_r0)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_get_r0_inf()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_get_r0_inf()\n\r");
 		goto err;
 	}
 	if(ip_ecc_get_r1_inf(&inf_r1)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_get_r1_inf()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_get_r1_inf()\n\r");
 		goto err;
 	}
 
 	/* Get the random one-shot token */
 	if (ip_ecc_get_token(token, nn_sz)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_get_token()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_get_token()\n\r");
 		goto err;
 	}
 
 	/* Write our scalar register with the scalar k */
 	if(ip_ecc_write_bignum(scalar, scalar_sz, EC_HW_REG_SCALAR)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_write_bignum()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_write_bignum()\n\r");
 		goto err;
 	}
+	/* For a public scalar, set the small scalar size in the same
+	 * sequence of register writes */
+	if(flags & HW_DRIVER_MUL_PUBLIC_SCALAR){
+		ip_ecc_set_public_scalar_size(scalar, scalar_sz);
+	}
 	/* Write our R1 register with the point to be multiplied */
 	if(ip_ecc_write_bignum(x, x_sz, EC_HW_REG_R1_X)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_write_bignum()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_write_bignum()\n\r");
 		goto err;
 	}
 	if(ip_ecc_write_bignum(y, y_sz, EC_HW_REG_R1_Y)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_write_bignum()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_write_bignum()\n\r");
 		goto err;
 	}
 
 	/* Restore our inf flags in a constant time fashion */
 	if(ip_ecc_set_r0_inf(inf_r0)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_set_r0_inf()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_set_r0_inf()\n\r");
 		goto err;
 	}
 	if(ip_ecc_set_r1_inf(inf_r1)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_set_r1_inf()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_set_r1_inf()\n\r");
 		goto err;
 	}
 
 	/* Execute our [k]P command */
 	if(ip_ecc_exec_command(PT_KP, NULL, kp_time, zmask, ktrc)) {
-		log_print("In hw_driver_mul(): Error in ip_ecc_exec_command()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_exec_command()\n\r");
 		goto err;
 	}
 
 	/* Get back the result from R1 */
 	if(((*out_x_sz) < nn_sz) || ((*out_y_sz) < nn_sz)){
-		log_print("In hw_driver_mul(): *out_x_sz = %d\n\r", *out_x_sz);
-		log_print("In hw_driver_mul(): *out_y_sz = %d\n\r", *out_y_sz);
-		log_print("In hw_driver_mul(): nn_sz = %d\n\r", nn_sz);
-		log_print("In hw_driver_mul(): Error in sizes' comparison\n\r");
+		log_print("In hw_driver_mul_ext(): *out_x_sz = %d\n\r", *out_x_sz);
+		log_print("In hw_driver_mul_ext(): *out_y_sz = %d\n\r", *out_y_sz);
+		log_print("In hw_driver_mul_ext(): nn_sz = %d\n\r", nn_sz);
+		log_print("In hw_driver_mul_ext(): Error in sizes' comparison\n\r");
 		goto err;
 	}
 	(*out_x_sz) = (*out_y_sz) = nn_sz;
 	if(ip_ecc_read_bignum(out_x, (*out_x_sz), EC_HW_REG_R1_X)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_read_bignum()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_read_bignum()\n\r");
 		goto err;
 	}
 	if(ip_ecc_read_bignum(out_y, (*out_y_sz), EC_HW_REG_R1_Y)){
-		log_print("In hw_driver_mul(): Error in ip_ecc_read_bignum()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_read_bignum()\n\r");
 		goto err;
 	}
 
 	/* Unmask the [k]P result coordinates with the one-shot token */
 	if (ip_ecc_unmask_with_token(out_x, (*out_x_sz), token, nn_sz, out_x, out_x_sz)) {
-		log_print("In hw_driver_mul(): Error in ip_ecc_unmask_with_token()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_unmask_with_token()\n\r");
 		goto err;
 	}
 	if (ip_ecc_unmask_with_token(out_y, (*out_y_sz), token, nn_sz, out_y, out_y_sz)) {
-		log_print("In hw_driver_mul(): Error in ip_ecc_unmask_with_token()\n\r");
+		log_print("In hw_driver_mul_ext(): Error in ip_ecc_unmask_with_token()\n\r");
 		goto err;
 	};
 
@@ -7882,31 +8593,1106 @@ err:
 	return -1;
 }
 
-/* Set the small scalar size in the hardware.
- *
- * The 'small scalar size' feature is provided by the IP in order
- * to provide a computation speed-up for really small scalar.
+/* Check if point (x, y) belongs to the subgroup of order q of the
+ * current curve, that is if [q](x, y) is the null point, in which
+ * case '*in_subgroup' is set to true.
  *
- * This is a "one shot" feature, meaning the 'nn' parameter is
- * still recorded by the IP and will become applicable again
- * as soon as the scalar multiplication following the call to
- * function hw_driver_set_small_scalar_size() is done.
+ * The order q is the one given to the last call to hw_driver_set_curve()
+ * and is uploaded as the scalar by the driver itself. It being public,
+ * the computation is shortened to its bit length (with no blinding, see
+ * hw_driver_mul_ext()) and only the null flag of the result is read
+ * back, the coordinates are not. Point (x, y) can't be the null point
+ * (the null flags of R0 & R1 are cleared before the computation).
  *
- * Hence hw_driver_set_small_scalar_size() must be called
- * each time the feature is needed.
+ * All size arguments (*_sz) must be given in bytes.
+ */
+int hw_driver_check_order(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+			  bool* in_subgroup)
+{
+	ip_ecc_curve_cache_t *c = &ip_ecc_curve_cache;
+	int iszero;
+	uint32_t nn_sz, q_bits;
+	uint8_t token[4096] = {0, };
+
+	if(driver_setup()){
+		log_print("In hw_driver_check_order(): Error in driver_setup()\n\r");
+		goto err;
+	}
+
+	/* The driver must know the order of the curve loaded in the IP
+	 * (i.e it was set with hw_driver_set_curve() & 'nn' is unchanged).
+	 */
+	if((!c->valid) || (!ip_ecc_curve_cache_nn_ok(c->p_sz, c->q_sz))){
+		log_print("In hw_driver_check_order(): Error, order of the current curve is unknown\n\r");
+		goto err;
+	}
+
+	nn_sz = ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size());
+	if(nn_sz > sizeof(token)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_nn_bytes_from_bits_sz()\n\r");
+		goto err;
+	}
+
+	/* The IP won't start a [k]P computation unless the token was read */
+	if(ip_ecc_get_token(token, nn_sz)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_get_token()\n\r");
+		goto err;
+	}
+
+	/* Write our scalar register with q & set the small scalar size to
+	 * its bit length, even if q is not shorter than 'nn': a small scalar
+	 * size also has the IP skip the blinding of the scalar, which adds a
+	 * random multiple of q to it and hence would make the result random
+	 * for a point out of the subgroup.
+	 */
+	if(ip_ecc_write_bignum(c->q, c->q_sz, EC_HW_REG_SCALAR)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_write_bignum()\n\r");
+		goto err;
+	}
+	q_bits = ip_ecc_bit_len(c->q, c->q_sz);
+	/* Disabling the blinding here is only acceptable because q is public:
+	 * don't reuse this for a secret scalar, whose bit length & value
+	 * would then leak through the timing & power of the computation.
+	 */
+	IPECC_SET_SMALL_SCALAR_SIZE((q_bits < 3) ? 3 : q_bits);
+
+	/* Write our R1 register with the point to be checked */
+	if(ip_ecc_write_bignum(x, x_sz, EC_HW_REG_R1_X)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_write_bignum()\n\r");
+		goto err;
+	}
+	if(ip_ecc_write_bignum(y, y_sz, EC_HW_REG_R1_Y)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_write_bignum()\n\r");
+		goto err;
+	}
+
+	/* The point to be checked is never the null point: clear the
+	 * null flags, whatever a previous computation left in them
+	 * (e.g the null result of a previous check).
+	 */
+	if(ip_ecc_set_r0_inf(0)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_set_r0_inf()\n\r");
+		goto err;
+	}
+	if(ip_ecc_set_r1_inf(0)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_set_r1_inf()\n\r");
+		goto err;
+	}
+
+	/* Execute our [k]P command */
+	if(ip_ecc_exec_command(PT_KP, NULL, NULL, NULL, NULL)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_exec_command()\n\r");
+		goto err;
+	}
+
+	/* Only the null flag of the result is needed */
+	if(ip_ecc_get_r1_inf(&iszero)){
+		log_print("In hw_driver_check_order(): Error in ip_ecc_get_r1_inf()\n\r");
+		goto err;
+	}
+	(*in_subgroup) = (iszero) ? true : false;
+
+	/* Clear the token */
+	ip_ecc_clear_token(token, nn_sz);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* State of the [k]P pipeline built on the shadow operand slots
+ * (see hw_driver_mul_queue() & hw_driver_mul_collect() below).
+ */
+static uint8_t ip_ecc_pipe_token[4096]; /* token of the computation in flight */
+static uint32_t ip_ecc_pipe_nn_sz = 0;
+static uint32_t ip_ecc_pipe_inflight = 0;
+static uint32_t ip_ecc_pipe_queued = 0;
+
+/* Write a big number into its shadow slot in the IP.
  *
- * Obviously this feature only concerns the scalar multiplication.
- * */
-int hw_driver_set_small_scalar_size(uint32_t bit_sz)
+ * Same formatting as ip_ecc_write_bignum() but without waiting for the
+ * IP not to be busy, since shadow slots can be written while a [k]P
+ * computation is running (the IP will only check there is enough
+ * random to mask the scalar when actually starting the computation).
+ */
+static inline int ip_ecc_write_shadow_bignum(const uint8_t *a, uint32_t a_sz,
+		uint32_t addr, uint32_t scal)
+{
+	uint32_t nn_size, words_sent, bytes_idx, j;
+	uint8_t end;
+
+	ip_ecc_word w;
+
+	/* Get the current nb of words we need to send to the IP */
+	nn_size = ip_ecc_nn_words_from_bytes_sz(ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size()));
+
+	if(ip_ecc_nn_words_from_bytes_sz(a_sz) > nn_size){
+		/* We overflow, this is an error! */
+		goto err;
+	}
+
+	/* Select the shadow slot */
+	IPECC_SET_SHADOW_WRITE_ADDR(addr, scal);
+
+	/* Send our words beginning with the last */
+	words_sent = 0;
+	bytes_idx = ((a_sz >= 1) ? (a_sz - 1) : 0);
+	end = ((a_sz >= 1) ? 0 : 1);
+	while(words_sent < nn_size){
+		/* Format our words */
+		w = 0;
+		if(!end){
+			for(j = 0; j < sizeof(w); j++){
+				w |= (ip_ecc_word)(a[bytes_idx] << (8 * j));
+				if(bytes_idx == 0){
+					/* We have reached the end of the bytes */
+					end = 1;
+					break;
+				}
+				bytes_idx--;
+			}
+		}
+		IPECC_WRITE_DATA(w);
+		words_sent++;
+	}
+
+	/* Check for error */
+	if(ip_ecc_check_error(NULL)){
+		goto err;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Give up on the [k]P pipeline after an error: the token is wiped, and
+ * the IP is soft-reset so that it neither holds a result that will never
+ * be read nor a queued computation waiting for its token (the curve has
+ * then to be set again).
+ */
+static inline void ip_ecc_pipe_abort(void)
+{
+	ip_ecc_clear_token(ip_ecc_pipe_token, sizeof(ip_ecc_pipe_token));
+	ip_ecc_pipe_inflight = 0;
+	ip_ecc_pipe_queued = 0;
+	IPECC_SOFT_RESET();
+	ip_ecc_curve_cache_invalidate();
+}
+
+/* Get the token for the computation that is going to be started next
+ * and wait for the IP to have actually started it.
+ */
+static inline int ip_ecc_pipe_start(void)
+{
+	/* Get the random one-shot token */
+	if(ip_ecc_get_token(ip_ecc_pipe_token, ip_ecc_pipe_nn_sz)){
+		goto err;
+	}
+
+	/* Reading the token allows the IP to transfer the shadow operands
+	 * & to start the computation */
+	IPECC_KP_QUEUED_WAIT();
+
+	/* Check for error */
+	if(ip_ecc_check_error(NULL)){
+		goto err;
+	}
+
+	ip_ecc_pipe_inflight = 1;
+
+	return 0;
+err:
+	return -1;
+}
+
+/* To know if the IP was synthesized with shadow operand slots */
+int hw_driver_shadow_is_supported(bool* shadow)
 {
 	if(driver_setup()){
 		goto err;
 	}
 
-	/* NOTE: sanity check on this size should be performed by
-	 * the hardware (e.g. is this size exceeds the nn size, and
-	 * so on). So no need to sanity check anything here. */
-	IPECC_SET_SMALL_SCALAR_SIZE(bit_sz);
+	(*shadow) = IPECC_IS_SHADOW_SUPPORTED();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Queue a [k]P computation: (x, y) is the point to multiply
+ * by 'scalar'.
+ *
+ * If no computation is in flight, the queued one is started right away,
+ * otherwise it will be by hw_driver_mul_collect() (meanwhile the IP keeps
+ * computing, this is where the overlap comes from).
+ *
+ * All size arguments (*_sz) must be given in bytes.
+ */
+int hw_driver_mul_queue(const uint8_t *x, uint32_t x_sz, const uint8_t *y, uint32_t y_sz,
+			const uint8_t *scalar, uint32_t scalar_sz)
+{
+	if(driver_setup()){
+		log_print("In hw_driver_mul_queue(): Error in driver_setup()\n\r");
+		goto err;
+	}
+
+	if(!IPECC_IS_SHADOW_SUPPORTED()){
+		log_print("In hw_driver_mul_queue(): IP has no shadow operand slots\n\r");
+		goto err;
+	}
+
+	/* Only one computation can be queued behind the one in flight */
+	if(ip_ecc_pipe_queued){
+		log_print("In hw_driver_mul_queue(): Error, a [k]P computation is already queued\n\r");
+		goto err;
+	}
+
+	if(!ip_ecc_pipe_inflight){
+		/* Check that the current value of 'nn' does not exceed the size
+		 * allocated to the token.
+		 */
+		ip_ecc_pipe_nn_sz = ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size());
+		if(ip_ecc_pipe_nn_sz > sizeof(ip_ecc_pipe_token)){
+			log_print("In hw_driver_mul_queue(): Error in ip_ecc_nn_bytes_from_bits_sz()\n\r");
+			goto err;
+		}
+	}
+
+	/* Upload the operands into the shadow slots */
+	if(ip_ecc_write_shadow_bignum(scalar, scalar_sz, IPECC_BNUM_K, 1)){
+		log_print("In hw_driver_mul_queue(): Error in ip_ecc_write_shadow_bignum()\n\r");
+		goto err;
+	}
+	if(ip_ecc_write_shadow_bignum(x, x_sz, IPECC_BNUM_R1_X, 0)){
+		log_print("In hw_driver_mul_queue(): Error in ip_ecc_write_shadow_bignum()\n\r");
+		goto err;
+	}
+	if(ip_ecc_write_shadow_bignum(y, y_sz, IPECC_BNUM_R1_Y, 0)){
+		log_print("In hw_driver_mul_queue(): Error in ip_ecc_write_shadow_bignum()\n\r");
+		goto err;
+	}
+
+	/* Queue the [k]P computation */
+	IPECC_QUEUE_PT_KP();
+	if(ip_ecc_check_error(NULL)){
+		log_print("In hw_driver_mul_queue(): Error in ip_ecc_check_error()\n\r");
+		goto err;
+	}
+
+	if(ip_ecc_pipe_inflight){
+		ip_ecc_pipe_queued = 1;
+	}
+	else{
+		if(ip_ecc_pipe_start()){
+			log_print("In hw_driver_mul_queue(): Error in ip_ecc_pipe_start()\n\r");
+			goto err_abort;
+		}
+	}
+
+	return 0;
+err_abort:
+	ip_ecc_pipe_abort();
+err:
+	return -1;
+}
+
+/* Wait for the [k]P computation in flight to be over and get its
+ * result, then start the queued one (if any).
+ *
+ * Argument 'kp_time' has the same meaning as for hw_driver_mul().
+ */
+int hw_driver_mul_collect(uint8_t *out_x, uint32_t *out_x_sz, uint8_t *out_y, uint32_t *out_y_sz,
+			  uint32_t* kp_time)
+{
+	if(driver_setup()){
+		log_print("In hw_driver_mul_collect(): Error in driver_setup()\n\r");
+		goto err;
+	}
+
+	if(!ip_ecc_pipe_inflight){
+		log_print("In hw_driver_mul_collect(): Error, no [k]P computation in flight\n\r");
+		goto err;
+	}
+
+	/* Check the size of the output buffers before consuming the result
+	 * (the computation stays in flight, so the call can be made again) */
+	if(((*out_x_sz) < ip_ecc_pipe_nn_sz) || ((*out_y_sz) < ip_ecc_pipe_nn_sz)){
+		log_print("In hw_driver_mul_collect(): Error in sizes' comparison\n\r");
+		goto err;
+	}
+	ip_ecc_pipe_inflight = 0;
+
+	/* Wait until the IP is not busy */
+	IPECC_BUSY_WAIT();
+
+#ifndef KP_TRACE
+	if(kp_time){
+		if(ip_ecc_get_time(kp_time)){
+			log_print("In hw_driver_mul_collect(): Error in ip_ecc_get_time()\n\r");
+			goto err_abort;
+		}
+	}
+#else
+	(void)kp_time;
+#endif
+
+	/* Check for error */
+	if(ip_ecc_check_error(NULL)){
+		log_print("In hw_driver_mul_collect(): Error in ip_ecc_check_error()\n\r");
+		goto err_abort;
+	}
+
+	/* Get back the result from R1 (reading YR1 last allows the IP
+	 * to start the queued computation, if any) */
+	(*out_x_sz) = (*out_y_sz) = ip_ecc_pipe_nn_sz;
+	if(ip_ecc_read_bignum(out_x, (*out_x_sz), EC_HW_REG_R1_X)){
+		log_print("In hw_driver_mul_collect(): Error in ip_ecc_read_bignum()\n\r");
+		goto err_abort;
+	}
+	if(ip_ecc_read_bignum(out_y, (*out_y_sz), EC_HW_REG_R1_Y)){
+		log_print("In hw_driver_mul_collect(): Error in ip_ecc_read_bignum()\n\r");
+		goto err_abort;
+	}
+
+	/* Unmask the [k]P result coordinates with the one-shot token */
+	if(ip_ecc_unmask_with_token(out_x, (*out_x_sz), ip_ecc_pipe_token, ip_ecc_pipe_nn_sz,
+				out_x, out_x_sz)){
+		log_print("In hw_driver_mul_collect(): Error in ip_ecc_unmask_with_token()\n\r");
+		goto err_abort;
+	}
+	if(ip_ecc_unmask_with_token(out_y, (*out_y_sz), ip_ecc_pipe_token, ip_ecc_pipe_nn_sz,
+				out_y, out_y_sz)){
+		log_print("In hw_driver_mul_collect(): Error in ip_ecc_unmask_with_token()\n\r");
+		goto err_abort;
+	}
+
+	/* Clear the token */
+	ip_ecc_clear_token(ip_ecc_pipe_token, ip_ecc_pipe_nn_sz);
+
+	/* Start the queued computation */
+	if(ip_ecc_pipe_queued){
+		ip_ecc_pipe_queued = 0;
+		if(ip_ecc_pipe_start()){
+			log_print("In hw_driver_mul_collect(): Error in ip_ecc_pipe_start()\n\r");
+			goto err_abort;
+		}
+	}
+
+	return 0;
+err_abort:
+	/* Neither the result nor the queued computation can be trusted */
+	ip_ecc_pipe_abort();
+err:
+	return -1;
+}
+
+/* Sequence id of the next command pushed into the hardware command
+ * queue (the IP numbers commands the same way, from 0 after a flush).
+ */
+static uint32_t ip_ecc_cmdq_nextid = 0;
+
+/* To know if the IP was synthesized with a hardware command queue */
+int hw_driver_cmdq_is_supported(bool* cmdq)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	(*cmdq) = IPECC_IS_CMDQ_SUPPORTED();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Get the depth of the command queue, the nb of commands it holds
+ * (including the one being executed, if any) and the nb of completion
+ * records not yet popped. Any pointer may be NULL.
+ */
+int hw_driver_cmdq_status(uint32_t* depth, uint32_t* occupancy, uint32_t* nb_results)
+{
+	uint32_t st;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_CMDQ_SUPPORTED()){
+		log_print("In hw_driver_cmdq_status(): IP has no command queue\n\r");
+		goto err;
+	}
+
+	st = IPECC_CMDQ_GET_STATUS();
+	if(depth){
+		(*depth) = IPECC_CMDQ_STATUS_DEPTH(st);
+	}
+	if(occupancy){
+		(*occupancy) = IPECC_CMDQ_STATUS_OCC(st);
+	}
+	if(nb_results){
+		(*nb_results) = IPECC_CMDQ_STATUS_NBRES(st);
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Push a point operation into the hardware command queue.
+ *
+ * The command operates on the operands currently held by the IP (the
+ * same ones as the nominal API, e.g R0 & R1 for a point addition) which
+ * must have been written beforehand. For a [k]P command the token must
+ * have been read (hw_driver_mul() flow) before the command is executed.
+ *
+ * On success '*id' holds the sequence id of the command, which is
+ * reported back in its completion record (see hw_driver_cmdq_pop_result()).
+ * An error is returned if the queue is full.
+ */
+int hw_driver_cmdq_push(ip_ecc_command cmd, uint32_t* id)
+{
+	uint32_t cmdw, st;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_CMDQ_SUPPORTED()){
+		log_print("In hw_driver_cmdq_push(): IP has no command queue\n\r");
+		goto err;
+	}
+
+	switch(cmd){
+		case PT_KP:{
+			cmdw = IPECC_W_CTRL_PT_KP;
+			break;
+		}
+		case PT_ADD:{
+			cmdw = IPECC_W_CTRL_PT_ADD;
+			break;
+		}
+		case PT_DBL:{
+			cmdw = IPECC_W_CTRL_PT_DBL;
+			break;
+		}
+		case PT_CHK:{
+			cmdw = IPECC_W_CTRL_PT_CHK;
+			break;
+		}
+		case PT_NEG:{
+			cmdw = IPECC_W_CTRL_PT_NEG;
+			break;
+		}
+		case PT_EQU:{
+			cmdw = IPECC_W_CTRL_PT_EQU;
+			break;
+		}
+		case PT_OPP:{
+			cmdw = IPECC_W_CTRL_PT_OPP;
+			break;
+		}
+		default:{
+			goto err;
+		}
+	}
+
+	/* Check that there is room left in the queue */
+	st = IPECC_CMDQ_GET_STATUS();
+	if(IPECC_CMDQ_STATUS_OCC(st) >= IPECC_CMDQ_STATUS_DEPTH(st)){
+		log_print("In hw_driver_cmdq_push(): command queue is full\n\r");
+		goto err;
+	}
+
+	IPECC_CMDQ_PUSH(cmdw);
+
+	if(id){
+		(*id) = ip_ecc_cmdq_nextid;
+	}
+	ip_ecc_cmdq_nextid = (ip_ecc_cmdq_nextid + 1) & IPECC_R_CMDQ_RESULT_ID_MSK;
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Pop the oldest completion record of the hardware command queue.
+ *
+ * '*valid' is set to 0 if no command has completed since the last call,
+ * in which case '*id' and '*status' are left untouched. Otherwise '*status'
+ * is a combination of the HW_DRIVER_CMDQ_ST_* bits. A command ending with
+ * HW_DRIVER_CMDQ_ST_ERR halts the queue until hw_driver_cmdq_resume() or
+ * hw_driver_cmdq_flush() is called.
+ */
+int hw_driver_cmdq_pop_result(int* valid, uint32_t* id, uint32_t* status)
+{
+	uint32_t res;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_CMDQ_SUPPORTED()){
+		log_print("In hw_driver_cmdq_pop_result(): IP has no command queue\n\r");
+		goto err;
+	}
+
+	res = IPECC_CMDQ_POP_RESULT();
+	(*valid) = !!(res & IPECC_R_CMDQ_RESULT_VALID);
+	if(*valid){
+		(*id) = (res >> IPECC_R_CMDQ_RESULT_ID_POS) & IPECC_R_CMDQ_RESULT_ID_MSK;
+		(*status) = 0;
+		if(res & IPECC_R_CMDQ_RESULT_YES){
+			(*status) |= HW_DRIVER_CMDQ_ST_YES;
+		}
+		if(res & IPECC_R_CMDQ_RESULT_R1_NULL){
+			(*status) |= HW_DRIVER_CMDQ_ST_INF;
+		}
+		if(res & IPECC_R_CMDQ_RESULT_ERR){
+			(*status) |= HW_DRIVER_CMDQ_ST_ERR;
+		}
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Resume the dispatch of commands after one of them ended in error
+ * (the error bits of the IP should have been acknowledged first).
+ */
+int hw_driver_cmdq_resume(void)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_CMDQ_SUPPORTED()){
+		log_print("In hw_driver_cmdq_resume(): IP has no command queue\n\r");
+		goto err;
+	}
+
+	IPECC_CMDQ_RESUME();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Discard all pending commands & completion records (the command being
+ * executed, if any, runs to completion) and restart numbering from 0.
+ */
+int hw_driver_cmdq_flush(void)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_CMDQ_SUPPORTED()){
+		log_print("In hw_driver_cmdq_flush(): IP has no command queue\n\r");
+		goto err;
+	}
+
+	IPECC_CMDQ_FLUSH();
+	ip_ecc_cmdq_nextid = 0;
+
+	return 0;
+err:
+	return -1;
+}
+
+/* To know if the IP was synthesized with performance counters */
+int hw_driver_perf_is_supported(bool* perf)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	(*perf) = IPECC_IS_PERF_SUPPORTED();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Get a consistent snapshot of all performance counters */
+int hw_driver_get_perf_counters(hw_driver_perf_counters_t* perf)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_PERF_SUPPORTED()){
+		log_print("In hw_driver_get_perf_counters(): IP has no performance counters\n\r");
+		goto err;
+	}
+
+	/* The first selection freezes the copy of counters that the IP
+	 * exposes, the last one releases it.
+	 */
+	IPECC_PERF_SELECT(IPECC_PERF_KP, 1);
+	perf->kp = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_ADD, 1);
+	perf->pt_add = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_DBL, 1);
+	perf->pt_dbl = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_CHK, 1);
+	perf->pt_chk = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_NEG, 1);
+	perf->pt_neg = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_EQU, 1);
+	perf->pt_equ = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_PT_OPP, 1);
+	perf->pt_opp = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_TRNG_STALL, 1);
+	perf->trng_stall = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_MTY, 1);
+	perf->mty = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_AXI, 1);
+	perf->axi = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_MM_USED, 1);
+	perf->mm_used = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_MM_AVAIL, 1);
+	perf->mm_avail = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_CYCLES, 1);
+	perf->cycles = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_KP_SETUP, 1);
+	perf->kp_setup = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_KP_LADDER, 1);
+	perf->kp_ladder = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_KP_EXIT, 1);
+	perf->kp_exit = IPECC_PERF_GET();
+	IPECC_PERF_SELECT(IPECC_PERF_KP, 0);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Clear all performance counters */
+int hw_driver_clear_perf_counters(void)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	if(!IPECC_IS_PERF_SUPPORTED()){
+		log_print("In hw_driver_clear_perf_counters(): IP has no performance counters\n\r");
+		goto err;
+	}
+
+	IPECC_PERF_CLEAR();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Set the small scalar size in the hardware.
+ *
+ * The 'small scalar size' feature is provided by the IP in order
+ * to provide a computation speed-up for really small scalar.
+ *
+ * This is a "one shot" feature, meaning the 'nn' parameter is
+ * still recorded by the IP and will become applicable again
+ * as soon as the scalar multiplication following the call to
+ * function hw_driver_set_small_scalar_size() is done.
+ *
+ * Hence hw_driver_set_small_scalar_size() must be called
+ * each time the feature is needed.
+ *
+ * Obviously this feature only concerns the scalar multiplication.
+ * */
+int hw_driver_set_small_scalar_size(uint32_t bit_sz)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	/* NOTE: sanity check on this size should be performed by
+	 * the hardware (e.g. is this size exceeds the nn size, and
+	 * so on). So no need to sanity check anything here. */
+	IPECC_SET_SMALL_SCALAR_SIZE(bit_sz);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Nb of words of a large number slot in the blocks processed by the DMA
+ * engine (this is the nb of words transmitted to W_WRITE_DATA for
+ * the current value of 'nn').
+ */
+static inline uint32_t ip_ecc_dma_nbw(void)
+{
+	return ip_ecc_nn_words_from_bytes_sz(ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size()));
+}
+
+/* To know if the IP was synthesized with the descriptor-ring DMA engine */
+int hw_driver_dma_is_supported(bool* dma)
+{
+	if(driver_setup()){
+		goto err;
+	}
+	(*dma) = IPECC_IS_DMA_SUPPORTED();
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Size in bytes of a large number slot in the curve, input & output
+ * blocks referenced by DMA job descriptors.
+ */
+int hw_driver_dma_slot_size(uint32_t* slot_sz)
+{
+	if(driver_setup()){
+		goto err;
+	}
+	(*slot_sz) = ip_ecc_dma_nbw() * sizeof(ip_ecc_word);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Initialize the ring of descriptors and start the DMA engine.
+ *
+ * 'ring' is the virtual address of the ring (which must be large
+ * enough to hold 2^log2sz descriptors of IPECC_DMA_DESC_WORDS words)
+ * and 'ring_bus' its address as seen by the IP master port.
+ *
+ * Producer & consumer indexes are 12-bit wide in the hardware, hence
+ * the ring can't hold more than 2^11 descriptors.
+ *
+ * As the size of slots is set here from the current value of 'nn',
+ * the DMA engine must be stopped and restarted if 'nn' is to change.
+ */
+int hw_driver_dma_start(hw_driver_dma_ring_t* r, void* ring, uint32_t ring_bus, uint32_t log2sz,
+		        bool irq)
+{
+	uint32_t i;
+	ip_ecc_word *d;
+
+	if(driver_setup()){
+		goto err;
+	}
+	if(!IPECC_IS_DMA_SUPPORTED()){
+		log_print("In hw_driver_dma_start(): DMA engine not supported by the IP\n\r");
+		goto err;
+	}
+	if((r == NULL) || (ring == NULL) || (log2sz > 11)){
+		goto err;
+	}
+
+	/* Make sure the engine is idle before resetting its indexes */
+	IPECC_DMA_DISABLE();
+	IPECC_DMA_RUNNING_WAIT();
+	IPECC_DMA_RESET();
+
+	/* Wait until the IP is not busy */
+	IPECC_BUSY_WAIT();
+
+	d = (ip_ecc_word*)ring;
+	for(i = 0; i < ((0x1UL << log2sz) * IPECC_DMA_DESC_WORDS); i++){
+		d[i] = 0;
+	}
+	r->ring = ring;
+	r->ring_bus = ring_bus;
+	r->log2sz = log2sz;
+	r->prod = r->cons = 0;
+
+	IPECC_DMA_CONFIGURE(ring_bus, log2sz, ip_ecc_dma_nbw());
+	IPECC_DMA_ENABLE(irq);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Stop the DMA engine.
+ *
+ * The job being processed (if any) is completed first. On return, access
+ * to the IP registers is given back to software. An error is returned if
+ * the engine was stopped because of a bus error, in which case the IP
+ * should be reset using hw_driver_reset().
+ */
+int hw_driver_dma_stop(void)
+{
+	if(driver_setup()){
+		goto err;
+	}
+
+	IPECC_DMA_DISABLE();
+	IPECC_DMA_RUNNING_WAIT();
+
+	if(IPECC_DMA_IS_BUS_ERR()){
+		log_print("In hw_driver_dma_stop(): DMA engine stopped on a bus error\n\r");
+		goto err;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Write a large number into slot 'slot' of memory block 'blk'
+ *
+ *   The input big number is in big-endian format, and it is formatted the
+ *   same way as what ip_ecc_write_bignum() sends to the IP (less significant
+ *   word first).
+ */
+int hw_driver_dma_put_bignum(void* blk, uint32_t slot, const uint8_t *a, uint32_t a_sz)
+{
+	uint32_t nbw, words_sent, bytes_idx, j;
+	uint8_t end;
+	ip_ecc_word *w;
+
+	if(driver_setup()){
+		goto err;
+	}
+	nbw = ip_ecc_dma_nbw();
+	if((blk == NULL) || (ip_ecc_nn_words_from_bytes_sz(a_sz) > nbw)){
+		goto err;
+	}
+
+	w = ((ip_ecc_word*)blk) + (slot * nbw);
+	words_sent = 0;
+	bytes_idx = ((a_sz >= 1) ? (a_sz - 1) : 0);
+	end = (((a != NULL) && (a_sz >= 1)) ? 0 : 1);
+	while(words_sent < nbw){
+		w[words_sent] = 0;
+		if(!end){
+			for(j = 0; j < sizeof(ip_ecc_word); j++){
+				w[words_sent] |= (ip_ecc_word)(a[bytes_idx] << (8 * j));
+				if(bytes_idx == 0){
+					/* We have reached the end of the bytes */
+					end = 1;
+					break;
+				}
+				bytes_idx--;
+			}
+		}
+		words_sent++;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Read a large number from slot 'slot' of memory block 'blk'
+ * (reverse of hw_driver_dma_put_bignum()).
+ */
+int hw_driver_dma_get_bignum(const void* blk, uint32_t slot, uint8_t *a, uint32_t a_sz)
+{
+	uint32_t nbw, words_received, bytes_idx, j;
+	uint8_t end;
+	const ip_ecc_word *w;
+
+	if(driver_setup()){
+		goto err;
+	}
+	nbw = ip_ecc_dma_nbw();
+	if((blk == NULL) || (a == NULL) || (ip_ecc_nn_words_from_bytes_sz(a_sz) > nbw)){
+		goto err;
+	}
+
+	w = ((const ip_ecc_word*)blk) + (slot * nbw);
+	words_received = 0;
+	bytes_idx = ((a_sz >= 1) ? (a_sz - 1) : 0);
+	end = ((a_sz >= 1) ? 0 : 1);
+	while((words_received < nbw) && (!end)){
+		for(j = 0; j < sizeof(ip_ecc_word); j++){
+			a[bytes_idx] = (w[words_received] >> (8 * j)) & 0xff;
+			if(bytes_idx == 0){
+				/* We have reached the end of the bytes */
+				end = 1;
+				break;
+			}
+			bytes_idx--;
+		}
+		words_received++;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Post a job in the ring of descriptors.
+ *
+ * 'curve_bus', 'in_bus' and 'out_bus' are the bus addresses of the curve,
+ * input and output blocks of the job (see ecc_dma.vhd for the slots
+ * they must contain depending on 'cmd'). 'curve_bus' is only used if
+ * flag HW_DRIVER_DMA_LOAD_CURVE is set.
+ *
+ * On success '*idx' holds the index of the job, to be passed to
+ * hw_driver_dma_poll(). An error is returned if the ring is full.
+ */
+int hw_driver_dma_post(hw_driver_dma_ring_t* r, ip_ecc_command cmd, uint32_t flags,
+		       uint32_t curve_bus, uint32_t in_bus, uint32_t out_bus, uint32_t* idx)
+{
+	uint32_t cmdw, i;
+	ip_ecc_word *d;
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	switch(cmd){
+		case PT_KP:{
+			cmdw = IPECC_W_CTRL_PT_KP;
+			break;
+		}
+		case PT_ADD:{
+			cmdw = IPECC_W_CTRL_PT_ADD;
+			break;
+		}
+		case PT_DBL:{
+			cmdw = IPECC_W_CTRL_PT_DBL;
+			break;
+		}
+		case PT_CHK:{
+			cmdw = IPECC_W_CTRL_PT_CHK;
+			break;
+		}
+		case PT_NEG:{
+			cmdw = IPECC_W_CTRL_PT_NEG;
+			break;
+		}
+		case PT_EQU:{
+			cmdw = IPECC_W_CTRL_PT_EQU;
+			break;
+		}
+		case PT_OPP:{
+			cmdw = IPECC_W_CTRL_PT_OPP;
+			break;
+		}
+		default:{
+			goto err;
+		}
+	}
+	cmdw |= (flags & (HW_DRIVER_DMA_P_INF | HW_DRIVER_DMA_Q_INF
+				| HW_DRIVER_DMA_LOAD_CURVE | HW_DRIVER_DMA_IRQ));
+	/* The IP will no longer hold the curve last set by hw_driver_set_curve() */
+	if(flags & HW_DRIVER_DMA_LOAD_CURVE){
+		ip_ecc_curve_cache_invalidate();
+	}
+
+	/* Check that there is room left in the ring */
+	r->cons = IPECC_DMA_GET_CONS();
+	if(((r->prod - r->cons) & IPECC_W_DMA_PROD_MSK) >= (0x1UL << r->log2sz)){
+		goto err;
+	}
+
+	d = ((ip_ecc_word*)r->ring)
+		+ ((r->prod & ((0x1UL << r->log2sz) - 1)) * IPECC_DMA_DESC_WORDS);
+	for(i = 0; i < IPECC_DMA_DESC_WORDS; i++){
+		d[i] = 0;
+	}
+	d[IPECC_DMA_DESC_CMD] = cmdw;
+	d[IPECC_DMA_DESC_CURVE] = curve_bus;
+	d[IPECC_DMA_DESC_IN] = in_bus;
+	d[IPECC_DMA_DESC_OUT] = out_bus;
+
+	(*idx) = r->prod;
+	r->prod = (r->prod + 1) & IPECC_W_DMA_PROD_MSK;
+	/* The descriptor must be in memory before the engine may fetch it */
+	IPECC_DMA_WMB();
+	IPECC_DMA_SET_PROD(r->prod);
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Get the status of the job of index 'idx' posted with hw_driver_dma_post().
+ *
+ * '*done' is set to 0 as long as the engine has not written back the
+ * status of the job, in which case '*status' is left untouched.
+ */
+int hw_driver_dma_poll(hw_driver_dma_ring_t* r, uint32_t idx, int* done, uint32_t* status)
+{
+	uint32_t st;
+	volatile ip_ecc_word *d;
+
+	if(driver_setup()){
+		goto err;
+	}
+	if(IPECC_DMA_IS_BUS_ERR()){
+		log_print("In hw_driver_dma_poll(): DMA engine stopped on a bus error\n\r");
+		goto err;
+	}
+
+	/* The engine writes back the status of a job before moving CONS past
+	 * it: don't let the read of the status word be done ahead of the one
+	 * of CONS (whether or not it moved since hw_driver_dma_post() last
+	 * read it) */
+	r->cons = IPECC_DMA_GET_CONS();
+	IPECC_DMA_RMB();
+	d = ((volatile ip_ecc_word*)r->ring)
+		+ ((idx & ((0x1UL << r->log2sz) - 1)) * IPECC_DMA_DESC_WORDS);
+	st = (uint32_t)(d[IPECC_DMA_DESC_STATUS] & 0xffffffff);
+	(*done) = !!(st & HW_DRIVER_DMA_ST_DONE);
+	if(*done){
+		(*status) = st;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/* Get the result of a [k]P job from its output block.
+ *
+ * Coordinates in the output block are masked with the one-shot token
+ * the engine gathered for the job (slot IPECC_DMA_SLOT_OUT_TOKEN). They
+ * are unmasked here, and the token is cleared from both the local copy
+ * and the output block.
+ */
+int hw_driver_dma_get_kp_result(void* out_blk, uint8_t *out_x, uint32_t *out_x_sz,
+				uint8_t *out_y, uint32_t *out_y_sz)
+{
+	uint32_t nn_sz;
+	uint8_t token[4096] = {0, };
+
+	if(driver_setup()){
+		goto err;
+	}
+
+	nn_sz = ip_ecc_nn_bytes_from_bits_sz(ip_ecc_get_nn_bit_size());
+	if(nn_sz > 4096){
+		goto err;
+	}
+	if(((*out_x_sz) < nn_sz) || ((*out_y_sz) < nn_sz)){
+		goto err;
+	}
+	(*out_x_sz) = (*out_y_sz) = nn_sz;
+
+	if(hw_driver_dma_get_bignum(out_blk, 0, out_x, nn_sz)){
+		goto err;
+	}
+	if(hw_driver_dma_get_bignum(out_blk, 1, out_y, nn_sz)){
+		goto err;
+	}
+	if(hw_driver_dma_get_bignum(out_blk, IPECC_DMA_SLOT_OUT_TOKEN, token, nn_sz)){
+		goto err;
+	}
+
+	/* Unmask the [k]P result coordinates with the one-shot token */
+	if(ip_ecc_unmask_with_token(out_x, (*out_x_sz), token, nn_sz, out_x, out_x_sz)){
+		goto err;
+	}
+	if(ip_ecc_unmask_with_token(out_y, (*out_y_sz), token, nn_sz, out_y, out_y_sz)){
+		goto err;
+	}
+
+	/* Clear the token */
+	ip_ecc_clear_token(token, nn_sz);
+	if(hw_driver_dma_put_bignum(out_blk, IPECC_DMA_SLOT_OUT_TOKEN, NULL, 0)){
+		goto err;
+	}
 
 	return 0;
 err:
@@ -72,6 +72,140 @@
   #endif
 #endif
 
+#if defined(WITH_EC_HW_COSIM)
+/* Co-simulation: TCP port & host the simulation (sim/ecc_cosim.vhd)
+ * listens on. Both can be overridden at run time with environment
+ * variables IPECC_COSIM_PORT & IPECC_COSIM_HOST.
+ */
+#ifndef IPECC_COSIM_PORT
+#define IPECC_COSIM_PORT                9000
+#endif
+#ifndef IPECC_COSIM_HOST
+#define IPECC_COSIM_HOST                "127.0.0.1"
+#endif
+
+static int cosim_fd = -1;
+/* Stand-in for the register page (never actually accessed, it only
+ * gives the driver addresses from which offsets of registers are taken)
+ */
+static volatile uint64_t cosim_regs[IPECC_PHYS_SZ / sizeof(uint64_t)];
+/* Statistics of the session (see hw_driver_cosim_stats()) */
+static uint64_t cosim_nbrd = 0, cosim_nbwr = 0, cosim_cycles = 0;
+static uint32_t cosim_last_cycle;
+static int cosim_first = 1;
+
+static int cosim_connect(void)
+{
+	int ret = -1, one = 1;
+	struct sockaddr_in addr;
+	const char *host = getenv("IPECC_COSIM_HOST");
+	const char *port = getenv("IPECC_COSIM_PORT");
+
+	if (host == NULL) {
+		host = IPECC_COSIM_HOST;
+	}
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((port != NULL) ? (uint16_t)atoi(port) : IPECC_COSIM_PORT);
+	if (inet_pton(AF_INET, host, &addr.sin_addr) <= 0) {
+		printf("Error: invalid co-simulation host address %s\n\r", host);
+		goto err;
+	}
+	cosim_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (cosim_fd < 0) {
+		perror("socket cosim");
+		goto err;
+	}
+	if (connect(cosim_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		printf("Error when connecting to the co-simulation on %s:%d\n\r", host, ntohs(addr.sin_port));
+		perror("connect cosim");
+		close(cosim_fd);
+		cosim_fd = -1;
+		goto err;
+	}
+	/* Requests are tiny & strictly alternate with responses */
+	setsockopt(cosim_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	log_print("Driver in co-simulation mode (%s:%d)\n\r", host, ntohs(addr.sin_port));
+
+	ret = 0;
+err:
+	return ret;
+}
+
+/* One register access, see sim/ecc_cosim_vhpi.c for the protocol */
+static uint32_t cosim_access(unsigned char op, volatile void *reg, uint32_t val)
+{
+	unsigned char buf[9];
+	uint32_t off, cycle;
+	size_t n;
+	ssize_t r;
+
+	off = (uint32_t)((uintptr_t)reg - (uintptr_t)cosim_regs);
+	buf[0] = op;
+	buf[1] = (unsigned char)(off >> 24); buf[2] = (unsigned char)(off >> 16);
+	buf[3] = (unsigned char)(off >> 8);  buf[4] = (unsigned char)off;
+	buf[5] = (unsigned char)(val >> 24); buf[6] = (unsigned char)(val >> 16);
+	buf[7] = (unsigned char)(val >> 8);  buf[8] = (unsigned char)val;
+	for (n = 0; n < 9; n += (size_t)r) {
+		r = send(cosim_fd, buf + n, 9 - n, 0);
+		if (r <= 0) {
+			goto err;
+		}
+	}
+	for (n = 0; n < 8; n += (size_t)r) {
+		r = recv(cosim_fd, buf + n, 8 - n, 0);
+		if (r <= 0) {
+			goto err;
+		}
+	}
+	val = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+	cycle = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | (uint32_t)buf[7];
+	/* The cycle counter of the testbench is a VHDL natural (it wraps
+	 * around at 2^31)
+	 */
+	if (!cosim_first) {
+		cosim_cycles += (cycle - cosim_last_cycle) & 0x7fffffffUL;
+	}
+	cosim_first = 0;
+	cosim_last_cycle = cycle;
+	if (op == 'R') {
+		cosim_nbrd++;
+	} else {
+		cosim_nbwr++;
+	}
+	return val;
+err:
+	/* No way to report an error to the caller of IPECC_GET_REG()
+	 * or IPECC_SET_REG(), and no point in going on without the IP
+	 */
+	printf("Error: lost connection with the co-simulation\n\r");
+	exit(EXIT_FAILURE);
+}
+
+uint32_t hw_driver_cosim_read(volatile void *reg)
+{
+	return cosim_access('R', reg, 0);
+}
+
+void hw_driver_cosim_write(volatile void *reg, uint32_t val)
+{
+	(void)cosim_access('W', reg, val);
+}
+
+/* Nb of register reads & writes issued by the driver, and nb of
+ * cycles of the IP clock simulated, since the start of the session
+ */
+int hw_driver_cosim_stats(uint64_t* nbrd, uint64_t* nbwr, uint64_t* cycles)
+{
+	if ((nbrd == NULL) || (nbwr == NULL) || (cycles == NULL)) {
+		return -1;
+	}
+	*nbrd = cosim_nbrd;
+	*nbwr = cosim_nbwr;
+	*cycles = cosim_cycles;
+	return 0;
+}
+#endif /* WITH_EC_HW_COSIM */
+
 /* Setup the driver depending on the environment.
  *
  * If 'pseudotrng_base_addr_p' is not NULL then the setup will also try
@@ -209,6 +343,18 @@ int hw_driver_setup(volatile uint8_t **base_addr_p, volatile uint8_t **pseudotrn
 			(*pseudotrng_base_addr_p) = base_address;
 		}
 	}
+#elif defined(WITH_EC_HW_COSIM)
+	{
+		if (cosim_connect()) {
+			ret = -1;
+			goto err;
+		}
+		(*base_addr_p) = (volatile uint8_t*)cosim_regs;
+		/* No pseudo TRNG device in the co-simulation */
+		if (pseudotrng_base_addr_p != NULL) {
+			(*pseudotrng_base_addr_p) = NULL;
+		}
+	}
 #endif
 
 	/* Log print in case of success */
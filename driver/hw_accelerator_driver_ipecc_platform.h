@@ -27,17 +27,11 @@
  * UIO, etc.) this may change. Anyhow, the relative mapping of the registers should
  * remain fixed once this base address is known.
  */
-#if defined(WITH_EC_HW_STANDALONE) && (defined(WITH_EC_HW_UIO) || defined(WITH_EC_HW_DEVMEM))
-#error "WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO and WITH_EC_HW_DEVMEM are mutually exclusive!"
+#if (defined(WITH_EC_HW_STANDALONE) + defined(WITH_EC_HW_UIO) + defined(WITH_EC_HW_DEVMEM) + defined(WITH_EC_HW_COSIM)) > 1
+#error "WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO, WITH_EC_HW_DEVMEM and WITH_EC_HW_COSIM are mutually exclusive!"
 #endif
-#if defined(WITH_EC_HW_UIO) && (defined(WITH_EC_HW_STANDALONE) || defined(WITH_EC_HW_DEVMEM))
-#error "WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO and WITH_EC_HW_DEVMEM are mutually exclusive!"
-#endif
-#if defined(WITH_EC_HW_DEVMEM) && (defined(WITH_EC_HW_UIO) || defined(WITH_EC_HW_STANDALONE))
-#error "WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO and WITH_EC_HW_DEVMEM are mutually exclusive!"
-#endif
-#if !defined(WITH_EC_HW_STANDALONE) && !defined(WITH_EC_HW_UIO) && !defined(WITH_EC_HW_DEVMEM)
-#error "One of WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO or WITH_EC_HW_DEVMEM must be set for the driver!"
+#if !defined(WITH_EC_HW_STANDALONE) && !defined(WITH_EC_HW_UIO) && !defined(WITH_EC_HW_DEVMEM) && !defined(WITH_EC_HW_COSIM)
+#error "One of WITH_EC_HW_STANDALONE, WITH_EC_HW_UIO, WITH_EC_HW_DEVMEM or WITH_EC_HW_COSIM must be set for the driver!"
 #endif
 
 #if defined(WITH_EC_HW_UIO) || defined(WITH_EC_HW_DEVMEM)    
@@ -53,6 +47,16 @@
 #include <stddef.h>
 #endif
 
+#if defined(WITH_EC_HW_COSIM)
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
 /* Log handling on the platform
  * (usually printf, adapt)
  */
@@ -73,6 +77,15 @@
  */
 int hw_driver_setup(volatile uint8_t **base_addr_p, volatile uint8_t **pseudotrng_base_addr_p);
 
+#if defined(WITH_EC_HW_COSIM)
+/* Co-simulation: registers are not memory-mapped, each access is sent
+ * to the simulated IP (see sim/ecc_cosim.vhd). 'reg' is an address in
+ * the range returned by hw_driver_setup() in *base_addr_p.
+ */
+uint32_t hw_driver_cosim_read(volatile void *reg);
+void hw_driver_cosim_write(volatile void *reg, uint32_t val);
+#endif
+
 #endif /* WITH_EC_HW_ACCELERATOR */
 
 #endif /* __HW_ACCELERATOR_DRIVER_PLATFORM_H__ */
@@ -0,0 +1,346 @@
+/*
+ *  Copyright (C) 2023 - This file is part of IPECC project
+ *
+ *  Authors:
+ *      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+ *      Ryad BENADJILA <ryadbenadjila@gmail.com>
+ *
+ *  Contributors:
+ *      Adrian THILLARD
+ *      Emmanuel PROUFF
+ *
+ *  This software is licensed under GPL v2 license.
+ *  See LICENSE file at the root folder of the project.
+ */
+
+/*
+ * Countermeasure cost profiler (IP synthesized in HW unsecure mode only).
+ *
+ * For each curve of a binary test-vector file (see vec_bin.c) the [k]P
+ * computation of the first [k]P test of the curve is run under every
+ * combination of the countermeasure settings given on the command line:
+ *
+ *   - attack level (hw_driver_attack_set_level(), this patches the microcode)
+ *   - blinding size (0 for no blinding)
+ *   - period of the Z-remask (0 for no periodic Z-remask)
+ *   - shuffling of the memory of large numbers
+ *   - XY-shuffling
+ *   - on-the-fly masking of the scalar by the AXI interface
+ *
+ * and the cost of each combination is written to stdout as one CSV line
+ * giving the mean & variance of both the nb of clock cycles of the [k]P
+ * computation (point-operation time counter of the IP, read with
+ * hw_driver_get_time_DBG()) and the wall-clock time of the whole call to
+ * hw_driver_mul() (transfers included), in microseconds. Each result is
+ * also checked against the expected one from the test-vector file.
+ */
+
+#include "../hw_accelerator_driver.h"
+#include "../hw_accelerator_driver_ipecc_platform.h"
+#include "ecc-test-linux.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#define CMP_MAX_VALUES  16
+
+/* Values taken by one countermeasure setting during the sweep */
+typedef struct {
+	const char* name;
+	uint32_t val[CMP_MAX_VALUES];
+	uint32_t nb;
+} cmp_knob_t;
+
+enum {
+	KNOB_LEVEL = 0,
+	KNOB_BLD,
+	KNOB_ZREMASK,
+	KNOB_SHUF,
+	KNOB_XYSHUF,
+	KNOB_AXIMSK,
+	KNOB_NB
+};
+
+/* Running mean & variance (Welford) */
+typedef struct {
+	uint32_t n;
+	double mean;
+	double m2;
+} cmp_acc_t;
+
+static cmp_knob_t knobs[KNOB_NB] = {
+	[KNOB_LEVEL] = { .name = "level", .nb = 0 },
+	[KNOB_BLD] = { .name = "blinding", .val = { 0, 32, 64 }, .nb = 3 },
+	[KNOB_ZREMASK] = { .name = "zremask", .val = { 0, 16 }, .nb = 2 },
+	[KNOB_SHUF] = { .name = "shuffle", .val = { 0, 1 }, .nb = 2 },
+	[KNOB_XYSHUF] = { .name = "xyshuf", .val = { 0, 1 }, .nb = 2 },
+	[KNOB_AXIMSK] = { .name = "aximsk", .val = { 0, 1 }, .nb = 2 },
+};
+
+static void usage(const char* prog)
+{
+	printf("Usage: %s [options] binary-test-vector-file\n", prog);
+	printf("Sweeps the countermeasure settings of the IP & prints the cost of [k]P for each\n");
+	printf("curve of the file (converted with 'vec-bin-convert') as CSV lines on stdout.\n");
+	printf("  -n NB      nb of measured [k]P per curve & setting (default: 20)\n");
+	printf("  -w NB      nb of [k]P run & not measured after each change of setting (default: 1)\n");
+	printf("  -c NB      only profile the first NB curves of the file\n");
+	printf("  -l LIST    attack levels (default: none, the microcode is left as is)\n");
+	printf("  -b LIST    blinding sizes in bits, 0 for none (default: 0,32,64)\n");
+	printf("  -z LIST    Z-remask periods, 0 for none (default: 0,16)\n");
+	printf("  -s LIST    memory shuffling off/on (default: 0,1)\n");
+	printf("  -x LIST    XY-shuffling off/on (default: 0,1)\n");
+	printf("  -a LIST    AXI masking of the scalar off/on (default: 0,1)\n");
+	printf("LIST is a comma-separated list of at most %d values (e.g 0,32,64).\n", CMP_MAX_VALUES);
+	printf("If attack levels are swept, the IP is left in level 3 on exit.\n");
+}
+
+static int parse_list(const char* s, cmp_knob_t* k)
+{
+	char* end;
+
+	k->nb = 0;
+	do {
+		if (k->nb == CMP_MAX_VALUES) {
+			goto err;
+		}
+		k->val[k->nb++] = strtoul(s, &end, 0);
+		if (end == s) {
+			goto err;
+		}
+		s = end + 1;
+	} while (*end == ',');
+	if (*end != '\0') {
+		goto err;
+	}
+
+	return 0;
+err:
+	printf("%sError: invalid list of values for setting '%s'.%s\n\r", KERR, k->name, KNRM);
+	return -1;
+}
+
+static void acc_add(cmp_acc_t* a, double x)
+{
+	double d = x - a->mean;
+
+	a->n++;
+	a->mean += d / a->n;
+	a->m2 += d * (x - a->mean);
+}
+
+static double acc_var(const cmp_acc_t* a)
+{
+	return (a->n > 1) ? a->m2 / (a->n - 1) : 0.;
+}
+
+/* Apply one combination of settings ('idx' is the index of the value of each knob). */
+static int apply_settings(const uint32_t* idx)
+{
+	uint32_t v;
+
+	/* Attack level first, as it also changes the AXI masking */
+	if (knobs[KNOB_LEVEL].nb) {
+		if (hw_driver_attack_set_level((int)knobs[KNOB_LEVEL].val[idx[KNOB_LEVEL]])) {
+			goto err;
+		}
+	}
+	v = knobs[KNOB_BLD].val[idx[KNOB_BLD]];
+	if ((v) ? hw_driver_enable_blinding_and_set_size(v) : hw_driver_disable_blinding()) {
+		goto err;
+	}
+	v = knobs[KNOB_ZREMASK].val[idx[KNOB_ZREMASK]];
+	if ((v) ? hw_driver_enable_zremask_and_set_period(v) : hw_driver_disable_zremask()) {
+		goto err;
+	}
+	v = knobs[KNOB_SHUF].val[idx[KNOB_SHUF]];
+	if ((v) ? hw_driver_enable_shuffling() : hw_driver_disable_shuffling()) {
+		goto err;
+	}
+	v = knobs[KNOB_XYSHUF].val[idx[KNOB_XYSHUF]];
+	if ((v) ? hw_driver_enable_xyshuf() : hw_driver_disable_xyshuf_DBG()) {
+		goto err;
+	}
+	v = knobs[KNOB_AXIMSK].val[idx[KNOB_AXIMSK]];
+	if ((v) ? hw_driver_enable_aximsk() : hw_driver_disable_aximsk_DBG()) {
+		goto err;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+/*
+ * Profile all combinations of settings on the curve & [k]P test
+ * given by records 'crv' & 'kp'.
+ */
+static int profile_curve(const vec_bin_rec_t* crv, const vec_bin_rec_t* kp, uint32_t nbruns, uint32_t nbwarm)
+{
+	uint8_t x[NBMAXSZ], y[NBMAXSZ];
+	uint32_t idx[KNOB_NB] = { 0, };
+	uint32_t nsz = NN_SZ(crv->nn);
+	uint32_t i, r, x_sz, y_sz, cycles, nbko;
+	struct timespec t0, t1;
+	cmp_acc_t acc_cy, acc_us;
+	bool done = false;
+
+	if (hw_driver_set_curve(crv->a, nsz, crv->b, nsz, crv->p, nsz, crv->q, nsz)) {
+		printf("%sError: could not set curve #%u in hardware.%s\n\r", KERR, crv->id, KNRM);
+		goto err;
+	}
+	/* Odometer over the values of all knobs (level being the slowest one) */
+	while (!done) {
+		/* Blinding must be strictly less than nn */
+		if (knobs[KNOB_BLD].val[idx[KNOB_BLD]] >= crv->nn) {
+			goto next;
+		}
+		if (apply_settings(idx)) {
+			printf("%sError: could not apply settings to the IP.%s\n\r", KERR, KNRM);
+			goto err;
+		}
+		memset(&acc_cy, 0, sizeof(acc_cy));
+		memset(&acc_us, 0, sizeof(acc_us));
+		nbko = 0;
+		for (r = 0; r < nbwarm + nbruns; r++) {
+			/* P is not null: clear the null flags a previous run (or
+			 * settings change) may have left set, as kp.c does.
+			 */
+			if ((hw_driver_point_unzero(0)) || (hw_driver_point_unzero(1))) {
+				printf("%sError: Setting base point as not the infinity point on hardware triggered an error.%s\n\r", KERR, KNRM);
+				goto err;
+			}
+			x_sz = y_sz = sizeof(x);
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			if (hw_driver_mul(kp->px, nsz, kp->py, nsz, kp->k, nsz, x, &x_sz, y, &y_sz, NULL, NULL, NULL)) {
+				printf("%sError: [k]P on curve #%u triggered an error.%s\n\r", KERR, crv->id, KNRM);
+				goto err;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			if (hw_driver_get_time_DBG(&cycles)) {
+				printf("%sError: could not read the point-operation time counter.%s\n\r", KERR, KNRM);
+				goto err;
+			}
+			if (r < nbwarm) {
+				continue;
+			}
+			/* (an expected result at infinity can't be checked that way) */
+			if ((kp->rx) && ((x_sz != nsz) || (y_sz != nsz)
+						|| memcmp(x, kp->rx, nsz) || memcmp(y, kp->ry, nsz))) {
+				nbko++;
+			}
+			acc_add(&acc_cy, (double)cycles);
+			acc_add(&acc_us, ((double)(t1.tv_sec - t0.tv_sec) * 1e6) + ((double)(t1.tv_nsec - t0.tv_nsec) / 1e3));
+		}
+		printf("%u,%u,", crv->id, crv->nn);
+		if (knobs[KNOB_LEVEL].nb) {
+			printf("%u,", knobs[KNOB_LEVEL].val[idx[KNOB_LEVEL]]);
+		} else {
+			printf("-,");
+		}
+		for (i = KNOB_BLD; i < KNOB_NB; i++) {
+			printf("%u,", knobs[i].val[idx[i]]);
+		}
+		printf("%u,%.1f,%.1f,%.2f,%.2f,%u\n", acc_cy.n, acc_cy.mean, acc_var(&acc_cy),
+				acc_us.mean, acc_var(&acc_us), nbko);
+		fflush(stdout);
+next:
+		for (i = KNOB_NB; i-- > 0; ) {
+			if (++idx[i] < (knobs[i].nb ? knobs[i].nb : 1)) {
+				break;
+			}
+			idx[i] = 0;
+		}
+		done = (i == (uint32_t)-1);
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+int main(int argc, char *argv[])
+{
+	vec_bin_t vb = { .base = NULL, .sz = 0, .off = 0, .nn = 0 };
+	vec_bin_rec_t rec, crv;
+	uint32_t nbruns = 20, nbwarm = 1, nbcurves = 0xffffffffUL, nbdone = 0;
+	bool hw_unsecure, secure, shuffle, nndyn, axi64, have_crv = false;
+	uint32_t nnmax;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "n:w:c:l:b:z:s:x:a:h")) != -1) {
+		switch (opt) {
+			case 'n': nbruns = strtoul(optarg, NULL, 0); break;
+			case 'w': nbwarm = strtoul(optarg, NULL, 0); break;
+			case 'c': nbcurves = strtoul(optarg, NULL, 0); break;
+			case 'l': if (parse_list(optarg, &knobs[KNOB_LEVEL])) exit(EXIT_FAILURE); break;
+			case 'b': if (parse_list(optarg, &knobs[KNOB_BLD])) exit(EXIT_FAILURE); break;
+			case 'z': if (parse_list(optarg, &knobs[KNOB_ZREMASK])) exit(EXIT_FAILURE); break;
+			case 's': if (parse_list(optarg, &knobs[KNOB_SHUF])) exit(EXIT_FAILURE); break;
+			case 'x': if (parse_list(optarg, &knobs[KNOB_XYSHUF])) exit(EXIT_FAILURE); break;
+			case 'a': if (parse_list(optarg, &knobs[KNOB_AXIMSK])) exit(EXIT_FAILURE); break;
+			default: usage(argv[0]); exit((opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	if ((optind != argc - 1) || (nbruns == 0)) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	memset(&crv, 0, sizeof(crv));
+	if (vec_bin_map(argv[optind], &vb)) {
+		exit(EXIT_FAILURE);
+	}
+
+	/* The point-operation time counter & most of the settings are only
+	 * available in HW unsecure mode.
+	 */
+	if (hw_driver_is_hw_unsecure(&hw_unsecure)) {
+		printf("%sError: Probing 'HW secure/unsecure mode' triggered an error.%s\n\r", KERR, KNRM);
+		exit(EXIT_FAILURE);
+	}
+	if (!hw_unsecure) {
+		printf("%sError: the profiler needs an IP synthesized in HW unsecure mode.%s\n\r", KERR, KNRM);
+		exit(EXIT_FAILURE);
+	}
+	if (hw_driver_get_capabilities(&secure, &shuffle, &nndyn, &axi64, &nnmax)) {
+		printf("%sError: hw_driver_get_capabilities() returned exception.%s\n\r", KERR, KNRM);
+		exit(EXIT_FAILURE);
+	}
+	if (!shuffle) {
+		/* Memory shuffling can't be enabled if the IP wasn't synthesized with it */
+		knobs[KNOB_SHUF].val[0] = 0;
+		knobs[KNOB_SHUF].nb = 1;
+	}
+	if (hw_driver_trng_post_proc_enable_DBG()) {
+		printf("%sError: Enabling TRNG post-processing on hardware triggered an error.%s\n\r", KERR, KNRM);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("# curve,nn,level,blinding,zremask,shuffle,xyshuf,aximsk,runs,"
+			"cycles_mean,cycles_var,us_mean,us_var,nb_wrong_results\n");
+	/* Profile each curve with the first [k]P test following it (with P not null) */
+	while ((nbdone < nbcurves) && ((ret = vec_bin_next(&vb, &rec)) == 1)) {
+		if (rec.type == VEC_BIN_REC_CURVE) {
+			crv = rec;
+			have_crv = true;
+		} else if ((have_crv) && (rec.type == OP_KP) && (rec.px)) {
+			if ((crv.nn > nnmax) || (profile_curve(&crv, &rec, nbruns, nbwarm))) {
+				printf("%sError: profiling of curve #%u failed.%s\n\r", KERR, crv.id, KNRM);
+				exit(EXIT_FAILURE);
+			}
+			have_crv = false;
+			nbdone++;
+		}
+	}
+	vec_bin_unmap(&vb);
+
+	/* Leave the IP in a known state */
+	hw_driver_reset();
+	if ((knobs[KNOB_LEVEL].nb) && (hw_driver_attack_set_level(3))) {
+		exit(EXIT_FAILURE);
+	}
+
+	return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -147,6 +147,8 @@ extern int check_test_equal(ipecc_test_t*, bool* res);
 /*   are P & Q opposite? */
 extern int ip_test_set_pts_and_test_oppos(ipecc_test_t*);
 extern int check_test_oppos(ipecc_test_t*, bool* res);
+/*   is P in the subgroup of order q? (self-contained) */
+extern int ip_test_check_order(bool* res);
 
 /* Curve definition */
 static curve_t curve = INIT_CURVE();
@@ -169,7 +171,7 @@ unsigned int debug_yr0[NBMAXSZ/4];
 unsigned int debug_xr1[NBMAXSZ/4];
 unsigned int debug_yr1[NBMAXSZ/4];
 unsigned int debug_zr01[NBMAXSZ/4];
-char debug_msg[KP_TRACE_PRINTF_SZ];
+kp_trace_buf_t kp_trace_buf = { .buf = NULL, .sz = 0, .max = 0 };
 
 uint32_t kptime;
 
@@ -206,9 +208,8 @@ kp_trace_info_t kp_trace_info =
 	.nb_xr1 = debug_xr1,
 	.nb_yr1 = debug_yr1,
 	.nb_zr01 = debug_zr01,
-	.msg = debug_msg,
-	.msgsz = 0,
-	.msgsz_max = KP_TRACE_PRINTF_SZ
+	.sink = kp_trace_mem_sink,
+	.sink_arg = &kp_trace_buf
 };
 
 /* Main test structure */
@@ -247,7 +248,9 @@ static all_stats_t stats = {
 	.nn_min = 0xffffffffUL,
 	.nn_max = 0,
 	.nn_avr = 0,
-	.nbcurves = 0
+	.nbcurves = 0,
+	.kp_cycles = 0,
+	.fclk = 0
 };
 
 /*
@@ -281,16 +284,19 @@ static bool line_is_empty(char *l)
 static void print_stats_regularly(all_stats_t* st, bool force)
 {
 	static bool only_once = true;
+	struct timeval now;
+	uint64_t elapsed_us;
 
 	if (((st->all.total % DISPLAY_MODULO) == DISPLAY_MODULO - 1) || (force)) {
 		if (only_once) {
-			printf("\n\n\n\n\n");
+			printf("\n\n\n\n\n\n");
 			only_once = false;
 		}
 		/* nn min, max */
-		printf("%s%s%s%s%s%s%s%s%s%s%s%s",
+		printf("%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
 				KERASELINE, KMVUP1LINE, KERASELINE, KMVUP1LINE, KERASELINE, KMVUP1LINE,
-				KERASELINE, KMVUP1LINE, KERASELINE, KMVUP1LINE, KERASELINE, KBOLD);
+				KERASELINE, KMVUP1LINE, KERASELINE, KMVUP1LINE, KERASELINE, KMVUP1LINE,
+				KERASELINE, KBOLD);
 		if (st->nbcurves)  {
 			printf("nn min|average|max: %s%u%s%s|%s%u%s%s|%s%u%s%s\n",
 					KORA, st->nn_min, KNRM, KBOLD, KVIO, (st->nn_avr)/(st->nbcurves),
@@ -320,6 +326,18 @@ static void print_stats_regularly(all_stats_t* st, bool force)
 				6, st->kp.total, 6, st->ptadd.total, 6, st->ptdbl.total, 6, st->ptneg.total,
 				6, st->test_equ.total, 6, st->test_opp.total, 6, st->test_crv.total, KCYN,
 				6, st->all.total, KNRM, KNOBOLD);
+		/* IP duty cycle: share of the wall-clock time spent by the IP computing [k]P
+		 * (this is where overlapping transfers with computation shows) */
+		gettimeofday(&now, NULL);
+		elapsed_us = ((uint64_t)(now.tv_sec - st->start.tv_sec) * 1000000ULL)
+			+ (uint64_t)now.tv_usec - (uint64_t)st->start.tv_usec;
+		if ((st->fclk) && (elapsed_us)) {
+			printf("%sIP duty cycle ([k]P): %s%5.1f %%%s%s\n", KBOLD, KVIO,
+					(100. * (double)(st->kp_cycles)) / ((double)(st->fclk) * (double)elapsed_us),
+					KNRM, KNOBOLD);
+		} else {
+			printf("%sIP duty cycle ([k]P): %s  n/a%s%s\n", KBOLD, KVIO, KNRM, KNOBOLD);
+		}
 	}
 }
 
@@ -349,6 +367,23 @@ void int_handler(int dummy)
 	if (stats.all.total > 0) {
 		print_stats_regularly(&stats, true);
 	}
+	{
+		uint32_t nb_loaded, nb_skipped;
+		if ((stats.nbcurves) && (hw_driver_get_curve_stats(&nb_loaded, &nb_skipped) == 0)) {
+			printf("%sCurves: %s%u%s loaded in hardware, %s%u%s reprogrammings avoided%s\n", KBOLD,
+					KVIO, nb_loaded, KNRM KBOLD, KVIO, nb_skipped, KNRM KBOLD, KNOBOLD);
+		}
+	}
+#if defined(WITH_EC_HW_COSIM)
+	{
+		uint64_t nbrd, nbwr, cycles;
+		if (hw_driver_cosim_stats(&nbrd, &nbwr, &cycles) == 0) {
+			printf("%sCo-simulation: %s%llu%s reads, %s%llu%s writes, %s%llu%s cycles%s\n", KBOLD,
+					KVIO, (unsigned long long)nbrd, KNRM KBOLD, KVIO, (unsigned long long)nbwr, KNRM KBOLD,
+					KVIO, (unsigned long long)cycles, KNRM KBOLD, KNOBOLD);
+		}
+	}
+#endif
 	/* Remove color on terminal, make the cursor visible again
 	 * and set normal (no bold) font
 	 */
@@ -461,6 +496,231 @@ err:
 	return -1;
 }
 
+/*
+ * Set large number 'l' from the 'nsz' bytes of a binary test-vector record
+ * (the driver API needs them in the fixed-size buffer of large_number_t,
+ * this is the only copy made).
+ */
+static void vec_bin_set_large_num(large_number_t* l, const uint8_t* v, uint32_t nsz)
+{
+	memcpy(l->val, v, nsz);
+	l->sz = nsz;
+	l->valid = true;
+}
+
+static void vec_bin_set_pt(point_t* pt, const uint8_t* x, const uint8_t* y, uint32_t nsz)
+{
+	if (x) {
+		vec_bin_set_large_num(&pt->x, x, nsz);
+		vec_bin_set_large_num(&pt->y, y, nsz);
+		pt->is_null = false;
+	} else {
+		pt->is_null = true;
+	}
+	pt->valid = true;
+}
+
+/*
+ * Main loop when test-vectors come from a binary file (see vec_bin.c)
+ * instead of standard input: same tests & statistics as with the text
+ * format, without any parsing.
+ */
+static void run_vec_bin(vec_bin_t* vb)
+{
+	vec_bin_rec_t r;
+	stats_t* st;
+	uint32_t nsz;
+	int ret;
+	bool result_pts_are_equal;
+	bool result_tests_are_identical;
+
+	while ((ret = vec_bin_next(vb, &r)) == 1) {
+		nsz = NN_SZ(r.nn);
+		if (r.type == VEC_BIN_REC_CURVE) {
+			curve.id = r.id;
+			curve.nn = r.nn;
+			PRINTF("%snn=%d\n\r%s", KINF, curve.nn, KNRM);
+			stats.nbcurves++;
+			if (curve.nn > stats.nn_max) {
+				stats.nn_max = curve.nn;
+			}
+			if (curve.nn < stats.nn_min) {
+				stats.nn_min = curve.nn;
+			}
+			stats.nn_avr += curve.nn;
+			vec_bin_set_large_num(&curve.p, r.p, nsz);
+			vec_bin_set_large_num(&curve.a, r.a, nsz);
+			vec_bin_set_large_num(&curve.b, r.b, nsz);
+			vec_bin_set_large_num(&curve.q, r.q, nsz);
+			curve.valid = true;
+			/*
+			 * Transfer curve parameters to the IP.
+			 */
+			if (ip_test_set_curve(&curve))
+			{
+				printf("%sError: Could not transmit curve parameters to driver.%s\n\r", KERR, KNRM);
+				print_stats_and_exit(&test, &stats, "(debug info: in binary curve record)", __LINE__);
+			}
+			continue;
+		}
+
+		test.op = (operation_t)r.type;
+		test.id = r.id;
+		test.blinding = r.nbbld;
+		test.is_an_exception = INT_TO_BOOLEAN(r.flags & VEC_BIN_F_EXCEPTION);
+		vec_bin_set_pt(&test.ptp, r.px, r.py, nsz);
+		if ((r.qx) || (r.flags & VEC_BIN_F_Q_NULL)) {
+			vec_bin_set_pt(&test.ptq, r.qx, r.qy, nsz);
+		}
+		if (r.k) {
+			vec_bin_set_large_num(&test.k, r.k, nsz);
+		}
+		if ((r.rx) || (r.flags & VEC_BIN_F_RES_NULL)) {
+			vec_bin_set_pt(&test.pt_sw_res, r.rx, r.ry, nsz);
+		}
+		test.sw_answer.answer = INT_TO_BOOLEAN(r.flags & VEC_BIN_F_TRUE);
+		test.sw_answer.valid = true;
+
+		/*
+		 * Have the operation or the test executed by hardware & check
+		 * its result against the expected one.
+		 */
+		switch (test.op) {
+			case OP_KP:{
+				st = &stats.kp;
+				if (ip_test_set_pt_and_run_kp(&test, &kp_trace_info)) {
+					printf("%sError: Computation of scalar multiplication on hardware triggered an error.%s\n\r", KERR, KNRM);
+					kp_error_log(&test);
+					goto err;
+				}
+				if (check_kp_result(&test, &result_pts_are_equal, &kp_trace_info)) {
+					kp_error_log(&test);
+					printf("%sError: Couldn't compare [k]P hardware result w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (test.kptime) {
+					stats.kp_cycles += *(test.kptime);
+				}
+				break;
+			}
+			case OP_PTADD:{
+				st = &stats.ptadd;
+				if (ip_test_set_pts_and_run_ptadd(&test)) {
+					printf("%sError: Computation of P + Q on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_ptadd_result(&test, &result_pts_are_equal)) {
+					printf("%sError: Couldn't compare P + Q hardware result w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			case OP_PTDBL:{
+				st = &stats.ptdbl;
+				if (ip_test_set_pt_and_run_ptdbl(&test)) {
+					printf("%sError: Computation of [2]P on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_ptdbl_result(&test, &result_pts_are_equal)) {
+					printf("%sError: Couldn't compare [2]P hardware result w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			case OP_PTNEG:{
+				st = &stats.ptneg;
+				if (ip_test_set_pt_and_run_ptneg(&test)) {
+					printf("%sError: Computation of -P on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_ptneg_result(&test, &result_pts_are_equal)) {
+					printf("%sError: Couldn't compare -P hardware result w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			case OP_TST_CHK:{
+				st = &stats.test_crv;
+				if (ip_test_set_pt_and_check_on_curve(&test)) {
+					printf("%sError: Point test \"is on curve?\" on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_test_oncurve(&test, &result_tests_are_identical)) {
+					printf("%sError: Couldn't compare hardware result to test \"is on curve?\" "
+							"w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			case OP_TST_EQU:{
+				st = &stats.test_equ;
+				if (ip_test_set_pts_and_test_equal(&test)) {
+					printf("%sError: Point test \"are pts equal?\" on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_test_equal(&test, &result_tests_are_identical)) {
+					printf("%sError: Couldn't compare hardware result to test \"are pts equal?\" "
+							"w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			case OP_TST_OPP:{
+				st = &stats.test_opp;
+				if (ip_test_set_pts_and_test_oppos(&test)) {
+					printf("%sError: Point test \"are pts opposite?\" on hardware triggered an error.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				if (check_test_oppos(&test, &result_tests_are_identical)) {
+					printf("%sError: Couldn't compare hardware result to test \"are pts opposite?\" "
+							"w/ the expected one.%s\n\r", KERR, KNRM);
+					goto err;
+				}
+				break;
+			}
+			default:{
+				/* (vec_bin_next() only returns known types of records) */
+				printf("%sError: Invalid test type.%s\n\r", KERR, KNRM);
+				print_stats_and_exit(&test, &stats, "(debug info: in binary test record)", __LINE__);
+				break;
+			}
+		}
+		/*
+		 * Stats
+		 */
+		st->ok++;
+		st->total++;
+		stats.all.ok++;
+		stats.all.total++;
+		print_stats_regularly(&stats, false);
+
+		/*
+		 * Reset a certain number of flags.
+		 */
+		test.ptp.valid = false;
+		test.ptq.valid = false;
+		test.pt_sw_res.valid = false;
+		test.pt_hw_res.valid = false;
+		test.sw_answer.valid = false;
+		test.hw_answer.valid = false;
+		test.k.valid = false;
+		test.blinding = 0;
+		test.op = OP_NONE;
+		test.is_an_exception = false;
+	}
+	if (ret < 0) {
+		print_stats_and_exit(&test, &stats, "(debug info: in binary test-vector file)", __LINE__);
+	}
+	return;
+
+err:
+	st->nok++;
+	st->total++;
+	stats.all.nok++;
+	stats.all.total++;
+	print_stats_and_exit(&test, &stats, "(debug info: in binary test record)", __LINE__);
+}
+
 int main(int argc, char *argv[])
 {
 	uint32_t i;
@@ -479,13 +739,25 @@ int main(int argc, char *argv[])
 
 	bool result_pts_are_equal;
 	bool result_tests_are_identical;
+	bool result_check_order;
 
 	uint32_t fclk, fclkmm;
 
 	uint32_t raw_ff_time, raw_ff_step, mean_raw_ff_time = 0;
 
-	(void)argc;
-	(void)argv;
+	vec_bin_t vb = { .base = NULL, .sz = 0, .off = 0, .nn = 0 };
+
+	/*
+	 * Test-vectors are read in the text format from standard input, unless
+	 * a file in the binary format (see vec_bin.c) is given as argument.
+	 */
+	if (argc > 2) {
+		printf("Usage: %s [binary-test-vector-file]\n\r", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if ((argc == 2) && (vec_bin_map(argv[1], &vb))) {
+		exit(EXIT_FAILURE);
+	}
 
 
 	/* Move the claptrap below rather in --help it it exists one day. */
@@ -611,6 +883,7 @@ int main(int argc, char *argv[])
 		printf("Estimating clock freqs... "); fflush(stdout);
 		hw_driver_get_clocks_freq_DBG(&fclk, &fclkmm, 3);
 		printf(" (%d MHz|%d MHz)\n\r", fclk, fclkmm);
+		stats.fclk = fclk;
 
 		/* Estimate the time it takes to fill the TRNG raw random FIFO
 		 */
@@ -634,6 +907,17 @@ int main(int argc, char *argv[])
 	}
 #endif
 
+	/* Subgroup checks (hw_driver_check_order()) on a curve with a
+	 * cofactor, before any test-vector is read (the curve is left
+	 * set in the IP but the next test-vector curve replaces it).
+	 */
+	if (nnmax >= 256) {
+		if (ip_test_check_order(&result_check_order)) {
+			printf("%sError: \"is P in the subgroup?\" test failed.%s\n\r", KERR, KNRM);
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	/* Make cursor invisible from the terminal window.
 	 */
 	printf("%s", KCURSORINVIS);
@@ -645,6 +929,13 @@ int main(int argc, char *argv[])
 	 * then having the same computation done by hardware, and then
 	 * checking the result of hardware against the expected one.
 	 */
+	gettimeofday(&stats.start, NULL);
+
+	if (vb.base) {
+		run_vec_bin(&vb);
+		vec_bin_unmap(&vb);
+		int_handler(0);
+	}
 
 	while (((nread = getline(&line, &len, stdin))) != -1) {
 		/*
@@ -1230,6 +1521,9 @@ int main(int argc, char *argv[])
 					/*
 					 * Stats
 					 */
+					if (test.kptime) {
+						stats.kp_cycles += *(test.kptime);
+					}
 					stats.kp.ok++;
 					stats.kp.total++;
 					stats.all.ok++;
@@ -1300,6 +1594,9 @@ int main(int argc, char *argv[])
 					/*
 					 * Stats
 					 */
+					if (test.kptime) {
+						stats.kp_cycles += *(test.kptime);
+					}
 					stats.kp.ok++;
 					stats.kp.total++;
 					stats.all.ok++;
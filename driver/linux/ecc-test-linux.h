@@ -22,8 +22,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/time.h>
 
-#if defined(WITH_EC_HW_UIO) || defined(WITH_EC_HW_DEVMEM)    
+#if defined(WITH_EC_HW_UIO) || defined(WITH_EC_HW_DEVMEM) || defined(WITH_EC_HW_COSIM)
 #include <unistd.h>                               
 #include <fcntl.h>
 #include <stdlib.h>
@@ -141,6 +142,10 @@ typedef struct {
 	uint32_t nn_max;
 	uint32_t nn_avr;
 	uint32_t nbcurves;
+	/* For the IP duty cycle (only in HW unsecure mode) */
+	uint64_t kp_cycles;  /* total nb of clock cycles spent computing [k]P */
+	uint32_t fclk;       /* frequency of the IP main clock (in MHz) */
+	struct timeval start;
 } all_stats_t;
 
 /*
@@ -223,6 +228,96 @@ typedef struct {
 	(t).valid = false; \
 } while (0)
 
+/*
+ * Growable memory buffer receiving the binary [k]P trace stream
+ * (see kp_trace_mem_sink() in kp_trace_decode.c).
+ */
+typedef struct {
+	uint8_t* buf;
+	uint32_t sz;
+	uint32_t max;
+} kp_trace_buf_t;
+
+extern int kp_trace_decode(const uint8_t*, uint32_t, FILE*);
+extern int kp_trace_mem_sink(void*, const uint8_t*, uint32_t);
+extern int kp_trace_fd_sink(void*, const uint8_t*, uint32_t);
+
+/*
+ * Binary format of test-vectors (see vec_bin.c), the same content as the
+ * text format but which ecc-test-linux can mmap and walk through without
+ * any parsing.
+ *
+ * File header: VEC_BIN_MAGIC (8 bytes) then VEC_BIN_VERSION (32-bit).
+ *
+ * Then records, each one starting at a 4-byte aligned offset with a header:
+ *   byte  0     type (VEC_BIN_REC_CURVE or one of the OP_* values of operation_t)
+ *   byte  1     flags (VEC_BIN_F_*)
+ *   bytes 2-3   nb of blinding bits ([k]P only)
+ *   bytes 4-7   curve or test nb
+ *   bytes 8-11  size of the record in bytes (header & trailing padding included)
+ * followed, for a curve record, by nn (32-bit) and then p, a, b & q,
+ * and for a test record by (in that order & when relevant to the operation):
+ *   Px, Py        unless VEC_BIN_F_P_NULL
+ *   Qx, Qy        P+Q, P==Q & P==-Q only, unless VEC_BIN_F_Q_NULL
+ *   k             [k]P only
+ *   x, y          of the expected result of [k]P, P+Q, [2]P & -P, unless
+ *                 VEC_BIN_F_RES_NULL (for point tests the expected answer
+ *                 is VEC_BIN_F_TRUE)
+ * Integers of headers are little-endian, large numbers are big-endian
+ * on NN_SZ(nn) bytes (nn of the last curve record), that is as the
+ * driver API expects them.
+ */
+#define VEC_BIN_MAGIC          "IPECCVEC"
+#define VEC_BIN_MAGIC_SZ       8
+#define VEC_BIN_VERSION        1
+#define VEC_BIN_HDR_SZ         (VEC_BIN_MAGIC_SZ + 4)
+#define VEC_BIN_REC_HDR_SZ     12
+
+#define VEC_BIN_REC_CURVE      0x80
+
+#define VEC_BIN_F_P_NULL       (1 << 0)
+#define VEC_BIN_F_Q_NULL       (1 << 1)
+#define VEC_BIN_F_RES_NULL     (1 << 2)
+#define VEC_BIN_F_TRUE         (1 << 3)
+#define VEC_BIN_F_EXCEPTION    (1 << 4)
+
+/*
+ * A mapped binary test-vector file.
+ */
+typedef struct {
+	const uint8_t* base;
+	size_t sz;
+	size_t off;
+	uint32_t nn;
+} vec_bin_t;
+
+/*
+ * One record of a binary test-vector file. Large numbers are not copied,
+ * they point into the mapping (NULL when absent from the record).
+ */
+typedef struct {
+	uint32_t type;
+	uint32_t flags;
+	uint32_t nbbld;
+	uint32_t id;
+	uint32_t nn;
+	const uint8_t* p;
+	const uint8_t* a;
+	const uint8_t* b;
+	const uint8_t* q;
+	const uint8_t* px;
+	const uint8_t* py;
+	const uint8_t* qx;
+	const uint8_t* qy;
+	const uint8_t* k;
+	const uint8_t* rx;
+	const uint8_t* ry;
+} vec_bin_rec_t;
+
+extern int vec_bin_map(const char*, vec_bin_t*);
+extern int vec_bin_next(vec_bin_t*, vec_bin_rec_t*);
+extern void vec_bin_unmap(vec_bin_t*);
+
 #define INT_TO_BOOLEAN(i)   ((i) ? true : false)
 
 #define DISPLAY_MODULO  10
@@ -26,6 +26,59 @@ extern uint32_t zmask[];
 
 extern int cmp_two_pts_coords(point_t*, point_t*, bool*);
 
+#ifdef KP_PIPELINE
+/*
+ * Run the [k]P test as a pipelined pair of identical computations using
+ * the shadow operand slots of the IP: the operands of the second one are
+ * uploaded while the first one is running. Result of the first one goes
+ * into t->pt_hw_res, result of the second one must match it.
+ */
+static point_t pt_hw_res2 = INIT_POINT();
+
+static int ip_test_run_kp_pipelined(ipecc_test_t* t)
+{
+	uint32_t kptime2;
+	bool equal;
+
+	if (hw_driver_mul_queue(t->ptp.x.val, t->ptp.x.sz, t->ptp.y.val, t->ptp.y.sz, t->k.val, t->k.sz)) {
+		printf("%sError: Queuing first [k]P computation on hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (hw_driver_mul_queue(t->ptp.x.val, t->ptp.x.sz, t->ptp.y.val, t->ptp.y.sz, t->k.val, t->k.sz)) {
+		printf("%sError: Queuing second [k]P computation on hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (hw_driver_mul_collect(t->pt_hw_res.x.val, &(t->pt_hw_res.x.sz), t->pt_hw_res.y.val,
+			&(t->pt_hw_res.y.sz), t->kptime)) {
+		printf("%sError: Collecting first [k]P result from hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	pt_hw_res2.x.sz = pt_hw_res2.y.sz = t->pt_hw_res.x.sz;
+	if (hw_driver_mul_collect(pt_hw_res2.x.val, &(pt_hw_res2.x.sz), pt_hw_res2.y.val,
+			&(pt_hw_res2.y.sz), t->kptime ? &kptime2 : NULL)) {
+		printf("%sError: Collecting second [k]P result from hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (t->kptime) {
+		*(t->kptime) += kptime2;
+	}
+
+	/* Both computations must give the same result */
+	if (cmp_two_pts_coords(&(t->pt_hw_res), &pt_hw_res2, &equal)) {
+		printf("%sError: Could not compare the two pipelined [k]P results.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (equal == false) {
+		printf("%sError: The two pipelined [k]P results differ.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+#endif
+
 int ip_test_set_pt_and_run_kp(ipecc_test_t* t)
 {
 	int is_null;
@@ -132,16 +185,20 @@ int ip_test_set_pt_and_run_kp(ipecc_test_t* t)
 		t->ktrc->phi1msk_valid = false;
 	}
 	t->ktrc->nb_steps = 0;
-	t->ktrc->msgsz = 0;
-	t->ktrc->msgsz_max = KP_TRACE_PRINTF_SZ;
-#if 0
-	/* Clear [k]P trace log buffer (hoping a DMA will do this...) */
-	bzero(t->ktrc->msg, KP_TRACE_PRINTF_SZ);
-#endif
+	/* Empty [k]P trace record buffer */
+	((kp_trace_buf_t*)(t->ktrc->sink_arg))->sz = 0;
 	t->ktrc->nn = t->curve->nn;
 #endif /* KP_TRACE */
 
 	/* Run [k]P command */
+#ifdef KP_PIPELINE
+	/* (input point at infinity is not supported by shadow operand slots) */
+	if (t->ptp.is_null == false) {
+		if (ip_test_run_kp_pipelined(t)) {
+			goto err;
+		}
+	} else
+#endif
 #ifdef KP_SET_ZMASK
 	if (hw_driver_mul(t->ptp.x.val, t->ptp.x.sz, t->ptp.y.val, t->ptp.y.sz, t->k.val, t->k.sz,
 			t->pt_hw_res.x.val, &(t->pt_hw_res.x.sz), t->pt_hw_res.y.val, &(t->pt_hw_res.y.sz), t->kptime, zmask, t->ktrc))
@@ -289,7 +346,10 @@ int kp_error_log(ipecc_test_t* t)
 	print_large_number("Hardware kPy=0x", &(t->pt_hw_res.y));
 #ifdef KP_TRACE
 	printf("%s<DEBUG START [k]P TRACE LOG:%s\n\r", KRED, KNRM);
-	printf("%s%s%s", KWHT, t->ktrc->msg, KNRM);
+	printf("%s", KWHT);
+	kp_trace_decode(((kp_trace_buf_t*)(t->ktrc->sink_arg))->buf,
+			((kp_trace_buf_t*)(t->ktrc->sink_arg))->sz, stdout);
+	printf("%s", KNRM);
 	printf("%sDEBUG END [k]P TRACE LOG>%s\n\r", KRED, KNRM);
 #endif
 	printf("\n\n\n\n\n\n");
@@ -0,0 +1,427 @@
+/*
+ *  Copyright (C) 2023 - This file is part of IPECC project
+ *
+ *  Authors:
+ *      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+ *      Ryad BENADJILA <ryadbenadjila@gmail.com>
+ *
+ *  Contributors:
+ *      Adrian THILLARD
+ *      Emmanuel PROUFF
+ *
+ *  This software is licensed under GPL v2 license.
+ *  See LICENSE file at the root folder of the project.
+ */
+
+/*
+ * Sinks & decoder for the binary [k]P trace stream produced by the driver
+ * when compiled with -DKP_TRACE (see KP_TRACE_REC_* in hw_accelerator_driver.h).
+ *
+ * The decoder renders the stream as the text view that the driver used to
+ * sprintf itself. When this file is compiled with -DKP_TRACE_DECODE_MAIN it
+ * also provides the main() of the standalone tool 'kp-trace-decode' which
+ * renders a trace file (as written e.g by kp_trace_fd_sink()) to stdout.
+ */
+
+#include "../hw_accelerator_driver.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "ecc-test-linux.h"
+
+#ifdef KP_TRACE_DECODE_MAIN
+#include "ecc_states.h"
+#include <fcntl.h>
+#else
+/* (defined by the driver, from ecc_states.h) */
+extern char* str_ipecc_state(unsigned int id);
+#endif
+
+/* Decoder state, a stream can be decoded one record at a time. */
+typedef struct {
+	uint32_t nn;
+	uint32_t ww;
+	uint32_t w;
+	uint32_t flags;
+	uint32_t jnbbit;
+	bool hdr;
+	uint32_t nb[KP_TRACE_NB_NB][(KP_TRACE_REC_MAX_SZ - KP_TRACE_REC_HDR_SZ) / 4];
+} kp_trace_dec_t;
+
+static const char* kp_trace_msg_str[] = {
+	[KP_TRACE_MSG_SETBKPT] = "Setting first breakpoint (on .checkoncurveL)\n\r",
+	[KP_TRACE_MSG_RUN] = "Running [k]P\n\r",
+	[KP_TRACE_MSG_POLL] = "Polling until debug halt\n\r",
+	[KP_TRACE_MSG_HALTED] = "IP is halted\n\r",
+	[KP_TRACE_MSG_STEPPING] = "Starting step-by-step execution\n\r",
+	[KP_TRACE_MSG_RESUME] = "Removing breakpoint & resuming.\n\r",
+};
+
+/* Prefixes of the large numbers in the text view (except lambda
+ * for which it depends on jnbbit).
+ */
+static const char* kp_trace_nb_str[] = {
+	[KP_TRACE_NB_XR0] = "[VHD-CMP-SAGE]     @ 4   XR0 = 0x",
+	[KP_TRACE_NB_YR0] = "[VHD-CMP-SAGE]     @ 5   YR0 = 0x",
+	[KP_TRACE_NB_XR1] = "[VHD-CMP-SAGE]     @ 6   XR1 = 0x",
+	[KP_TRACE_NB_YR1] = "[VHD-CMP-SAGE]     @ 7   YR1 = 0x",
+	[KP_TRACE_NB_ZR01] = "[VHD-CMP-SAGE]     @ 26 ZR01 = 0x",
+	[KP_TRACE_NB_ALPHA] = "alf = 0x",
+	[KP_TRACE_NB_PHI0] = "phi0 = 0x",
+	[KP_TRACE_NB_PHI1] = "phi1 = 0x",
+	[KP_TRACE_NB_LAMBDA] = NULL,
+	[KP_TRACE_NB_KAP0MSK] = "  kap0msk  = 0x",
+	[KP_TRACE_NB_KAP1MSK] = "  kap1msk  = 0x",
+	[KP_TRACE_NB_KAPP0MSK] = "  kapP0msk  = 0x",
+	[KP_TRACE_NB_KAPP1MSK] = "  kapP1msk  = 0x",
+	[KP_TRACE_NB_PHI0MSK] = "  phi0msk  = 0x",
+	[KP_TRACE_NB_PHI1MSK] = "  phi1msk  = 0x",
+};
+
+static inline uint32_t kp_trace_get16(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t kp_trace_get32(const uint8_t* p)
+{
+	return kp_trace_get16(p) | (kp_trace_get16(p + 2) << 16);
+}
+
+static void kp_trace_dec_step(kp_trace_dec_t* d, uint32_t evt, FILE* out)
+{
+	const char* op;
+	uint32_t kap = (d->flags & KP_TRACE_FLG_KAP) ? 1 : 0;
+	uint32_t kapp = (d->flags & KP_TRACE_FLG_KAPP) ? 1 : 0;
+
+	switch (evt) {
+		case KP_TRACE_EVT_ALPHA:
+			fprintf(out, "%sGetting alpha%s\n\r", KUNK, KNRM);
+			break;
+		case KP_TRACE_EVT_PHI01:
+			fprintf(out, "%sGetting phi0 & phi1%s\n\r", KUNK, KNRM);
+			break;
+		case KP_TRACE_EVT_LAMBDA:
+			if (d->jnbbit == 1) {
+				fprintf(out, "%sGetting lambda (aka first Z-mask)%s\n\r", KUNK, KNRM);
+			} else {
+				fprintf(out, "%sGetting periodic Z-remask%s\n\r", KUNK, KNRM);
+			}
+			break;
+		case KP_TRACE_EVT_SETUP1:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of setup, "
+					"R0 <- [2]P), R1 <- [P])\n");
+			break;
+		case KP_TRACE_EVT_SETUP2:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (second part of setup, "
+					"[3]P <- [2]P + P by ZADDU completed)\n");
+			break;
+		case KP_TRACE_EVT_AFTER_ZADDC:
+		case KP_TRACE_EVT_AFTER_ZADDU:
+			op = (evt == KP_TRACE_EVT_AFTER_ZADDC) ? "ZADDC" : "ZADDU";
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates after %s of BIT %d "
+					"(kap%d = %d,  kap'%d = %d)\n",
+					op, d->jnbbit, d->jnbbit, kap, d->jnbbit, kapp);
+			break;
+		case KP_TRACE_EVT_SUBP_COZ:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (first part of subtractP, "
+					"[k + 1 - (k mod 2)]P & P made Co-Z)\n");
+			break;
+		case KP_TRACE_EVT_SUBP_DONE:
+			fprintf(out, "[VHD-CMP-SAGE] R1 coordinates (second part of subtractP, "
+					"cond. sub. [k + 1 - (k mod 2)]P - P completed)\n");
+			break;
+		case KP_TRACE_EVT_EXIT:
+			fprintf(out, "[VHD-CMP-SAGE] R1 coordinates (after exit routine, "
+					"end of computation, result is in R1 if not null)\n");
+			break;
+		case KP_TRACE_EVT_ZADD_VOID:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (in .zadd_voidL)\n");
+			break;
+		case KP_TRACE_EVT_ZDBL_NA_IN:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (entrance of .zdbl_not_alwaysL)\n");
+			break;
+		case KP_TRACE_EVT_ZDBL_NA_OUT:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .zdbl_not_alwaysL)\n");
+			break;
+		case KP_TRACE_EVT_PRE_ZADDU_OUT:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .pre_zadduL)\n");
+			break;
+		case KP_TRACE_EVT_ZADDU_OUT:
+			fprintf(out, "[VHD-CMP-SAGE] R0/R1 coordinates (terminated .zadduL)\n");
+			break;
+		default:
+			/* KP_TRACE_EVT_KAPMSK, KP_TRACE_EVT_KAPPMSK & KP_TRACE_EVT_PHIMSK
+			 * only show the PC line followed by the masks. */
+			break;
+	}
+}
+
+static void kp_trace_dec_lgnb(kp_trace_dec_t* d, uint32_t id, FILE* out)
+{
+	int32_t i;
+	bool isz = false;
+	bool colored = false;
+	const char* pfx = kp_trace_nb_str[id];
+
+	switch (id) {
+		case KP_TRACE_NB_XR0:
+		case KP_TRACE_NB_YR0:
+			isz = (d->flags & KP_TRACE_FLG_R0Z) ? true : false;
+			break;
+		case KP_TRACE_NB_XR1:
+		case KP_TRACE_NB_YR1:
+			isz = (d->flags & KP_TRACE_FLG_R1Z) ? true : false;
+			break;
+		case KP_TRACE_NB_LAMBDA:
+			pfx = (d->jnbbit == 1) ? "lambda = 0x" : "Z-remask = 0x";
+			colored = true;
+			break;
+		case KP_TRACE_NB_ALPHA:
+		case KP_TRACE_NB_PHI0:
+		case KP_TRACE_NB_PHI1:
+			colored = true;
+			break;
+		default:
+			break;
+	}
+
+	if (colored) {
+		fprintf(out, "%s", KUNK);
+	}
+	fprintf(out, "%s", pfx);
+	for (i = d->w - 1; i >= 0; i--) {
+		fprintf(out, "%0*x", (int)DIV(d->ww, 4), d->nb[id][i]);
+	}
+	if (colored) {
+		fprintf(out, "%s\n\r", KNRM);
+	} else if (id == KP_TRACE_NB_ZR01) {
+		fprintf(out, "\n");
+	} else {
+		fprintf(out, "%s\n\r", isz ? ((id <= KP_TRACE_NB_YR0) ? " but R0 = 0" : " but R1 = 0") : "");
+	}
+}
+
+/*
+ * Decode the record at the head of 'rec' (of 'sz' bytes available) and render
+ * it to 'out'. Returns the size of the record, or -1 if it is malformed.
+ */
+static int kp_trace_dec_rec(kp_trace_dec_t* d, const uint8_t* rec, uint32_t sz, FILE* out)
+{
+	uint32_t type, arg, len, i;
+	const uint8_t* p = rec + KP_TRACE_REC_HDR_SZ;
+
+	if (sz < KP_TRACE_REC_HDR_SZ) {
+		goto err;
+	}
+	type = rec[0];
+	arg = rec[1];
+	len = kp_trace_get16(rec + 2);
+	if (sz < (KP_TRACE_REC_HDR_SZ + len)) {
+		goto err;
+	}
+	if ((d->hdr == false) && (type != KP_TRACE_REC_HDR)) {
+		goto err;
+	}
+
+	switch (type) {
+		case KP_TRACE_REC_HDR:
+			if ((len < 12) || (arg != KP_TRACE_VERSION) || (kp_trace_get32(p) != KP_TRACE_MAGIC)) {
+				goto err;
+			}
+			d->nn = kp_trace_get16(p + 4);
+			d->ww = kp_trace_get16(p + 6);
+			d->w = kp_trace_get16(p + 8);
+			if ((4 * d->w) > (KP_TRACE_REC_MAX_SZ - KP_TRACE_REC_HDR_SZ)) {
+				goto err;
+			}
+			d->hdr = true;
+			break;
+		case KP_TRACE_REC_MSG:
+			if (arg >= (sizeof(kp_trace_msg_str) / sizeof(kp_trace_msg_str[0]))) {
+				goto err;
+			}
+			fprintf(out, "%s", kp_trace_msg_str[arg]);
+			break;
+		case KP_TRACE_REC_STEP:
+			if (len < 8) {
+				goto err;
+			}
+			d->flags = p[3];
+			d->jnbbit = kp_trace_get16(p + 4);
+			fprintf(out, "PC=%s0x%03x%s (%s%s%s)\n\r", KGRN, kp_trace_get16(p), KNRM,
+					KYEL, str_ipecc_state(p[2]), KNRM);
+			kp_trace_dec_step(d, arg, out);
+			break;
+		case KP_TRACE_REC_LGNB:
+		case KP_TRACE_REC_SAME:
+			if (arg >= KP_TRACE_NB_NB) {
+				goto err;
+			}
+			if (type == KP_TRACE_REC_LGNB) {
+				if (len != (4 * d->w)) {
+					goto err;
+				}
+				for (i = 0; i < d->w; i++) {
+					d->nb[arg][i] = kp_trace_get32(p + (4 * i));
+				}
+			}
+			kp_trace_dec_lgnb(d, arg, out);
+			break;
+		case KP_TRACE_REC_END:
+			if (len < 4) {
+				goto err;
+			}
+			fprintf(out, "%d debug steps for this [k]P computation.\n", kp_trace_get32(p));
+			break;
+		default:
+			goto err;
+	}
+
+	return KP_TRACE_REC_HDR_SZ + len;
+err:
+	return -1;
+}
+
+/*
+ * Render a complete [k]P trace stream of 'sz' bytes as text to 'out'.
+ */
+int kp_trace_decode(const uint8_t* buf, uint32_t sz, FILE* out)
+{
+	static kp_trace_dec_t dec;
+	uint32_t off = 0;
+	int n;
+
+	while (off < sz) {
+		if (buf[off] == KP_TRACE_REC_HDR) {
+			dec.hdr = false;
+		}
+		n = kp_trace_dec_rec(&dec, buf + off, sz - off, out);
+		if (n < 0) {
+			fprintf(out, "%sError: malformed [k]P trace record at offset %d%s\n\r", KERR, off, KNRM);
+			goto err;
+		}
+		off += n;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+static int kp_trace_buf_append(kp_trace_buf_t* b, const uint8_t* data, uint32_t sz)
+{
+	uint8_t* nbuf;
+	uint32_t nmax;
+
+	if ((b->sz + sz) > b->max) {
+		nmax = (b->max ? b->max : 65536);
+		while (nmax < (b->sz + sz)) {
+			nmax *= 2;
+		}
+		nbuf = realloc(b->buf, nmax);
+		if (nbuf == NULL) {
+			goto err;
+		}
+		b->buf = nbuf;
+		b->max = nmax;
+	}
+	memcpy(b->buf + b->sz, data, sz);
+	b->sz += sz;
+
+	return 0;
+err:
+	return -1;
+}
+
+/*
+ * Sink (for field 'sink' of kp_trace_info_t) appending records to
+ * a growable memory buffer. If compiled with -DKP_TRACE_CONSOLE records
+ * are also rendered to the console on-the-fly.
+ */
+int kp_trace_mem_sink(void* arg, const uint8_t* rec, uint32_t sz)
+{
+	if (kp_trace_buf_append((kp_trace_buf_t*)arg, rec, sz)) {
+		goto err;
+	}
+#ifdef KP_TRACE_CONSOLE
+	{
+		static kp_trace_dec_t dec;
+		if (rec[0] == KP_TRACE_REC_HDR) {
+			dec.hdr = false;
+		}
+		(void)kp_trace_dec_rec(&dec, rec, sz, stdout);
+	}
+#endif
+
+	return 0;
+err:
+	return -1;
+}
+
+/*
+ * Sink (for field 'sink' of kp_trace_info_t) writing records to the
+ * file descriptor pointed to by 'arg'. Such a file can be rendered
+ * offline with the 'kp-trace-decode' tool.
+ */
+int kp_trace_fd_sink(void* arg, const uint8_t* rec, uint32_t sz)
+{
+	int fd = *((int*)arg);
+	ssize_t n;
+
+	while (sz) {
+		n = write(fd, rec, sz);
+		if (n <= 0) {
+			goto err;
+		}
+		rec += n;
+		sz -= n;
+	}
+
+	return 0;
+err:
+	return -1;
+}
+
+#ifdef KP_TRACE_DECODE_MAIN
+int main(int argc, char* argv[])
+{
+	kp_trace_buf_t b = { .buf = NULL, .sz = 0, .max = 0 };
+	uint8_t tmp[4096];
+	ssize_t n;
+	int fd = STDIN_FILENO;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [trace-file]\n", argv[0]);
+		fprintf(stderr, "Renders a binary [k]P trace (from stdin if no file is given) as text.\n");
+		goto err;
+	}
+	if (argc == 2) {
+		fd = open(argv[1], O_RDONLY);
+		if (fd < 0) {
+			perror(argv[1]);
+			goto err;
+		}
+	}
+	while ((n = read(fd, tmp, sizeof(tmp))) > 0) {
+		if (kp_trace_buf_append(&b, tmp, n)) {
+			fprintf(stderr, "Error: out of memory\n");
+			goto err;
+		}
+	}
+	if (n < 0) {
+		perror("read");
+		goto err;
+	}
+	if (kp_trace_decode(b.buf, b.sz, stdout)) {
+		goto err;
+	}
+	free(b.buf);
+
+	return 0;
+err:
+	return 1;
+}
+#endif /* KP_TRACE_DECODE_MAIN */
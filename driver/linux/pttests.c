@@ -410,3 +410,89 @@ int check_test_oppos(ipecc_test_t* t, /* stats_t* st, */ bool* res)
 err:
 	return -1;
 }
+
+/* Test "is P in the subgroup of order q?" (see hw_driver_check_order())
+ *
+ * Self-contained test on Wei25519 (the short Weierstrass form of
+ * Curve25519, of cofactor 8), running two subgroup checks back to back:
+ * first on the base point G (of order q), then on G + T, T being a
+ * point of order 4 (so that [q](G + T) = [q]T is not the null point).
+ * The null result of the first check must not leak into the second one.
+ */
+static const uint8_t wei25519_p[32] = {
+	0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xed
+};
+static const uint8_t wei25519_a[32] = {
+	0x2a, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+	0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0x98, 0x49, 0x14, 0xa1, 0x44
+};
+static const uint8_t wei25519_b[32] = {
+	0x7b, 0x42, 0x5e, 0xd0, 0x97, 0xb4, 0x25, 0xed, 0x09, 0x7b, 0x42, 0x5e, 0xd0, 0x97, 0xb4, 0x25,
+	0xed, 0x09, 0x7b, 0x42, 0x5e, 0xd0, 0x97, 0xb4, 0x26, 0x0b, 0x5e, 0x9c, 0x77, 0x10, 0xc8, 0x64
+};
+static const uint8_t wei25519_q[32] = {
+	0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x14, 0xde, 0xf9, 0xde, 0xa2, 0xf7, 0x9c, 0xd6, 0x58, 0x12, 0x63, 0x1a, 0x5c, 0xf5, 0xd3, 0xed
+};
+static const uint8_t wei25519_gx[32] = {
+	0x2a, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+	0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xad, 0x24, 0x5a
+};
+static const uint8_t wei25519_gy[32] = {
+	0x20, 0xae, 0x19, 0xa1, 0xb8, 0xa0, 0x86, 0xb4, 0xe0, 0x1e, 0xdd, 0x2c, 0x77, 0x48, 0xd1, 0x4c,
+	0x92, 0x3d, 0x4d, 0x7e, 0x6d, 0x7c, 0x61, 0xb2, 0x29, 0xe9, 0xc5, 0xa2, 0x7e, 0xce, 0xd3, 0xd9
+};
+static const uint8_t wei25519_gtx[32] = {
+	0x49, 0x59, 0x78, 0x99, 0x8d, 0x27, 0x55, 0xdf, 0x58, 0x72, 0x4b, 0x63, 0xce, 0x07, 0xf3, 0x8d,
+	0x66, 0x9b, 0x40, 0x58, 0xbf, 0x5d, 0x98, 0xa3, 0x29, 0x3f, 0x8c, 0xa9, 0x72, 0xdc, 0xcf, 0x0e
+};
+static const uint8_t wei25519_gty[32] = {
+	0x29, 0x63, 0x46, 0xbb, 0xcc, 0x9f, 0x74, 0x3d, 0x91, 0xdb, 0x44, 0x2e, 0xea, 0xbb, 0x2c, 0xae,
+	0x02, 0xf3, 0x98, 0xb0, 0xe3, 0xa5, 0x53, 0xd6, 0x22, 0xf0, 0xe7, 0x31, 0xdf, 0x2e, 0x9c, 0xb2
+};
+
+int ip_test_check_order(bool* res)
+{
+	bool in_subgroup;
+
+	*res = false;
+
+	if (hw_driver_set_curve(wei25519_a, sizeof(wei25519_a), wei25519_b, sizeof(wei25519_b),
+				wei25519_p, sizeof(wei25519_p), wei25519_q, sizeof(wei25519_q)))
+	{
+		printf("%sError: transmitting curve Wei25519 to the hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+
+	/* G is in the subgroup */
+	if (hw_driver_check_order(wei25519_gx, sizeof(wei25519_gx), wei25519_gy, sizeof(wei25519_gy), &in_subgroup))
+	{
+		printf("%sError: Test \"is P in the subgroup?\" by hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (in_subgroup == false) {
+		printf("%sError: mistmatch between hardware result and expected one for \"is P in the subgroup?\" test.\n\r"
+				"         Hardware says false however it should be true (point G).%s\n\r", KERR, KNRM);
+		goto err;
+	}
+
+	/* G + T is not (its check runs right after the one of G) */
+	if (hw_driver_check_order(wei25519_gtx, sizeof(wei25519_gtx), wei25519_gty, sizeof(wei25519_gty), &in_subgroup))
+	{
+		printf("%sError: Test \"is P in the subgroup?\" by hardware triggered an error.%s\n\r", KERR, KNRM);
+		goto err;
+	}
+	if (in_subgroup == true) {
+		printf("%sError: mistmatch between hardware result and expected one for \"is P in the subgroup?\" test.\n\r"
+				"         Hardware says true however it should be false (point G + T).%s\n\r", KERR, KNRM);
+		goto err;
+	}
+
+	PRINTF("HW & SW answers match for test \"is P in the subgroup?\" (G then G + T)\n\r");
+	*res = true;
+
+	return 0;
+err:
+	return -1;
+}
@@ -0,0 +1,591 @@
+/*
+ *  Copyright (C) 2023 - This file is part of IPECC project
+ *
+ *  Authors:
+ *      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+ *      Ryad BENADJILA <ryadbenadjila@gmail.com>
+ *
+ *  Contributors:
+ *      Adrian THILLARD
+ *      Emmanuel PROUFF
+ *
+ *  This software is licensed under GPL v2 license.
+ *  See LICENSE file at the root folder of the project.
+ */
+
+/*
+ * Reader of the binary test-vector format (see VEC_BIN_* in ecc-test-linux.h).
+ *
+ * The file is mmap'ed and each call to vec_bin_next() only checks the bounds
+ * of the next record & points into the mapping, so that on the target the
+ * cost of reading the test-vectors no longer competes with the one of the
+ * hardware computations (as parsing the text format does for small nn).
+ *
+ * When this file is compiled with -DVEC_BIN_MAIN it also provides the main()
+ * of the host tool 'vec-bin-convert' which converts test-vectors from the
+ * text format (as produced e.g by sage/ecc-gen-vectors) to the binary one.
+ */
+
+#include "../hw_accelerator_driver.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ecc-test-linux.h"
+
+static inline uint32_t vec_bin_get16(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t vec_bin_get32(const uint8_t* p)
+{
+	return vec_bin_get16(p) | (vec_bin_get16(p + 2) << 16);
+}
+
+/* Which large numbers a test record holds, depending on its operation. */
+static bool vec_bin_op_has_q(uint32_t op)
+{
+	return (op == OP_PTADD) || (op == OP_TST_EQU) || (op == OP_TST_OPP);
+}
+
+static bool vec_bin_op_has_res(uint32_t op)
+{
+	return (op == OP_KP) || (op == OP_PTADD) || (op == OP_PTDBL) || (op == OP_PTNEG);
+}
+
+/*
+ * Return the position of the next large number of 'sz' bytes in a record
+ * & move forward, or NULL if the record is too short to hold it.
+ */
+static const uint8_t* vec_bin_take(const uint8_t** pos, const uint8_t* end, uint32_t sz)
+{
+	const uint8_t* p = *pos;
+
+	if ((size_t)(end - p) < sz) {
+		return NULL;
+	}
+	*pos = p + sz;
+	return p;
+}
+
+int vec_bin_map(const char* path, vec_bin_t* vb)
+{
+	struct stat st;
+	void* m;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("%sError: can't open binary test-vector file '%s'.%s\n\r", KERR, path, KNRM);
+		goto err;
+	}
+	if (fstat(fd, &st) < 0) {
+		printf("%sError: can't get size of binary test-vector file '%s'.%s\n\r", KERR, path, KNRM);
+		goto err_close;
+	}
+	if ((size_t)st.st_size < VEC_BIN_HDR_SZ) {
+		printf("%sError: '%s' is not a binary test-vector file (too short).%s\n\r", KERR, path, KNRM);
+		goto err_close;
+	}
+	m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m == MAP_FAILED) {
+		printf("%sError: can't mmap binary test-vector file '%s'.%s\n\r", KERR, path, KNRM);
+		goto err_close;
+	}
+	/* (the mapping stays valid once the file is closed) */
+	close(fd);
+	madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+	vb->base = (const uint8_t*)m;
+	vb->sz = (size_t)st.st_size;
+	vb->off = VEC_BIN_HDR_SZ;
+	vb->nn = 0;
+	if (memcmp(vb->base, VEC_BIN_MAGIC, VEC_BIN_MAGIC_SZ)) {
+		printf("%sError: '%s' is not a binary test-vector file (bad magic, convert "
+				"text test-vectors with 'vec-bin-convert').%s\n\r", KERR, path, KNRM);
+		goto err_unmap;
+	}
+	if (vec_bin_get32(vb->base + VEC_BIN_MAGIC_SZ) != VEC_BIN_VERSION) {
+		printf("%sError: binary test-vector file '%s' has version %u (expected %u).%s\n\r", KERR,
+				path, vec_bin_get32(vb->base + VEC_BIN_MAGIC_SZ), VEC_BIN_VERSION, KNRM);
+		goto err_unmap;
+	}
+
+	return 0;
+err_unmap:
+	vec_bin_unmap(vb);
+	goto err;
+err_close:
+	close(fd);
+err:
+	return -1;
+}
+
+void vec_bin_unmap(vec_bin_t* vb)
+{
+	if (vb->base) {
+		munmap((void*)vb->base, vb->sz);
+	}
+	vb->base = NULL;
+	vb->sz = 0;
+}
+
+/*
+ * Get next record of a mapped file in 'r'.
+ *
+ * Returns 1 if a record was read, 0 at the end of the file
+ * and -1 if the file is corrupted.
+ */
+int vec_bin_next(vec_bin_t* vb, vec_bin_rec_t* r)
+{
+	const uint8_t* h;
+	const uint8_t* pos;
+	const uint8_t* end;
+	uint32_t len, nsz;
+
+	if (vb->off == vb->sz) {
+		return 0;
+	}
+	if ((vb->sz - vb->off) < VEC_BIN_REC_HDR_SZ) {
+		printf("%sError: truncated record header in binary test-vector file "
+				"(offset %zu).%s\n\r", KERR, vb->off, KNRM);
+		goto err;
+	}
+	h = vb->base + vb->off;
+	len = vec_bin_get32(h + 8);
+	if ((len < VEC_BIN_REC_HDR_SZ) || (len % 4) || (len > (vb->sz - vb->off))) {
+		printf("%sError: invalid record size %u in binary test-vector file "
+				"(offset %zu).%s\n\r", KERR, len, vb->off, KNRM);
+		goto err;
+	}
+	r->type = h[0];
+	r->flags = h[1];
+	r->nbbld = vec_bin_get16(h + 2);
+	r->id = vec_bin_get32(h + 4);
+	r->p = r->a = r->b = r->q = NULL;
+	r->px = r->py = r->qx = r->qy = r->k = r->rx = r->ry = NULL;
+	pos = h + VEC_BIN_REC_HDR_SZ;
+	end = h + len;
+
+	if (r->type == VEC_BIN_REC_CURVE) {
+		if ((end - pos) < 4) {
+			goto err_short;
+		}
+		r->nn = vec_bin_get32(pos);
+		pos += 4;
+		if ((r->nn == 0) || (NN_SZ(r->nn) > NBMAXSZ)) {
+			printf("%sError: invalid value %u of nn in binary test-vector file "
+					"(offset %zu).%s\n\r", KERR, r->nn, vb->off, KNRM);
+			goto err;
+		}
+		nsz = NN_SZ(r->nn);
+		if (((r->p = vec_bin_take(&pos, end, nsz)) == NULL)
+				|| ((r->a = vec_bin_take(&pos, end, nsz)) == NULL)
+				|| ((r->b = vec_bin_take(&pos, end, nsz)) == NULL)
+				|| ((r->q = vec_bin_take(&pos, end, nsz)) == NULL))
+		{
+			goto err_short;
+		}
+		vb->nn = r->nn;
+	} else if ((r->type >= OP_KP) && (r->type <= OP_TST_OPP)) {
+		if (vb->nn == 0) {
+			printf("%sError: test record before any curve record in binary test-vector file "
+					"(offset %zu).%s\n\r", KERR, vb->off, KNRM);
+			goto err;
+		}
+		r->nn = vb->nn;
+		nsz = NN_SZ(vb->nn);
+		if ( !(r->flags & VEC_BIN_F_P_NULL) ) {
+			if (((r->px = vec_bin_take(&pos, end, nsz)) == NULL)
+					|| ((r->py = vec_bin_take(&pos, end, nsz)) == NULL)) {
+				goto err_short;
+			}
+		}
+		if ( (vec_bin_op_has_q(r->type)) && !(r->flags & VEC_BIN_F_Q_NULL) ) {
+			if (((r->qx = vec_bin_take(&pos, end, nsz)) == NULL)
+					|| ((r->qy = vec_bin_take(&pos, end, nsz)) == NULL)) {
+				goto err_short;
+			}
+		}
+		if (r->type == OP_KP) {
+			if ((r->k = vec_bin_take(&pos, end, nsz)) == NULL) {
+				goto err_short;
+			}
+		}
+		if ( (vec_bin_op_has_res(r->type)) && !(r->flags & VEC_BIN_F_RES_NULL) ) {
+			if (((r->rx = vec_bin_take(&pos, end, nsz)) == NULL)
+					|| ((r->ry = vec_bin_take(&pos, end, nsz)) == NULL)) {
+				goto err_short;
+			}
+		}
+	} else {
+		printf("%sError: unknown record type 0x%02x in binary test-vector file "
+				"(offset %zu).%s\n\r", KERR, r->type, vb->off, KNRM);
+		goto err;
+	}
+	vb->off += len;
+
+	return 1;
+err_short:
+	printf("%sError: record too short for its content in binary test-vector file "
+			"(offset %zu).%s\n\r", KERR, vb->off, KNRM);
+err:
+	return -1;
+}
+
+#ifdef VEC_BIN_MAIN
+/*
+ * Converter from the text format of test-vectors to the binary one.
+ *
+ * Contrary to ecc-test-linux it doesn't enforce the order of the lines
+ * inside a curve or a test: a record is written as soon as the last line
+ * of the curve ("q=") or of the test (the expected result) is read, and
+ * it must then hold all the large numbers its operation requires.
+ */
+
+/* Large numbers of a record under construction (index in conv_t.nb) */
+enum {
+	NB_P = 0, NB_A, NB_B, NB_Q,
+	NB_PX, NB_PY, NB_QX, NB_QY, NB_K, NB_RX, NB_RY,
+	NB_NB
+};
+
+typedef struct {
+	FILE* out;
+	uint32_t lineno;
+	uint32_t nn;
+	/* record under construction */
+	uint32_t type;
+	uint32_t flags;
+	uint32_t nbbld;
+	uint32_t id;
+	bool exception;
+	bool set[NB_NB];
+	uint8_t nb[NB_NB][NBMAXSZ];
+	/* serialized record */
+	uint8_t rec[VEC_BIN_REC_HDR_SZ + 4 + (NB_NB * NBMAXSZ)];
+} conv_t;
+
+/* Tokens of the text format giving a large number ('complete' when it is the
+ * last line of a record).
+ */
+static const struct {
+	const char* tok;
+	uint32_t nb;
+	bool complete;
+} conv_nb_tok[] = {
+	{ "p=0x", NB_P, false }, { "a=0x", NB_A, false }, { "b=0x", NB_B, false }, { "q=0x", NB_Q, true },
+	{ "Px=0x", NB_PX, false }, { "Py=0x", NB_PY, false },
+	{ "Qx=0x", NB_QX, false }, { "Qy=0x", NB_QY, false },
+	{ "k=0x", NB_K, false },
+	{ "kPx=0x", NB_RX, false }, { "kPy=0x", NB_RY, true },
+	{ "PplusQx=0x", NB_RX, false }, { "PplusQy=0x", NB_RY, true },
+	{ "twoPx=0x", NB_RX, false }, { "twoPy=0x", NB_RY, true },
+	{ "negPx=0x", NB_RX, false }, { "negPy=0x", NB_RY, true },
+};
+
+/* Tokens of the text format giving a null point */
+static const struct {
+	const char* tok;
+	uint32_t flag;
+	bool complete;
+} conv_null_tok[] = {
+	{ "P=0", VEC_BIN_F_P_NULL, false }, { "Q=0", VEC_BIN_F_Q_NULL, false },
+	{ "kP=0", VEC_BIN_F_RES_NULL, true }, { "PplusQ=0", VEC_BIN_F_RES_NULL, true },
+	{ "twoP=0", VEC_BIN_F_RES_NULL, true }, { "negP=0", VEC_BIN_F_RES_NULL, true },
+};
+
+static const struct {
+	const char* tok;
+	uint32_t op;
+} conv_test_tok[] = {
+	{ "== TEST [k]P #", OP_KP }, { "== TEST P+Q #", OP_PTADD },
+	{ "== TEST [2]P #", OP_PTDBL }, { "== TEST -P #", OP_PTNEG },
+	{ "== TEST isPoncurve #", OP_TST_CHK }, { "== TEST isP==Q #", OP_TST_EQU },
+	{ "== TEST isP==-Q #", OP_TST_OPP },
+};
+
+#define ARRAY_SZ(a)  (sizeof(a) / sizeof((a)[0]))
+
+static inline void conv_put16(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void conv_put32(uint8_t* p, uint32_t v)
+{
+	conv_put16(p, v);
+	conv_put16(p + 2, v >> 16);
+}
+
+static void conv_reset(conv_t* c, uint32_t type, uint32_t id)
+{
+	memset(c->set, 0, sizeof(c->set));
+	c->type = type;
+	c->flags = 0;
+	c->nbbld = 0;
+	c->id = id;
+}
+
+/*
+ * Convert the hexadecimal string 'pc' (without the 0x) into a big-endian
+ * number of 'sz' bytes.
+ */
+static int conv_hex(const char* pc, uint8_t* nb, uint32_t sz)
+{
+	size_t n, i, j;
+	uint8_t d;
+
+	for (n = 0; (pc[n] != '\0') && (pc[n] != '\r') && (pc[n] != '\n')
+			&& (pc[n] != ' ') && (pc[n] != '\t'); n++)
+		;
+	if (n == 0) {
+		goto err;
+	}
+	memset(nb, 0, sz);
+	for (i = n, j = 0; i-- > 0; j++) {
+		if ((pc[i] >= '0') && (pc[i] <= '9')) {
+			d = pc[i] - '0';
+		} else if ((pc[i] >= 'a') && (pc[i] <= 'f')) {
+			d = pc[i] - 'a' + 10;
+		} else if ((pc[i] >= 'A') && (pc[i] <= 'F')) {
+			d = pc[i] - 'A' + 10;
+		} else {
+			goto err;
+		}
+		if (j / 2 < sz) {
+			nb[sz - 1 - (j / 2)] |= (j % 2) ? (d << 4) : d;
+		} else if (d) {
+			/* (leading zeros beyond nn are harmless) */
+			goto err;
+		}
+	}
+	return 0;
+err:
+	return -1;
+}
+
+/* Serialize & write the record under construction. */
+static int conv_write(conv_t* c)
+{
+	static const uint32_t curve_nbs[] = { NB_P, NB_A, NB_B, NB_Q };
+	uint32_t nbs[NB_NB];
+	uint32_t i, n = 0, len, nsz;
+
+	nsz = NN_SZ(c->nn);
+	len = VEC_BIN_REC_HDR_SZ;
+	if (c->type == VEC_BIN_REC_CURVE) {
+		conv_put32(c->rec + len, c->nn);
+		len += 4;
+		for (i = 0; i < ARRAY_SZ(curve_nbs); i++) {
+			nbs[n++] = curve_nbs[i];
+		}
+	} else {
+		if ( !(c->flags & VEC_BIN_F_P_NULL) ) {
+			nbs[n++] = NB_PX;
+			nbs[n++] = NB_PY;
+		}
+		if ( (vec_bin_op_has_q(c->type)) && !(c->flags & VEC_BIN_F_Q_NULL) ) {
+			nbs[n++] = NB_QX;
+			nbs[n++] = NB_QY;
+		}
+		if (c->type == OP_KP) {
+			nbs[n++] = NB_K;
+		}
+		if ( (vec_bin_op_has_res(c->type)) && !(c->flags & VEC_BIN_F_RES_NULL) ) {
+			nbs[n++] = NB_RX;
+			nbs[n++] = NB_RY;
+		}
+		if (c->exception) {
+			c->flags |= VEC_BIN_F_EXCEPTION;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		if (c->set[nbs[i]] == false) {
+			fprintf(stderr, "Error: line %u: %s #%u is missing some of its values.\n",
+					c->lineno, (c->type == VEC_BIN_REC_CURVE) ? "curve" : "test", c->id);
+			goto err;
+		}
+		memcpy(c->rec + len, c->nb[nbs[i]], nsz);
+		len += nsz;
+	}
+	/* Pad to a multiple of 4 bytes */
+	while (len % 4) {
+		c->rec[len++] = 0;
+	}
+	c->rec[0] = (uint8_t)c->type;
+	c->rec[1] = (uint8_t)c->flags;
+	conv_put16(c->rec + 2, c->nbbld);
+	conv_put32(c->rec + 4, c->id);
+	conv_put32(c->rec + 8, len);
+	if (fwrite(c->rec, 1, len, c->out) != len) {
+		perror("fwrite");
+		goto err;
+	}
+	/* An "# EXCEPTION" comment only applies up to the end of the next record */
+	c->exception = false;
+	conv_reset(c, 0, 0);
+
+	return 0;
+err:
+	return -1;
+}
+
+static int conv_line(conv_t* c, const char* line)
+{
+	const char* s;
+	uint32_t i;
+
+	if (line[0] == '#') {
+		if (strncmp(line, "# EXCEPTION", strlen("# EXCEPTION")) == 0) {
+			c->exception = true;
+		}
+		return 0;
+	}
+	for (s = line; (*s == ' ') || (*s == '\t'); s++)
+		;
+	if ((*s == '\0') || (*s == '\r') || (*s == '\n')) {
+		return 0;
+	}
+	if ((strncmp(line, "== ", strlen("== ")) == 0) && (c->type != 0)) {
+		fprintf(stderr, "Error: line %u: %s #%u is not complete.\n", c->lineno,
+				(c->type == VEC_BIN_REC_CURVE) ? "curve" : "test", c->id);
+		goto err;
+	}
+	if (strncmp(line, "== NEW CURVE #", strlen("== NEW CURVE #")) == 0) {
+		c->nn = 0;
+		conv_reset(c, VEC_BIN_REC_CURVE, strtoul(line + strlen("== NEW CURVE #"), NULL, 10));
+		return 0;
+	}
+	for (i = 0; i < ARRAY_SZ(conv_test_tok); i++) {
+		if (strncmp(line, conv_test_tok[i].tok, strlen(conv_test_tok[i].tok)) == 0) {
+			if (c->nn == 0) {
+				fprintf(stderr, "Error: line %u: test before any curve.\n", c->lineno);
+				goto err;
+			}
+			/* The test nb is the one after the dot ("#curve.test") */
+			s = strchr(line + strlen(conv_test_tok[i].tok), '.');
+			conv_reset(c, conv_test_tok[i].op, s ? strtoul(s + 1, NULL, 10) : 0);
+			return 0;
+		}
+	}
+	if (c->type == 0) {
+		fprintf(stderr, "Error: line %u: value outside of any curve or test.\n", c->lineno);
+		goto err;
+	}
+	if (strncmp(line, "nn=", strlen("nn=")) == 0) {
+		c->nn = strtoul(line + strlen("nn="), NULL, 10);
+		if ((c->nn == 0) || (NN_SZ(c->nn) > NBMAXSZ)) {
+			fprintf(stderr, "Error: line %u: invalid value of nn.\n", c->lineno);
+			goto err;
+		}
+		return 0;
+	}
+	if (strncmp(line, "nbbld=", strlen("nbbld=")) == 0) {
+		c->nbbld = strtoul(line + strlen("nbbld="), NULL, 10);
+		if (c->nbbld > 0xffff) {
+			fprintf(stderr, "Error: line %u: nb of blinding bits too large.\n", c->lineno);
+			goto err;
+		}
+		return 0;
+	}
+	for (i = 0; i < ARRAY_SZ(conv_nb_tok); i++) {
+		if (strncmp(line, conv_nb_tok[i].tok, strlen(conv_nb_tok[i].tok)) == 0) {
+			if (c->nn == 0) {
+				fprintf(stderr, "Error: line %u: value before \"nn=\".\n", c->lineno);
+				goto err;
+			}
+			if (conv_hex(line + strlen(conv_nb_tok[i].tok), c->nb[conv_nb_tok[i].nb], NN_SZ(c->nn))) {
+				fprintf(stderr, "Error: line %u: invalid hexadecimal number (or larger than nn).\n",
+						c->lineno);
+				goto err;
+			}
+			c->set[conv_nb_tok[i].nb] = true;
+			return conv_nb_tok[i].complete ? conv_write(c) : 0;
+		}
+	}
+	for (i = 0; i < ARRAY_SZ(conv_null_tok); i++) {
+		if (strncmp(line, conv_null_tok[i].tok, strlen(conv_null_tok[i].tok)) == 0) {
+			c->flags |= conv_null_tok[i].flag;
+			return conv_null_tok[i].complete ? conv_write(c) : 0;
+		}
+	}
+	if ((strncasecmp(line, "true", strlen("true")) == 0) || (strncasecmp(line, "false", strlen("false")) == 0)) {
+		if ((c->type != OP_TST_CHK) && (c->type != OP_TST_EQU) && (c->type != OP_TST_OPP)) {
+			fprintf(stderr, "Error: line %u: answer in a test which is not a point test.\n", c->lineno);
+			goto err;
+		}
+		if (strncasecmp(line, "true", strlen("true")) == 0) {
+			c->flags |= VEC_BIN_F_TRUE;
+		}
+		return conv_write(c);
+	}
+	fprintf(stderr, "Error: line %u: unknown token.\n", c->lineno);
+err:
+	return -1;
+}
+
+int main(int argc, char* argv[])
+{
+	static conv_t c;
+	FILE* in = stdin;
+	char* line = NULL;
+	size_t len = 0;
+	uint8_t hdr[VEC_BIN_HDR_SZ];
+
+	if (argc > 3) {
+		fprintf(stderr, "Usage: %s [text-file [binary-file]]\n", argv[0]);
+		fprintf(stderr, "Converts text test-vectors (from stdin if no file is given) to the binary\n");
+		fprintf(stderr, "format that ecc-test-linux reads when given a file as argument (to stdout\n");
+		fprintf(stderr, "if no output file is given).\n");
+		goto err;
+	}
+	c.out = stdout;
+	if ((argc >= 2) && (strcmp(argv[1], "-"))) {
+		if ((in = fopen(argv[1], "r")) == NULL) {
+			perror(argv[1]);
+			goto err;
+		}
+	}
+	if (argc == 3) {
+		if ((c.out = fopen(argv[2], "wb")) == NULL) {
+			perror(argv[2]);
+			goto err;
+		}
+	}
+	memcpy(hdr, VEC_BIN_MAGIC, VEC_BIN_MAGIC_SZ);
+	conv_put32(hdr + VEC_BIN_MAGIC_SZ, VEC_BIN_VERSION);
+	if (fwrite(hdr, 1, sizeof(hdr), c.out) != sizeof(hdr)) {
+		perror("fwrite");
+		goto err;
+	}
+	while (getline(&line, &len, in) != -1) {
+		c.lineno++;
+		if (conv_line(&c, line)) {
+			goto err;
+		}
+	}
+	if (c.type != 0) {
+		fprintf(stderr, "Error: input ends in the middle of %s #%u.\n",
+				(c.type == VEC_BIN_REC_CURVE) ? "curve" : "test", c.id);
+		goto err;
+	}
+	free(line);
+	if (fclose(c.out)) {
+		perror("fclose");
+		return 1;
+	}
+
+	return 0;
+err:
+	free(line);
+	return 1;
+}
+#endif /* VEC_BIN_MAIN */
@@ -34,7 +34,13 @@ entity ecc is
 		-- width of AXI data bus
 		constant C_S_AXI_DATA_WIDTH : integer := axi32or64; -- in ecc_customize
 		-- width of AXI address bus
-		constant C_S_AXI_ADDR_WIDTH : integer := AXIAW -- in ecc_pkg
+		constant C_S_AXI_ADDR_WIDTH : integer := AXIAW; -- in ecc_pkg
+		-- simulation-only pathnames, default values are set in ecc_customize
+		-- (having them as generics allows to override them from the command
+		-- line of the simulator, e.g to run several simulations in parallel)
+		constant simlog : string := simlogfile;
+		constant simxyshuflog : string := simxyshuflogfile;
+		constant simtrng : string := simtrngfile
 	);
 	port(
 		-- AXI clock
@@ -257,6 +263,13 @@ architecture struct of ecc is
 			dbgdecodepc : in std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
 			dbgbreakpointid : in std_logic_vector(1 downto 0);
 			dbgbreakpointhit : in std_logic;
+			dbgtraceen : out std_logic;
+			dbgtraceclr : out std_logic;
+			dbgtraceraddr : out std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+			dbgtracere : out std_logic;
+			dbgtracerdata : in std_logic_vector(31 downto 0);
+			dbgtracecnt : in std_logic_vector(TRACE_ADDR_SZ downto 0);
+			dbgtraceovf : in std_logic;
 			-- HW unsecure/Side-Channel analysis features
 			--    (interface with ecc_curve_iram)
 			dbgiwaddr : out std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
@@ -302,6 +315,8 @@ architecture struct of ecc is
 			not_always_add : out std_logic;
 			no_nnrnd_sf : out std_logic;
 			no_collision_cr : out std_logic;
+			-- performance counters (interface with ecc_fp)
+			perfmmbusy : in std_logic_vector(0 to nbmult - 1);
 			clkmm : in std_logic; -- Montgomery mult. clock required as input (for division & out)
 			clkdivo : out std_logic;
 			clkmmdivo : out std_logic
@@ -417,6 +432,7 @@ architecture struct of ecc is
 
 	-- unit handling execution of microcore routines
 	component ecc_curve is
+		generic(simxyshuflog : string);
 		port(
 			clk : in std_logic;
 			rstn : in  std_logic; -- deassertion ('1') assumed to be synchr. w/ clk
@@ -480,6 +496,13 @@ architecture struct of ecc is
 			dbgtrngcompletebypass : in std_logic;
 			dbgxy01addr : out std_logic_vector(7 downto 0);
 			dbgxy01nextaddr : out std_logic_vector(7 downto 0);
+			dbgtraceen : in std_logic;
+			dbgtraceclr : in std_logic;
+			dbgtraceraddr : in std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+			dbgtracere : in std_logic;
+			dbgtracerdata : out std_logic_vector(31 downto 0);
+			dbgtracecnt : out std_logic_vector(TRACE_ADDR_SZ downto 0);
+			dbgtraceovf : out std_logic;
 			-- HW unsecure/Side-Channel analysis features
 			--   (interface with ecc_scalar shared w/ ecc_axi)
 			dbgpgmstate : in std_logic_vector(3 downto 0);
@@ -537,6 +560,7 @@ architecture struct of ecc is
 	--    other arithmetic operations
 	--  - performs result data write back into ecc_fp_dram
 	component ecc_fp is
+		generic(simlog : string);
 		port (
 			clk : in std_logic;
 			rstn : in  std_logic; -- deassertion ('1') assumed synchronous to clk
@@ -547,6 +571,8 @@ architecture struct of ecc is
 			-- interface with multipliers
 			mmi : out mmi_type;
 			mmo : in mmo_type;
+			-- interface with ecc_axi (performance counters)
+			mmbusy : out std_logic_vector(0 to nbmult - 1);
 			-- interface with ecc_fp_dram
 			fpre : out std_logic;
 			fpraddr : out std_logic_vector(FP_ADDR - 1 downto 0);
@@ -625,6 +651,7 @@ architecture struct of ecc is
 
 	-- True random number generator w/ embedded post-processing
 	component ecc_trng is
+		generic(simtrng : string);
 		port(
 			clk : in std_logic;
 			rstn : in std_logic;
@@ -970,6 +997,7 @@ architecture struct of ecc is
 	signal mmi : mmi_type;
 	signal mmo : mmo_type;
 	-- signals between ecc_axi & ecc_fp
+	signal mmbusy : std_logic_vector(0 to nbmult - 1);
 	signal nndyn_nnrnd_mask : std_logic_vector(ww - 1 downto 0);
 	signal nndyn_nnrnd_maskwg : unsigned(log2(w) - 1 downto 0);
 	-- signals between ecc_axi and ecc_fp_dram
@@ -1035,6 +1063,13 @@ architecture struct of ecc is
 	signal dbgdecodepc : std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
 	signal dbgbreakpointid : std_logic_vector(1 downto 0);
 	signal dbgbreakpointhit : std_logic;
+	signal dbgtraceen : std_logic;
+	signal dbgtraceclr : std_logic;
+	signal dbgtraceraddr : std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+	signal dbgtracere : std_logic;
+	signal dbgtracerdata : std_logic_vector(31 downto 0);
+	signal dbgtracecnt : std_logic_vector(TRACE_ADDR_SZ downto 0);
+	signal dbgtraceovf : std_logic;
 	-- HW unsecure/Side-Channel analysis features (signals between ecc_axi & ecc_fp)
 	signal dbgtrngnnrnddet : std_logic;
 	-- HW unsecure/Side-Channel analysis features (signals between ecc_axi & ecc_trng)
@@ -1081,6 +1116,7 @@ architecture struct of ecc is
 	-- software reset (to other components of the IP)
 	signal swrst : std_logic;
 
+
 begin
 
 	assert (axi32or64 = 32 or axi32or64 = 64)
@@ -1271,6 +1307,13 @@ begin
 			dbgdecodepc => dbgdecodepc,
 			dbgbreakpointid => dbgbreakpointid,
 			dbgbreakpointhit => dbgbreakpointhit,
+			dbgtraceen => dbgtraceen,
+			dbgtraceclr => dbgtraceclr,
+			dbgtraceraddr => dbgtraceraddr,
+			dbgtracere => dbgtracere,
+			dbgtracerdata => dbgtracerdata,
+			dbgtracecnt => dbgtracecnt,
+			dbgtraceovf => dbgtraceovf,
 			-- HW unsecure features (interface with ecc_curve_iram)
 			dbgiwaddr => dbgiwaddr,
 			dbgiwdata => dbgiwdata,
@@ -1312,6 +1355,8 @@ begin
 			not_always_add => not_always_add,
 			no_nnrnd_sf => no_nnrnd_sf,
 			no_collision_cr => no_collision_cr,
+			-- performance counters (interface with ecc_fp)
+			perfmmbusy => mmbusy,
 			clkmm => clkmm, -- Montgomery mult. clock required as input (for division & out)
 			clkdivo => clkdivo,
 			clkmmdivo => clkmmdivo
@@ -1425,6 +1470,7 @@ begin
 
 	-- curve arithmetic programs/routines execution unit
 	c0: ecc_curve
+		generic map(simxyshuflog => simxyshuflog)
 		port map(
 			clk => s_axi_aclk,
 			rstn => s_axi_aresetn_resync,
@@ -1488,6 +1534,13 @@ begin
 			dbgtrngcompletebypass => dbgtrngcompletebypass,
 			dbgxy01addr => dbgxy01addr,
 			dbgxy01nextaddr => dbgxy01nextaddr,
+			dbgtraceen => dbgtraceen,
+			dbgtraceclr => dbgtraceclr,
+			dbgtraceraddr => dbgtraceraddr,
+			dbgtracere => dbgtracere,
+			dbgtracerdata => dbgtracerdata,
+			dbgtracecnt => dbgtracecnt,
+			dbgtraceovf => dbgtraceovf,
 			-- HW unsecure/Side-Channel analysis features (interface with ecc_scalar)
 			dbgpgmstate => dbgpgmstate,
 			dbgnbbits => dbgnbbits
@@ -1537,6 +1590,7 @@ begin
 	-- prime field arithmetic (unit controlling arithmetic operations
 	-- submitted by ecc_curve while executing programs/routines)
 	f0: ecc_fp
+		generic map(simlog => simlog)
 		port map(
 			clk => s_axi_aclk,
 			rstn => s_axi_aresetn_resync,
@@ -1547,6 +1601,8 @@ begin
 			-- interface with multipliers
 			mmi => mmi,
 			mmo => mmo,
+			-- interface with ecc_axi (performance counters)
+			mmbusy => mmbusy,
 			-- interface with ecc_fp_dram
 			fpre => fpre,
 			fpraddr => fpraddr,
@@ -1623,6 +1679,7 @@ begin
 
 	-- TRNG
 	t0: ecc_trng
+		generic map(simtrng => simtrng)
 		port map(
 			clk => s_axi_aclk,
 			rstn => s_axi_aresetn_resync,
@@ -188,6 +188,13 @@ entity ecc_axi is
 		dbgdecodepc : in std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
 		dbgbreakpointid : in std_logic_vector(1 downto 0);
 		dbgbreakpointhit : in std_logic;
+		dbgtraceen : out std_logic;
+		dbgtraceclr : out std_logic;
+		dbgtraceraddr : out std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+		dbgtracere : out std_logic;
+		dbgtracerdata : in std_logic_vector(31 downto 0);
+		dbgtracecnt : in std_logic_vector(TRACE_ADDR_SZ downto 0);
+		dbgtraceovf : in std_logic;
 		-- HW unsecure/Side-Channel analysis features (interface with ecc_curve_iram)
 		dbgiwaddr : out std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
 		dbgiwdata : out std_logic_vector(OPCODE_SZ - 1 downto 0);
@@ -232,6 +239,8 @@ entity ecc_axi is
 		not_always_add : out std_logic;
 		no_nnrnd_sf : out std_logic;
 		no_collision_cr : out std_logic;
+		-- performance counters (interface with ecc_fp)
+		perfmmbusy : in std_logic_vector(0 to nbmult - 1);
 		clkmm : in std_logic; -- Montgomery mult. clock required as input (for division & out)
 		clkdivo : out std_logic;
 		clkmmdivo : out std_logic
@@ -247,6 +256,26 @@ architecture rtl of ecc_axi is
 
 	constant readlat : positive := set_readlat;
 
+	-- shadow operand slots (only used when 'shadow' = TRUE in ecc_customize)
+	-- slot 0 holds the next scalar k, slot 1 the next XR1 & slot 2 the next YR1,
+	-- each slot being made of SHW words of C_S_AXI_DATA_WIDTH bits
+	constant SHW : positive := div(nn, C_S_AXI_DATA_WIDTH);
+	constant SHAW : positive := log2((3 * SHW) - 1);
+
+	-- hardware command queue (only used when 'cmdqdepth' > 0 in ecc_customize)
+	-- a command is made of the 7 point-operation bits of W_CTRL & of an 8-bit
+	-- sequence id, a completion record adds to them the YES, R1_NULL & ERR
+	-- flags (see R_CMDQ_RESULT)
+	constant CQOPW : positive := CTRL_PT_OPP - CTRL_KP + 1;
+	constant CQIDW : positive := CMDQ_RES_ID_MSB - CMDQ_RES_ID_LSB + 1;
+	constant CQCW : positive := CQOPW + CQIDW;
+	constant CQRW : positive := CQCW + 3;
+	constant CQCNTW : positive := log2(cmdqdepth);
+
+	-- random words read by software through R_RANDOM are made of RNDW words
+	-- of ww bits pulled from the AXI IRN FIFO of ecc_trng
+	constant RNDW : positive := div(C_S_AXI_DATA_WIDTH, ww);
+
 	type state_type is
 		(idle, writeln, readln, -- ln stands for large number
 		 newnn, -- used only when nn_dynamic = TRUE
@@ -265,6 +294,12 @@ architecture rtl of ecc_axi is
 		arready : std_logic;
 		rvalid : std_logic;
 		rdatax : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0); -- AXI R data
+		-- internally generated write-beats, see (s287)
+		intern : std_logic;
+		iawvalid : std_logic;
+		iwvalid : std_logic;
+		iwaddr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 4 downto 0);
+		iwdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
 	end record;
 
 	type reg_rnd_write_type is record
@@ -413,6 +448,93 @@ architecture rtl of ecc_axi is
 		swrst_cnt : unsigned(2 downto 0);
 	end record; -- ctrl
 
+	type shadow_step_type is (shctrl, shfetch, shdata, shend);
+	type shadow_cnt_type is array(0 to 2) of unsigned(log2(SHW) - 1 downto 0);
+
+	type reg_shadow_type is record
+		-- upload of operands by software into the shadow RAM
+		writing : std_logic;
+		slot : natural range 0 to 2;
+		cnt : shadow_cnt_type;
+		valid : std_logic_vector(0 to 2);
+		we : std_logic;
+		waddr : std_logic_vector(SHAW - 1 downto 0);
+		wdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		-- queued start of [k]P computation
+		kpqueued : std_logic;
+		outpending : std_logic;
+		rdyr1 : std_logic;
+		-- transfer of shadow operands (using internally generated AXI beats)
+		replay : std_logic;
+		step : shadow_step_type;
+		rslot : natural range 0 to 3;
+		rcnt : unsigned(log2(SHW) - 1 downto 0);
+		re : std_logic;
+		raddr : std_logic_vector(SHAW - 1 downto 0);
+		rdsh : std_logic_vector(1 downto 0);
+	end record;
+
+	type cmdq_step_type is (cqidle, cqfetch, cqexec, cqwait);
+
+	type reg_cmdq_type is record
+		-- push of commands by software
+		we : std_logic;
+		wdata : std_logic_vector(CQCW - 1 downto 0);
+		nextid : unsigned(CQIDW - 1 downto 0);
+		ovf : std_logic;
+		halted : std_logic;
+		flush : std_logic;
+		-- dispatch of commands (using internally generated AXI beats)
+		step : cmdq_step_type;
+		re : std_logic;
+		rdsh : std_logic_vector(2 downto 0);
+		cmd : std_logic_vector(CQCW - 1 downto 0);
+		err : std_logic;
+		-- completion records
+		rwe : std_logic;
+		rwdata : std_logic_vector(CQRW - 1 downto 0);
+		rre : std_logic;
+		rrdsh : std_logic_vector(2 downto 0);
+		head : std_logic_vector(CQRW - 1 downto 0);
+		headvalid : std_logic;
+	end record;
+
+	type reg_rng_type is record
+		trngrdy : std_logic;
+		buf : std_logic_vector((RNDW * ww) - 1 downto 0);
+		cnt : natural range 0 to RNDW;
+		full : std_logic;
+		data : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		arpending : std_logic;
+	end record;
+
+	-- microcode execution trace (only used when 'tracedepth' > 0 in
+	-- ecc_customize, in HW unsecure mode only)
+	type reg_trace_type is record
+		en : std_logic;
+		clr : std_logic;
+		-- read port of the trace RAM in ecc_curve
+		ptr : unsigned(TRACE_ADDR_SZ downto 0);
+		addr : std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+		re : std_logic;
+		rdv : std_logic;
+		-- one entry is kept ready for software
+		full : std_logic;
+		data : std_logic_vector(31 downto 0);
+		arpending : std_logic;
+	end record;
+
+	-- performance counters (only used when 'perfcnt' = TRUE in ecc_customize)
+	type perf_cnt_type is array(0 to PERF_NB - 1) of unsigned(31 downto 0);
+
+	type reg_perf_type is record
+		cnt : perf_cnt_type;
+		snap : perf_cnt_type;
+		sel : unsigned(PERF_CTRL_SEL_MSB - PERF_CTRL_SEL_LSB downto 0);
+		frz : std_logic;
+		clr : std_logic;
+	end record;
+
 	type nndyn_reg_type is record
 		valnntest : unsigned(log2(nn) - 1 downto 0);
 		valnn : unsigned(log2(nn) - 1 downto 0);
@@ -601,9 +723,21 @@ architecture rtl of ecc_axi is
 		ctrl : ctrl_reg_type;
 		nndyn : nndyn_reg_type;
 		debug : debug_reg_type;
+		shadow : reg_shadow_type;
+		cmdq : reg_cmdq_type;
+		rng : reg_rng_type;
+		perf : reg_perf_type;
+		trace : reg_trace_type;
 	end record;
 
 	signal r, rin : reg_type;
+	signal shadow_rdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+	signal cmdq_dout : std_logic_vector(CQCW - 1 downto 0);
+	signal cmdq_empty, cmdq_full : std_logic;
+	signal cmdq_count : std_logic_vector(CQCNTW - 1 downto 0);
+	signal cmdr_dout : std_logic_vector(CQRW - 1 downto 0);
+	signal cmdr_empty, cmdr_full : std_logic;
+	signal cmdr_count : std_logic_vector(CQCNTW - 1 downto 0);
 	signal nndyn_mask_s : std_logic_vector(ww - 1 downto 0);
 	signal nndyn_mask_is_all1_but_msb_s : std_logic;
 	signal nndyn_wm1_s : unsigned(log2(w - 1) - 1 downto 0);
@@ -790,12 +924,17 @@ begin
 	              dbgtrngaxirdy, dbgtrngaxivalid, dbgtrngefprdy, dbgtrngefpvalid,
 	              dbgtrngcrvrdy, dbgtrngcrvvalid, dbgtrngshfrdy, dbgtrngshfvalid,
 	              dbgtrngrawrdy, dbgtrngrawvalid,
+	              shadow_rdata,
+	              cmdq_dout, cmdq_empty, cmdq_full, cmdq_count,
+	              cmdr_dout, cmdr_empty, cmdr_full, cmdr_count,
+	              perfmmbusy,
 	              r_debug_clkmmcnt
 								-- /HW unsecure only
 	              , laststep, firstzdbl, firstzaddu, first2pz, first3pz, 
 	              torsion2, kap, kapp, zu, zc, r0z, r1z, dbgjoyebit,
 	              pts_are_equal, pts_are_oppos, phimsb, kb0end,
-	              dbgxy01addr, dbgxy01nextaddr
+	              dbgxy01addr, dbgxy01nextaddr,
+	              dbgtracerdata, dbgtracecnt, dbgtraceovf
 								-- HW unsecure only/
 							)
 		variable v : reg_type;
@@ -817,6 +956,8 @@ begin
 		variable dw : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
 		variable v_pop_possible, v_kp_possible : boolean;
 		variable v_busy, v_wlock : boolean;
+		variable v_computing : boolean;
+		variable v_mmused : natural range 0 to nbmult;
 		variable vtmp6 : unsigned(BLD_BITS_MSB - BLD_BITS_LSB + 1 downto 0);
 		variable vtmp7 : unsigned(BLD_BITS_MSB - BLD_BITS_LSB + 1 downto 0);
 		variable v_blindiff : unsigned(BLD_BITS_MSB - BLD_BITS_LSB + 1 downto 0);
@@ -1405,7 +1546,10 @@ begin
 		-- ----------------------------------------------------------
 
 		-- handshake over AXI address-write channel
-		if s_axi_awvalid = '1' and r.axi.awready = '1' then
+		-- (s_axi_awready is masked while internal write-beats are generated,
+		-- see (s287))
+		if s_axi_awvalid = '1' and r.axi.awready = '1' and r.axi.intern = '0'
+		then
 			v.axi.awpending := '1';
 			v.axi.waddr := s_axi_awaddr(C_S_AXI_ADDR_WIDTH - 1 downto 3);
 			v.axi.awready := '0';
@@ -1413,7 +1557,10 @@ begin
 		end if;
 
 		-- handshake over AXI data-write channel
-		if s_axi_wvalid = '1' and r.axi.wready = '1' then
+		-- (s_axi_wready is masked while internal write-beats are generated,
+		-- see (s287))
+		if s_axi_wvalid = '1' and r.axi.wready = '1' and r.axi.intern = '0'
+		then
 			v.axi.dwpending := '1';
 			-- note that r.axi.wdatax, which content is both pulled from AXI bus
 			-- and pushed into r.write.shdataww in shift-register mode, cannot be
@@ -1433,8 +1580,62 @@ begin
 			v.axi.bvalid := '0';
 		end if;
 
+		-- (s287) internally generated write-beats: while r.axi.intern is high
+		-- the write address & data channels are driven by ecc_axi itself
+		-- (transfer of shadow operands, see (s290), or dispatch of queued
+		-- commands, see (s293)) instead of AXI fabric - beats are then decoded
+		-- exactly as if they had been issued by software
+		if r.axi.intern = '1' then
+			if r.axi.iawvalid = '1' and r.axi.awready = '1' then
+				v.axi.awpending := '1';
+				v.axi.waddr := r.axi.iwaddr;
+				v.axi.awready := '0';
+				v.axi.arready := '0';
+				v.axi.iawvalid := '0';
+			end if;
+			if r.axi.iwvalid = '1' and r.axi.wready = '1' then
+				v.axi.dwpending := '1';
+				v.axi.wdatax := r.axi.iwdata;
+				v.axi.wready := '0';
+				v.axi.iwvalid := '0';
+			end if;
+		end if;
+
 		v_writebn_accepted := TRUE; -- (s54), see (s56)
 
+		-- (s300) microcode execution trace (see (s299) in ecc_curve.vhd)
+		-- Entries are prefetched from the trace RAM of ecc_curve one at a
+		-- time, so that one is always kept ready in r.trace.data for the
+		-- next read of R_DBG_TRACE_DATA by software (see (s301)).
+		if (not hwsecure) and tracedepth > 0 then -- statically resolved by synthesizer
+			v.trace.clr := '0';
+			v.trace.re := '0';
+			v.trace.rdv := r.trace.re; -- read latency of trace RAM is 1
+			if r.trace.rdv = '1' then
+				v.trace.data := dbgtracerdata;
+				v.trace.full := '1';
+			end if;
+			-- (r.trace.clr gates the prefetch for the one cycle it takes
+			-- ecc_curve to reset its count of entries)
+			if r.trace.full = '0' and r.trace.re = '0' and r.trace.rdv = '0'
+				and r.trace.clr = '0' and r.trace.ptr < unsigned(dbgtracecnt)
+			then
+				v.trace.re := '1';
+				v.trace.addr :=
+					std_logic_vector(r.trace.ptr(TRACE_ADDR_SZ - 1 downto 0));
+				v.trace.ptr := r.trace.ptr + 1;
+			end if;
+			-- a read of R_DBG_TRACE_DATA that was accepted while the entry was
+			-- still being fetched (see (s301)) is answered as soon as it is
+			if r.trace.arpending = '1' and r.trace.full = '1' then
+				v.axi.rdatax := (others => '0');
+				v.axi.rdatax(31 downto 0) := r.trace.data;
+				v.axi.rvalid := '1';
+				v.trace.arpending := '0';
+				v.trace.full := '0';
+			end if;
+		end if;
+
 		-- -----------------------------------------------------------
 		-- r.axi.awpending & r.axi.dwpending both HIGH: new write-beat
 		-- -----------------------------------------------------------
@@ -1448,6 +1649,20 @@ begin
 		if r.debug.readsh(0) = '1' then
 			v.debug.readrdy := '1';
 		end if;
+		if shadow then -- statically resolved by synthesizer
+			v.shadow.we := '0';
+			v.shadow.re := '0';
+			v.shadow.rdsh := '0' & r.shadow.rdsh(1);
+		end if;
+		if cmdqdepth > 0 then -- statically resolved by synthesizer
+			v.cmdq.we := '0';
+			v.cmdq.re := '0';
+			v.cmdq.rwe := '0';
+			v.cmdq.rre := '0';
+			v.cmdq.flush := '0';
+			v.cmdq.rdsh := '0' & r.cmdq.rdsh(2 downto 1);
+			v.cmdq.rrdsh := '0' & r.cmdq.rrdsh(2 downto 1);
+		end if;
 		if r.axi.awpending = '1' and r.axi.dwpending = '1' then
 			v.axi.awpending := '0';
 			v.axi.dwpending := '0';
@@ -1466,7 +1681,49 @@ begin
 				v.axi.arready := '1';
 				-- drive write-response to initiator
 				v.axi.bvalid := '1';
-				if (not v_wlock) or (not hwsecure) then -- (s162), see (s161)
+				-- any write to W_CTRL ends a possible upload of shadow operands
+				v.shadow.writing := '0';
+				if shadow and r.axi.wdatax(CTRL_SHADOW) = '1' then
+					-- -------------------------------------------------------
+					--        access to the shadow operand slots (s288)
+					-- -------------------------------------------------------
+					-- Shadow slots are not part of ecc_fp_dram, hence they can be
+					-- written even if a computation is running (no check of
+					-- v_wlock here), see (s289) for the upload of the data words
+					if r.axi.wdatax(CTRL_WRITE_NB) = '1' then
+						v_axi_wdatax_msb := r.axi.wdatax(
+							CTRL_NBADDR_LSB + FP_ADDR_MSB - 1 downto CTRL_NBADDR_LSB);
+						v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '0';
+						if v_axi_wdatax_msb = CST_ADDR_K
+							and r.axi.wdatax(CTRL_WRITE_K) = '1'
+						then
+							v.shadow.slot := 0;
+						elsif v_axi_wdatax_msb = CST_ADDR_XR1 then
+							v.shadow.slot := 1;
+						elsif v_axi_wdatax_msb = CST_ADDR_YR1 then
+							v.shadow.slot := 2;
+						else
+							-- only k, XR1 & YR1 have a shadow slot
+							v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '1';
+						end if;
+						if v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) = '0' then
+							v.shadow.writing := '1';
+							v.shadow.valid(v.shadow.slot) := '0';
+							v.shadow.cnt(v.shadow.slot) := (others => '0');
+						end if;
+					elsif r.axi.wdatax(CTRL_KP) = '1' then
+						-- queue a [k]P computation, which will actually start
+						-- as soon as possible, see (s290)
+						if r.shadow.valid = "111" and r.shadow.kpqueued = '0' then
+							v.shadow.kpqueued := '1';
+							v.ctrl.ierrid(STATUS_ERR_I_KP_FBD) := '0';
+						else
+							v.ctrl.ierrid(STATUS_ERR_I_KP_FBD) := '1';
+						end if;
+					else
+						v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '1';
+					end if;
+				elsif (not v_wlock) or (not hwsecure) then -- (s162), see (s161)
 					-- in HW unsecure mode we always grant write access to W_CTRL register
 					-- (so use with care)
 					-- Decode content of W_CTRL register. Since sevaral actions can
@@ -1506,6 +1763,9 @@ begin
 						-- by default the large number to write is not 'a', but see bypass
 						-- (s121) below
 						v.ctrl.newa := '0'; -- (s120)
+						-- software no longer cares about the result of the last [k]P
+						-- computation (if any), see (s291)
+						v.shadow.outpending := '0';
 						-- (s177)
 						-- set some flags according to the address of the large nb software
 						-- says he's about to modify, so that ecc_axi knows what curve
@@ -1754,6 +2014,18 @@ begin
 								end if;
 							end if;
 							if v_read_no_error then
+								-- (s291) the read of YR1 is the last thing software does
+								-- with the result of a [k]P computation: once it is over
+								-- the next queued computation is allowed to start, see
+								-- (s290)
+								if shadow and
+									v.fpaddr0(FP_ADDR - 1 downto FP_ADDR - FP_ADDR_MSB)
+										= CST_ADDR_YR1
+								then
+									v.shadow.rdyr1 := '1';
+								else
+									v.shadow.rdyr1 := '0';
+								end if;
 								v.read.fpre0 := '1';
 								v.read.rdataxcanbefilled := '1';
 								v.read.shdatawwcanbeemptied := '0';
@@ -1874,7 +2146,23 @@ begin
 				v.axi.arready := '1';
 				-- drive write-response to initiator
 				v.axi.bvalid := '1'; -- (s4)
-				if r.ctrl.state = writeln then -- (s57)
+				if shadow and r.shadow.writing = '1' then
+					-- (s289) one data word of a shadow operand, see (s288)
+					v.axi.wready := '1';
+					if r.shadow.cnt(r.shadow.slot) = to_unsigned(SHW, log2(SHW)) then
+						-- slot is already full
+						v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '1';
+					else
+						v.shadow.we := '1';
+						v.shadow.waddr := std_logic_vector(to_unsigned(
+							(r.shadow.slot * SHW) + to_integer(r.shadow.cnt(r.shadow.slot)),
+							SHAW));
+						v.shadow.wdata := r.axi.wdatax;
+						v.shadow.cnt(r.shadow.slot) := r.shadow.cnt(r.shadow.slot) + 1;
+						v.shadow.valid(r.shadow.slot) := '1';
+						v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '0';
+					end if;
+				elsif r.ctrl.state = writeln then -- (s57)
 					v.write.new32 := '1';
 					-- clear possible past error
 					v.ctrl.ierrid(STATUS_ERR_I_WREG_FBD) := '0';
@@ -2203,6 +2491,18 @@ begin
 				-- sub-component of the IP
 				v.ctrl.swrst := '1';
 				v.ctrl.swrst_cnt := (others => '1');
+				-- shadow operands & queued [k]P computation are discarded
+				v.shadow.writing := '0';
+				v.shadow.valid := "000";
+				v.shadow.kpqueued := '0';
+				v.shadow.outpending := '0';
+				-- so are commands pending in the command queue
+				v.cmdq.flush := '1';
+				v.cmdq.nextid := (others => '0');
+				v.cmdq.ovf := '0';
+				v.cmdq.halted := '0';
+				v.cmdq.headvalid := '0';
+				v.cmdq.rrdsh := "000";
 			-- ------------------------------------------------
 			-- decoding write to W_TOKEN register
 			-- ------------------------------------------------
@@ -2229,6 +2529,67 @@ begin
 					-- before being generated", see (s247))
 					v.ctrl.ierrid(STATUS_ERR_I_TOKEN) := '1'; -- (s248)
 				end if;
+			-- ------------------------------------------------
+			-- decoding write to W_CMDQ_PUSH register
+			-- ------------------------------------------------
+			-- (s292) pushing a command into the hardware command queue is
+			-- allowed even while the IP is busy (that's the whole point of it),
+			-- commands are then dispatched by (s293)
+			elsif cmdqdepth > 0 -- statically resolved by synthesizer
+			  and r.axi.waddr = W_CMDQ_PUSH
+			then
+				v.axi.wready := '1';
+				v.axi.awready := '1';
+				v.axi.arready := '1';
+				v.axi.bvalid := '1';
+				if cmdq_full = '0' and r.cmdq.we = '0' then
+					v.cmdq.we := '1';
+					v.cmdq.wdata := r.axi.wdatax(CTRL_PT_OPP downto CTRL_KP)
+						& std_logic_vector(r.cmdq.nextid);
+					v.cmdq.nextid := r.cmdq.nextid + 1;
+				else
+					-- queue is full, command is discarded
+					v.cmdq.ovf := '1';
+				end if;
+			-- ------------------------------------------------
+			-- decoding write to W_CMDQ_CTRL register
+			-- ------------------------------------------------
+			elsif cmdqdepth > 0 -- statically resolved by synthesizer
+			  and r.axi.waddr = W_CMDQ_CTRL
+			then
+				v.axi.wready := '1';
+				v.axi.awready := '1';
+				v.axi.arready := '1';
+				v.axi.bvalid := '1';
+				if r.axi.wdatax(CMDQ_CTRL_FLUSH) = '1' then
+					-- discard all pending commands & completion records (the
+					-- command possibly being executed is not affected, and its
+					-- completion record will still be produced)
+					v.cmdq.flush := '1';
+					v.cmdq.nextid := (others => '0');
+					v.cmdq.ovf := '0';
+					v.cmdq.halted := '0';
+					v.cmdq.headvalid := '0';
+					v.cmdq.rrdsh := "000";
+				elsif r.axi.wdatax(CMDQ_CTRL_RESUME) = '1' then
+					-- resume dispatch after a command ended in error
+					v.cmdq.halted := '0';
+				end if;
+			-- ------------------------------------------------
+			-- decoding write to W_PERF_CTRL register
+			-- ------------------------------------------------
+			-- (accepted even while the IP is busy, see (s298))
+			elsif perfcnt -- statically resolved by synthesizer
+			  and r.axi.waddr = W_PERF_CTRL
+			then
+				v.axi.wready := '1';
+				v.axi.awready := '1';
+				v.axi.arready := '1';
+				v.axi.bvalid := '1';
+				v.perf.sel := unsigned(
+					r.axi.wdatax(PERF_CTRL_SEL_MSB downto PERF_CTRL_SEL_LSB));
+				v.perf.frz := r.axi.wdatax(PERF_CTRL_FRZ);
+				v.perf.clr := r.axi.wdatax(PERF_CTRL_CLR);
 			-- ------------------------------
 			-- below are DEBUG only registers
 			-- ------------------------------
@@ -2282,6 +2643,27 @@ begin
 				v.axi.arready := '1';
 				v.axi.bvalid := '1';
 			-- ----------------------------------------------------------------
+			-- decoding write to W_DBG_TRACE_CTRL register
+			-- ----------------------------------------------------------------
+			elsif (not hwsecure) and r.axi.waddr = W_DBG_TRACE_CTRL then
+				v.trace.en := r.axi.wdatax(DBG_TRACE_EN);
+				if r.axi.wdatax(DBG_TRACE_CLR) = '1' then
+					-- stays asserted 1 cycle thx to (s300)
+					v.trace.clr := '1';
+				end if;
+				if r.axi.wdatax(DBG_TRACE_CLR) = '1'
+					or r.axi.wdatax(DBG_TRACE_RWD) = '1'
+				then
+					v.trace.ptr := (others => '0');
+					v.trace.re := '0';
+					v.trace.rdv := '0';
+					v.trace.full := '0';
+				end if;
+				v.axi.wready := '1';
+				v.axi.awready := '1';
+				v.axi.arready := '1';
+				v.axi.bvalid := '1';
+			-- ----------------------------------------------------------------
 			-- decoding write to W_DBG_TRIG_ACT register
 			-- ----------------------------------------------------------------
 			elsif (not hwsecure) and r.axi.waddr = W_DBG_TRIG_ACT then
@@ -2616,6 +2998,219 @@ begin
 			end if;
 		end if; -- awpending = dwpending = 1 (one data beat)
 
+		-- write responses to internal write-beats are not forwarded to AXI
+		-- fabric, see (s287)
+		if r.axi.intern = '1' then
+			v.axi.bvalid := '0';
+		end if;
+
+		-- ----------------------------------------------------------
+		--   transfer of shadow operands & start of queued [k]P (s290)
+		-- ----------------------------------------------------------
+		-- Once a [k]P computation has been queued by software (see (s288)), it
+		-- is started as soon as the IP is idle and the result of the previous
+		-- computation (if any) was read by software, see (s291). For this the
+		-- content of the three shadow slots is transferred into ecc_fp_dram by
+		-- generating internally the same sequence of writes to W_CTRL and to
+		-- W_WRITE_DATA that software would issue (see (s287)), followed by a
+		-- write to W_CTRL with the KP bit set. Each word is erased from the
+		-- shadow RAM as soon as it has been transferred.
+		if shadow then -- statically resolved by synthesizer
+			if r.shadow.replay = '0' then
+				if r.shadow.kpqueued = '1' and r.shadow.writing = '0'
+					and r.axi.intern = '0'
+					and r.shadow.outpending = '0' and (not v_busy)
+					and r.ctrl.state = idle and r.write.active = '0'
+					and r.read.active = '0'
+					and r.axi.awpending = '0' and r.axi.dwpending = '0'
+					and r.axi.awready = '1' and r.axi.wready = '1'
+					and r.axi.bvalid = '0'
+					-- no write transaction from software is on its way
+					and s_axi_awvalid = '0' and s_axi_wvalid = '0'
+					-- token & random conditions, same as in (s231) & (s122)
+					and ( ((not hwsecure) and (r.ctrl.token_act = '0'
+					                           or r.ctrl.tokwasread = '1'))
+					     or ((hwsecure) and r.ctrl.tokwasread = '1') )
+					and ( r.write.rnd.enough_random = '1'
+					     or ((not hwsecure) and r.debug.noaxirnd = '1') )
+				then
+					v.shadow.replay := '1';
+					v.axi.intern := '1';
+					v.shadow.rslot := 0;
+					v.shadow.step := shctrl;
+				end if;
+			elsif r.shadow.replay = '1' then
+				case r.shadow.step is
+					when shctrl =>
+						-- wait for the previous large number to be completely written
+						if r.axi.iawvalid = '0' and r.axi.iwvalid = '0'
+							and r.axi.awpending = '0' and r.axi.dwpending = '0'
+							and (not v_busy) and r.ctrl.state = idle
+							and r.write.active = '0'
+						then
+							v.axi.iawvalid := '1';
+							v.axi.iwvalid := '1';
+							v.axi.iwaddr := W_CTRL;
+							v.axi.iwdata := (others => '0');
+							if r.shadow.rslot = 3 then
+								v.axi.iwdata(CTRL_KP) := '1';
+								v.shadow.step := shend;
+							else
+								v.axi.iwdata(CTRL_WRITE_NB) := '1';
+								if r.shadow.rslot = 0 then
+									v.axi.iwdata(CTRL_WRITE_K) := '1';
+									v.axi.iwdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+										downto CTRL_NBADDR_LSB) := CST_ADDR_K;
+								elsif r.shadow.rslot = 1 then
+									v.axi.iwdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+										downto CTRL_NBADDR_LSB) := CST_ADDR_XR1;
+								else
+									v.axi.iwdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+										downto CTRL_NBADDR_LSB) := CST_ADDR_YR1;
+								end if;
+								v.shadow.rcnt := (others => '0');
+								v.shadow.raddr := std_logic_vector(
+									to_unsigned(r.shadow.rslot * SHW, SHAW));
+								v.shadow.step := shfetch;
+							end if;
+						end if;
+					when shfetch =>
+						-- wait for the previous beat to be consumed before
+						-- reading the next word from the shadow RAM
+						if r.axi.iawvalid = '0' and r.axi.iwvalid = '0'
+							and r.axi.awpending = '0' and r.axi.dwpending = '0'
+						then
+							if r.shadow.rcnt = r.shadow.cnt(r.shadow.rslot) then
+								v.shadow.rslot := r.shadow.rslot + 1;
+								v.shadow.step := shctrl;
+							else
+								v.shadow.re := '1';
+								v.shadow.rdsh := "10";
+								v.shadow.step := shdata;
+							end if;
+						end if;
+					when shdata =>
+						if r.shadow.rdsh(0) = '1' then
+							v.axi.iawvalid := '1';
+							v.axi.iwvalid := '1';
+							v.axi.iwaddr := W_WRITE_DATA;
+							v.axi.iwdata := shadow_rdata;
+							-- erase the word from the shadow RAM
+							v.shadow.we := '1';
+							v.shadow.waddr := r.shadow.raddr;
+							v.shadow.wdata := (others => '0');
+							v.shadow.raddr := std_logic_vector(unsigned(r.shadow.raddr) + 1);
+							v.shadow.rcnt := r.shadow.rcnt + 1;
+							v.shadow.step := shfetch;
+						end if;
+					when shend =>
+						-- wait for the KP order to be decoded
+						if r.axi.iawvalid = '0' and r.axi.iwvalid = '0'
+							and r.axi.awpending = '0' and r.axi.dwpending = '0'
+						then
+							v.shadow.replay := '0';
+							v.axi.intern := '0';
+							v.shadow.kpqueued := '0';
+							v.shadow.valid := "000";
+							v.shadow.cnt := (others => (others => '0'));
+						end if;
+				end case;
+			end if;
+		end if;
+
+		-- ----------------------------------------------------------
+		--          dispatch of queued commands (s293)
+		-- ----------------------------------------------------------
+		-- As soon as the IP is idle, the oldest command pushed by software
+		-- into the command queue (see (s292)) is popped out & issued as a write
+		-- to W_CTRL register using an internally generated beat (see (s287)).
+		-- It is then decoded exactly as if software had issued it, so it is
+		-- subject to the same conditions (k, XR1 & YR1 set, token read, etc.)
+		-- Once the IP is idle again, a completion record is pushed into the
+		-- result queue. A command which ends in error halts the dispatch until
+		-- software acknowledges it through W_CMDQ_CTRL.
+		-- Note that the write address & data channels are only masked during
+		-- the few cycles it takes to issue the command, not during its
+		-- execution, so that software can keep pushing commands & collecting
+		-- completion records in the meantime.
+		if cmdqdepth > 0 then -- statically resolved by synthesizer
+			case r.cmdq.step is
+				when cqidle =>
+					if cmdq_empty = '0' and r.cmdq.halted = '0'
+						and r.cmdq.flush = '0' and r.cmdq.we = '0'
+						-- there must be room for the completion record
+						and cmdr_full = '0' and r.cmdq.rwe = '0'
+						-- (v.axi.intern covers a transfer of shadow operands
+						-- possibly starting in this very cycle, see (s290))
+						and v.axi.intern = '0' and (not v_busy)
+						and r.ctrl.state = idle and r.write.active = '0'
+						and r.read.active = '0'
+						and r.axi.awpending = '0' and r.axi.dwpending = '0'
+						and r.axi.awready = '1' and r.axi.wready = '1'
+						and r.axi.bvalid = '0'
+						-- no write transaction from software is on its way
+						and s_axi_awvalid = '0' and s_axi_wvalid = '0'
+					then
+						v.axi.intern := '1';
+						v.cmdq.re := '1';
+						v.cmdq.rdsh := "100";
+						v.cmdq.step := cqfetch;
+					end if;
+				when cqfetch =>
+					if r.cmdq.rdsh(0) = '1' then
+						v.cmdq.cmd := cmdq_dout;
+						v.axi.iawvalid := '1';
+						v.axi.iwvalid := '1';
+						v.axi.iwaddr := W_CTRL;
+						v.axi.iwdata := (others => '0');
+						v.axi.iwdata(CTRL_PT_OPP downto CTRL_KP) :=
+							cmdq_dout(CQCW - 1 downto CQIDW);
+						v.cmdq.step := cqexec;
+					end if;
+				when cqexec =>
+					-- wait for the command to be decoded, then give the write
+					-- channels back to software
+					if r.axi.iawvalid = '0' and r.axi.iwvalid = '0'
+						and r.axi.awpending = '0' and r.axi.dwpending = '0'
+					then
+						v.axi.intern := '0';
+						-- the command was refused by (s188)-(s189) if the decoding
+						-- has just raised the error flag corresponding to it (the IP
+						-- then stays idle & the completion record is flagged ERR)
+						v.cmdq.err := r.ctrl.ierrid(STATUS_ERR_I_WREG_FBD);
+						if r.cmdq.cmd(CQIDW) = '1' then -- CTRL_KP bit of the command
+							if r.ctrl.ierrid(STATUS_ERR_I_KP_FBD) = '1' then
+								v.cmdq.err := '1';
+							end if;
+						elsif r.ctrl.ierrid(STATUS_ERR_I_POP_FBD) = '1' then
+							v.cmdq.err := '1';
+						end if;
+						v.cmdq.step := cqwait;
+					end if;
+				when cqwait =>
+					if not v_busy then
+						v.cmdq.rwe := '1';
+						v.cmdq.rwdata := r.cmdq.cmd(CQCW - 1 downto CQIDW)
+							& r.cmdq.err & r.ctrl.r1_is_null & r.ctrl.yes
+							& r.cmdq.cmd(CQIDW - 1 downto 0);
+						v.cmdq.halted := r.cmdq.err;
+						v.cmdq.step := cqidle;
+					end if;
+			end case;
+			-- prefetch of the oldest completion record into r.cmdq.head, from
+			-- where it is popped by a read of R_CMDQ_RESULT, see (s294)
+			if r.cmdq.headvalid = '0' and r.cmdq.rrdsh = "000"
+				and r.cmdq.rre = '0' and cmdr_empty = '0' and r.cmdq.flush = '0'
+			then
+				v.cmdq.rre := '1';
+				v.cmdq.rrdsh := "100";
+			end if;
+			if r.cmdq.rrdsh(0) = '1' and v.cmdq.flush = '0' then
+				v.cmdq.head := cmdr_dout;
+				v.cmdq.headvalid := '1';
+			end if;
+		end if;
+
 		-- detection of writing one new limb of a large number to be transferred
 		-- into ecc_fp_dram
 		-- (one large number among: p, a, b, q, [XY]R[01], k0, k1 when in HW secure
@@ -2637,13 +3232,132 @@ begin
 		-- r.write.rnd.irn to be resumed thx to (s67)
 		
 		-- handshake with ecc_trng
-		if r.write.rnd.trngrdy = '1' and trngvalid = '1' then
+		-- (random words read by software have priority, see (s295))
+		if r.write.rnd.trngrdy = '1' and trngvalid = '1' and r.rng.trngrdy = '0'
+		then
 			v.write.rnd.trngrdy := '0';
 			v.write.rnd.irn := trngdata;
 			v.write.rnd.irnempty := '0';
 			v.write.rnd.bitsirn := to_unsigned(ww - 1, log2(ww - 1));
 		end if;
 
+		-- (s295) random words for software (register R_RANDOM)
+		-- One word of C_S_AXI_DATA_WIDTH bits is kept ready in r.rng.data.
+		-- As soon as software has read it, the next one is gathered from
+		-- the AXI IRN FIFO of ecc_trng (the one that also feeds the masking
+		-- of the scalar, which waits during the few cycles it takes).
+		if r.rng.full = '0' and r.rng.trngrdy = '0' then
+			v.rng.trngrdy := '1';
+			v.rng.cnt := 0;
+		end if;
+		if r.rng.trngrdy = '1' and trngvalid = '1' then
+			v.rng.buf := trngdata & r.rng.buf((RNDW * ww) - 1 downto ww);
+			if r.rng.cnt = RNDW - 1 then
+				v.rng.trngrdy := '0';
+				v.rng.full := '1';
+				v.rng.data := v.rng.buf(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			else
+				v.rng.cnt := r.rng.cnt + 1;
+			end if;
+		end if;
+		-- a read of R_RANDOM that was accepted while no word was ready yet
+		-- (see (s296)) is answered as soon as one is
+		if r.rng.arpending = '1' and r.rng.full = '1' then
+			v.axi.rdatax := r.rng.data;
+			v.axi.rvalid := '1';
+			v.rng.arpending := '0';
+			v.rng.full := '0';
+		end if;
+
+		-- (s298) performance counters
+		-- Counters are free-running (they wrap around) and are only cleared
+		-- by reset or by software (bit CLR of W_PERF_CTRL). What software
+		-- reads through R_PERF_DATA is r.perf.snap, a copy of them which is
+		-- refreshed only while the IP is not computing (and not frozen by
+		-- software), so that no intermediate value can ever be sampled in
+		-- the middle of an operation.
+		if perfcnt then -- statically resolved by synthesizer
+			v_computing := r.ctrl.kppending = '1' or r.ctrl.poppending = '1'
+			              or r.ctrl.mtypending = '1' or r.ctrl.agocstmty = '1'
+			              or r.ctrl.amtypending = '1' or r.ctrl.agomtya = '1'
+			              or (nn_dynamic and r.nndyn.active = '1');
+			-- busy cycles per type of command
+			if r.ctrl.kppending = '1' then
+				v.perf.cnt(PERF_KP) := r.perf.cnt(PERF_KP) + 1;
+				-- [k]P cycles split by phase, according to the program
+				-- ecc_scalar is running (the few cycles in no program, e.g
+				-- waiting for the XY-shuffle permutation, are not counted)
+				if dbgpgmstate = DEBUG_STATE_CHECKONCURVE
+				  or dbgpgmstate = DEBUG_STATE_BLINDINIT
+				  or dbgpgmstate = DEBUG_STATE_BLINDBIT
+				  or dbgpgmstate = DEBUG_STATE_BLINDEXIT
+				  or dbgpgmstate = DEBUG_STATE_ADPA
+				  or dbgpgmstate = DEBUG_STATE_SETUP
+				then
+					v.perf.cnt(PERF_KP_SETUP) := r.perf.cnt(PERF_KP_SETUP) + 1;
+				elsif dbgpgmstate = DEBUG_STATE_ITOH
+				  or dbgpgmstate = DEBUG_STATE_ZADDU
+				  or dbgpgmstate = DEBUG_STATE_ZADDC
+				then
+					v.perf.cnt(PERF_KP_LADDER) := r.perf.cnt(PERF_KP_LADDER) + 1;
+				elsif dbgpgmstate = DEBUG_STATE_SUBTRACTP
+				  or dbgpgmstate = DEBUG_STATE_EXIT
+				then
+					v.perf.cnt(PERF_KP_EXIT) := r.perf.cnt(PERF_KP_EXIT) + 1;
+				end if;
+			end if;
+			if r.ctrl.poppending = '1' then
+				v.perf.cnt(PERF_PT_ADD + to_integer(unsigned(r.ctrl.popid))) :=
+					r.perf.cnt(PERF_PT_ADD + to_integer(unsigned(r.ctrl.popid))) + 1;
+			end if;
+			-- cycles where at least one client of ecc_trng is starving
+			if (dbgtrngaxirdy = '1' and dbgtrngaxivalid = '0')
+			  or (dbgtrngefprdy = '1' and dbgtrngefpvalid = '0')
+			  or (dbgtrngcrvrdy = '1' and dbgtrngcrvvalid = '0')
+			  or (dbgtrngshfrdy = '1' and dbgtrngshfvalid = '0')
+			then
+				v.perf.cnt(PERF_TRNG_STALL) := r.perf.cnt(PERF_TRNG_STALL) + 1;
+			end if;
+			-- Montgomery constants & signals associated to a new prime size
+			if r.ctrl.mtypending = '1' or r.ctrl.agocstmty = '1'
+			  or r.ctrl.amtypending = '1' or r.ctrl.agomtya = '1'
+			  or (nn_dynamic and r.nndyn.active = '1')
+			then
+				v.perf.cnt(PERF_MTY) := r.perf.cnt(PERF_MTY) + 1;
+			end if;
+			-- AXI-lite transfers
+			if s_axi_awvalid = '1' or s_axi_wvalid = '1' or s_axi_arvalid = '1'
+			  or r.axi.rvalid = '1' or r.axi.bvalid = '1'
+			then
+				v.perf.cnt(PERF_AXI) := r.perf.cnt(PERF_AXI) + 1;
+			end if;
+			-- Montgomery multipliers utilization
+			v_mmused := 0;
+			for i in 0 to nbmult - 1 loop
+				if perfmmbusy(i) = '1' then
+					v_mmused := v_mmused + 1;
+				end if;
+			end loop;
+			v.perf.cnt(PERF_MM_USED) := r.perf.cnt(PERF_MM_USED) + v_mmused;
+			if v_computing then
+				v.perf.cnt(PERF_MM_AVAIL) := r.perf.cnt(PERF_MM_AVAIL) + nbmult;
+			end if;
+			-- total number of cycles
+			v.perf.cnt(PERF_CYCLES) := r.perf.cnt(PERF_CYCLES) + 1;
+			-- copy visible by software
+			if not v_computing and r.perf.frz = '0' then
+				v.perf.snap := r.perf.cnt;
+			end if;
+			-- clear by software
+			if r.perf.clr = '1' then
+				for i in 0 to PERF_NB - 1 loop
+					v.perf.cnt(i) := (others => '0');
+					v.perf.snap(i) := (others => '0');
+				end loop;
+				v.perf.clr := '0';
+			end if;
+		end if;
+
 		-- (s203), bypass by HW unsecure feature, see (s202) register
 		-- W_DBG_CFG_AXIMSK
 		if r.debug.noaxirnd = '1' then
@@ -3177,6 +3891,9 @@ begin
 			-- authorize SW to read the result
 			v.ctrl.read_forbidden := '0';
 			v.ctrl.tokwasread := '0'; -- (s233), reset of (s232)
+			-- result must be read by software before a queued [k]P computation
+			-- may overwrite it, see (s290) & (s291)
+			v.shadow.outpending := '1';
 		end if;
 
 		-- -------------------------
@@ -3332,12 +4049,14 @@ begin
 			then
 				dw := (others => '0');
 				-- Informational bits
-				if v_busy then -- (s160), see (s30)
+				-- (internal write-beats are seen as busy by software, see (s287))
+				if v_busy or r.axi.intern = '1' then -- (s160), see (s30)
 					dw(STATUS_BUSY) := '1';
 				else
 					dw(STATUS_BUSY) := '0';
 				end if;
 				dw(STATUS_KP) := r.ctrl.kppending;
+				dw(STATUS_KP_QUEUED) := r.shadow.kpqueued;
 				dw(STATUS_MTY) :=
 				     r.ctrl.mtypending or r.ctrl.agocstmty -- or r.ctrl.newp;
 				  or r.ctrl.amtypending or r.ctrl.agomtya;
@@ -3419,6 +4138,28 @@ begin
 				else
 					dw(CAP_NNDYN) := '0';
 				end if;
+				-- presence of the descriptor-ring DMA engine is not known here:
+				-- bit CAP_DMA is set by ecc_dma (if any) on its way back, see
+				-- (s8) in ecc_dma.vhd
+				dw(CAP_DMA) := '0';
+				-- are shadow operand slots available, see (s288)
+				if shadow then -- statically resolved by synthesizer
+					dw(CAP_SHADOW) := '1';
+				else
+					dw(CAP_SHADOW) := '0';
+				end if;
+				-- is the hardware command queue available, see (s292)
+				if cmdqdepth > 0 then -- statically resolved by synthesizer
+					dw(CAP_CMDQ) := '1';
+				else
+					dw(CAP_CMDQ) := '0';
+				end if;
+				-- are performance counters available, see (s298)
+				if perfcnt then -- statically resolved by synthesizer
+					dw(CAP_PERF) := '1';
+				else
+					dw(CAP_PERF) := '0';
+				end if;
 				-- maximal (or static) value of prime size
 				dw(CAP_NNMAX_MSB downto CAP_NNMAX_LSB) := std_logic_vector(
 					to_unsigned(nn, log2(nn))); -- (s171)
@@ -3455,6 +4196,101 @@ begin
 					resize(r.nndyn.valnn, C_S_AXI_DATA_WIDTH));
 				v.axi.rdatax := dw;
 				v.axi.rvalid := '1'; -- (s5)
+			-- ---------------------------------------
+			-- decoding read of R_CMDQ_STATUS register
+			-- ---------------------------------------
+			elsif cmdqdepth > 0 -- statically resolved by synthesizer
+			  and s_axi_araddr(ADB + 2 downto 3) = R_CMDQ_STATUS
+			then
+				dw := (others => '0');
+				-- occupancy counts the command possibly being executed
+				if r.cmdq.step = cqidle then
+					dw(CMDQ_STS_OCC_MSB downto CMDQ_STS_OCC_LSB) := std_logic_vector(
+						resize(unsigned(cmdq_count), CMDQ_IDX_SZ));
+				else
+					dw(CMDQ_STS_OCC_MSB downto CMDQ_STS_OCC_LSB) := std_logic_vector(
+						resize(unsigned(cmdq_count), CMDQ_IDX_SZ) + 1);
+				end if;
+				dw(CMDQ_STS_DEPTH_MSB downto CMDQ_STS_DEPTH_LSB) :=
+					std_logic_vector(to_unsigned(cmdqdepth, CMDQ_IDX_SZ));
+				-- number of completion records not read yet by software
+				if r.cmdq.headvalid = '1' or r.cmdq.rrdsh /= "000" then
+					dw(CMDQ_STS_NBRES_MSB downto CMDQ_STS_NBRES_LSB) :=
+						std_logic_vector(resize(unsigned(cmdr_count), CMDQ_IDX_SZ) + 1);
+				else
+					dw(CMDQ_STS_NBRES_MSB downto CMDQ_STS_NBRES_LSB) :=
+						std_logic_vector(resize(unsigned(cmdr_count), CMDQ_IDX_SZ));
+				end if;
+				dw(CMDQ_STS_OVF) := r.cmdq.ovf;
+				dw(CMDQ_STS_HALTED) := r.cmdq.halted;
+				v.axi.rdatax := dw;
+				v.axi.rvalid := '1'; -- (s5)
+			-- ---------------------------------------
+			-- decoding read of R_CMDQ_RESULT register
+			-- ---------------------------------------
+			-- (s294) reading the oldest completion record pops it out
+			elsif cmdqdepth > 0 -- statically resolved by synthesizer
+			  and s_axi_araddr(ADB + 2 downto 3) = R_CMDQ_RESULT
+			then
+				dw := (others => '0');
+				if r.cmdq.headvalid = '1' then
+					dw(CMDQ_RES_ID_MSB downto CMDQ_RES_ID_LSB) :=
+						r.cmdq.head(CQIDW - 1 downto 0);
+					dw(CMDQ_RES_VALID) := '1';
+					dw(CMDQ_RES_YES) := r.cmdq.head(CQIDW);
+					dw(CMDQ_RES_R1_NULL) := r.cmdq.head(CQIDW + 1);
+					dw(CMDQ_RES_ERR) := r.cmdq.head(CQIDW + 2);
+					dw(CMDQ_RES_OP_MSB downto CMDQ_RES_OP_LSB) :=
+						r.cmdq.head(CQRW - 1 downto CQIDW + 3);
+					v.cmdq.headvalid := '0';
+				end if;
+				v.axi.rdatax := dw;
+				v.axi.rvalid := '1'; -- (s5)
+			-- ----------------------------------
+			-- decoding read of R_RANDOM register
+			-- ----------------------------------
+			-- (s296) each read pops one random word, see (s295)
+			elsif s_axi_araddr(ADB + 2 downto 3) = R_RANDOM then
+				if r.rng.full = '1' then
+					v.axi.rdatax := r.rng.data;
+					v.axi.rvalid := '1'; -- (s5)
+					v.rng.full := '0';
+				elsif to_integer(unsigned(trngaxiirncount)) + r.rng.cnt >= RNDW then
+					-- the word is being gathered, s_axi_rvalid will be asserted
+					-- by (s295) as soon as it is complete
+					v.rng.arpending := '1';
+				else
+					-- no random available
+					v.axi.rdatax := (others => '0');
+					v.axi.rvalid := '1'; -- (s5)
+					v.ctrl.ierrid(STATUS_ERR_I_RREG_FBD) := '1';
+				end if;
+			-- --------------------------------------
+			-- decoding read of R_RANDOM_CNT register
+			-- --------------------------------------
+			elsif s_axi_araddr(ADB + 2 downto 3) = R_RANDOM_CNT then
+				dw := (others => '0');
+				dw(RNDCNT_IRN_MSB downto RNDCNT_IRN_LSB) := std_logic_vector(
+					resize(unsigned(trngaxiirncount), RNDCNT_IRN_MSB - RNDCNT_IRN_LSB + 1));
+				dw(RNDCNT_NBW_MSB downto RNDCNT_NBW_LSB) := std_logic_vector(
+					to_unsigned(RNDW, RNDCNT_NBW_MSB - RNDCNT_NBW_LSB + 1));
+				dw(RNDCNT_RDY) := r.rng.full;
+				v.axi.rdatax := dw;
+				v.axi.rvalid := '1'; -- (s5)
+			-- -------------------------------------
+			-- decoding read of R_PERF_DATA register
+			-- -------------------------------------
+			-- (see (s298))
+			elsif perfcnt -- statically resolved by synthesizer
+			  and s_axi_araddr(ADB + 2 downto 3) = R_PERF_DATA
+			then
+				dw := (others => '0');
+				if to_integer(r.perf.sel) < PERF_NB then
+					dw(31 downto 0) := std_logic_vector(
+						r.perf.snap(to_integer(r.perf.sel)));
+				end if;
+				v.axi.rdatax := dw;
+				v.axi.rvalid := '1'; -- (s5)
 			-- ------------------------------
 			-- below are DEBUG only registers
 			-- ------------------------------
@@ -3799,6 +4635,48 @@ begin
 				v.axi.rdatax(31 downto 0) := dw;
 				v.axi.rvalid := '1'; -- (s5)
 			-- --------------------------------------------
+			-- decoding read of R_DBG_TRACE_STATUS register
+			-- --------------------------------------------
+			elsif (not hwsecure) -- statically resolved by synthesizer
+				and s_axi_araddr(ADB + 2 downto 3) = R_DBG_TRACE_STATUS
+			then
+				dw := (others => '0');
+				if tracedepth > 0 then -- statically resolved by synthesizer
+					dw(DBG_TRACE_STS_CNT_MSB downto DBG_TRACE_STS_CNT_LSB) :=
+						std_logic_vector(resize(unsigned(dbgtracecnt),
+							DBG_TRACE_STS_CNT_MSB - DBG_TRACE_STS_CNT_LSB + 1));
+					dw(DBG_TRACE_STS_LOGD_MSB downto DBG_TRACE_STS_LOGD_LSB) :=
+						std_logic_vector(to_unsigned(TRACE_ADDR_SZ,
+							DBG_TRACE_STS_LOGD_MSB - DBG_TRACE_STS_LOGD_LSB + 1));
+					dw(DBG_TRACE_STS_EN) := r.trace.en;
+					dw(DBG_TRACE_STS_OVF) := dbgtraceovf;
+				end if;
+				v.axi.rdatax(31 downto 0) := dw;
+				v.axi.rvalid := '1'; -- (s5)
+			-- ------------------------------------------
+			-- decoding read of R_DBG_TRACE_DATA register
+			-- ------------------------------------------
+			-- (s301) each read pops one trace entry, see (s300)
+			elsif (not hwsecure) -- statically resolved by synthesizer
+				and s_axi_araddr(ADB + 2 downto 3) = R_DBG_TRACE_DATA
+			then
+				if tracedepth > 0 and r.trace.full = '1' then
+					v.axi.rdatax(31 downto 0) := r.trace.data;
+					v.axi.rvalid := '1'; -- (s5)
+					v.trace.full := '0';
+				elsif tracedepth > 0 and (r.trace.re = '1' or r.trace.rdv = '1'
+					or (r.trace.clr = '0' and r.trace.ptr < unsigned(dbgtracecnt)))
+				then
+					-- the entry is being fetched, s_axi_rvalid will be asserted
+					-- by (s300) as soon as it is available
+					v.trace.arpending := '1';
+				else
+					-- no more entry in the trace
+					v.axi.rdatax := (others => '0');
+					v.axi.rvalid := '1'; -- (s5)
+					v.ctrl.ierrid(STATUS_ERR_I_RREG_FBD) := '1';
+				end if;
+			-- --------------------------------------------
 			-- unknown target address, drive back dumb data (all 1's)
 			-- --------------------------------------------
 			else
@@ -3837,6 +4715,10 @@ begin
 					-- reading is now over was the random token. Also assert
 					-- r.ctrl.tokwasread so as to allow [k]P computation to
 					-- start, see (s231)
+					if r.shadow.rdyr1 = '1' then
+						v.shadow.rdyr1 := '0';
+						v.shadow.outpending := '0'; -- see (s291)
+					end if;
 					if r.read.token = '1' then
 						v.ctrl.tokavail4read := '0'; -- (s230)
 						-- (s232) will be reset by (s233) at the end of [k]P computation
@@ -4734,6 +5616,9 @@ begin
 			v.axi.bvalid := '0';
 			v.axi.rvalid := '0';
 			v.axi.arready := '1';
+			v.axi.intern := '0';
+			v.axi.iawvalid := '0';
+			v.axi.iwvalid := '0';
 			v.write.doshift := '0';
 			v.write.new32 := '0';
 			v.write.fpwe0 := '0';
@@ -4878,6 +5763,50 @@ begin
 			v.write.active := '0';
 			v.write.busy := '0';
 			-- no need to reset r.write.rnd.masklsb nor .firstwwmask
+			-- shadow operand slots
+			v.shadow.writing := '0';
+			v.shadow.valid := "000";
+			v.shadow.we := '0';
+			v.shadow.kpqueued := '0';
+			v.shadow.outpending := '0';
+			v.shadow.rdyr1 := '0';
+			v.shadow.replay := '0';
+			v.shadow.re := '0';
+			v.shadow.rdsh := "00";
+			-- random words for software
+			v.rng.trngrdy := '0';
+			v.rng.cnt := 0;
+			v.rng.full := '0';
+			v.rng.arpending := '0';
+			-- microcode execution trace
+			v.trace.en := '0';
+			v.trace.clr := '0';
+			v.trace.ptr := (others => '0');
+			v.trace.re := '0';
+			v.trace.rdv := '0';
+			v.trace.full := '0';
+			v.trace.arpending := '0';
+			-- command queue
+			v.cmdq.we := '0';
+			v.cmdq.nextid := (others => '0');
+			v.cmdq.ovf := '0';
+			v.cmdq.halted := '0';
+			v.cmdq.flush := '0';
+			v.cmdq.step := cqidle;
+			v.cmdq.re := '0';
+			v.cmdq.rdsh := "000";
+			v.cmdq.rwe := '0';
+			v.cmdq.rre := '0';
+			v.cmdq.rrdsh := "000";
+			v.cmdq.headvalid := '0';
+			-- performance counters
+			for i in 0 to PERF_NB - 1 loop
+				v.perf.cnt(i) := (others => '0');
+				v.perf.snap(i) := (others => '0');
+			end loop;
+			v.perf.sel := (others => '0');
+			v.perf.frz := '0';
+			v.perf.clr := '0';
 			-- dynamic prime size feature
 			if nn_dynamic then
 				-- the idea here is that when nn_dynamic = TRUE, all r.nndyn.xxx
@@ -5081,8 +6010,10 @@ begin
 	xre <= r.read.fpre;
 
 	-- to external AXI interface
-	s_axi_awready <= r.axi.awready;
-	s_axi_wready <= r.axi.wready;
+	-- (write channels are masked while internal write-beats are generated,
+	-- see (s287))
+	s_axi_awready <= r.axi.awready and not r.axi.intern;
+	s_axi_wready <= r.axi.wready and not r.axi.intern;
 	s_axi_bresp <= CST_AXI_RESP_OKAY;
 	s_axi_bvalid <= r.axi.bvalid;
 	s_axi_arready <= r.axi.arready;
@@ -5213,11 +6144,97 @@ begin
 			else '0';
 	end generate;
 
+	-- shadow operand slots, see (s288)
+	sh0: if shadow generate -- statically resolved by synthesizer
+		sh00: syncram_sdp
+			generic map(
+				rdlat => 1, datawidth => C_S_AXI_DATA_WIDTH, datadepth => 3 * SHW)
+			port map(
+				clk => s_axi_aclk,
+				-- port A (W only)
+				addra => r.shadow.waddr,
+				wea => r.shadow.we,
+				dia => r.shadow.wdata,
+				-- port B (R only)
+				addrb => r.shadow.raddr,
+				reb => r.shadow.re,
+				dob => shadow_rdata
+			);
+	end generate;
+
+	sh1: if not shadow generate -- statically resolved by synthesizer
+		shadow_rdata <= (others => '0');
+	end generate;
+
+	-- hardware command queue & queue of completion records, see (s292)
+	cq0: if cmdqdepth > 0 generate -- statically resolved by synthesizer
+		signal gnd : std_logic;
+		signal gndd : std_logic_vector(log2(cmdqdepth - 1) - 1 downto 0);
+	begin
+		gnd <= '0';
+		gndd <= (others => '0');
+		cq00: fifo
+			generic map(
+				datawidth => CQCW, datadepth => cmdqdepth, debug => FALSE)
+			port map(
+				clk => s_axi_aclk,
+				rstn => s_axi_aresetn,
+				swrst => r.cmdq.flush,
+				datain => r.cmdq.wdata,
+				we => r.cmdq.we,
+				werr => open,
+				full => cmdq_full,
+				dataout => cmdq_dout,
+				re => r.cmdq.re,
+				empty => cmdq_empty,
+				rerr => open,
+				count => cmdq_count,
+				-- debug feature (not used here)
+				dbgdeact => gnd,
+				dbgwaddr => open,
+				dbgraddr => gndd,
+				dbgrst => gnd
+			);
+		cq01: fifo
+			generic map(
+				datawidth => CQRW, datadepth => cmdqdepth, debug => FALSE)
+			port map(
+				clk => s_axi_aclk,
+				rstn => s_axi_aresetn,
+				swrst => r.cmdq.flush,
+				datain => r.cmdq.rwdata,
+				we => r.cmdq.rwe,
+				werr => open,
+				full => cmdr_full,
+				dataout => cmdr_dout,
+				re => r.cmdq.rre,
+				empty => cmdr_empty,
+				rerr => open,
+				count => cmdr_count,
+				-- debug feature (not used here)
+				dbgdeact => gnd,
+				dbgwaddr => open,
+				dbgraddr => gndd,
+				dbgrst => gnd
+			);
+	end generate;
+
+	cq1: if cmdqdepth = 0 generate -- statically resolved by synthesizer
+		cmdq_dout <= (others => '0');
+		cmdq_empty <= '1';
+		cmdq_full <= '1';
+		cmdq_count <= (others => '0');
+		cmdr_dout <= (others => '0');
+		cmdr_empty <= '1';
+		cmdr_full <= '1';
+		cmdr_count <= (others => '0');
+	end generate;
+
 	-- general busy signal
 	kppending <= r.ctrl.kppending;
 
 	-- interface with ecc_trng
-	trngrdy <= r.write.rnd.trngrdy;
+	trngrdy <= r.write.rnd.trngrdy or r.rng.trngrdy;
 
 	-- HW unsecure/Side-Channel analysis features (to ecc_curve_iram)
 	dbgiwaddr <= r.debug.iwaddr;
@@ -5232,6 +6249,10 @@ begin
 	dbgresume <= r.debug.resume;
 	dbghalt <= r.debug.halt;
 	dbgnoxyshuf <= r.debug.noxyshuf;
+	dbgtraceen <= r.trace.en;
+	dbgtraceclr <= r.trace.clr;
+	dbgtraceraddr <= r.trace.addr;
+	dbgtracere <= r.trace.re;
 
 	-- HW unsecure/Side-Channel analysis features (to trng)
 	dbgtrngnnrnddet <= r.debug.trng.nnrnddeterm; -- (s38)
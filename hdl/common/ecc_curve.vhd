@@ -19,13 +19,18 @@ use ieee.numeric_std.all;
 
 use work.ecc_customize.all;
 use work.ecc_utils.all;
+use work.ecc_log.all;
 use work.ecc_pkg.all;
+use work.ecc_software.all;
 
 -- pragma translate_off
 use std.textio.all;
 -- pragma translate_on
 
 entity ecc_curve is
+	generic(
+		-- simulation-only (see 'simxyshuflogfile' in ecc_customize.vhd)
+		simxyshuflog : string := simxyshuflogfile);
 	port(
 		clk : in std_logic;
 		rstn : in std_logic; -- synchronous reset
@@ -90,6 +95,13 @@ entity ecc_curve is
 		dbgtrngcompletebypass : in std_logic;
 		dbgxy01addr : out std_logic_vector(7 downto 0);
 		dbgxy01nextaddr : out std_logic_vector(7 downto 0);
+		dbgtraceen : in std_logic;
+		dbgtraceclr : in std_logic;
+		dbgtraceraddr : in std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+		dbgtracere : in std_logic;
+		dbgtracerdata : out std_logic_vector(31 downto 0);
+		dbgtracecnt : out std_logic_vector(TRACE_ADDR_SZ downto 0);
+		dbgtraceovf : out std_logic;
 		-- HW unsecure/Side-Channel analysis features (interface with ecc_scalar)
 		dbgpgmstate : in std_logic_vector(3 downto 0);
 		dbgnbbits : in std_logic_vector(15 downto 0)
@@ -293,6 +305,24 @@ architecture rtl of ecc_curve is
 		halt_pending : std_logic;
 	end record;
 
+	-- microcode execution trace (HW unsecure feature, see (s299))
+	type trace_reg_type is record
+		en : std_logic;
+		tick : unsigned(15 downto 0);
+		-- entry of the last decoded instruction, not written yet
+		pend : std_logic;
+		pc : std_logic_vector(IRAM_ADDR_SZ - 1 downto 0);
+		cls : std_logic_vector(2 downto 0);
+		taken : std_logic;
+		stamp : unsigned(15 downto 0);
+		-- write port of trace RAM
+		cnt : unsigned(TRACE_ADDR_SZ downto 0);
+		ovf : std_logic;
+		we : std_logic;
+		waddr : std_logic_vector(TRACE_ADDR_SZ - 1 downto 0);
+		wdata : std_logic_vector(31 downto 0);
+	end record;
+
 	type reg_type is record
 		active : std_logic;
 		state : state_type;
@@ -306,6 +336,7 @@ architecture rtl of ecc_curve is
 		shuffle : shuffle_reg_type;
 		-- HW unsecure/Side-Channel analysis features
 		debug : debug_reg_type;
+		trace : trace_reg_type;
 		-- pragma translate_off
 		shuffle_adr_x0 : std_logic_vector(1 downto 0);
 		shuffle_adr_x0_sw3 : std_logic_vector(1 downto 0);
@@ -332,6 +363,36 @@ architecture rtl of ecc_curve is
 
 	signal r, rin : reg_type;
 
+	-- class of an instruction in the microcode execution trace, see (s299)
+	function trace_class(op : std_logic_vector(OPCODE_SZ - 1 downto 0))
+		return std_logic_vector is
+		variable vcl : natural range 0 to 7;
+	begin
+		vcl := DBG_TRACE_CL_NOP;
+		if op(OP_S_POS) = '1' then
+			vcl := DBG_TRACE_CL_STOP;
+		elsif op(OP_TYPE_MSB downto OP_TYPE_LSB) = OPCODE_ARITH then
+			if op(OP_OP_MSB downto OP_OP_LSB) = OPCODE_ARITH_RED then
+				vcl := DBG_TRACE_CL_REDC;
+			elsif op(OP_OP_MSB downto OP_OP_LSB) = OPCODE_ARITH_TST then
+				vcl := DBG_TRACE_CL_TPAR;
+			else
+				vcl := DBG_TRACE_CL_ARITH;
+			end if;
+		elsif op(OP_TYPE_MSB downto OP_TYPE_LSB) = OPCODE_BRANCH then
+			if op(OP_OP_MSB downto OP_OP_LSB) = OPCODE_BRA_CALL
+			  or op(OP_OP_MSB downto OP_OP_LSB) = OPCODE_BRA_CALLSN
+			then
+				vcl := DBG_TRACE_CL_CALL;
+			elsif op(OP_OP_MSB downto OP_OP_LSB) = OPCODE_BRA_RET then
+				vcl := DBG_TRACE_CL_RET;
+			else
+				vcl := DBG_TRACE_CL_BRANCH;
+			end if;
+		end if;
+		return std_logic_vector(to_unsigned(vcl, 3));
+	end function trace_class;
+
 	-- address of variable OPC_VOID below must be chosen in such a way that
 	-- it does not bash any useful variable. Variable OPC_VOID is used as a
 	-- dummy target variable:
@@ -416,7 +477,7 @@ begin
 	               iterate_shuffle_valid, iterate_shuffle_force, dbghalt,
 	               doblinding, opo, dbgbreakpoints, dbgpgmstate, dbgnbbits,
 	               dbgnbopcodes, dbgdosomeopcodes, dbgresume, dbgnoxyshuf,
-	               dbgtrngcompletebypass,
+	               dbgtrngcompletebypass, dbgtraceen, dbgtraceclr,
 	               swrst, zu, zc, r0z, r1z, ptadd,
 	               pts_are_equal, pts_are_oppos, first3pz, firstzaddu, firstzdbl,
 	               not_always_add, no_collision_cr)
@@ -425,6 +486,7 @@ begin
 		variable vtmp1 : std_logic_vector(2 downto 0);
 		variable vopsincr : boolean;
 		variable vdobranch : boolean;
+		variable vtrcissue : boolean;
 		variable v_breakpointhit : boolean;
 		variable v_breakpointnb : natural range 0 to 3;
 		variable v_shuffle_adr_x0 : std_logic_vector(1 downto 0);
@@ -449,6 +511,7 @@ begin
 
 		vopsincr := FALSE;
 		vdobranch := FALSE;
+		vtrcissue := FALSE;
 
 		-- (s106), see also (s107)
 		-- r.ctrl.kb0end bit directly drives output 'kb0end' to ecc_scalar
@@ -632,6 +695,7 @@ begin
 					v.decode.state := decode; -- (s114), bypassed by (s115)-(s118)
 					v.decode.rdy := '0';
 					v.decode.pc := r.fetch.pc;
+					vtrcissue := TRUE; -- see (s299)
 					-- (s7)
 					-- dispatch 'r.fetch.opcode' in different fields
 					-- 1/ fields common to all types of instructions
@@ -3089,6 +3153,7 @@ begin
 					vdobranch := TRUE;
 				end if;
 				if vdobranch then
+					v.trace.taken := '1'; -- see (s299)
 					v.fetch.ramresh :=
 						(sramlat => '1', others => '0'); -- (s13) only 1 clk thx to (s0)
 					v.fetch.state := fetch;
@@ -3176,6 +3241,47 @@ begin
 			v.debug.halted := '0';
 		end if;
 
+		-- (s299) microcode execution trace (HW unsecure feature)
+		-- One entry is recorded per decoded instruction (see 'tracedepth'
+		-- in ecc_customize.vhd). The entry of an instruction is only written
+		-- into the trace RAM once the next one is decoded (or once the program
+		-- stops), as it's only then that we know if a branch was taken.
+		-- Recording stops (and overflow is flagged) when the RAM is full.
+		if (not hwsecure) and tracedepth > 0 then -- statically resolved by synthesizer
+			v.trace.we := '0';
+			v.trace.en := dbgtraceen;
+			if r.trace.en = '1' then
+				v.trace.tick := r.trace.tick + 1;
+			end if;
+			if (vtrcissue or r.stop = '1') and r.trace.pend = '1' then
+				v.trace.pend := '0';
+				if r.trace.cnt = to_unsigned(tracedepth, TRACE_ADDR_SZ + 1) then
+					v.trace.ovf := '1';
+				else
+					v.trace.we := '1';
+					v.trace.waddr :=
+						std_logic_vector(r.trace.cnt(TRACE_ADDR_SZ - 1 downto 0));
+					v.trace.wdata := std_logic_vector(r.trace.stamp) -- 31..16
+						& r.trace.taken & r.trace.cls -- 15, 14..12
+						& std_logic_vector(resize(unsigned(r.trace.pc), 12)); -- 11..0
+					v.trace.cnt := r.trace.cnt + 1;
+				end if;
+			end if;
+			if vtrcissue and r.trace.en = '1' then
+				v.trace.pend := '1';
+				v.trace.pc := r.fetch.pc;
+				v.trace.cls := trace_class(r.fetch.opcode);
+				v.trace.taken := '0';
+				v.trace.stamp := r.trace.tick;
+			end if;
+			if dbgtraceclr = '1' then
+				v.trace.pend := '0';
+				v.trace.tick := (others => '0');
+				v.trace.cnt := (others => '0');
+				v.trace.ovf := '0';
+			end if;
+		end if;
+
 		-- ======================================================================
 		-- shuffle feature (countermeasure against side-channel leak of operands'
 		-- address of the four variables XR0, XR1, YR0 and YR1)
@@ -3537,6 +3643,12 @@ begin
 			-- no need tot reset r.debug.breakpointid
 			v.debug.breakpointhit := '0';
 			v.debug.halt_pending := '0';
+			v.trace.en := '0';
+			v.trace.tick := (others => '0');
+			v.trace.pend := '0';
+			v.trace.cnt := (others => '0');
+			v.trace.ovf := '0';
+			v.trace.we := '0';
 			-- pragma translate_off
 			v.ctrl.first2pz := '0'; -- (s102), see (s103)
 			v.ctrl.torsion2 := '0'; -- (s104), see (s105)
@@ -3630,6 +3742,32 @@ begin
 								 & r.shuffle.adr_y0 & r.shuffle.adr_x0;
 	dbgxy01nextaddr <= r.shuffle.next_adr_y1 & r.shuffle.next_adr_x1
 										 & r.shuffle.next_adr_y0 & r.shuffle.next_adr_x0;
+	dbgtracecnt <= std_logic_vector(r.trace.cnt);
+	dbgtraceovf <= r.trace.ovf;
+
+	-- microcode execution trace RAM, see (s299)
+	tr0: if (not hwsecure) and tracedepth > 0 generate -- statically resolved by synthesizer
+		assert (is_a_power_of_two(tracedepth))
+			report "parameter 'tracedepth' must be a power of 2"
+				severity FAILURE;
+		tr00: syncram_sdp
+			generic map(rdlat => 1, datawidth => 32, datadepth => tracedepth)
+			port map(
+				clk => clk,
+				-- port A (W only)
+				addra => r.trace.waddr,
+				wea => r.trace.we,
+				dia => r.trace.wdata,
+				-- port B (R only)
+				addrb => dbgtraceraddr,
+				reb => dbgtracere,
+				dob => dbgtracerdata
+			);
+	end generate;
+
+	tr1: if hwsecure or tracedepth = 0 generate -- statically resolved by synthesizer
+		dbgtracerdata <= (others => '0');
+	end generate;
 
 	-- pragma translate_off
 	pc <= r.decode.pc;
@@ -3661,7 +3799,7 @@ begin
 	-- pragma translate_off
 	-- Logging the shuffling permutations of [XY]R[01] variables
 	process(clk)
-		file output : TEXT open write_mode is simxyshuflogfile;
+		file output : TEXT open write_mode is simxyshuflog;
 		variable lineout : line;
 		variable vnb : integer := 0;
 	begin
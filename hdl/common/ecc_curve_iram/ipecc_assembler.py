@@ -9,7 +9,7 @@
 #     Adrian THILLARD
 #     Emmanuel PROUFF
 
-import re, sys, os, math, random
+import re, sys, os, math, random, time
 
 class bcolors:
     HEADER = '\033[95m'
@@ -49,8 +49,47 @@ def compute_monty_coef(prime, pbitlen):
     return r, r_square, pinv
 
 ### Emulation related stuff
+#
+# The emulator executes the microcode the way ecc_curve & ecc_fp do:
+#   - large numbers are W = w * ww bits wide (see profile_hw_model) and
+#     NNADD/NNSUB/NNSRL/NNSLL/NNDIV2 work in two's complement on W bits,
+#   - FPREDC computes A * B / R mod p with R = 2**(nn + 2) (monty-cst.s),
+#   - NNADD & NNSUB update %Z & %SN, shifts & random instructions only
+#     update %Z, NNXOR, FPREDC & TESTPAR[s] update none of them,
+#   - NNRNDs, NNRNDf, NNSRLs & TESTPARs drive the mask shift-registers
+#     (large_shr components of ecc_fp),
+#   - patches (",pN" option) are decoded by a translation to Python of
+#     the patch decoding logic of ecc_curve.vhd (see emulate_load_patches)
+#     and the [XY]R[01] coordinates are shuffled as ecc_curve does.
+# Function emulate_kp (-k option) sequences the routines the way ecc_scalar
+# does to compute a whole [k]P, see ecc_scalar.vhd.
+
+# Nb of mask shift-registers (see NB_MSK_SH_REG in ecc_pkg.vhd)
+EMULATE_NB_MSK_SH_REG = 4
+# Max nb of instructions executed per routine (protects against endless loops)
+EMULATE_MAX_STEPS = 1 << 22
+
+# Name of ecc_curve's r.ctrl.* flags in the emulator
+emulate_ctrl_flags = {
+    "mu0"  : "%mu0",
+    "kb0"  : "%kb0",
+    "par"  : "%par",
+    "kap"  : "%kap",
+    "kapp" : "%kapP",
+    "z"    : "%Z",
+    "sn"   : "%SN",
+}
+
+# Function decoding the patches (set by emulate_load_patches) and
+# C_PATCH_* constants of ecc_curve.vhd
+emulate_patch_decode = None
+emulate_patch_cst = {}
+# Flags read & written and patch signals possibly set by each patch
+# (also set by emulate_load_patches, used by the profiler & the scheduler)
+emulate_patch_info = {}
+
 class IPECCExecutionContext(object):
-    def __init__(self, registers, flags, ip, lrip):
+    def __init__(self, registers, flags, ip, lrip, nn=None):
         global OPERANDS_BITS_SIZE
         global BIGNUM_BITS_SIZE
         MEMORY_SIZE = 2**OPERANDS_BITS_SIZE
@@ -61,10 +100,10 @@ class IPECCExecutionContext(object):
                 sys.exit(-1)
             self.r[addr] = val
         self.flags = {
-            "%mu0"  : 0,      
-            "%kb0"  : 0,      
-            "%par"  : 0,      
-            "%kapP" : 0,      
+            "%mu0"  : 0,
+            "%kb0"  : 0,
+            "%par"  : 0,
+            "%kapP" : 0,
             "%kap"  : 0,
             # Arithmetic carry flag
             "%Carith"   : 0,
@@ -72,8 +111,18 @@ class IPECCExecutionContext(object):
             "%Cshift"   : 0,
             # Zero flag
             "%Z"    : 0,
-            # Strictly negative flag                          
-            "%SN"   : 0,                                        
+            # Strictly negative flag
+            "%SN"   : 0,
+            # Flags of ecc_curve set through patches (nullity of
+            # [2]P, of [2]R and comparison of R0 & R1 coordinates)
+            "first2pz" : 0,
+            "torsion2" : 0,
+            "xmxz"     : 0,
+            "ymyz"     : 0,
+            "detectfirst2pz" : 0,
+            "detecttorsion2" : 0,
+            "detectxmxz"     : 0,
+            "detectymyz"     : 0,
         }
         for (f, val) in flags:
             self.flags[f] = val
@@ -87,27 +136,56 @@ class IPECCExecutionContext(object):
             self.lrip = lrip
         else:
             self.lrip = 0
-        # p constant cached
-        self.p = self.r[0]
         # Executed "line" in textual form
         self.executed_line = None
-        # Masking related stuff
-        self.s = [0x0, 0x0, 0x0, 0x0]
-        #### Patch related stuff
-        #### FIXME: this must be implemented!
-        #self.do_blinding = 0
-        #self.masklsb = 0
-        #self.setup = 0
-        #self.laststep = 0
-        #self.zu = self.zc = 0
-        #self.r0z = self.r1z = 0
-        #self.patches = {
-        #        "p"  : 0,
-        #        "as" : 0,
-        #        "opa" : { "x0" : 0, "x1" : 0, "y0" : 0, "y1" : 0, "x0next" : 0, "x1next" : 0, "y0next" : 0, "y1next" : 0, "x0det" : 0, "y0det" : 0 },
-        #        "opb" : { "x0" : 0, "x1" : 0, "y0" : 0, "y1" : 0, "x0next" : 0, "x1next" : 0, "y0next" : 0, "y1next" : 0, "x0det" : 0, "y0det" : 0 },
-        #        "opc" : { "x1" : 0, "y1" : 0, "x0next" : 0, "x1next" : 0, "y0next" : 0, "y1next" : 0, "blvoid" : 0, "copiesopa" : 0, "bl0" : 0, "bl1" : 0 },
-        #}
+        # Size of numbers
+        if nn is None:
+            nn = BIGNUM_BITS_SIZE
+        self.set_nn(nn)
+        # Masking related stuff (content of the mask shift-registers
+        # along with the nb of bits they were filled with)
+        self.shr = [0] * EMULATE_NB_MSK_SH_REG
+        self.shrcnt = [0] * EMULATE_NB_MSK_SH_REG
+        # Shuffling of [XY]R[01] coordinates (in order x0, y0, x1, y1)
+        self.adr = [0, 1, 2, 3]
+        self.nxt = [0, 1, 2, 3]
+        # Signals of ecc_scalar & ecc_axi read by the patch logic
+        self.sig = {
+            "hwsecure"        : ipecc_hw_params["hwsecure"],
+            "not_always_add"  : 0,
+            "no_collision_cr" : 0,
+            "ptadd"           : 0,
+            "doblinding"      : 0,
+            "masklsb"         : 0,
+            "laststep"        : 0,
+            "firstzdbl"       : 0,
+            "firstzaddu"      : 0,
+            "first3pz"        : 0,
+            "r0z"             : 0,
+            "r1z"             : 0,
+            "zu"              : 0,
+            "zc"              : 0,
+            "pts_are_equal"   : 0,
+            "pts_are_oppos"   : 0,
+        }
+        self.patch = {}
+        self.rng = random.Random()
+        # Operands of the last ARITHmetic instruction (patches applied) &
+        # timing state of the hardware if cycles are counted (see
+        # ProfileState)
+        self.operands = ([], [], [])
+        self.timer = None
+    def set_nn(self, nn):
+        # W & R depend on the (possibly dynamic) value of nn
+        ww = profile_hw_model()["ww"]
+        self.nn = nn
+        self.model = profile_hw_model(nn)
+        self.W = ww * ((nn + 4 + ww - 1) // ww)
+        self.mask = (1 << self.W) - 1
+        self.nnmask = (1 << nn) - 1
+        self.monty_R = 1 << (nn + 2)
+        self.monty_p = None
+        self.monty_Rinv = None
     def __str__(self):
         a = "\t============== IPECC Execution context ==============\n"
         addr = 0
@@ -120,21 +198,214 @@ class IPECCExecutionContext(object):
             a += "\t==> %s\n" % self.executed_line
         return a
 
-def apply_patch(execution_context, opa, opb, opc, options):
-    for o in options:
-        patch_num = None
-        # Get the patch
-        aa = re.search(r"p([0-9]+)", o)
-        if aa is not None:
-            patch_num = int(aa.group(1))
-        if patch_num is None:
-            # Nothing to do, return
-            return (execution_context, opa, opb, opc)
+# Translation of a VHDL expression of the patch decoding logic
+def emulate_vhdl_expr(e):
+    def ident(m):
+        t = m.group(0)
+        if t in ("and", "or", "not"):
+            return t
+        if t == "xor":
+            return "^"
+        if t == "r.decode.c.patchid":
+            return "pid"
+        if t.startswith("r.ctrl."):
+            t = t[len("r.ctrl."):]
+            return "f[\"%s\"]" % emulate_ctrl_flags.get(t, t)
+        if "." in t:
+            raise ValueError("unsupported identifier %s" % t)
+        return "s[\"%s\"]" % t
+    e = re.sub(r"\"([01]+)\"", lambda m: str(int(m.group(1), 2)), e)
+    e = re.sub(r"'([01])'", r"\1", e)
+    e = re.sub(r"[A-Za-z_][A-Za-z0-9_\.]*", ident, e)
+    e = e.replace("/=", "!=")
+    e = re.sub(r"(?<![!<>=])=(?!=)", "==", e)
+    return " ".join(e.split())
+
+# Translation of an if/elsif/else VHDL construct or of a list of
+# statements (up to the first token in 'end') into Python source
+def emulate_vhdl_block(tokens, i, indent, end):
+    src = []
+    while tokens[i] not in end:
+        t = tokens[i]
+        if t == "if":
+            keyword = "if"
+            while True:
+                if tokens[i + 2] != "then":
+                    raise ValueError("'then' expected after 'if %s'" % tokens[i + 1])
+                src.append("%s%s %s:" % (indent, keyword, emulate_vhdl_expr(tokens[i + 1])))
+                (body, i) = emulate_vhdl_block(tokens, i + 3, indent + "    ", ("elsif", "else", "end if;"))
+                src += body + ["%s    pass" % indent]
+                if tokens[i] == "elsif":
+                    keyword = "elif"
+                    continue
+                if tokens[i] == "else":
+                    src.append("%selse:" % indent)
+                    (body, i) = emulate_vhdl_block(tokens, i + 1, indent + "    ", ("end if;",))
+                    src += body + ["%s    pass" % indent]
+                break
+            i += 1
         else:
-            print_error("Error: ", "%s: " % execution_context.executed_line, " patch %d is asked, patches are NOT implemented yet!" % patch_num)
-            sys.exit(-1)
-    # Nothing to do, return
-    return (execution_context, opa, opb, opc)
+            if tokens[i + 1] != ";":
+                raise ValueError("';' expected after '%s'" % t)
+            check = re.search(r"^([A-Za-z_][A-Za-z0-9_\.]*)\s*:=\s*(.*)$", t)
+            if t == "null":
+                src.append("%spass" % indent)
+            elif check is None:
+                raise ValueError("unsupported statement '%s'" % t)
+            elif check.group(1).startswith("v.decode.patch."):
+                src.append("%spatch[\"%s\"] = int(%s)" % (indent, check.group(1)[len("v.decode.patch."):], emulate_vhdl_expr(check.group(2))))
+            elif check.group(1).startswith("v.ctrl."):
+                flag = check.group(1)[len("v.ctrl."):]
+                src.append("%sf[\"%s\"] = int(%s)" % (indent, emulate_ctrl_flags.get(flag, flag), emulate_vhdl_expr(check.group(2))))
+            elif check.group(1).startswith("v.decode."):
+                # state of ecc_curve's decode FSM, not relevant here
+                src.append("%spass" % indent)
+            else:
+                raise ValueError("unsupported assignment '%s'" % t)
+            i += 2
+    return (src, i)
+
+# Extract from ecc_curve.vhd the logic decoding the patches & the
+# addresses they target, and turn it into function emulate_patch_decode
+def emulate_load_patches(vhdl):
+    global emulate_patch_decode
+    global emulate_patch_cst
+    for check in re.finditer(r"constant\s+(C_PATCH_[A-Z0-9_]+)\s*:[^;]*to_unsigned\(([0-9]+)", vhdl):
+        emulate_patch_cst[check.group(1)] = int(check.group(2))
+    # Remove comments then split in tokens
+    vhdl = re.sub(r"--[^\n]*", "", vhdl)
+    check = re.search(r"\bif\s+r\.decode\.c\.patch\s*=\s*'1'\s*then", vhdl)
+    if check is None:
+        print_error("Error: ", "", "cannot find the patch decoding logic in ecc_curve.vhd")
+        sys.exit(-1)
+    tokens = []
+    for t in re.split(r"(\bend\s+if\s*;|\belsif\b|\bif\b|\belse\b|\bthen\b|;)", vhdl[check.start():]):
+        t = " ".join(t.split())
+        if re.search(r"^end\s+if\s*;$", t) is not None:
+            t = "end if;"
+        if t != "":
+            tokens.append(t)
+    try:
+        # Only keep the statements inside "if r.decode.c.patch = '1'"
+        (body, i) = emulate_vhdl_block(tokens, 3, "    ", ("elsif", "else", "end if;"))
+    except (ValueError, IndexError) as e:
+        print_error("Error: ", "", "cannot translate the patch decoding logic of ecc_curve.vhd (%s)" % e)
+        sys.exit(-1)
+    src = "def emulate_patch_decode(pid, f, s, patch):\n" + "\n".join(["    pass"] + body) + "\n"
+    env = {}
+    exec(compile(src, "ecc_curve.vhd (patches)", "exec"), env)
+    emulate_patch_decode = env["emulate_patch_decode"]
+    # Statements outside of the if/elsif chain on the patch id are
+    # recorded under None & apply to all patches
+    pid = None
+    for l in body:
+        check = re.search(r"^    (el)?if pid == ([0-9]+):$", l)
+        if check is not None:
+            pid = int(check.group(2))
+        elif re.search(r"^    \S", l) is not None:
+            pid = None
+        info = emulate_patch_info.setdefault(pid, { "patch" : set(), "reads" : set(), "writes" : set() })
+        info["patch"] |= set(re.findall(r"patch\[\"(\w+)\"\]", l))
+        check = re.search(r"^\s*f\[\"([^\"]+)\"\] = (.*)$", l)
+        if check is not None:
+            info["writes"].add(check.group(1))
+            l = check.group(2)
+        info["reads"] |= set(re.findall(r"f\[\"([^\"]+)\"\]", l))
+    return
+
+# Operand resolution of the patch state of ecc_curve, in the order of
+# priority of the if/elsif chains for opA, opB & opC (an integer gives
+# an address, ("adr", i) & ("nxt", i) resp. the current & the next
+# shuffled address of x0, y0, x1 or y1)
+emulate_patch_opa = [
+    ("opax0det", "XR0"), ("opay0det", "YR0"), ("opax1det", "XR1"), ("opay1det", "YR1"),
+    ("opax0", ("adr", 0)), ("opay0", ("adr", 1)), ("opax1", ("adr", 2)), ("opay1", ("adr", 3)),
+    ("opax0next", ("nxt", 0)), ("opay0next", ("nxt", 1)), ("opax1next", ("nxt", 2)), ("opay1next", ("nxt", 3)),
+    ("opaxtmp", "C_PATCH_XTMP"), ("opaytmp", "C_PATCH_YTMP"), ("opaz", "C_PATCH_ZERO"),
+    ("opax0bk", "XR0bk"), ("opay0bk", "YR0bk"),
+]
+emulate_patch_opb = [
+    ("opbx0det", "XR0"), ("opby0det", "YR0"), ("opby1det", "YR1"), ("opbx1det", "XR1"),
+    ("opbx0", ("adr", 0)), ("opby0", ("adr", 1)), ("opbx1", ("adr", 2)), ("opby1", ("adr", 3)),
+    ("opbx0next", ("nxt", 0)), ("opby0next", ("nxt", 1)), ("opbx1next", ("nxt", 2)), ("opby1next", ("nxt", 3)),
+    ("opbz", "C_PATCH_ZERO"), ("opbr", "C_PATCH_R"),
+]
+emulate_patch_opc = [
+    ("opcx1", ("adr", 2)), ("opcy1", ("adr", 3)),
+    ("opcx0next", ("nxt", 0)), ("opcy0next", ("nxt", 1)), ("opcx1next", ("nxt", 2)), ("opcy1next", ("nxt", 3)),
+    ("opccopiesopa", "opa"), ("opcvoid", "C_PATCH_OPC_VOID"),
+    ("opcbl0", "C_PATCH_KB0"), ("opcbl1", "C_PATCH_KB1"),
+    ("opcx0", ("adr", 0)), ("opcy0", ("adr", 1)),
+    ("opcx0det", "XR0"), ("opcy0det", "YR0"), ("opcx1det", "XR1"), ("opcy1det", "YR1"),
+]
+
+# Addresses of the patch targets which do not depend on the shuffling
+# (see emulate_patch_addr) & operand, rank in its chain & target of
+# each signal of the patch state
+emulate_patch_addr_cache = {}
+emulate_patch_prio = {}
+def emulate_patch_addr(execution_context, target, opa):
+    if type(target) is tuple:
+        # XYR01_MSB & r.shuffle.[next_]adr_*
+        if target[0] == "adr":
+            return emulate_patch_addr_cache["XYR01_MSB"] + execution_context.adr[target[1]]
+        return emulate_patch_addr_cache["XYR01_MSB"] + execution_context.nxt[target[1]]
+    if target == "opa":
+        return opa
+    return emulate_patch_addr_cache[target]
+
+def emulate_patch_addr_init():
+    for (chain, op) in ((emulate_patch_opa, 0), (emulate_patch_opb, 1), (emulate_patch_opc, 2)):
+        for (rank, (name, target)) in enumerate(chain):
+            emulate_patch_prio[name] = (op, rank, target)
+    emulate_patch_addr_cache["XYR01_MSB"] = binstring_to_int(ipecc_operands_dict["XR0"]) & ~3
+    for chain in (emulate_patch_opa, emulate_patch_opb, emulate_patch_opc):
+        for (name, target) in chain:
+            if (type(target) is tuple) or (target == "opa"):
+                continue
+            if target in emulate_patch_cst:
+                emulate_patch_addr_cache[target] = emulate_patch_cst[target]
+            else:
+                emulate_patch_addr_cache[target] = binstring_to_int(ipecc_operands_dict[target])
+
+def apply_patch(execution_context, patch_num, opa, opb, opc):
+    if emulate_patch_decode is None:
+        print_error("Error: ", "%s: " % execution_context.executed_line, " patch %d is asked but patches were not loaded (VHDL files are needed)" % patch_num)
+        sys.exit(-1)
+    if len(emulate_patch_addr_cache) == 0:
+        emulate_patch_addr_init()
+    patch = execution_context.patch
+    patch.clear()
+    try:
+        emulate_patch_decode(patch_num, execution_context.flags, execution_context.sig, patch)
+    except KeyError as e:
+        print_error("Error: ", "%s: " % execution_context.executed_line, " patch %d reads unknown signal %s" % (patch_num, e))
+        sys.exit(-1)
+    if patch.get("p", 0) == 1:
+        if execution_context.flags["%SN"] == 1:
+            opb = emulate_patch_cst["C_PATCH_P"]
+        else:
+            opb = emulate_patch_cst["C_PATCH_ZERO"]
+    if patch.get("as", 0) == 1:
+        if execution_context.flags["%SN"] == 0:
+            opb = emulate_patch_cst["C_PATCH_ZERO"]
+        else:
+            opb = emulate_patch_cst["C_PATCH_TWOP"]
+    # Highest priority target asserted by the patch for each operand
+    sel = [None, None, None]
+    for (name, v) in patch.items():
+        if (v == 1) and (name in emulate_patch_prio):
+            (op, rank, target) = emulate_patch_prio[name]
+            if (sel[op] is None) or (rank < sel[op][0]):
+                sel[op] = (rank, target)
+    popa = opa
+    if sel[0] is not None:
+        opa = emulate_patch_addr(execution_context, sel[0][1], popa)
+    if sel[1] is not None:
+        opb = emulate_patch_addr(execution_context, sel[1][1], popa)
+    if sel[2] is not None:
+        opc = emulate_patch_addr(execution_context, sel[2][1], popa)
+    return (opa, opb, opc)
 
 def update_arith_flags(C, execution_context, Z=False, SN=False, ODD=False):
     if Z is True:
@@ -142,334 +413,213 @@ def update_arith_flags(C, execution_context, Z=False, SN=False, ODD=False):
         execution_context.flags['%Z'] = int(C == 0)
     if SN is True:
         # If we have produced a negative number set the SN
-        execution_context.flags['%SN'] = (C >> (BIGNUM_BITS_SIZE - 1)) & 1
+        execution_context.flags['%SN'] = (C >> (execution_context.W - 1)) & 1
     if ODD is True:
         # Check if we are even or odd
         execution_context.flags['%par'] = (C % 2)
     return execution_context
 
+# At the end of each arithmetic instruction, ecc_curve records the
+# nullity of its result if a patch asked for it
+def update_detect_flags(execution_context):
+    flags = execution_context.flags
+    for (d, f) in emulate_detect_flags:
+        if flags[d] == 1:
+            flags[f] = flags['%Z']
+            flags[d] = 0
+    return execution_context
+emulate_detect_flags = tuple(("detect" + f, f) for f in ("first2pz", "torsion2", "xmxz", "ymyz"))
+
+# Operands of an instruction as written in the source, number of its
+# patch if any & which of its operands are addresses, decoded once per
+# instruction (see get_operands)
+emulate_operands_cache = {}
+def emulate_decode_operands(ins):
+    addr, instruction, options, abstract_operands, l = ins
+    ops = [None, None, None]
+    isop = [False, False, False]
+    for i in range(3):
+        if abstract_operands[i] is not None:
+            ops[i] = abstract_operands[i][2]
+            isop[i] = (abstract_operands[i][0] == "OP")
+    patch_num = None
+    for o in options:
+        # Get the patch
+        if o[0] == "p":
+            patch_num = int(o[1:])
+    emulate_operands_cache[l] = (ops[0], ops[1], ops[2], patch_num, tuple(isop))
+    return emulate_operands_cache[l]
+
+def get_operands(ins, execution_context):
+    l = ins[4]
+    execution_context.executed_line = l
+    dec = emulate_operands_cache.get(l)
+    if dec is None:
+        dec = emulate_decode_operands(ins)
+    (opa, opb, opc, patch_num, isop) = dec
+    # Apply the possible patches
+    if patch_num is not None:
+        (opa, opb, opc) = apply_patch(execution_context, patch_num, opa, opb, opc)
+    execution_context.operands = ([opa] if isop[0] else [], [opb] if isop[1] else [], [opc] if isop[2] else [])
+    return (opa, opb, opc)
+
 def nop_emulate(ins, execution_context):
     # Nop does nothing except increment the ip
     execution_context.ip += 1
     return execution_context
 
 def nnadd_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Perform our addition modulo
-    A = execution_context.r[opa]
-    B = execution_context.r[opb]
-    C = (A + B)
+    opa, opb, opc = get_operands(ins, execution_context)
+    C = execution_context.r[opa] + execution_context.r[opb]
     # Do we have to add the carry?
-    for o in options:
-        if (o == 'X') and (execution_context.flags['%Carith'] == 1):
-            C += 1
-    # If we have produced a carry set the flag
-    if C >= (2**BIGNUM_BITS_SIZE):
-        execution_context.flags['%Carith'] = 1
-    C = (C % (2**BIGNUM_BITS_SIZE))
+    if ('X' in ins[2]) and (execution_context.flags['%Carith'] == 1):
+        C += 1
+    execution_context.flags['%Carith'] = (C >> execution_context.W) & 1
+    C &= execution_context.mask
     # Update the arithmetic flags
     execution_context = update_arith_flags(C, execution_context, Z=True, SN=True)
-    # Result
     execution_context.r[opc] = C
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nnsub_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Perform our addition modulo
-    A = execution_context.r[opa]
-    B = execution_context.r[opb]
-    C = (A - B)
-    # Do we have to add the carry?
-    for o in options:
-        if (o == 'X') and (execution_context.flags['%Carith'] == 1):
-            C += 1
+    opa, opb, opc = get_operands(ins, execution_context)
+    C = execution_context.r[opa] - execution_context.r[opb]
+    # The carry of a subtraction is set when there is no borrow
+    if ('X' in ins[2]) and (execution_context.flags['%Carith'] == 0):
+        C -= 1
+    execution_context.flags['%Carith'] = int(C >= 0)
     # Normalize our number in two's complement
-    C = (C % (2**BIGNUM_BITS_SIZE))
-    # Update the arithmetic flags
+    C &= execution_context.mask
     execution_context = update_arith_flags(C, execution_context, Z=True, SN=True)
-    # Result
     execution_context.r[opc] = C
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nnsrl_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
+    opa, opb, opc = get_operands(ins, execution_context)
     A = execution_context.r[opa]
-    # Do we have to add the carry?
+    # Do we have to shift the carry in?
     carry = 0
-    for o in options:
-        if (o == 'X') and (execution_context.flags['%Cshift'] == 1):
-            carry = 1
-    if (A & 1):
-        execution_context.flags['%Cshift'] = 1
-    C = (A >> 1) | (carry << (BIGNUM_BITS_SIZE - 1))
-    # Update the arithmetic flags
+    if 'X' in ins[2]:
+        carry = execution_context.flags['%Cshift']
+    execution_context.flags['%Cshift'] = A & 1
+    C = (A >> 1) | (carry << (execution_context.W - 1))
     execution_context = update_arith_flags(C, execution_context, Z=True)
     execution_context.r[opc] = C
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nnsll_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
+    opa, opb, opc = get_operands(ins, execution_context)
     A = execution_context.r[opa]
-    # Do we have to add the carry?
+    # Do we have to shift the carry in?
     carry = 0
-    for o in options:
-        if (o == 'X') and (execution_context.flags['%Cshift'] == 1):
-            carry = 1
-    if (A >> (BIGNUM_BITS_SIZE - 1)) == 1:
-        execution_context.flags['%Cshift'] = 1
-    C = (A << 1) % (2**BIGNUM_BITS_SIZE)
-    C |= carry
-    # Update the arithmetic flags
+    if 'X' in ins[2]:
+        carry = execution_context.flags['%Cshift']
+    execution_context.flags['%Cshift'] = (A >> (execution_context.W - 1)) & 1
+    C = ((A << 1) & execution_context.mask) | carry
     execution_context = update_arith_flags(C, execution_context, Z=True)
     execution_context.r[opc] = C
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nnrnd_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    execution_context.r[opc] = random.randrange(0, 2**BIGNUM_BITS_SIZE)
-    # Update the arithmetic flags
+    opa, opb, opc = get_operands(ins, execution_context)
+    C = execution_context.rng.getrandbits(execution_context.W)
+    execution_context.r[opc] = C
     execution_context = update_arith_flags(C, execution_context, Z=True)
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def testpars_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    opc_name = abstract_operands[2][1]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Test the parity of opa and update the flag
+    opa, opb, opc = get_operands(ins, execution_context)
+    opc_name = ins[3][2][1]
+    # Test the parity of opa unmasked by the output bit of the shift-register
     A = execution_context.r[opa]
-    execution_context.flags[opc_name] = (A % 2)
-    # 
+    execution_context.flags[opc_name] = (A ^ execution_context.shr[opb]) & 1
+    execution_context.ip += 1
     return execution_context
 
 def nnxor_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Perform our addition modulo
-    A = execution_context.r[opa]
-    B = execution_context.r[opb]
-    C = (A ^ B)
-    # Result
-    execution_context.r[opc] = C
-    # Increment IP
+    opa, opb, opc = get_operands(ins, execution_context)
+    execution_context.r[opc] = execution_context.r[opa] ^ execution_context.r[opb]
     execution_context.ip += 1
     return execution_context
 
 def fpredc_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Perform our addition modulo
+    opa, opb, opc = get_operands(ins, execution_context)
+    p = execution_context.r[0]
+    if execution_context.monty_p != p:
+        execution_context.monty_p = p
+        execution_context.monty_Rinv = modinv(execution_context.monty_R, p)
     A = execution_context.r[opa]
     B = execution_context.r[opb]
-    pbitlen = getbitlen(execution_context.p)
-    # NOTE: we add 4 bits for the Monty trick using R > 4p
-    # for the 0 < u, v, w < 2p invariant
-    MontyR = 2**(BIGNUM_BITS_SIZE + 4)
-    C = (A * B * modinv(MontyR, execution_context.p)) % execution_context.p
-    # Result
-    execution_context.r[opc] = C
-    # Increment IP
+    execution_context.r[opc] = (A * B * execution_context.monty_Rinv) % p
     execution_context.ip += 1
     return execution_context
 
 def testpar_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opc = abstract_operands[2][2]
-    opc_name = abstract_operands[2][1]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
+    opa, opb, opc = get_operands(ins, execution_context)
+    opc_name = ins[3][2][1]
     # Test the parity of opa and update the flag
-    A = execution_context.r[opa]
-    execution_context.flags[opc_name] = (A % 2)
-    # Increment IP
+    execution_context.flags[opc_name] = execution_context.r[opa] & 1
     execution_context.ip += 1
     return execution_context
 
 def nnrndm_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operand
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # NOTE: (BIGNUM_BITS_SIZE - 1) truncation for NNRNDM to
-    # ensure the random result is < p
-    execution_context.r[opc] = random.randrange(0, 2**(BIGNUM_BITS_SIZE - 1))
-    # Update the arithmetic flags
+    opa, opb, opc = get_operands(ins, execution_context)
+    # Random is masked to the nn bits of the current curve
+    C = execution_context.rng.getrandbits(execution_context.W) & execution_context.nnmask
+    execution_context.r[opc] = C
     execution_context = update_arith_flags(C, execution_context, Z=True)
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nndiv2_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
+    opa, opb, opc = get_operands(ins, execution_context)
     A = execution_context.r[opa]
     # Save the sign
-    sign = (A >> (BIGNUM_BITS_SIZE - 1)) & 0x1
-    C = (A >> 1) | (sign << (BIGNUM_BITS_SIZE - 1))
+    sign = (A >> (execution_context.W - 1)) & 1
+    C = (A >> 1) | (sign << (execution_context.W - 1))
     execution_context.r[opc] = C
-    # Update the arithmetic flags
     execution_context = update_arith_flags(C, execution_context, Z=True)
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
 def nnrnds_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Generate our mask
-    s_num = int(opb)
-    execution_context.s[s_num] = random.randrange(0, 2**BIGNUM_BITS_SIZE)
-    # Put the mask in the opc operand
-    execution_context.r[opc] = execution_context.s[s_num]
-    # Update the arithmetic flags
+    opa, opb, opc = get_operands(ins, execution_context)
+    W = execution_context.W
+    # The random is written in opc & pushed in the shift-register
+    C = execution_context.rng.getrandbits(W)
+    execution_context.shr[opb] = (execution_context.shr[opb] >> W) | (C << W)
+    execution_context.shrcnt[opb] += W
+    execution_context.r[opc] = C
     execution_context = update_arith_flags(C, execution_context, Z=True)
-    # Increment IP
     execution_context.ip += 1
     return execution_context
 
-def nnrndf_emumate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    # Generate our mask
-    s_num = int(opb)
-    execution_context.s[s_num] = random.randrange(0, 2**BIGNUM_BITS_SIZE)
-    # Put the mask in the opc operand
-    execution_context.r[opc] = execution_context.s[s_num]
-    # Increment IP
+def nnrndf_emulate(ins, execution_context):
+    opa, opb, opc = get_operands(ins, execution_context)
+    W = execution_context.W
+    C = execution_context.rng.getrandbits(W)
+    execution_context.shr[opb] = (execution_context.shr[opb] >> W) | (C << W)
+    execution_context.shrcnt[opb] += W
+    # The shift-register is then aligned (right-shifted) so that it has
+    # been shifted 2W times since the beginning of [k]P
+    if execution_context.shrcnt[opb] < 2 * W:
+        execution_context.shr[opb] >>= (2 * W) - execution_context.shrcnt[opb]
+        execution_context.shrcnt[opb] = 2 * W
+    execution_context.r[opc] = C
+    execution_context = update_arith_flags(C, execution_context, Z=True)
     execution_context.ip += 1
     return execution_context
 
 def nnsrls_emulate(ins, execution_context):
-    # Unpack values
-    addr, instruction, options, abstract_operands, l = ins
-    execution_context.executed_line = l
-    # Get the operands
-    opa = abstract_operands[0][2]
-    opb = abstract_operands[1][2]
-    opc = abstract_operands[2][2]
-    # Apply the possible patches
-    execution_context, opa, opb, opc = apply_patch(execution_context, opa, opb, opc, options)
-    A = execution_context.r[opa] 
-    s_num = int(opb)
-    # Unmask our value
-    A = (A ^ execution_context.s[s_num])
-    # Do we have to add the carry?
-    carry = 0
-    for o in options:
-        if (o == 'X') and (execution_context.flags['%Cshift'] == 1):
-            carry = 1
-    if (A & 1):
-        execution_context.flags['%Cshift'] = (1 ^ (execution_context.s[s_num] & 0x1))
-    C = (A >> 1) | (carry << (BIGNUM_BITS_SIZE - 1))
-    # Shift our mask
-    execution_context.s[s_num] = execution_context.s[s_num] >> 1
-    # Mask our result value
-    C = (C ^ execution_context.s[s_num])
-    execution_context.r[opc] = C
-    # Update the arithmetic flags
-    execution_context = update_arith_flags(C, execution_context, Z=True)
-    # Increment IP
-    execution_context.ip += 1
+    # Same as NNSRL but also shifts the shift-register
+    opb = ins[3][1][2]
+    execution_context = nnsrl_emulate(ins, execution_context)
+    execution_context.shr[opb] >>= 1
     return execution_context
 
 def j_emulate(ins, execution_context):
@@ -757,6 +907,17 @@ ecc_addr_h_end = r"""
 #endif /* __ECC_ADDR_H__ */
 """
 
+ecc_addr_h_lgnb_wr = r"""
+/* Large numbers written by each opcode
+ *
+ * (bit i of entry j is set if opcode at address j may write
+ * large number @i, whatever its patch selects; the software
+ * driver uses it to only read back, when tracing a [k]P
+ * computation step by step, the large numbers written since
+ * it last read them).
+ */
+"""
+
 
 #####################################################
 #####################################################
@@ -776,7 +937,7 @@ def key_words_regexp(l):
 BIGNUM_BITS_SIZE = 528
 OPERANDS_BITS_SIZE = 5
 PATCH_BITS_SIZE = 6
-IMMEDIATE_BITS_SIZE = 9
+IMMEDIATE_BITS_SIZE = 10
 CONSTANTS_BITS_SIZE = 2
 OPCODE_BITS_SIZE = 4
 OPCODE_CLASS_BITS_SIZE = 2
@@ -864,7 +1025,7 @@ ipecc_operands_dict = {
 	"lambdasq": "10110",
 	"MM": "10110",
 	"lambda": "10101",
-	"lambdacu": "10101",
+	"lambdacu": "10111",
 	"Y1Z1": "10101",
 	"A": "01000",
 	"BmX": "01000",
@@ -941,6 +1102,12 @@ ipecc_operands_dict = {
 	"Rmodp": "11101",
     "Qs": "01001",
     "AZ": "01000",
+    "AZU": "11001",
+    "token": "10010",
+    "4YR1sq": "10111",
+    "8YR1cu": "10111",
+    "BmXU": "10111",
+    "FC": "10001",
     "KK": "10000",
     "BZ": "10111",
     "BZd": "10111",
@@ -988,6 +1155,23 @@ ipecc_operands_dict = {
 	"disass_r31": "11111",
 }
 
+# Hardware parameters only used by the profiler (-p) & the
+# emulator (-e & -k), default values match the ones of
+# ecc_customize.vhd and are updated when read from it
+ipecc_hw_params = {
+    "nn"           : 528,
+    "hwsecure"     : True,
+    "techno"       : "series7",
+    "multwidth"    : 32,
+    "nbmult"       : 2,
+    "nbdsp"        : 6,
+    "sramlat"      : 2,
+    "shuffle"      : True,
+    "shuffle_type" : "permute_lgnb",
+    "blinding"     : 96,
+    "zremask"      : 4,
+}
+
 FLAGS_BITS_SIZE = OPERANDS_BITS_SIZE
 ipecc_flags_dict = {
     "%mu0"    : "10000",
@@ -1060,7 +1244,7 @@ ipecc_instructions_dict = {
 	"NNRNDM" : ([None, None, ipecc_operand()], "ARITH", "1010", "RNM", nnrndm_emulate),
 	"NNDIV2" : ([ipecc_operand(), None, ipecc_operand()], "ARITH", "1011", "DIV", nndiv2_emulate),
 	"NNRNDS" : ([None, ipecc_const(), ipecc_operand()], "ARITH", "1100", "RNH", nnrnds_emulate),
-	"NNRNDF" : ([None, ipecc_const(), ipecc_operand()], "ARITH", "1101", "RNF", nnrndf_emumate),
+	"NNRNDF" : ([None, ipecc_const(), ipecc_operand()], "ARITH", "1101", "RNF", nnrndf_emulate),
 	"NNSRLS" : ([ipecc_operand(), ipecc_const(), ipecc_operand()], "ARITH", "1110", "SRH", nnsrls_emulate),
 	# branch instructions, the None is to be updated with a
     # proper label after the fitst pass
@@ -1450,6 +1634,25 @@ def encode_opcodes(asm):
         encoding = encoding.replace('S', '0')
     return (encoding, abstract_asm_representation)
 
+# Table of the large numbers each opcode may write, exported in ecc_addr.h
+def assemble_lgnb_writes(abstract_asm):
+    masks = {}
+    for (addr, (instruction, barrier, stop, ins)) in profile_program(abstract_asm).items():
+        (rd, wr) = sched_resources(ins)
+        masks[addr] = 0
+        for r in wr:
+            if (type(r) is tuple) and (r[0] == "@"):
+                masks[addr] |= (1 << r[1])
+    nb = (max(masks.keys()) + 1) if len(masks) != 0 else 0
+    output_h = ecc_addr_h_lgnb_wr
+    output_h += "#define DEBUG_ECC_IRAM_NB_OPCODES        %d\n" % nb
+    output_h += "#define DEBUG_ECC_IRAM_LGNB_WR_INIT        { \\\n"
+    for i in range(0, nb, 6):
+        output_h += "\t" + ", ".join("0x%08x" % masks.get(j, 0) for j in range(i, min(i + 6, nb)))
+        output_h += ", \\\n" if (i + 6) < nb else " \\\n"
+    output_h += "}\n"
+    return output_h
+
 def assemble_file(infile):
     with open(infile, "r") as f:
         asm = f.read()
@@ -1502,6 +1705,10 @@ def assemble_file(infile):
             if check is not None:
                 k_ = k.replace(r"L_dbg:", "")[1:]
                 output_h += ("#define DEBUG_ECC_IRAM_"+k_.upper()+"_ADDR        %s\n") % ipecc_labels_dict[k][1]
+        # Large numbers each opcode may write (only known if the patches
+        # of ecc_curve.vhd were loaded)
+        if (emulate_patch_decode is not None) and ((2**OPERANDS_BITS_SIZE) <= 32):
+            output_h += assemble_lgnb_writes(abstract_asm)
         output_h = ecc_addr_h_begin + output_h + ecc_addr_h_end
         #outfile = os.path.splitext(infile)[0] + "_addr.vhd"
         outfile = "ecc_addr.vhd"
@@ -1592,13 +1799,7 @@ def emulate_file(infile, initial_state):
         print("    -> Second pass for opcode encoding done")
         # First, check if the asked address for ip and rip and breakip are indeed in our
         # range and classify our opcodes in an address base dictionnary
-        abstract_asm_dict = {}
-        for ins in abstract_asm: 
-            (current_addr, instruction, OPTIONS, ABSTRACT_OPERANDS, l) = ins
-            if current_addr not in abstract_asm_dict.keys():
-                abstract_asm_dict[current_addr] = [ ins ]
-            else:
-                abstract_asm_dict[current_addr].append(ins)
+        abstract_asm_dict = emulate_program(abstract_asm)
         if (ip is not None):
             if ip not in abstract_asm_dict.keys():
                 print_error("Error: ", "bad ip value %d" % ip, " ip not in allowed range for the program")
@@ -1617,31 +1818,1402 @@ def emulate_file(infile, initial_state):
                 sys.exit(-1)
             context.breakip = breakip
         # Our execution loop
-        stop = False
         while True:
-            # Execute in a loop
-            all_ins_at_ip = abstract_asm_dict[context.ip]
-            for ins in all_ins_at_ip:
-                (current_addr, instruction, OPTIONS, ABSTRACT_OPERANDS, l) = ins
-                # Get the routine to execute
-                emulation_routine = ipecc_instructions_dict[instruction][4]
-                context = emulation_routine(ins, context)
-                if verbosity is not None:
-                    print(context)
-                # Do we have to stop ?
-                if instruction == "STOP":
-                    print_info("Hitting STOP", "")
-                    stop = True
-                    break
-                if context.ip == breakip:
-                    stop = True
-                    print_info("Hitting breakip: ", "breakip = %d" % breakip)
-                    break
+            if context.ip not in abstract_asm_dict.keys():
+                print_error("Error: ", "%s: " % context.executed_line, " ip=%d is out of the program" % context.ip)
+                sys.exit(-1)
+            # Get the routine to execute
+            (emulation_routine, arith, barrier, stop, ins) = abstract_asm_dict[context.ip]
+            context = emulation_routine(ins, context)
+            if arith is True:
+                context = update_detect_flags(context)
+            if verbosity is not None:
+                print(context)
+            # Do we have to stop ?
             if stop is True:
+                print_info("Hitting STOP", "")
+                break
+            if context.ip == breakip:
+                print_info("Hitting breakip: ", "breakip = %d" % breakip)
                 break
         print(context)
     return
 
+##########################################################
+### Emulation of [k]P computations (-k option)
+#
+# Routines are sequenced the way ecc_scalar does in the hwsecure (double-
+# &-add always) flavour, without the token feature: Montgomery constants
+# are computed once per curve (.constMTY0L, nn + 2 times .constMTY1L,
+# .constMTY2L & .aMontyL), then for each [k]P the scalar is masked the way
+# ecc_axi does and .chkcurveL, blinding, .adpaL, .drawZL, .setupL, .zadduL
+# are run, then for each bit .itohL, .pre_zadduL, .zadduL (or .zdblL),
+# .pre_zaddcL, .zaddcL (or .zdblL or .znegcL), with periodical Z-remasking,
+# and finally .subtractPL & .exitL. Nullity of R0 & R1 is tracked from the
+# flags set by the patches, see the Joye FSM in ecc_scalar.vhd.
+# Cycles are counted along with the cost model of the profiler (see
+# ProfileState) with the addresses actually accessed: the execution
+# context gets the ones of the whole [k]P & of its main loop along with
+# the nb of bits of the latter (attribute 'kp_cycles'), the set of
+# durations of the regular steps of the main loop (.pre_zadduL to .zaddcL
+# with neither R0 nor R1 null): more than one value means that the timing
+# of the ladder depends on the scalar or on the random permutations, and
+# the cycle the main loop starts at (what precedes it being the setup
+# phase of [k]P, and what follows it the exit phase).
+
+# Build a dictionary (address -> (emulation routine, is arith, barrier,
+# stop, line)) from the abstract representation of the program
+def emulate_program(abstract_asm):
+    prog = {}
+    for (addr, (instruction, barrier, stop, ins)) in profile_program(abstract_asm).items():
+        prog[addr] = (ipecc_instructions_dict[instruction][4], ipecc_instructions_dict[instruction][1] == "ARITH", barrier, stop, ins)
+    return prog
+
+# Entry address of each exported routine
+def exported_routines():
+    routines = {}
+    for k in ipecc_labels_dict.keys():
+        check = re.search(r"^\.(.*)L_export:$", k)
+        if check is not None:
+            routines[check.group(1)] = binstring_to_int(ipecc_labels_dict[k][0])
+    return routines
+
+# Execute one routine, up to the instruction carrying its STOP (cycles
+# are counted if the execution context has a timing state)
+def emulate_routine(execution_context, prog, entry):
+    timer = execution_context.timer
+    if timer is not None:
+        timer.launch()
+    execution_context.ip = entry
+    for step in range(EMULATE_MAX_STEPS):
+        ip = execution_context.ip
+        if ip not in prog:
+            print_error("Error: ", "%s: " % execution_context.executed_line, " ip=%d is out of the program" % ip)
+            sys.exit(-1)
+        (emulation_routine, arith, barrier, stop, ins) = prog[ip]
+        execution_context = emulation_routine(ins, execution_context)
+        if arith is True:
+            execution_context = update_detect_flags(execution_context)
+        if timer is not None:
+            timer.issue(ins, barrier, execution_context.model, execution_context.operands)
+            if (arith is False) and (execution_context.ip != ip + 1):
+                timer.branch(execution_context.model)
+        if stop is True:
+            if timer is not None:
+                timer.stop()
+            return execution_context
+    print_error("Error: ", "routine @%d: " % entry, " no STOP met after %d instructions" % EMULATE_MAX_STEPS)
+    sys.exit(-1)
+
+def emulate_addr(name):
+    return binstring_to_int(ipecc_operands_dict[name])
+
+def emulate_set_curve(execution_context, prog, routines, nn, p, a, b, q):
+    execution_context.set_nn(nn)
+    r = execution_context.r
+    for (name, val) in (("p", p), ("a", a), ("b", b), ("q", q), ("one", 1), ("zero", 0)):
+        r[emulate_addr(name)] = val
+    emulate_routine(execution_context, prog, routines["constMTY0"])
+    for i in range(nn + 2):
+        emulate_routine(execution_context, prog, routines["constMTY1"])
+    emulate_routine(execution_context, prog, routines["constMTY2"])
+    emulate_routine(execution_context, prog, routines["aMonty"])
+    return execution_context
+
+# Permutation of the [XY]R[01] coordinates (see ecc_curve.vhd)
+def emulate_shuffle(execution_context, force=False):
+    execution_context.adr = execution_context.nxt
+    if force is False:
+        perm = [0, 1, 2, 3]
+        execution_context.rng.shuffle(perm)
+        execution_context.nxt = [perm[i] for i in execution_context.nxt]
+    return execution_context
+
+# Returns None if [k]P is the null point, its affine coordinates otherwise
+def emulate_kp(execution_context, prog, routines, k, Px, Py):
+    ctx = execution_context
+    hp = ipecc_hw_params
+    r = ctx.r
+    f = ctx.flags
+    s = ctx.sig
+    W = ctx.W
+    def run(name):
+        emulate_routine(ctx, prog, routines[name])
+    ctx.timer = ProfileState(hp["nbmult"])
+    ctx.kp_cycles = None
+    # initkp
+    for fl in ("%kapP", "first2pz", "torsion2"):
+        f[fl] = 0
+    ctx.shr = [0] * EMULATE_NB_MSK_SH_REG
+    ctx.shrcnt = [0] * EMULATE_NB_MSK_SH_REG
+    ctx.adr = [0, 1, 2, 3]
+    perm = [0, 1, 2, 3]
+    ctx.rng.shuffle(perm)
+    ctx.nxt = perm
+    for sg in ("laststep", "firstzdbl", "firstzaddu", "first3pz", "r0z", "r1z", "zu", "zc", "pts_are_equal", "pts_are_oppos"):
+        s[sg] = 0
+    r1z_init = 0
+    # Transfer of the point & of the scalar (on-the-fly masking of ecc_axi)
+    r[emulate_addr("XR1")] = Px
+    r[emulate_addr("YR1")] = Py
+    blindbits = hp["blinding"]
+    if blindbits > 0:
+        s["doblinding"] = 1
+        m = ctx.rng.getrandbits(W)
+        kb = k + m
+        (r[emulate_addr("kb0")], r[emulate_addr("kb1")]) = (kb & ctx.mask, kb >> W)
+        (r[emulate_addr("m0")], r[emulate_addr("m1")]) = (m, 0)
+        s["masklsb"] = m & 1
+        nbbits = blindbits + ctx.nn - 3
+    else:
+        s["doblinding"] = 0
+        mu = ctx.rng.getrandbits(W)
+        (r[emulate_addr("kb0")], r[emulate_addr("kb1")]) = (k ^ mu, 0)
+        (r[emulate_addr("mu0")], r[emulate_addr("mu1")]) = (mu, 0)
+        s["masklsb"] = mu & 1
+        nbbits = ctx.nn - 3
+    run("chkcurve")
+    if f["%Z"] == 0:
+        print_error("Error: ", "", "point is not on curve")
+        return None
+    if blindbits > 0:
+        run("blindstart")
+        for i in range(blindbits):
+            run("blnbit")
+        run("blindstop")
+    run("adpa")
+    s["firstzdbl"] = 1
+    run("drawZ")
+    while f["%Z"] == 1:
+        run("drawZ")
+    run("setup")
+    s["firstzdbl"] = 0
+    (s["r0z"], s["r1z"]) = (f["first2pz"], 0)
+    s["first3pz"] = f["xmxz"] & (1 - f["ymyz"])
+    s["firstzaddu"] = 1
+    s["zu"] = 1
+    run("zaddu")
+    s["firstzaddu"] = 0
+    s["zu"] = 0
+    if f["%kap"] == 0:
+        (s["r0z"], s["r1z"]) = (r1z_init, s["first3pz"])
+    else:
+        (s["r0z"], s["r1z"]) = (s["first3pz"], r1z_init)
+    loop_start = ctx.timer.t
+    loop_bits = 1
+    steps = set()
+    run("itoh")
+    zremaskbits = hp["zremask"] - 1
+    zrmcnt = zremaskbits
+    while True:
+        # ZADDU (or ZDBL if R0 = R1)
+        emulate_shuffle(ctx)
+        step_start = ctx.timer.t
+        run("pre_zaddu")
+        r0z = s["r0z"]
+        r1z = s["r1z"]
+        regular = (r0z == 0 and r1z == 0)
+        if r0z ^ r1z:
+            (s["pts_are_equal"], s["pts_are_oppos"]) = (0, 0)
+        else:
+            s["pts_are_equal"] = f["xmxz"] & f["ymyz"]
+            s["pts_are_oppos"] = f["xmxz"] & (1 - f["ymyz"])
+        s["zu"] = 1
+        if r0z == 0 and r1z == 0 and f["xmxz"] == 1 and f["ymyz"] == 1:
+            run("zdbl")
+            regular = False
+            if f["%kapP"] == 1:
+                s["r0z"] = f["torsion2"]
+            else:
+                s["r1z"] = f["torsion2"]
+        else:
+            run("zaddu")
+            regular = regular and s["pts_are_oppos"] == 0
+            kapp = f["%kapP"]
+            if r0z == 0 and r1z == 0 and s["pts_are_oppos"] == 1:
+                if kapp == 0:
+                    s["r1z"] = 1
+                else:
+                    s["r0z"] = 1
+            elif r0z == 0 and r1z == 1:
+                if kapp == 0:
+                    (s["r0z"], s["r1z"]) = (1, 0)
+                else:
+                    s["r1z"] = 0
+            elif r0z == 1 and r1z == 0:
+                if kapp == 0:
+                    s["r0z"] = 0
+                else:
+                    (s["r0z"], s["r1z"]) = (0, 1)
+        # ZADDC (or ZDBL if R0 = +/-R1, or ZNEGC if one is null)
+        emulate_shuffle(ctx)
+        run("pre_zaddc")
+        r0z = s["r0z"]
+        r1z = s["r1z"]
+        if r0z ^ r1z:
+            (s["pts_are_equal"], s["pts_are_oppos"]) = (0, 0)
+        else:
+            s["pts_are_equal"] = f["xmxz"] & f["ymyz"]
+            s["pts_are_oppos"] = f["xmxz"] & (1 - f["ymyz"])
+        (s["zu"], s["zc"]) = (0, 1)
+        if r0z == 0 and r1z == 0 and f["xmxz"] == 1:
+            run("zdbl")
+            kap = f["%kap"]
+            if s["pts_are_equal"] == 1:
+                if kap == 0:
+                    (s["r0z"], s["r1z"]) = (1, f["torsion2"])
+                else:
+                    (s["r0z"], s["r1z"]) = (f["torsion2"], 1)
+            elif s["pts_are_oppos"] == 1:
+                if kap == 0:
+                    (s["r0z"], s["r1z"]) = (f["torsion2"], 1)
+                else:
+                    (s["r0z"], s["r1z"]) = (1, f["torsion2"])
+        elif r0z ^ r1z:
+            run("znegc")
+            (s["r0z"], s["r1z"]) = (0, 0)
+        else:
+            run("zaddc")
+            if regular and r0z == 0 and r1z == 0:
+                steps.add(ctx.timer.t - step_start)
+        s["zc"] = 0
+        if nbbits == 0:
+            break
+        nbbits -= 1
+        loop_bits += 1
+        # Z-remasking
+        if hp["zremask"] > 0:
+            if zrmcnt == 0:
+                zrmcnt = zremaskbits
+                run("drawZ")
+                while f["%Z"] == 1:
+                    run("drawZ")
+                run("Zremask")
+            else:
+                zrmcnt -= 1
+        run("itoh")
+    loop_cycles = ctx.timer.t - loop_start
+    # Last step: conditional subtraction of P
+    emulate_shuffle(ctx, force=True)
+    s["laststep"] = 1
+    run("subtractP")
+    phimsb = f["%par"]
+    if s["doblinding"] == 1:
+        kb0end = f["%kb0"] ^ f["%mu0"]
+    else:
+        kb0end = f["%kb0"] ^ s["masklsb"]
+    if phimsb == 1:
+        s["r0z"] = s["r1z"]
+    s["r1z"] = r1z_init
+    r0z = s["r0z"]
+    r1z = s["r1z"]
+    (s["pts_are_equal"], s["pts_are_oppos"]) = (0, 0)
+    if r0z == 1 and r1z == 0:
+        run("znegc")
+        s["r1z"] = kb0end
+    elif r0z == 0 and r1z == 0 and f["xmxz"] == 1:
+        s["pts_are_equal"] = f["ymyz"]
+        s["pts_are_oppos"] = 1 - f["ymyz"]
+        s["zc"] = 1
+        run("zdbl")
+        s["zc"] = 0
+        s["r1z"] = ((s["pts_are_equal"] & (1 - kb0end)) | (s["pts_are_oppos"] & (1 - kb0end) & f["torsion2"]))
+    else:
+        run("zaddc")
+        s["r1z"] = 0
+    s["laststep"] = 0
+    run("exit")
+    ctx.kp_cycles = (max(ctx.timer.t, ctx.timer.pending), loop_cycles, loop_bits, steps, loop_start)
+    ctx.timer = None
+    if s["r1z"] == 1:
+        return None
+    return (r[emulate_addr("XR1")], r[emulate_addr("YR1")])
+
+# Affine reference for checking the emulation ([k]P on y^2 = x^3 + ax + b)
+def emulate_ref_add(P, Q, a, p):
+    if P is None:
+        return Q
+    if Q is None:
+        return P
+    if P[0] == Q[0]:
+        if (P[1] + Q[1]) % p == 0:
+            return None
+        l = ((3 * P[0] * P[0] + a) * modinv(2 * P[1], p)) % p
+    else:
+        l = ((Q[1] - P[1]) * modinv(Q[0] - P[0], p)) % p
+    x = (l * l - P[0] - Q[0]) % p
+    return (x, (l * (P[0] - x) - P[1]) % p)
+
+def emulate_ref_kp(k, P, a, p):
+    R = None
+    for i in range(k.bit_length() - 1, -1, -1):
+        R = emulate_ref_add(R, R, a, p)
+        if (k >> i) & 1:
+            R = emulate_ref_add(R, P, a, p)
+    return R
+
+# Random point of the curve (p is assumed prime)
+def emulate_ref_point(rng, a, b, p):
+    while True:
+        x = rng.randrange(p)
+        y2 = (x * x * x + a * x + b) % p
+        if y2 == 0 or pow(y2, (p - 1) // 2, p) != 1:
+            continue
+        # Tonelli-Shanks
+        (q, e) = (p - 1, 0)
+        while q % 2 == 0:
+            (q, e) = (q // 2, e + 1)
+        z = 2
+        while pow(z, (p - 1) // 2, p) != p - 1:
+            z += 1
+        (c, y, t) = (pow(z, q, p), pow(y2, (q + 1) // 2, p), pow(y2, q, p))
+        while t != 1:
+            (i, t2) = (0, t)
+            while t2 != 1:
+                (i, t2) = (i + 1, (t2 * t2) % p)
+            bb = pow(c, 1 << (e - i - 1), p)
+            (e, c, y, t) = (i, (bb * bb) % p, (y * bb) % p, (t * bb * bb) % p)
+        return (x, y)
+
+# Parse a test-vector file in the format of sim/std-curves-test-vectors.txt
+def emulate_parse_vectors(vectors):
+    curves = []
+    curve = test = None
+    for l in vectors.splitlines():
+        if re.search(r"^==\s*NEW CURVE", l) is not None:
+            curve = { "name" : l[2:].strip(), "tests" : [] }
+            curves.append(curve)
+            test = None
+        elif re.search(r"^==\s*TEST \[k\]P", l) is not None:
+            test = { "name" : l[2:].strip() }
+            curve["tests"].append(test)
+        else:
+            check = re.search(r"^\s*(nn|p|a|b|q|Px|Py|k|kPx|kPy)\s*=\s*(0x[0-9a-fA-F]+|[0-9]+)\s*$", l)
+            if check is not None:
+                if test is not None:
+                    test[check.group(1)] = get_dec_hexa_bin_value(check.group(2))
+                elif curve is not None:
+                    curve[check.group(1)] = get_dec_hexa_bin_value(check.group(2))
+    return curves
+
+# Synthesis parameters the cycle count of a test depends on, as written
+# by ecc_tb in the 'config' column of its CSV file (see function
+# cycles_config in ecc_tb.vhd)
+def emulate_cycles_config():
+    hp = ipecc_hw_params
+    return "%s;nbmult=%d;nbdsp=%d;sramlat=%d;hwsecure=%s;shuffle=%s;shuffle_type=%s;zremask=%d" % (
+            hp["techno"], hp["nbmult"], hp["nbdsp"], hp["sramlat"], str(hp["hwsecure"]).lower(),
+            str(hp["shuffle"]).lower(), hp["shuffle_type"], hp["zremask"])
+
+# Line of the CSV file of cycle counts (same columns as the one of ecc_tb,
+# see 'simcsvfile' in ecc_customize.vhd) for one [k]P of the emulator:
+# 'cycles' & 'busy' both are the nb of cycles of the [k]P in the model
+def emulate_cycles_line(curve, test, nn, kp_cycles):
+    (total, loop_cycles, loop_bits, steps, loop_start) = kp_cycles
+    fields = ["kP", re.sub(r"^TEST \[k\]P\s*", "", test["name"]), re.sub(r"^NEW CURVE\s*", "", curve["name"]),
+            nn, ipecc_hw_params["blinding"], emulate_cycles_config(), total, total,
+            loop_start, loop_cycles, total - loop_start - loop_cycles]
+    return ",".join([str(f) for f in fields])
+
+def emulate_kp_file(infile, vectorsfile, nbrandom, seed, csvfile=None):
+    with open(infile, "r") as f:
+        asm = f.read()
+    # First pass to resolve the labels
+    resolve_labels(asm)
+    print("    -> First pass for labels resolution done")
+    # Second pass for encoding opcodes
+    (encoding, abstract_asm) = encode_opcodes(asm)
+    print("    -> Second pass for opcode encoding done")
+    prog = emulate_program(abstract_asm)
+    routines = exported_routines()
+    with open(vectorsfile, "r") as f:
+        curves = emulate_parse_vectors(f.read())
+    if seed is None:
+        seed = random.getrandbits(32)
+    hp = ipecc_hw_params
+    print_info("Parameters: ", "hwsecure=%s blinding=%d zremask=%d seed=%d" % (hp["hwsecure"], hp["blinding"], hp["zremask"], seed))
+    context = IPECCExecutionContext([], [], None, None)
+    context.rng.seed(seed)
+    csvlines = ["op,test,curve,nn,nbbld,config,cycles,busy,setup,ladder,exit"]
+    nbtests = nbfail = 0
+    start = time.time()
+    for curve in curves:
+        nn = curve.get("nn", curve["p"].bit_length())
+        if nn > BIGNUM_BITS_SIZE:
+            print_warning("Warning: ", "%s skipped (nn=%d > %d)" % (curve["name"], nn, BIGNUM_BITS_SIZE))
+            continue
+        emulate_set_curve(context, prog, routines, nn, curve["p"], curve["a"], curve["b"], curve["q"])
+        tests = list(curve["tests"])
+        for i in range(nbrandom):
+            P = emulate_ref_point(context.rng, curve["a"], curve["b"], curve["p"])
+            tests.append({ "name" : "random [k]P #%d" % i, "Px" : P[0], "Py" : P[1], "k" : context.rng.randrange(1, curve["q"]) })
+        cycles = []
+        steps = set()
+        for test in tests:
+            if "kPx" in test:
+                expected = (test["kPx"], test["kPy"])
+            else:
+                expected = emulate_ref_kp(test["k"], (test["Px"], test["Py"]), curve["a"], curve["p"])
+            result = emulate_kp(context, prog, routines, test["k"], test["Px"], test["Py"])
+            nbtests += 1
+            if result != expected:
+                nbfail += 1
+                print_error("Error: ", "%s, %s: " % (curve["name"], test["name"]), "[k]P mismatch (k=0x%x)" % test["k"])
+            if context.kp_cycles is not None:
+                cycles.append(context.kp_cycles)
+                steps |= context.kp_cycles[3]
+                csvlines.append(emulate_cycles_line(curve, test, nn, context.kp_cycles))
+        if len(cycles) != 0:
+            print("    %-24s %3d [k]P, %9d cycles on average, %6d per bit of the main loop" % (curve["name"], len(cycles),
+                    sum([c[0] for c in cycles]) // len(cycles), sum([c[1] for c in cycles]) // sum([c[2] for c in cycles])))
+        if len(steps) > 1:
+            nbfail += 1
+            print_error("Error: ", "%s: " % curve["name"], "steps of the main loop take from %d to %d cycles" % (min(steps), max(steps)))
+    elapsed = time.time() - start
+    if nbfail > 0:
+        print_error("Error: ", "", "%d [k]P out of %d mismatch" % (nbfail, nbtests))
+        sys.exit(-1)
+    print_progress("[+] %d [k]P emulated & checked in %.1f s (%.1f [k]P per minute)" % (nbtests, elapsed, (60.0 * nbtests) / max(elapsed, 1e-3)))
+    if csvfile is not None:
+        with open(csvfile, "w") as f:
+            f.write("\n".join(csvlines) + "\n")
+        print("    -> Cycle counts written in %s" % csvfile)
+    return
+
+##########################################################
+### Static profiling (cycle cost model)
+#
+# The cost of each instruction is estimated from the parameters of
+# ecc_customize.vhd (see ipecc_hw_params) with the following model:
+#   - ecc_curve issues one instruction every PROFILE_ISSUE cycles, and
+#     a taken branch (or call/return) costs a refetch of the IRAM pipe,
+#   - ecc_fp carries out one instruction at a time: it is busy during
+#     all the execution of NNADD, NNSUB, NNSRL... and only during the
+#     push of operands (x & y) in the case of FPREDC,
+#   - each of the 'nbmult' Montgomery multipliers (mm_ndsp) then runs
+#     the 3 cycles of multiply-&-acc (xy, sp & ap) of the REDC, each one
+#     made of ceil(w / ndsp) bursts, before the result is pulled back
+#     (see the illustration at the beginning of mm_ndsp.vhd),
+#   - BARRIER waits for all pending operations to complete, and the
+#     scoreboard of ecc_fp (if 'nbmult' > 2) holds back an instruction
+#     accessing the result of an FPREDC still in progress (see (s158)
+#     in ecc_fp.vhd),
+#     addresses being the ones written in the source (patches are not
+#     applied, the -k option gives exact figures),
+#   - STOP does not wait for pending operations: in the [k]P main loop
+#     an FPREDC may remain in progress from one routine to the next,
+#     which is accounted for by running its routines one after the
+#     other (see profile_ladder_bit).
+# Calls are followed. Routines of the [k]P main loop have no data
+# dependent control flow, the others only loop over the bits of a
+# large number: a JZ/JSN/CALLSN instruction is thus assumed to be
+# taken once every 'nn' times it is executed (the first time it is
+# not) and a JODD/JKAP instruction every other time.
+# Values must be checked against R_DBG_TIME (the nb of cycles of the
+# last [k]P as measured by the IP in HW unsecure mode, see function
+# hw_driver_get_time_DBG() in the driver), which can be passed as an
+# extra argument to -p.
+
+# Nb of cycles to fetch, decode & issue one instruction
+PROFILE_ISSUE = 2
+# Nb of cycles taken by ecc_scalar to launch a routine
+PROFILE_LAUNCH = 4
+# Max nb of instructions walked through per routine, in multiple
+# of 'nn' (protects against endless loops)
+PROFILE_MAX_STEPS = 64
+
+def profile_hw_model(nn=None):
+    hp = ipecc_hw_params
+    if nn is None:
+        nn = hp["nn"]
+    # 'ww' (see function set_ww in ecc_utils.vhd)
+    if hp["techno"] == "ialtera":
+        ww = 27
+    elif hp["techno"] == "asic":
+        ww = hp["multwidth"]
+    else:
+        ww = 16
+    # 'w' & 'ndsp' (see ecc_pkg.vhd & mm_ndsp_pkg.vhd)
+    w = (nn + 4 + ww - 1) // ww
+    ndsp = min(hp["nbdsp"], w)
+    sramlat = hp["sramlat"]
+    # 'readlat' (see function set_readlat in ecc_utils.vhd)
+    if (hp["shuffle"] is False) or (hp["shuffle_type"] == "none"):
+        readlat = sramlat
+    elif hp["shuffle_type"] == "permute_limbs":
+        readlat = (2 * sramlat) + 2
+    else:
+        readlat = sramlat + 2
+    # MIN_SLK & NBRA (see mm_ndsp_pkg.vhd)
+    if ndsp == 1:
+        min_slk = sramlat + 2
+    elif ndsp == 2:
+        min_slk = 4
+    else:
+        min_slk = ndsp + 1
+    nbra = (2 * sramlat) + ndsp + 11
+    nb_bursts = (w + ndsp - 1) // ndsp
+    model = {
+        "ww"        : ww,
+        "w"         : w,
+        "ndsp"      : ndsp,
+        "readlat"   : readlat,
+        "branch"    : sramlat + 2,
+        # results of add/sub/xor are written back every other cycle
+        "addsub"    : readlat + 3 + (2 * w),
+        "logic"     : readlat + 3 + (2 * w),
+        "shift"     : readlat + 3 + w,
+        "test"      : readlat + 3,
+        "rnd"       : w + 3,
+        "redc_push" : readlat + 2 + (2 * w),
+        "redc_mult" : (3 * nb_bursts * (w + min_slk)) + nbra,
+        "redc_pull" : sramlat + 2 + w,
+    }
+    return model
+
+profile_arith_class = {
+    "ADD" : "addsub", "SUB" : "addsub",
+    "XOR" : "logic",
+    "SRL" : "shift", "SLL" : "shift", "DIV" : "shift", "SRH" : "shift",
+    "TST" : "test", "TSH" : "test",
+    "RND" : "rnd", "RNM" : "rnd", "RNH" : "rnd", "RNF" : "rnd",
+    "RED" : "redc",
+}
+
+# Build a dictionary (address -> (instruction, barrier, stop, line))
+# from the abstract representation of the program
+def profile_program(abstract_asm):
+    prog = {}
+    barrier = False
+    last_addr = None
+    for ins in abstract_asm:
+        (current_addr, instruction, OPTIONS, ABSTRACT_OPERANDS, l) = ins
+        if instruction == "BARRIER":
+            barrier = True
+        elif instruction == "STOP":
+            # STOP is encoded in the previous instruction
+            if last_addr is not None:
+                (i, b, st, ll) = prog[last_addr]
+                prog[last_addr] = (i, b, True, ll)
+        else:
+            prog[current_addr] = (instruction, barrier, False, ins)
+            barrier = False
+            last_addr = current_addr
+    return prog
+
+# Addresses operands a, b & c of an ARITHmetic instruction may stand for
+# (a patched operand is the address written in the source if its patch may
+# select it, all the addresses the patch may select otherwise)
+profile_operands_cache = {}
+def profile_operands(ins):
+    if ins[4] not in profile_operands_cache:
+        (patched, rd, wr) = sched_patches(ins)
+        ops = []
+        for i in range(3):
+            o = ins[3][i]
+            lit = o[2] if (o is not None) and (o[0] == "OP") else None
+            if (len(patched[i]) == 0) or (lit in patched[i]):
+                ops.append([] if lit is None else [lit])
+            else:
+                ops.append(sorted(patched[i]))
+        profile_operands_cache[ins[4]] = tuple(ops)
+    return profile_operands_cache[ins[4]]
+
+# Operands (0 to 2 for a, b & c) checked by the scoreboard of ecc_fp
+# (see (s158) in ecc_fp.vhd) for an ARITHmetic instruction
+def profile_accessed(instruction):
+    op = ipecc_instructions_dict[instruction][3]
+    acc = []
+    if op not in ("RND", "RNM", "RNH", "RNF"):
+        acc.append(0)
+    if op in ("ADD", "SUB", "XOR", "RED"):
+        acc.append(1)
+    if op not in ("TST", "TSH"):
+        acc.append(2)
+    return tuple(acc)
+
+# Class of an instruction for the cost model (None if not ARITHmetic) &
+# operands checked by the scoreboard, by instruction (see issue)
+profile_issue_cache = {}
+def profile_issue_info(instruction):
+    if instruction not in profile_issue_cache:
+        if ipecc_instructions_dict[instruction][1] != "ARITH":
+            profile_issue_cache[instruction] = (None, ())
+        else:
+            profile_issue_cache[instruction] = (profile_arith_class[ipecc_instructions_dict[instruction][3]], profile_accessed(instruction))
+    return profile_issue_cache[instruction]
+
+# Timing state of ecc_curve, ecc_fp & the multipliers (issue returns the
+# cycle ecc_fp starts an instruction, 'ops' being the lists of addresses
+# its operands stand for if known, see profile_operands)
+class ProfileState(object):
+    def __init__(self, nbmult):
+        self.t = 0
+        self.fp_free = 0
+        self.mm_free = [0] * nbmult
+        self.pending = 0
+        # completion of the FPREDCs in progress, by destination address
+        self.dst = {}
+        self.stats = { "barrier" : 0, "mmwait" : 0, "sbwait" : 0 }
+    def copy(self):
+        s = ProfileState(0)
+        s.t = self.t
+        s.fp_free = self.fp_free
+        s.mm_free = list(self.mm_free)
+        s.pending = self.pending
+        s.dst = dict(self.dst)
+        s.stats = dict(self.stats)
+        return s
+    def launch(self):
+        self.t += PROFILE_LAUNCH
+    def branch(self, model):
+        self.t += model["branch"]
+    # ecc_curve stops once ecc_fp has accepted the last instruction (the
+    # end of its push for an FPREDC, the end of its execution otherwise)
+    def stop(self):
+        self.t = max(self.t, self.fp_free)
+    def issue(self, ins, barrier, model, ops=None):
+        t = self.t
+        if barrier is True:
+            if self.pending > t:
+                self.stats["barrier"] += self.pending - t
+                t = self.pending
+            self.dst = {}
+        t += PROFILE_ISSUE
+        self.t = t
+        (cls, accessed) = profile_issue_info(ins[1])
+        if cls is None:
+            return t
+        if ops is None:
+            ops = profile_operands(ins)
+        start = t if t > self.fp_free else self.fp_free
+        dst = self.dst
+        if len(dst) > 0:
+            ready = 0
+            for i in accessed:
+                for a in ops[i]:
+                    r = dst.get(a, 0)
+                    if r > ready:
+                        ready = r
+            if ready > start:
+                self.stats["sbwait"] += ready - start
+                start = ready
+        if cls == "redc":
+            mm_free = self.mm_free
+            mm = mm_free.index(min(mm_free))
+            if mm_free[mm] > start:
+                self.stats["mmwait"] += mm_free[mm] - start
+                start = mm_free[mm]
+            self.fp_free = start + model["redc_push"]
+            end = self.fp_free + model["redc_mult"] + model["redc_pull"]
+            mm_free[mm] = end
+            for a in ops[2]:
+                dst[a] = end
+        else:
+            self.fp_free = start + model[cls]
+            end = self.fp_free
+        # ecc_curve waits for ecc_fp to accept the instruction
+        self.t = start
+        if end > self.pending:
+            self.pending = end
+        return start
+
+# Walk through a routine from its entry up to its STOP, with the timing
+# state 'st' of the routines executed before if any (function 'visit' is
+# called with the address of each instruction walked through)
+def profile_routine(prog, entry, model, visit=None, st=None):
+    if st is None:
+        st = ProfileState(ipecc_hw_params["nbmult"])
+    t0 = st.t
+    stats0 = dict(st.stats)
+    st.launch()
+    stats = { "nbins" : 0, "nbredc" : 0, "branch" : 0, "truncated" : False }
+    stack = []
+    nbexec = {}
+    pc = entry
+    while pc in prog:
+        (instruction, barrier, stop, ins) = prog[pc]
+        if visit is not None:
+            visit(pc)
+        stats["nbins"] += 1
+        if stats["nbins"] > PROFILE_MAX_STEPS * ipecc_hw_params["nn"]:
+            stats["truncated"] = True
+            break
+        st.issue(ins, barrier, model)
+        next_pc = pc + 1
+        optype = ipecc_instructions_dict[instruction][1]
+        op = ipecc_instructions_dict[instruction][3]
+        if optype == "ARITH":
+            if profile_arith_class[op] == "redc":
+                stats["nbredc"] += 1
+        elif optype == "BRANCH":
+            taken = False
+            if op in ("B", "CALL"):
+                taken = True
+                if op == "CALL":
+                    stack.append(pc + 1)
+                next_pc = ins[3][0][2]
+            elif op == "RET":
+                if len(stack) == 0:
+                    break
+                taken = True
+                next_pc = stack.pop()
+            else:
+                nbexec[pc] = nbexec.get(pc, 0) + 1
+                if op in ("BODD", "BKAP"):
+                    taken = ((nbexec[pc] % 2) == 0)
+                else:
+                    taken = ((nbexec[pc] % ipecc_hw_params["nn"]) == 0)
+                if taken is True:
+                    if op == "CALLSN":
+                        stack.append(pc + 1)
+                    next_pc = ins[3][0][2]
+            if taken is True:
+                stats["branch"] += model["branch"]
+                st.branch(model)
+        if stop is True:
+            break
+        pc = next_pc
+    st.stop()
+    for k in st.stats.keys():
+        stats[k] = st.stats[k] - stats0[k]
+    # cycles up to the completion of all the pending operations
+    stats["cycles"] = max(st.t, st.pending) - t0
+    return stats
+
+# Routines of one bit of the [k]P main loop (see ecc_scalar.vhd)
+PROFILE_LADDER = ["itoh", "pre_zaddu", "zaddu", "pre_zaddc", "zaddc"]
+# Nb of bits run before the one measured by profile_ladder_bit
+PROFILE_LADDER_WARMUP = 2
+
+# Cycles of one bit of the [k]P main loop, its routines being run one
+# after the other from the state the previous bits left (FPREDCs may
+# remain in progress from one routine to the next): this is the time
+# between the STOPs of .zaddcL in steady state
+def profile_ladder_bit(prog, routines, model):
+    st = ProfileState(ipecc_hw_params["nbmult"])
+    for i in range(PROFILE_LADDER_WARMUP + 1):
+        t = st.t
+        for name in PROFILE_LADDER:
+            profile_routine(prog, routines[name], model, st=st)
+    return st.t - t
+
+# Predicted cycles of [k]P given the ones of each routine (dictionary name
+# -> cycles), and the part of it saved by overlapping the routines of the
+# main loop (see profile_ladder_bit)
+def profile_kp_cycles(prog, routines, cycles, model):
+    (nbbits, seq) = profile_kp_sequence()
+    total = sum([nb * cycles[name] for (name, nb) in seq if name in cycles])
+    overlap = 0
+    if all([name in routines for name in PROFILE_LADDER]):
+        bit = profile_ladder_bit(prog, routines, model)
+        overlap = (nbbits - 1) * (bit - sum([cycles[name] for name in PROFILE_LADDER]))
+    return (total + overlap, overlap)
+
+# Nb of calls of each routine during a [k]P computation (see the
+# sequencing of programs in ecc_scalar.vhd), not taking into account
+# exceptions (null or equal points) nor the optional attack features
+def profile_kp_sequence():
+    nn = ipecc_hw_params["nn"]
+    blinding = ipecc_hw_params["blinding"]
+    zremask = ipecc_hw_params["zremask"]
+    nbbits = nn + max(blinding, 0)
+    seq = [("chkcurve", 1)]
+    if blinding > 0:
+        seq += [("blindstart", 1), ("blnbit", blinding), ("blindstop", 1)]
+    seq += [("adpa", 1), ("drawZ", 1), ("setup", 1), ("zaddu", 1)]
+    seq += [("itoh", nbbits - 1), ("pre_zaddu", nbbits - 1), ("zaddu", nbbits - 1),
+            ("pre_zaddc", nbbits - 1), ("zaddc", nbbits - 1)]
+    if zremask > 0:
+        seq += [("drawZ", (nbbits - 1) // zremask), ("Zremask", (nbbits - 1) // zremask)]
+    seq += [("subtractP", 1), ("exit", 1), ("token_kP_mask", 1)]
+    return (nbbits, seq)
+
+def profile_file(infile, measured):
+    with open(infile, "r") as f:
+        asm = f.read()
+    # First pass to resolve the labels
+    resolve_labels(asm)
+    print("    -> First pass for labels resolution done")
+    # Second pass for encoding opcodes
+    (encoding, abstract_asm) = encode_opcodes(asm)
+    print("    -> Second pass for opcode encoding done")
+    model = profile_hw_model()
+    prog = profile_program(abstract_asm)
+    hp = ipecc_hw_params
+    print_info("Parameters: ", "nn=%d nbmult=%d nbdsp=%d sramlat=%d shuffle=%s (%s) blinding=%d zremask=%d" %
+            (hp["nn"], hp["nbmult"], hp["nbdsp"], hp["sramlat"], hp["shuffle"], hp["shuffle_type"], hp["blinding"], hp["zremask"]))
+    print_info("Model: ", "ww=%d w=%d ndsp=%d readlat=%d" % (model["ww"], model["w"], model["ndsp"], model["readlat"]))
+    print("    NNADD/NNSUB/NNXOR %d, NNSRL/NNSLL/NNDIV2 %d, TESTPAR %d, NNRND %d cycles" %
+            (model["addsub"], model["shift"], model["test"], model["rnd"]))
+    print("    FPREDC %d cycles (push %d + multiply-&-acc %d + pull %d), taken branch +%d cycles" %
+            (model["redc_push"] + model["redc_mult"] + model["redc_pull"], model["redc_push"],
+             model["redc_mult"], model["redc_pull"], model["branch"]))
+    # Cost of each exported routine
+    routines = {}
+    for (name, entry) in exported_routines().items():
+        routines[name] = (entry, profile_routine(prog, entry, model))
+    print("")
+    print("    %-20s %6s %6s %6s %8s %8s %8s %8s" % ("routine", "addr", "instr", "redc", "barrier", "mm-wait", "sb-wait", "cycles"))
+    for name in sorted(routines.keys(), key=lambda n: routines[n][0]):
+        (entry, st) = routines[name]
+        print("    %-20s 0x%03x %6d %6d %8d %8d %8d %8d%s" % (name, entry, st["nbins"], st["nbredc"],
+                st["barrier"], st["mmwait"], st["sbwait"], st["cycles"], " (truncated)" if st["truncated"] else ""))
+    # Predicted [k]P breakdown
+    (nbbits, seq) = profile_kp_sequence()
+    entries = dict([(name, routines[name][0]) for name in routines.keys()])
+    cycles = dict([(name, routines[name][1]["cycles"]) for name in routines.keys()])
+    (total, overlap) = profile_kp_cycles(prog, entries, cycles, model)
+    print("")
+    print_info("[k]P: ", "%d bits (nn + blinding)" % nbbits)
+    print("    %-20s %8s %12s %7s" % ("routine", "calls", "cycles", "%"))
+    for (name, nb) in seq:
+        if nb == 0:
+            continue
+        if name not in routines:
+            print_warning("Warning: ", "routine %s not found in %s" % (name, infile))
+            continue
+        c = nb * routines[name][1]["cycles"]
+        print("    %-20s %8d %12d %6.1f%%" % (name, nb, c, (100.0 * c) / total))
+    if overlap != 0:
+        print("    %-20s %8d %12d %6.1f%%" % ("(main loop overlap)", nbbits - 1, overlap, (100.0 * overlap) / total))
+    if all([name in routines for name in PROFILE_LADDER]):
+        print_info("Main loop: ", "%d cycles per bit" % profile_ladder_bit(prog, entries, model))
+    print_progress("[+] Predicted [k]P: %d cycles" % total)
+    if measured is not None:
+        print_info("R_DBG_TIME: ", "%d cycles measured, model error %+.1f%%" % (measured, (100.0 * (total - measured)) / measured))
+    return
+
+##########################################################
+### Microcode scheduling (-s option)
+#
+# Each basic block of the program (instructions between two labels, a
+# branch, a NOP or a STOP) is reordered and its BARRIERs are placed again
+# using the cost model of the profiler:
+#   - a dependency graph is built from the large numbers (addresses) &
+#     the flags read & written by the instructions; a patched operand
+#     may target all the addresses its patch can select in ecc_curve.vhd
+#     (see emulate_load_patches) and flags are only ordered w.r.t. the
+#     instructions actually reading them (all flags are considered live
+#     at the end of the block),
+#   - as ecc_curve does not wait for the result of FPREDC, a BARRIER is
+#     only needed before an instruction reading or writing an address an
+#     FPREDC not yet waited for may write (reading the operands of a
+#     pending FPREDC is harmless, they were pushed to the multiplier),
+#   - FPREDCs pending when entering a block are those of the original
+#     program: the instructions following its first BARRIER are kept
+#     behind a BARRIER, and an FPREDC of the block may only remain
+#     pending at its end if it already was in the original program,
+#   - list scheduling is tried with a few priority functions and the
+#     original order of the block is kept unless one of them is faster.
+# The critical path of a block is the longest path of its dependency
+# graph (a successor of an FPREDC waits for its completion) or the time
+# ecc_fp is busy, whichever is greater. The nb of multipliers can be
+# overridden to evaluate hardware configurations not synthesized yet.
+
+# Memory resource of an address
+def sched_mem(addr):
+    return ("@", addr)
+
+# Addresses a patch target (see emulate_patch_opa/opb/opc) may select
+def sched_patch_targets(target):
+    if type(target) is tuple:
+        base = binstring_to_int(ipecc_operands_dict["XR0"]) & ~3
+        return set(range(base, base + 4))
+    if target in emulate_patch_cst:
+        return set([emulate_patch_cst[target]])
+    return set([binstring_to_int(ipecc_operands_dict[target])])
+
+# Flags read by the branch instructions
+sched_branch_flags = {
+    "BZ" : ["%Z"], "BSN" : ["%SN"], "CALLSN" : ["%SN"],
+    "BODD" : ["%par"], "BKAP" : ["%kap"],
+}
+
+# Addresses each operand (a, b & c) of an ARITHmetic instruction may be
+# patched into (empty set if the operand is not patched) along with the
+# flags read & written by its patches
+def sched_patches(ins):
+    (addr, instruction, options, abstract_operands, l) = ins
+    lit = set()
+    if (abstract_operands[0] is not None) and (abstract_operands[0][0] == "OP"):
+        lit.add(abstract_operands[0][2])
+    rd = set()
+    wr = set()
+    patched = [set(), set(), set()]
+    for o in options:
+        if o[0] != "p":
+            continue
+        info = { "patch" : set(), "reads" : set(), "writes" : set() }
+        for pid in (None, int(o[1:])):
+            if pid in emulate_patch_info:
+                for k in info.keys():
+                    info[k] |= emulate_patch_info[pid][k]
+        targets = [set(), set(), set()]
+        for (chain, i) in ((emulate_patch_opa, 0), (emulate_patch_opb, 1)):
+            for (name, target) in chain:
+                if name in info["patch"]:
+                    targets[i] |= sched_patch_targets(target)
+        if "p" in info["patch"]:
+            targets[1] |= set([emulate_patch_cst["C_PATCH_P"], emulate_patch_cst["C_PATCH_ZERO"]])
+            rd.add("%SN")
+        if "as" in info["patch"]:
+            targets[1] |= set([emulate_patch_cst["C_PATCH_ZERO"], emulate_patch_cst["C_PATCH_TWOP"]])
+            rd.add("%SN")
+        for (name, target) in emulate_patch_opc:
+            if name in info["patch"]:
+                if target == "opa":
+                    targets[2] |= lit | targets[0]
+                else:
+                    targets[2] |= sched_patch_targets(target)
+        for i in range(3):
+            patched[i] |= targets[i]
+        rd |= info["reads"]
+        for f in info["writes"]:
+            if f.startswith("detect"):
+                # nullity of the result is recorded at the end of the instruction
+                rd.add("%Z")
+                wr.add(f[len("detect"):])
+            else:
+                wr.add(f)
+    return (patched, rd, wr)
+
+# Resources (addresses, flags & mask shift-registers) possibly read
+# & written by an instruction (only the ones it surely accesses if
+# 'may' is False: operands a patch can retarget are then ignored)
+def sched_resources(ins, may=True):
+    (addr, instruction, options, abstract_operands, l) = ins
+    optype = ipecc_instructions_dict[instruction][1]
+    op = ipecc_instructions_dict[instruction][3]
+    rd = set()
+    wr = set()
+    if optype == "BRANCH":
+        rd |= set(sched_branch_flags.get(op, []))
+        return (rd, wr)
+    if optype != "ARITH":
+        return (rd, wr)
+    ops = [set(), set(), set()]
+    for i in range(3):
+        if (abstract_operands[i] is not None) and (abstract_operands[i][0] == "OP"):
+            ops[i].add(abstract_operands[i][2])
+    (patched, prd, pwr) = sched_patches(ins)
+    for i in range(3):
+        if may is True:
+            ops[i] |= patched[i]
+        elif len(patched[i]) != 0:
+            ops[i] = set()
+    rd |= prd
+    wr |= pwr
+    if op in ("ADD", "SUB", "XOR", "RED"):
+        rd |= set(sched_mem(a) for a in ops[0] | ops[1])
+    elif op in ("SRL", "SLL", "DIV", "SRH", "TST", "TSH"):
+        rd |= set(sched_mem(a) for a in ops[0])
+    if op not in ("TST", "TSH"):
+        wr |= set(sched_mem(a) for a in ops[2])
+    if op in ("ADD", "SUB"):
+        wr |= set(["%Z", "%SN", "%Carith"])
+        if "X" in options:
+            rd.add("%Carith")
+    elif op in ("SRL", "SLL", "SRH"):
+        wr |= set(["%Z", "%Cshift"])
+        if "X" in options:
+            rd.add("%Cshift")
+    elif op in ("DIV", "RND", "RNM", "RNH", "RNF"):
+        wr.add("%Z")
+    elif op in ("TST", "TSH"):
+        wr.add(abstract_operands[2][1])
+    if op in ("SRH", "TSH", "RNH", "RNF"):
+        # mask shift-register
+        rd.add(("shr", abstract_operands[1][2]))
+        wr.add(("shr", abstract_operands[1][2]))
+    return (rd, wr)
+
+def sched_is_flag(r):
+    return type(r) is str
+
+# Dependency graph of the instructions of a block: succ[i] is the set
+# of the instructions which must remain after instruction i
+def sched_dependencies(res):
+    n = len(res)
+    succ = [set() for i in range(n)]
+    flags = set()
+    for (rd, wr) in res:
+        flags |= set(r for r in rd | wr if sched_is_flag(r))
+    for j in range(n):
+        (rdj, wrj) = res[j]
+        for i in range(j):
+            (rdi, wri) = res[i]
+            if any(not sched_is_flag(r) for r in (wri & (rdj | wrj)) | (rdi & wrj)):
+                succ[i].add(j)
+    for f in flags:
+        writes = [i for i in range(n) if f in res[i][1]]
+        last = None
+        for i in range(n):
+            if f in res[i][0]:
+                # the write reaching this read must remain the last one
+                for w in writes:
+                    if w == i or w == last:
+                        continue
+                    if w < i:
+                        succ[w].add(last)
+                    else:
+                        succ[i].add(w)
+                if last is not None:
+                    succ[last].add(i)
+            if f in res[i][1]:
+                last = i
+        # flags are live at the end of the block
+        for w in writes[:-1]:
+            succ[w].add(writes[-1])
+    for i in range(n):
+        succ[i].discard(i)
+    return succ
+
+# Latency of an instruction (from its start to the one of an instruction
+# depending on it, issued behind a BARRIER in the case of FPREDC) and the
+# time ecc_fp is busy with it
+def sched_latency(ins, model):
+    optype = ipecc_instructions_dict[ins[1]][1]
+    if optype != "ARITH":
+        return (PROFILE_ISSUE, 0)
+    cls = profile_arith_class[ipecc_instructions_dict[ins[1]][3]]
+    if cls == "redc":
+        return (model["redc_push"] + model["redc_mult"] + model["redc_pull"] + PROFILE_ISSUE, model["redc_push"])
+    return (model[cls], model[cls])
+
+def sched_is_redc(ins):
+    return ins[1] == "FPREDC"
+
+# Time of a block executed in the given order ((index, barrier) list,
+# index None standing for the terminating branch/NOP if any), all
+# pending operations being waited for
+def sched_block_time(blk, order, model):
+    st = ProfileState(ipecc_hw_params["nbmult"])
+    for (i, barrier) in order:
+        st.issue(blk["term"][2] if i is None else blk["nodes"][i][2], barrier, model)
+    return max(st.t, st.pending)
+
+# Schedule of a block in its original order
+def sched_original(blk):
+    order = [(i, blk["nodes"][i][3]) for i in range(len(blk["nodes"]))]
+    if blk["term"] is not None:
+        order.append((None, blk["term"][3]))
+    return order
+
+# Analysis of a block: dependencies, constraints at its boundaries &
+# priorities (longest latency path to the end of the block)
+def sched_analyze(blk, model):
+    nodes = blk["nodes"]
+    n = len(nodes)
+    res = [sched_resources(ins) for (text, l, ins, barrier) in nodes]
+    succ = sched_dependencies(res)
+    # instructions following the first BARRIER & FPREDCs which must
+    # not be pending at the end of the block ("E" stands for the ones
+    # pending when entering it)
+    after = [False] * n
+    pending = set(["E"])
+    for (i, barrier) in sched_original(blk):
+        if barrier is True:
+            pending.clear()
+        if i is None:
+            continue
+        after[i] = ("E" not in pending)
+        if sched_is_redc(nodes[i][2]):
+            pending.add(i)
+    if blk["barrier_out"] is True:
+        pending.clear()
+    lat = [sched_latency(ins, model) for (text, l, ins, barrier) in nodes]
+    prio = [0] * n
+    for i in reversed(range(n)):
+        prio[i] = lat[i][0] + max([prio[j] for j in succ[i]] + [0])
+    return { "res" : res, "succ" : succ, "after" : after, "keep" : pending, "prio" : prio }
+
+# List scheduling of a block, the candidate instruction being chosen
+# with function 'key'; returns None if a BARRIER would be needed at the
+# end of the block just before its STOP
+def sched_list(blk, ana, model, key):
+    nodes = blk["nodes"]
+    n = len(nodes)
+    res = ana["res"]
+    npred = [0] * n
+    for i in range(n):
+        for j in ana["succ"][i]:
+            npred[j] += 1
+    ready = [i for i in range(n) if npred[i] == 0]
+    st = ProfileState(ipecc_hw_params["nbmult"])
+    pending = set(["E"])
+    order = []
+    def hazard(i):
+        for p in pending:
+            if p == "E":
+                if ana["after"][i] is True:
+                    return True
+            elif any(not sched_is_flag(r) for r in res[p][1] & (res[i][0] | res[i][1])):
+                return True
+        return False
+    while len(ready) != 0:
+        best = None
+        for i in ready:
+            barrier = hazard(i)
+            start = st.copy().issue(nodes[i][2], barrier, model)
+            k = key(i, barrier, start, ana)
+            if (best is None) or (k < best[0]):
+                best = (k, i, barrier)
+        (k, i, barrier) = best
+        st.issue(nodes[i][2], barrier, model)
+        if barrier is True:
+            pending.clear()
+        if sched_is_redc(nodes[i][2]):
+            pending.add(i)
+        order.append((i, barrier))
+        ready.remove(i)
+        for j in ana["succ"][i]:
+            npred[j] -= 1
+            if npred[j] == 0:
+                ready.append(j)
+    barrier = len(pending - ana["keep"]) != 0
+    if blk["term"] is not None:
+        order.append((None, barrier))
+    elif barrier is True:
+        if blk["stop"] is not None:
+            # a BARRIER cannot be put before a STOP
+            return None
+        order.append(("BARRIER", True))
+    return order
+
+sched_keys = [
+    # earliest start, then longest path to the end of the block
+    lambda i, barrier, start, ana : (start, -ana["prio"][i], i),
+    # longest path first
+    lambda i, barrier, start, ana : (-ana["prio"][i], start, i),
+    # avoid BARRIERs, then longest path
+    lambda i, barrier, start, ana : (barrier, -ana["prio"][i], i),
+]
+
+# Reorder a block (order None if the original one is kept)
+def sched_block(blk, model):
+    ana = sched_analyze(blk, model)
+    best = (sched_block_time(blk, sched_original(blk), model), None)
+    for key in sched_keys:
+        order = sched_list(blk, ana, model, key)
+        if order is None:
+            continue
+        t = sched_block_time(blk, [o for o in order if o[0] != "BARRIER"], model)
+        if t < best[0]:
+            best = (t, order)
+    blk["order"] = best[1]
+    return blk
+
+# Split the source in basic blocks: the result is a list of either lines
+# (labels, comments) or blocks (dict with the list of instructions with
+# the comment lines preceding them, the terminating branch/NOP & STOP)
+def sched_blocks(asm, abstract_asm):
+    items = []
+    k = 0
+    for l in asm.splitlines():
+        comment = re.search(r"^\s*#", l)
+        empty_line = re.search(r"^\s*$", l)
+        label = re.search(r"^\s*(\.[a-zA-Z0-9].*:)\s*(#.*)*$", l)
+        if (comment is not None) or (empty_line is not None):
+            items.append(("text", l, None))
+        elif label is not None:
+            items.append(("label", l, None))
+        else:
+            items.append(("ins", l, abstract_asm[k]))
+            k += 1
+    out = []
+    blk = None
+    text = []
+    unit_text = []
+    barrier = False
+    def new_block():
+        return { "nodes" : [], "term" : None, "stop" : None, "tail" : [], "lines" : [], "barrier_out" : False }
+    for (kind, l, ins) in items:
+        if kind == "text":
+            text.append(l)
+            continue
+        if kind == "label":
+            if blk is not None:
+                blk["barrier_out"] = barrier
+                blk["tail"] = unit_text
+                barrier = False
+                unit_text = []
+                out.append(blk)
+                blk = None
+            out += text + [l]
+            text = []
+            continue
+        instruction = ins[1]
+        if instruction == "STOP":
+            # the BARRIER of a STOP is lost (see encode_opcodes)
+            barrier = False
+            if blk is None:
+                out += text + [l]
+            else:
+                blk["stop"] = (unit_text + text, l)
+                blk["lines"] += text + [l]
+                out.append(blk)
+                blk = None
+            unit_text = []
+            text = []
+            continue
+        if blk is None:
+            blk = new_block()
+        blk["lines"] += text + [l]
+        if instruction == "BARRIER":
+            # comments preceding the BARRIER go with the instruction
+            barrier = True
+            unit_text += text
+            text = []
+            continue
+        unit = (unit_text + text, l, ins, barrier)
+        unit_text = []
+        text = []
+        barrier = False
+        if ipecc_instructions_dict[instruction][1] in ("BRANCH", "NOP"):
+            blk["term"] = unit
+            out.append(blk)
+            blk = None
+        else:
+            blk["nodes"].append(unit)
+    if blk is not None:
+        blk["barrier_out"] = barrier
+        blk["tail"] = unit_text
+        out.append(blk)
+    return out + text
+
+# Source of a scheduled block
+def sched_block_lines(blk):
+    if blk["order"] is None:
+        return blk["lines"]
+    lines = []
+    tail = blk["tail"]
+    # BARRIERs are indented like the instructions
+    indent = "\t"
+    for (i, barrier) in blk["order"]:
+        if i == "BARRIER":
+            lines += tail + [indent + "BARRIER"]
+            tail = []
+            continue
+        (text, l, ins, b) = blk["term"] if i is None else blk["nodes"][i]
+        indent = re.search(r"^\s*", l).group(0)
+        lines += text
+        if barrier is True:
+            lines.append(indent + "BARRIER")
+        lines.append(l)
+    lines += tail
+    if blk["stop"] is not None:
+        lines += blk["stop"][0] + [blk["stop"][1]]
+    return lines
+
+def sched_source(out):
+    lines = []
+    for blk in out:
+        if type(blk) is dict:
+            lines += sched_block_lines(blk)
+        else:
+            lines.append(blk)
+    return "\n".join(lines) + "\n"
+
+def sched_assemble(asm):
+    resolve_labels(asm)
+    (encoding, abstract_asm) = encode_opcodes(asm)
+    return profile_program(abstract_asm)
+
+# Cycles of each exported routine, the ones of the whole [k]P & of all
+# the routines
+def sched_cycles(prog, model, visit=None):
+    routines = {}
+    entries = exported_routines()
+    for (name, entry) in entries.items():
+        routines[name] = profile_routine(prog, entry, model, None if visit is None else visit(name))["cycles"]
+    (kp, overlap) = profile_kp_cycles(prog, entries, routines, model)
+    return (routines, (kp, sum(routines.values())))
+
+# Lower bound of the cycles of a routine: critical path of the dataflow
+# of the instructions walked through (true dependencies only, operations
+# starting as soon as their operands are ready), or the time ecc_curve
+# & ecc_fp are busy, whichever is greater
+class SchedBound(object):
+    def __init__(self, prog, model):
+        self.res = {}
+        self.lat = {}
+        self.redc = {}
+        for (addr, (instruction, barrier, stop, ins)) in prog.items():
+            self.res[addr] = sched_resources(ins, False)
+            self.lat[addr] = sched_latency(ins, model)
+            self.redc[addr] = sched_is_redc(ins)
+        self.routines = {}
+    def visit(self, name):
+        st = { "ready" : {}, "cp" : 0, "busy" : 0, "nbins" : 0 }
+        self.routines[name] = st
+        def f(pc):
+            (rd, wr) = self.res[pc]
+            (lat, busy) = self.lat[pc]
+            done = max([st["ready"].get(r, 0) for r in rd] + [0]) + lat
+            for r in wr:
+                st["ready"][r] = done
+            if self.redc[pc] is True:
+                done -= PROFILE_ISSUE
+            st["cp"] = max(st["cp"], done)
+            st["busy"] += busy
+            st["nbins"] += 1
+        return f
+    def cycles(self, name):
+        st = self.routines[name]
+        return PROFILE_LAUNCH + max(st["cp"], st["busy"], PROFILE_ISSUE * st["nbins"])
+
+def schedule_file(infile, outfile):
+    with open(infile, "r") as f:
+        asm = f.read()
+    resolve_labels(asm)
+    print("    -> First pass for labels resolution done")
+    (encoding, abstract_asm) = encode_opcodes(asm)
+    print("    -> Second pass for opcode encoding done")
+    model = profile_hw_model()
+    hp = ipecc_hw_params
+    print_info("Parameters: ", "nn=%d nbmult=%d nbdsp=%d sramlat=%d" % (hp["nn"], hp["nbmult"], hp["nbdsp"], hp["sramlat"]))
+    prog = profile_program(abstract_asm)
+    (before, before_total) = sched_cycles(prog, model)
+    out = sched_blocks(asm, abstract_asm)
+    blocks = [blk for blk in out if type(blk) is dict]
+    for blk in blocks:
+        sched_block(blk, model)
+    print("    -> Blocks scheduled")
+    # Blocks are scheduled independently: only keep the reordered ones
+    # which speed up [k]P (or the other routines)
+    (after, total) = sched_cycles(sched_assemble(sched_source(out)), model)
+    for blk in blocks:
+        if blk["order"] is None:
+            continue
+        order = blk["order"]
+        blk["order"] = None
+        (a, t) = sched_cycles(sched_assemble(sched_source(out)), model)
+        if t <= total:
+            (after, total) = (a, t)
+        else:
+            blk["order"] = order
+    sched = sched_source(out)
+    sched_prog = sched_assemble(sched)
+    if sorted(prog.keys()) != sorted(sched_prog.keys()):
+        print_error("Error: ", "", "scheduled program differs in size from the original one")
+        sys.exit(-1)
+    with open(outfile, "w") as f:
+        f.write(sched)
+    print_info("Scheduled program: ", "%s (%d blocks, %d reordered)" % (outfile, len(blocks),
+            len([blk for blk in blocks if blk["order"] is not None])))
+    bound = SchedBound(sched_prog, model)
+    sched_cycles(sched_prog, model, bound.visit)
+    print("")
+    print("    %-20s %8s %8s %8s %8s" % ("routine", "cp", "before", "after", "gain"))
+    for (name, entry) in sorted(exported_routines().items(), key=lambda e: e[1]):
+        print("    %-20s %8d %8d %8d %7.1f%%" % (name, bound.cycles(name), before[name], after[name],
+                (100.0 * (before[name] - after[name])) / before[name]))
+    print("")
+    print_progress("[+] Predicted [k]P: %d cycles before, %d after scheduling (%.1f%% less)" % (before_total[0], total[0],
+            (100.0 * (before_total[0] - total[0])) / before_total[0]))
+    return
+
 ##########################################################
 def disassemble(binary):
     lines = binary.splitlines()
@@ -1890,6 +3462,16 @@ def parse_vhdl(vhdl, vhdl_conf):
         if check is not None:
             nbopcodes = int(check.group(1))
         ## Bignum size
+        ## Hardware parameters (only used by the profiler & the emulator)
+        check = re.search(r"^\s*constant\s+(nn|multwidth|nbmult|nbdsp|sramlat|blinding|zremask)\s*:[^:]*:=\s*([0-9]+)", l)
+        if check is not None:
+            ipecc_hw_params[check.group(1)] = int(check.group(2))
+        check = re.search(r"^\s*constant\s+(shuffle|hwsecure)\s*:\s*boolean\s*:=\s*(TRUE|FALSE)", l)
+        if check is not None:
+            ipecc_hw_params[check.group(1)] = (check.group(2) == "TRUE")
+        check = re.search(r"^\s*constant\s+(techno|shuffle_type)\s*:\s*[a-z_]+\s*:=\s*([a-z0-9_]+)", l)
+        if check is not None:
+            ipecc_hw_params[check.group(1)] = check.group(2)
         check = re.search(r"constant\s+nn\s*:\s*positive\s*:=\s*([0-9]+)", l)
         if check is not None:
             nnsize = int(check.group(1))
@@ -1950,8 +3532,8 @@ def parse_csv(csv):
 
 ## Sanity check and update our dictionaries if asked
 if len(sys.argv) > 3:
-    if len(sys.argv) != 6:
-        print_error("Error: ", "", "expecting -a, -d, or -e the VHDL file as arg3, the VHDL conf as arg4 and the CSV file as arg5!")
+    if (len(sys.argv) != 6) and not ((sys.argv[1] in ("-p", "-s")) and (len(sys.argv) == 7)) and not ((sys.argv[1] == "-k") and (len(sys.argv) in (7, 8, 9, 10))):
+        print_error("Error: ", "", "expecting -a, -d, -e, -p, -k or -s, the VHDL file as arg3, the VHDL conf as arg4 and the CSV file as arg5!")
         sys.exit(-1)
     print("  -> Parsing %s, %s and %s for checking/updating our constants" % (sys.argv[3], sys.argv[4], sys.argv[5]))
     with open(sys.argv[3], "r") as f1, open(sys.argv[4], "r") as f2 :
@@ -1961,9 +3543,15 @@ if len(sys.argv) > 3:
     with open(sys.argv[5], "r") as f:
         csv = f.read()
         parse_csv(csv)
+    # The emulator decodes patches the way ecc_curve.vhd does (the
+    # assembler also needs them to export the large numbers each
+    # opcode may write)
+    if sys.argv[1] in ("-a", "-e", "-p", "-k", "-s"):
+        with open(os.path.join(os.path.dirname(sys.argv[3]), "ecc_curve.vhd"), "r") as f:
+            emulate_load_patches(f.read())
 
 if len(sys.argv) < 3:
-    print_error("Error: ", "", "expecting -a (assemble) or -d (disassemble) or -e (execute) with at least the file")
+    print_error("Error: ", "", "expecting -a (assemble) or -d (disassemble) or -e (execute) or -p (profile) or -k ([k]P emulation) or -s (schedule) with at least the file")
     sys.exit(-1)
 
 if sys.argv[1] == "-a":
@@ -1981,6 +3569,43 @@ elif sys.argv[1] == "-e":
     initial_state = sys.stdin.read()
     print("  -> Emulation of file %s" % sys.argv[2])
     emulate_file(sys.argv[2], initial_state)
+elif sys.argv[1] == "-p":
+    ## Static profiling (an optional last argument gives the nb of
+    ## cycles of a [k]P as measured by the IP through R_DBG_TIME)
+    measured = None
+    if len(sys.argv) == 7:
+        measured = get_dec_hexa_bin_value(sys.argv[6])
+    print("  -> Profiling file %s" % sys.argv[2])
+    profile_file(sys.argv[2], measured)
+elif sys.argv[1] == "-k":
+    ## Emulation of [k]P computations, checked against the test-vector
+    ## file given as arg6 (optionally followed by a nb of extra [k]P
+    ## on random points & scalars for each curve, by the seed and by the
+    ## CSV file to write the cycle counts of the tests into)
+    if len(sys.argv) < 7:
+        print_error("Error: ", "", "-k expects the VHDL files, the CSV file and the test-vector file")
+        sys.exit(-1)
+    nbrandom = 0
+    seed = None
+    if len(sys.argv) > 7:
+        nbrandom = get_dec_hexa_bin_value(sys.argv[7])
+    if len(sys.argv) > 8:
+        seed = get_dec_hexa_bin_value(sys.argv[8])
+    csvfile = None
+    if len(sys.argv) > 9:
+        csvfile = sys.argv[9]
+    print("  -> Emulation of [k]P with file %s" % sys.argv[2])
+    emulate_kp_file(sys.argv[2], sys.argv[6], nbrandom, seed, csvfile)
+elif sys.argv[1] == "-s":
+    ## Scheduling of the microcode, written in <file>_sched.s (an
+    ## optional last argument overrides the nb of multipliers)
+    if len(sys.argv) < 6:
+        print_error("Error: ", "", "-s expects the VHDL files and the CSV file")
+        sys.exit(-1)
+    if len(sys.argv) == 7:
+        ipecc_hw_params["nbmult"] = get_dec_hexa_bin_value(sys.argv[6])
+    print("  -> Scheduling file %s" % sys.argv[2])
+    schedule_file(sys.argv[2], re.sub(r"(\.s)?$", "_sched.s", sys.argv[2], count=1))
 else:
-    print_error("Error: ", "", "unknown option '%s' (-a, -d or -e expected)" % sys.argv[1])
+    print_error("Error: ", "", "unknown option '%s' (-a, -d, -e, -p, -k or -s expected)" % sys.argv[1])
     sys.exit(-1)
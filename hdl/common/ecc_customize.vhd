@@ -34,7 +34,7 @@ package ecc_customize is
 	-- multwidth is only used if 'techno' = 'asic'
 	-- (otherwise its value has no meaning and can be ignored)
 	constant multwidth : positive := 32; -- 32 seems fair for an ASIC default
-	constant nbmult : positive range 1 to 2 := 2;
+	constant nbmult : positive range 1 to 4 := 2;
 	constant nbdsp : positive := 6;
 	constant sramlat : positive range 1 to 2 := 2;
 	constant async : boolean := FALSE;
@@ -68,6 +68,12 @@ package ecc_customize is
 	-- Miscellaneous
 	-- -------------
 	constant axi32or64 : natural := 32; -- 32 or 64 only allowed values
+	constant dma : boolean := FALSE;
+	constant dmaaw : positive := 32;
+	constant shadow : boolean := FALSE;
+	constant cmdqdepth : natural := 0;
+	constant perfcnt : boolean := FALSE;
+	constant tracedepth : natural := 0;
 	constant nblargenb : positive := 32;  -- Change these two parameters only if
 	constant nbopcodes : positive := 1024; -- |you really know what you're doing.
 	-- --------------------------
@@ -78,6 +84,7 @@ package ecc_customize is
 	constant simlogfile : string := "/tmp/ecc.log";
 	constant simxyshuflogfile : string := "/tmp/ecc_xyshuf.log";
 	constant simtrngfile : string := "/tmp/random.txt";
+	constant simcsvfile : string := "/tmp/ecc_cycles.csv";
 	-- ********************************
 	-- End of: user-editable parameters
 	-- ********************************
@@ -289,7 +296,7 @@ end package ecc_customize;
 --       Number of Montgomery multipliers instanciated in the IP.
 --
 -- TYPE/VALUE
---       Integer which should be kept small (default being 2)
+--       Integer between 1 and 4 (default being 2)
 --
 -- DESCRIPTION
 --       The number of Montgomery multipliers in the IP should be dictated by
@@ -321,9 +328,34 @@ end package ecc_customize;
 --       to carry out in parallel due to the dependency that exists between
 --       intermediate variables in the CoZ formulae.
 --       This means that setting 'nbmult' to a value more than 2 for your design
---       would simply increase - quite significantly - its surface, without
---       improving the speed of curve computations at all. Normally you don't
---       want to do that. On the other hand, if for any particular reason
+--       would increase - quite significantly - its surface, while improving
+--       the speed of curve computations only if the microcode is reordered
+--       to expose more independent REDC operations (the gain can be predicted
+--       without simulation using 'make profile' & 'make schedule NBMULT=<n>'
+--       in directory ecc_curve_iram/). Each FPREDC is dispatched to the first
+--       free multiplier, and with more than 2 multipliers ecc_fp holds back
+--       any operation that accesses the result of an FPREDC still in
+--       progress (see (s158) in ecc_fp.vhd), so that the microcode only needs
+--       BARRIER to synchronize with results of FPREDC it actually depends on.
+--       This scoreboard is not generated with 1 or 2 multipliers, for which
+--       the hardware is the same as before it was introduced (the default
+--       microcode places all its BARRIERs and does not need it). Normally
+--       you don't want more than 2 multipliers.
+--       Values 3 and 4 are EXPERIMENTAL: they have not been synthesized nor
+--       simulated yet, so no area, Fmax or measured cycle figures are
+--       available for them. For reference, the figures predicted by
+--       'make schedule NBMULT=<n>' on the default microcode (nn = 528,
+--       nbdsp = 6, sramlat = 2) for one [k]P are:
+--
+--         nbmult    unscheduled    scheduled
+--           1        12526853       12526839
+--           2         8956740        8675331
+--           3         8393523        8033240
+--           4         8393523        8032591
+--
+--       i.e about 7% less cycles going from 2 to 3 multipliers and no
+--       further gain with 4, which the area cost should be weighed against.
+--       On the other hand, if for any particular reason
 --       you're considering choosing another set of formulae for your specific
 --       design, then you may also consider tweaking parameter 'nbmult'.
 --       Note that the set of formulae is implemented in software in IPECC
@@ -1318,6 +1350,213 @@ end package ecc_customize;
 --
 -- ============================================================================
 -- NAME
+--       'dma'
+--       'dmaaw'
+--
+-- DEFINITION
+--       'dma': enables the descriptor-ring DMA engine (ecc_dma.vhd) which
+--       allows the IP to fetch its jobs from system memory.
+--       'dmaaw': width of the address bus of the AXI4 master interface
+--       of the DMA engine.
+--
+-- TYPE/VALUE
+--       'dma': Boolean. Default is FALSE.
+--       'dmaaw': Integer, at most 32. Default is 32.
+--
+-- DESCRIPTION
+--       Without the DMA engine, the software driver has to transfer every
+--       large number, command and result through the AXI-lite register
+--       interface of the IP, one word at a time, polling R_STATUS in between.
+--
+--       The engine lives in a separate top-level, entity ecc_dma_top (file
+--       ecc_dma_top.vhd), which must be instantiated instead of entity ecc
+--       when 'dma' is set to TRUE (entity ecc itself has no DMA port, so
+--       that existing integrations are left unchanged). ecc_dma_top inserts
+--       the engine in between its AXI-lite slave interface and the one of
+--       ecc, and adds a second AXI interface (an AXI4 master, with data bus
+--       of width 'axi32or64' and address bus of width 'dmaaw') which must be
+--       connected to the system memory. Capability bit CAP_DMA is only set
+--       when the engine is actually present. Software then:
+--
+--         - allocates in memory a ring of 2**L job descriptors (L being
+--           programmed in register W_DMA_RING_CFG) and writes the bus
+--           address of the ring in register W_DMA_RING_BASE;
+--
+--         - fills descriptors and advances the producer index in register
+--           W_DMA_PROD;
+--
+--         - collects completions by reading the consumer index in register
+--           R_DMA_STATUS (or waits for an interrupt, if one was asked for
+--           in the descriptor and enabled in W_DMA_CTRL).
+--
+--       The engine replays, for each descriptor, the exact register sequence
+--       the software driver would have issued (including the token and the
+--       masking of the scalar), so the security properties of the IP are
+--       unchanged. While the engine is enabled, software writes to the nominal
+--       registers of the IP (and reads of R_READ_DATA) are discarded and flag
+--       CPU_FBD is raised in R_DMA_STATUS.
+--
+--       See the comment header of ecc_dma.vhd for the layout of descriptors.
+--
+-- SEE ALSO
+--       'axi32or64'
+--
+-- ============================================================================
+-- NAME
+--       'shadow'
+--
+-- DEFINITION
+--       Enables a shadow set of input slots (next scalar k & next base point
+--       XR1/YR1) along with a "queued start" of [k]P computation.
+--
+-- TYPE/VALUE
+--       Boolean. Default is FALSE.
+--
+-- DESCRIPTION
+--       Without this option, the operands of the next [k]P computation can
+--       only be transferred once the current computation is over (the IP
+--       refuses any write to W_CTRL as long as bit BUSY is set in R_STATUS)
+--       and the IP is idle during all the time software spends uploading
+--       them.
+--
+--       When 'shadow' is set to TRUE, ecc_axi contains a small RAM of
+--       3 x ceil(nn / axi32or64) words into which software can write the
+--       next k, XR1 & YR1 even while the IP is busy, by setting bit
+--       CTRL_SHADOW along with the usual bits in W_CTRL. Writing W_CTRL
+--       with both CTRL_KP & CTRL_SHADOW bits set then queues the start of
+--       the [k]P computation using these operands (bit KP_QUEUED is set in
+--       R_STATUS).
+--
+--       As soon as the IP is idle, the result of the previous [k]P compu-
+--       tation has been read back by software (slot YR1 is preserved until
+--       then) and the token of the new computation has been read, ecc_axi
+--       transfers the shadow operands into the memory of large numbers (as if
+--       software had written them, thus with the same masking of the scalar)
+--       and starts the computation. Each shadow word is erased once it has
+--       been transferred.
+--
+--       The point at infinity cannot be used as input of a queued [k]P.
+--
+-- ============================================================================
+-- NAME
+--       'cmdqdepth'
+--
+-- DEFINITION
+--       Depth of the hardware command queue (0 means no queue).
+--
+-- TYPE/VALUE
+--       Integer. Default is 0. If not 0, must be a power of 2 between 2
+--       and 128.
+--
+-- DESCRIPTION
+--       Without a command queue, software has to wait for bit BUSY to be
+--       low in R_STATUS before it can issue the next point operation, which
+--       costs at least one AXI round trip between two operations.
+--
+--       When 'cmdqdepth' is not 0, ecc_axi contains a FIFO of 'cmdqdepth'
+--       point-operation commands (the same bits KP, PT_ADD, PT_DBL, PT_CHK,
+--       PT_NEG, PT_EQU & PT_OPP as in W_CTRL) which software pushes using
+--       register W_CMDQ_PUSH, even while the IP is busy. Each command gets
+--       an 8-bit sequence id (0 for the first one after a flush, then
+--       incremented with each push). The queue is drained back to back: as
+--       soon as the IP is idle, ecc_axi issues the oldest command exactly as
+--       if software had written it in W_CTRL, and pushes at the end of its
+--       execution a completion record (id, command, YES, R1_NULL & ERR flags)
+--       into a second FIFO from which software pops it by reading
+--       R_CMDQ_RESULT. Occupancy, depth and number of completion records
+--       available are given by R_CMDQ_STATUS.
+--
+--       Commands operate on the same operand slots as the ones of W_CTRL
+--       (e.g R0/R1 for point operations, XR1/YR1 & k for [k]P) so software
+--       must upload all the operands of a sequence beforehand, and in HW
+--       secure mode, read the token before pushing a [k]P command. A command
+--       which the IP refuses (bit ERR set in its completion record) halts the
+--       queue until software writes W_CMDQ_CTRL (bits RESUME or FLUSH).
+--
+-- ============================================================================
+-- NAME
+--       'perfcnt'
+--
+-- DEFINITION
+--       Enables a set of free-running performance counters, readable by
+--       software in HW secure mode as well as in HW unsecure mode.
+--
+-- TYPE/VALUE
+--       Boolean. Default is FALSE.
+--
+-- DESCRIPTION
+--       Apart from the performance counters, the only timing information
+--       the IP gives is register R_DBG_TIME (duration of the last point
+--       operation) which only exists in HW unsecure mode.
+--
+--       When 'perfcnt' is set to TRUE, ecc_axi maintains 16 counters of 32
+--       bits (see constants PERF_* in ecc_software.vhd) which count, since
+--       the last reset of the IP or the last clear by software:
+--
+--         - the number of cycles the IP was busy with each type of command
+--           ([k]P, PT_ADD, PT_DBL, PT_CHK, PT_NEG, PT_EQU & PT_OPP),
+--         - the number of [k]P cycles spent in each of its three phases:
+--           setup (check of the input point, blinding & Co-Z setup), main
+--           loop (Co-Z ladder) and exit (final subtraction, inversion of Z
+--           & return to affine coordinates),
+--         - the number of cycles at least one client of the TRNG was waiting
+--           for an internal random number,
+--         - the number of cycles spent computing Montgomery constants or
+--           the signals associated to a new prime size,
+--         - the number of cycles an AXI transfer was in progress on the
+--           AXI-lite interface,
+--         - the number of Montgomery multiplier-cycles used (sum over all
+--           'nbmult' multipliers of the cycles each one was holding an
+--           FPREDC operation) and available ('nbmult' per cycle of
+--           computation),
+--         - the total number of cycles.
+--
+--       Counters wrap around. Software selects one of them by writing
+--       W_PERF_CTRL and reads it through R_PERF_DATA. What R_PERF_DATA
+--       actually shows is a copy of the counters which is only refreshed
+--       while the IP is not computing: values can't be sampled in the
+--       middle of an operation, so they only reveal totals over complete
+--       operations, which software could measure anyway. Software can also
+--       freeze this copy (bit FRZ of W_PERF_CTRL) to read a consistent
+--       snapshot of all counters.
+--
+-- ============================================================================
+-- NAME
+--       'tracedepth'
+--
+-- DEFINITION
+--       Number of entries of the on-chip microcode execution trace RAM.
+--
+-- TYPE/VALUE
+--       Natural. Default is 0 (no trace RAM). Otherwise must be a power of 2.
+--
+-- DESCRIPTION
+--       Only meaningful in HW unsecure mode ('hwsecure' = FALSE): in HW
+--       secure mode no trace RAM is instanciated whatever the value of
+--       'tracedepth'.
+--
+--       When software enables it (bit EN of register W_DBG_TRACE_CTRL)
+--       ecc_curve records one 32-bit entry per microcode instruction it
+--       executes, at full speed (no breakpoint nor step-by-step execution
+--       is involved): PC of the instruction, its class (NOP, arithmetic,
+--       FPREDC, TESTPAR, branch, call, return or stop), whether a branch
+--       was taken and a 16-bit cycle stamp of the cycle the instruction
+--       was decoded. Recording stops when the RAM is full (overflow is
+--       reported in register R_DBG_TRACE_STATUS).
+--
+--       Software drains the entries in order through register
+--       R_DBG_TRACE_DATA after the computation. The difference between
+--       the stamps of two consecutive entries gives the number of cycles
+--       spent on an instruction, which allows a cycle-accurate profile of
+--       each microcode routine.
+--
+--       Each entry of the trace RAM costs 32 bits of Block-RAM.
+--
+-- SEE ALSO
+--       'hwsecure'
+--
+-- ============================================================================
+-- NAME
 --       'nblargenb'
 --
 -- DEFINITION
@@ -1425,6 +1664,19 @@ end package ecc_customize;
 --       obviously customize to meet your requirements) including an online
 --       textual help on each of these parameters.
 --
+--       'simvecfile' (as well as 'simlogfile', 'simxyshuflogfile',
+--       'simtrngfile' and 'simcsvfile') is only the default value of a generic
+--       of the testbench ecc_tb (resp. 'simvec', 'simlog', 'simxyshuflog',
+--       'simtrng' & 'simcsv')
+--       which can be overridden from the command line of the simulator, e.g
+--       with GHDL:
+--
+--         $ ./ecc_tb -gsimvec=/tmp/my_vectors.txt --ieee-asserts=disable
+--
+--       This is what 'make regress' in folder 'sim/' relies on to split an
+--       input test-vector file into as many shards as there are cores and
+--       simulate them in parallel (see sim/ecc_tb_regress.py).
+--
 -- ============================================================================
 -- NAME
 --       'simkb'
@@ -1503,3 +1755,43 @@ end package ecc_customize;
 --
 -- SEE ALSO
 --       'notrng'
+--
+-- ============================================================================
+-- NAME
+--       'simcsvfile'
+--
+-- DEFINITION
+--       Only used in simulation. File path of the CSV file where the test-
+--       bench logs the number of clock cycles taken by each test.
+--
+-- TYPE/VALUE
+--       Character string indicating a file path which should be accessible
+--       in write mode.
+--       Default is "/tmp/ecc_cycles.csv".
+--
+-- DESCRIPTION
+--       One line is written per test of the input test-vector file, with the
+--       following columns:
+--
+--         op,test,curve,nn,nbbld,config,cycles,busy,setup,ladder,exit
+--
+--       where 'config' sums up the synthesis parameters the cycle count
+--       depends on (techno, nbmult, shuffle_type, zremask...), 'cycles' is
+--       the number of AXI clock cycles between the transfer of the operands
+--       & the IP being ready again (as measured by the testbench, hence
+--       including the AXI accesses of the emulated driver), and the last
+--       four columns are only filled if 'perfcnt' = TRUE: 'busy' is the
+--       number of cycles the IP was busy with the command, and for a [k]P
+--       'setup', 'ladder' & 'exit' split these between its three phases.
+--
+--       Script sim/ecc_cycles_compare.py compares such a file with a
+--       reference one and fails if some test takes more cycles than in the
+--       reference (beyond a tolerance), was run with another 'config', is
+--       missing, or if no test at all could be compared, see targets
+--       'cycles-check' and 'cycles-baseline' in sim/Makefile.
+--       The emulator of the microcode (ipecc_assembler.py -k) writes the
+--       same file from its cycle model, and the reference committed (file
+--       sim/cycles-baseline.csv) is the one of the model. With CYCLES_SIM=
+--       ghdl the gate runs the testbench instead, 'perfcnt' being forced to
+--       TRUE for that regression, against a reference of its own which has
+--       to be created first by 'make cycles-baseline CYCLES_SIM=ghdl'.
@@ -0,0 +1,1036 @@
+--
+--  Copyright (C) 2023 - This file is part of IPECC project
+--
+--  Authors:
+--      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+--      Ryad BENADJILA <ryadbenadjila@gmail.com>
+--
+--  Contributors:
+--      Adrian THILLARD
+--      Emmanuel PROUFF
+--
+--  This software is licensed under GPL v2 license.
+--  See LICENSE file at the root folder of the project.
+--
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.ecc_customize.all;
+use work.ecc_utils.all;
+use work.ecc_log.all;
+use work.ecc_pkg.all;
+use work.ecc_software.all;
+
+-- Descriptor-ring DMA engine (instantiated by ecc_dma_top.vhd, the top-level
+-- to use instead of ecc.vhd when parameter 'dma' is set to TRUE in
+-- ecc_customize.vhd).
+--
+-- ecc_dma sits in between the AXI-lite slave interface of the IP (port s_axi_*
+-- connected to the CPU) and ecc_axi (port e_axi_*). It decodes the four DMA
+-- registers by itself and forwards all other accesses to ecc_axi, except when
+-- the engine is enabled, in which case software writes to the IP registers
+-- (and reads of R_READ_DATA) are discarded and flag CPU_FBD is raised in
+-- R_DMA_STATUS.
+--
+-- When enabled, and as long as the consumer index (in R_DMA_STATUS) differs
+-- from the producer index (in W_DMA_PROD) the engine fetches the next job
+-- descriptor from system memory through its AXI4 master port (m_axi_*) and
+-- replays on port e_axi_* the exact register sequence the software driver
+-- would have issued to perform the job. Hence nothing changes regarding the
+-- way ecc_axi handles masking of the scalar, the token, errors, etc.
+--
+-- A descriptor is made of DMA_DESC_WORDS (8) words of C_S_AXI_DATA_WIDTH bits
+-- (only the 32 LSbits of each word are meaningful), descriptor #i being at
+-- address RING_BASE + (i mod 2**L) * 8 * (C_S_AXI_DATA_WIDTH / 8):
+--
+--   word 0 (CMD)    bits 0-6: same command bits as in W_CTRL register (only
+--                             one must be set)
+--                   bit 8:    first input point is the point at infinity
+--                   bit 9:    second input point is the point at infinity
+--                   bit 12:   load curve parameters before the operation
+--                   bit 13:   raise an interrupt upon completion (subject to
+--                             bit IRQ_EN of W_DMA_CTRL)
+--   word 1 (CURVE)  address of the curve block: slots 0-3 = p, a, b, q
+--   word 2 (IN)     address of the input block: slots 0-1 = first point
+--                   (x, y), slots 2-3 = second point (x, y), slot 4 = k
+--   word 3 (OUT)    address of the output block: slots 0-1 = result point
+--                   (x, y), slot 2 = token (only for [k]P, for which result
+--                   coordinates are masked with the token, exactly as what
+--                   is read from R_READ_DATA)
+--   word 4 (STATUS) written back by the engine when the job is done:
+--                   bit 0 DONE, bit 1 YES (answer of CHK/EQU/OPP), bit 2
+--                   result is the point at infinity, bit 3 an error occurred
+--                   and bits 16-31 a copy of the error bits of R_STATUS
+--   words 5-7       reserved
+--
+-- A slot is NBW words (W_DMA_RING_CFG) of C_S_AXI_DATA_WIDTH bits, less
+-- significant word first, exactly as the words written to W_WRITE_DATA.
+--
+-- A bus error on the m_axi_* port stops the engine (DMA_EN is cleared and
+-- BUS_ERR is raised in R_DMA_STATUS). The IP might then be in the middle of
+-- a large number transfer and software should issue a soft reset.
+
+entity ecc_dma is
+	generic(
+		-- width of AXI data bus
+		constant C_S_AXI_DATA_WIDTH : integer := axi32or64;
+		-- width of AXI address bus
+		constant C_S_AXI_ADDR_WIDTH : integer := AXIAW;
+		-- width of address bus of the AXI4 master interface
+		constant C_M_AXI_ADDR_WIDTH : integer := dmaaw
+	);
+	port(
+		-- AXI clock
+		s_axi_aclk : in std_logic;
+		-- AXI reset (expected active low, async asserted, sync deasserted)
+		s_axi_aresetn : in std_logic;
+		-- AXI-lite slave interface (from CPU)
+		--   write-address channel
+		s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+		s_axi_awprot : in std_logic_vector(2 downto 0); -- ignored
+		s_axi_awvalid : in std_logic;
+		s_axi_awready : out std_logic;
+		--   write-data channel
+		s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		s_axi_wvalid : in std_logic;
+		s_axi_wready : out std_logic;
+		--   write-response channel
+		s_axi_bresp : out std_logic_vector(1 downto 0);
+		s_axi_bvalid : out std_logic;
+		s_axi_bready : in std_logic;
+		--   read-address channel
+		s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		s_axi_arprot : in std_logic_vector(2 downto 0); -- ignored
+		s_axi_arvalid : in std_logic;
+		s_axi_arready : out std_logic;
+		--   read-data channel
+		s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		s_axi_rresp : out std_logic_vector(1 downto 0);
+		s_axi_rvalid : out std_logic;
+		s_axi_rready : in std_logic;
+		-- AXI-lite master interface (to ecc_axi)
+		--   write-address channel
+		e_axi_awaddr : out std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+		e_axi_awprot : out std_logic_vector(2 downto 0);
+		e_axi_awvalid : out std_logic;
+		e_axi_awready : in std_logic;
+		--   write-data channel
+		e_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		e_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		e_axi_wvalid : out std_logic;
+		e_axi_wready : in std_logic;
+		--   write-response channel
+		e_axi_bresp : in std_logic_vector(1 downto 0);
+		e_axi_bvalid : in std_logic;
+		e_axi_bready : out std_logic;
+		--   read-address channel
+		e_axi_araddr : out std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		e_axi_arprot : out std_logic_vector(2 downto 0);
+		e_axi_arvalid : out std_logic;
+		e_axi_arready : in std_logic;
+		--   read-data channel
+		e_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		e_axi_rresp : in std_logic_vector(1 downto 0);
+		e_axi_rvalid : in std_logic;
+		e_axi_rready : out std_logic;
+		-- AXI4 master interface (to system memory, single-beat transfers only)
+		--   write-address channel
+		m_axi_awaddr : out std_logic_vector(C_M_AXI_ADDR_WIDTH - 1 downto 0);
+		m_axi_awlen : out std_logic_vector(7 downto 0);
+		m_axi_awsize : out std_logic_vector(2 downto 0);
+		m_axi_awburst : out std_logic_vector(1 downto 0);
+		m_axi_awcache : out std_logic_vector(3 downto 0);
+		m_axi_awprot : out std_logic_vector(2 downto 0);
+		m_axi_awvalid : out std_logic;
+		m_axi_awready : in std_logic;
+		--   write-data channel
+		m_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		m_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		m_axi_wlast : out std_logic;
+		m_axi_wvalid : out std_logic;
+		m_axi_wready : in std_logic;
+		--   write-response channel
+		m_axi_bresp : in std_logic_vector(1 downto 0);
+		m_axi_bvalid : in std_logic;
+		m_axi_bready : out std_logic;
+		--   read-address channel
+		m_axi_araddr : out std_logic_vector(C_M_AXI_ADDR_WIDTH - 1 downto 0);
+		m_axi_arlen : out std_logic_vector(7 downto 0);
+		m_axi_arsize : out std_logic_vector(2 downto 0);
+		m_axi_arburst : out std_logic_vector(1 downto 0);
+		m_axi_arcache : out std_logic_vector(3 downto 0);
+		m_axi_arprot : out std_logic_vector(2 downto 0);
+		m_axi_arvalid : out std_logic;
+		m_axi_arready : in std_logic;
+		--   read-data channel
+		m_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		m_axi_rresp : in std_logic_vector(1 downto 0);
+		m_axi_rlast : in std_logic;
+		m_axi_rvalid : in std_logic;
+		m_axi_rready : out std_logic;
+		-- interrupt (job completion or bus error)
+		irq : out std_logic
+	);
+end entity ecc_dma;
+
+architecture rtl of ecc_dma is
+
+	constant CST_AXI_RESP_OKAY : std_logic_vector(1 downto 0) := "00";
+
+	-- nb of bytes per word & per descriptor (as a shift amount)
+	constant BPW : positive := C_S_AXI_DATA_WIDTH / 8;
+	constant LOG2BPW : natural := log2(BPW - 1);
+	constant LOG2DESC : natural := LOG2BPW + log2(DMA_DESC_WORDS - 1);
+
+	subtype maddr_type is unsigned(C_M_AXI_ADDR_WIDTH - 1 downto 0);
+	subtype idx_type is unsigned(DMA_IDX_SZ - 1 downto 0);
+
+	-- Steps of a job, in the order they are executed. Function next_step
+	-- below skips the ones that are useless for the current command.
+	type step_type is (st_idle, st_desc, st_init, st_crv_p, st_crv_a, st_crv_b,
+		st_crv_q, st_token, st_tokrd, st_k, st_x0, st_y0, st_x1, st_y1,
+		st_null0, st_null1, st_exec, st_errack, st_res_x, st_res_y, st_status);
+
+	-- Phases of a step:
+	--   ph_poll      read R_STATUS until IP is not busy (step st_k also
+	--                waits for enough random to mask the scalar)
+	--   ph_reg       write the step's register (W_CTRL, W_TOKEN, etc)
+	--   ph_word_poll read R_STATUS until IP is not busy (before each word)
+	--   ph_word_reg  write W_WRITE_DATA or read R_READ_DATA
+	--   ph_word_mem  read or write one word from/to system memory
+	--   ph_exec      read R_STATUS until the point operation is done
+	type phase_type is (ph_poll, ph_reg, ph_word_poll, ph_word_reg, ph_word_mem,
+		ph_exec);
+
+	type reg_axi_type is record
+		awpending : std_logic;
+		dwpending : std_logic;
+		waddr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		awready : std_logic;
+		wready : std_logic;
+		bvalid : std_logic;
+		bresp : std_logic_vector(1 downto 0);
+		wdatax : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		wstrb : std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		arready : std_logic;
+		raddr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		rvalid : std_logic;
+		rresp : std_logic_vector(1 downto 0);
+		rdatax : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		-- CPU accesses waiting to be forwarded to ecc_axi
+		fwdw : std_logic;
+		fwdr : std_logic;
+	end record;
+
+	-- transaction on port e_axi_* (to ecc_axi)
+	type reg_ep_type is record
+		busy : std_logic;
+		cpu : std_logic; -- transaction issued on behalf of the CPU
+		lastcpu : std_logic; -- for round-robin arbitration
+		write : std_logic;
+		awvalid : std_logic;
+		wvalid : std_logic;
+		arvalid : std_logic;
+		addr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		wdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		wstrb : std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+	end record;
+
+	-- transaction on port m_axi_* (to system memory)
+	type reg_mp_type is record
+		busy : std_logic;
+		write : std_logic;
+		awvalid : std_logic;
+		wvalid : std_logic;
+		arvalid : std_logic;
+		addr : maddr_type;
+		wdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+	end record;
+
+	-- software-visible control & status
+	type reg_ctl_type is record
+		en : std_logic;
+		irqen : std_logic;
+		base : maddr_type;
+		log2sz : unsigned(3 downto 0);
+		nbw : idx_type;
+		prod : idx_type;
+		cons : idx_type;
+		buserr : std_logic;
+		cpufbd : std_logic;
+		irq : std_logic;
+		irqsh : std_logic_vector(3 downto 0);
+	end record;
+
+	type reg_eng_type is record
+		step : step_type;
+		phase : phase_type;
+		issued : std_logic;
+		-- request to port e_axi_*
+		ereq : std_logic;
+		ewrite : std_logic;
+		eaddr : rat;
+		ewdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		edone : std_logic;
+		-- request to port m_axi_*
+		mreq : std_logic;
+		mwrite : std_logic;
+		mdone : std_logic;
+		merr : std_logic;
+		-- data of the last response (from e_axi_* or m_axi_*)
+		data : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		-- parameters of current step
+		reg : rat;
+		regdata : std_logic_vector(31 downto 0);
+		nbxfer : std_logic;
+		dirout : std_logic;
+		maddr : maddr_type;
+		wcnt : idx_type;
+		-- current descriptor
+		daddr : maddr_type;
+		cmd : std_logic_vector(31 downto 0);
+		curve : maddr_type;
+		inblk : maddr_type;
+		outblk : maddr_type;
+		-- outcome of the job
+		yes : std_logic;
+		r1null : std_logic;
+		err : std_logic;
+		errs : std_logic_vector(STATUS_ERR_MSB downto STATUS_ERR_LSB);
+	end record;
+
+	-- All registers
+	type reg_type is record
+		axi : reg_axi_type;
+		ep : reg_ep_type;
+		mp : reg_mp_type;
+		ctl : reg_ctl_type;
+		eng : reg_eng_type;
+	end record;
+
+	signal r, rin : reg_type;
+
+	-- command bits (those of W_CTRL) in descriptor word CMD
+	function is_kp(cmd : std_logic_vector) return boolean is
+	begin
+		return cmd(CTRL_KP) = '1';
+	end function is_kp;
+
+	-- does the command use point R1 as input
+	function uses_r1(cmd : std_logic_vector) return boolean is
+	begin
+		return cmd(CTRL_KP) = '1' or cmd(CTRL_PT_ADD) = '1'
+			or cmd(CTRL_PT_EQU) = '1' or cmd(CTRL_PT_OPP) = '1';
+	end function uses_r1;
+
+	-- does the command produce a point (in R1)
+	function has_result(cmd : std_logic_vector) return boolean is
+	begin
+		return cmd(CTRL_KP) = '1' or cmd(CTRL_PT_ADD) = '1'
+			or cmd(CTRL_PT_DBL) = '1' or cmd(CTRL_PT_NEG) = '1';
+	end function has_result;
+
+	function is_needed(s : step_type; cmd : std_logic_vector;
+		err, r1null : std_logic) return boolean is
+	begin
+		case s is
+			when st_crv_p | st_crv_a | st_crv_b | st_crv_q =>
+				return cmd(DMA_CMD_LOAD_CURVE) = '1';
+			when st_token | st_tokrd | st_k =>
+				return is_kp(cmd);
+			when st_x0 | st_y0 | st_null0 =>
+				return not is_kp(cmd);
+			when st_x1 | st_y1 | st_null1 =>
+				return uses_r1(cmd);
+			when st_errack =>
+				return err = '1';
+			when st_res_x | st_res_y =>
+				return has_result(cmd) and err = '0' and r1null = '0';
+			when others =>
+				return TRUE;
+		end case;
+	end function is_needed;
+
+	function next_step(s : step_type; cmd : std_logic_vector;
+		err, r1null : std_logic) return step_type is
+	begin
+		for vs in step_type loop
+			if vs > s and is_needed(vs, cmd, err, r1null) then
+				return vs;
+			end if;
+		end loop;
+		-- after st_status
+		return st_idle;
+	end function next_step;
+
+	-- address of word 0 of slot 'slot' of a data block
+	function slot_addr(blk : maddr_type; slot : natural; nbw : idx_type)
+		return maddr_type is
+	begin
+		return blk + shift_left(
+			resize(to_unsigned(slot, 3) * nbw, C_M_AXI_ADDR_WIDTH), LOG2BPW);
+	end function slot_addr;
+
+begin
+
+	assert (C_M_AXI_ADDR_WIDTH <= 32)
+		report "Wrong value of parameter dmaaw in ecc_customize.vhd "
+		     & "(must not exceed 32)."
+			severity FAILURE;
+
+	-- combinational logic
+	comb: process(s_axi_aresetn, r,
+	              s_axi_awaddr, s_axi_awvalid, s_axi_wdata, s_axi_wstrb,
+	              s_axi_wvalid, s_axi_bready, s_axi_araddr, s_axi_arvalid,
+	              s_axi_rready,
+	              e_axi_awready, e_axi_wready, e_axi_bresp, e_axi_bvalid,
+	              e_axi_arready, e_axi_rdata, e_axi_rresp, e_axi_rvalid,
+	              m_axi_awready, m_axi_wready, m_axi_bresp, m_axi_bvalid,
+	              m_axi_arready, m_axi_rdata, m_axi_rresp, m_axi_rvalid)
+		variable v : reg_type;
+		variable dw : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		variable v_running : boolean;
+		variable v_stepdone : boolean;
+		variable v_jobdone : boolean;
+		variable v_cpu : boolean;
+		variable v_ringmask : idx_type;
+		variable v_slot : natural range 0 to 4;
+	begin
+		v := r;
+
+		v.eng.edone := '0';
+		v.eng.mdone := '0';
+		v.eng.merr := '0';
+		v_stepdone := FALSE;
+		v_jobdone := FALSE;
+
+		v_running := r.eng.step /= st_idle;
+
+		-- Interrupt, once raised, lasts 4 cycles (see (s6) & (s7)).
+		v.ctl.irqsh := '0' & r.ctl.irqsh(3 downto 1);
+		if r.ctl.irqsh(0) = '1' then
+			v.ctl.irq := '0';
+		end if;
+
+		-- -------------------------------------------------
+		-- AXI-lite slave interface (CPU) - write transfers
+		-- -------------------------------------------------
+
+		-- handshake over AXI address-write channel
+		if s_axi_awvalid = '1' and r.axi.awready = '1' then
+			v.axi.awpending := '1';
+			v.axi.waddr := s_axi_awaddr;
+			v.axi.awready := '0'; -- (s0), will be reasserted back by (s2)
+		end if;
+
+		-- handshake over AXI data-write channel
+		if s_axi_wvalid = '1' and r.axi.wready = '1' then
+			v.axi.dwpending := '1';
+			v.axi.wdatax := s_axi_wdata;
+			v.axi.wstrb := s_axi_wstrb;
+			v.axi.wready := '0'; -- (s1), will be reasserted back by (s2)
+		end if;
+
+		-- handshake over AXI write-response channel
+		if r.axi.bvalid = '1' and s_axi_bready = '1' then
+			v.axi.bvalid := '0';
+			v.axi.awready := '1'; -- (s2), had been deasserted by (s0)
+			v.axi.wready := '1'; -- (s2), had been deasserted by (s1)
+		end if;
+
+		-- new write-beat: either one of the DMA registers, which we decode
+		-- here, or a register of ecc_axi, to which the access is forwarded
+		-- (unless the engine is enabled)
+		if r.axi.awpending = '1' and r.axi.dwpending = '1' then
+			v.axi.awpending := '0';
+			v.axi.dwpending := '0';
+			v.axi.bresp := CST_AXI_RESP_OKAY;
+			v.axi.bvalid := '1';
+			if r.axi.waddr(ADB + 2 downto 3) = W_DMA_CTRL then
+				v.ctl.en := r.axi.wdatax(DMA_CTRL_EN);
+				v.ctl.irqen := r.axi.wdatax(DMA_CTRL_IRQ_EN);
+				if r.axi.wdatax(DMA_CTRL_RESET) = '1' and not v_running then
+					v.ctl.prod := (others => '0');
+					v.ctl.cons := (others => '0');
+					v.ctl.buserr := '0';
+					v.ctl.cpufbd := '0';
+				end if;
+			elsif r.axi.waddr(ADB + 2 downto 3) = W_DMA_RING_BASE then
+				if not v_running then
+					v.ctl.base := unsigned(r.axi.wdatax(C_M_AXI_ADDR_WIDTH - 1 downto 0));
+				end if;
+			elsif r.axi.waddr(ADB + 2 downto 3) = W_DMA_RING_CFG then
+				if not v_running then
+					v.ctl.log2sz := unsigned(
+						r.axi.wdatax(DMA_CFG_LOG2SZ_MSB downto DMA_CFG_LOG2SZ_LSB));
+					v.ctl.nbw := unsigned(
+						r.axi.wdatax(DMA_CFG_NBW_MSB downto DMA_CFG_NBW_LSB));
+				end if;
+			elsif r.axi.waddr(ADB + 2 downto 3) = W_DMA_PROD then
+				v.ctl.prod := unsigned(r.axi.wdatax(DMA_PROD_MSB downto DMA_PROD_LSB));
+			elsif r.ctl.en = '1' or v_running then
+				-- IP registers belong to the engine, discard the write
+				v.ctl.cpufbd := '1';
+			else
+				-- forward the write to ecc_axi (response will be given by (s3))
+				v.axi.bvalid := '0';
+				v.axi.fwdw := '1';
+			end if;
+		end if;
+
+		-- ------------------------------------------------
+		-- AXI-lite slave interface (CPU) - read transfers
+		-- ------------------------------------------------
+
+		-- handshake over AXI address-read channel
+		if s_axi_arvalid = '1' and r.axi.arready = '1' then
+			v.axi.arready := '0'; -- (s4), will be reasserted by (s5)
+			v.axi.rresp := CST_AXI_RESP_OKAY;
+			if s_axi_araddr(ADB + 2 downto 3) = R_DMA_STATUS then
+				dw := (others => '0');
+				dw(DMA_STS_EN) := r.ctl.en;
+				if v_running then
+					dw(DMA_STS_RUNNING) := '1';
+				end if;
+				dw(DMA_STS_BUS_ERR) := r.ctl.buserr;
+				dw(DMA_STS_CPU_FBD) := r.ctl.cpufbd;
+				dw(DMA_STS_CONS_MSB downto DMA_STS_CONS_LSB) :=
+					std_logic_vector(r.ctl.cons);
+				v.axi.rdatax := dw;
+				v.axi.rvalid := '1';
+			elsif s_axi_araddr(ADB + 2 downto 3) = R_READ_DATA
+				and (r.ctl.en = '1' or v_running)
+			then
+				-- large numbers being read belong to the engine
+				v.axi.rdatax := (others => '0');
+				v.axi.rvalid := '1';
+				v.ctl.cpufbd := '1';
+			else
+				-- forward the read to ecc_axi (response will be given by (s3))
+				v.axi.raddr := s_axi_araddr;
+				v.axi.fwdr := '1';
+			end if;
+		end if;
+
+		-- handshake over AXI data-read channel
+		if r.axi.rvalid = '1' and s_axi_rready = '1' then
+			v.axi.rvalid := '0';
+			v.axi.arready := '1'; -- (s5), had been deasserted by (s4)
+			-- pragma translate_off
+			v.axi.rdatax := (others => 'X');
+			-- pragma translate_on
+		end if;
+
+		-- ------------------------------------------------------------
+		-- AXI-lite master interface (ecc_axi): one transfer at a time,
+		-- shared by the CPU (forwarded accesses) and the engine
+		-- ------------------------------------------------------------
+
+		if r.ep.awvalid = '1' and e_axi_awready = '1' then
+			v.ep.awvalid := '0';
+		end if;
+		if r.ep.wvalid = '1' and e_axi_wready = '1' then
+			v.ep.wvalid := '0';
+		end if;
+		if r.ep.arvalid = '1' and e_axi_arready = '1' then
+			v.ep.arvalid := '0';
+		end if;
+
+		-- end of transfer (BREADY & RREADY are constantly asserted)
+		if r.ep.busy = '1' and ((r.ep.write = '1' and e_axi_bvalid = '1')
+			or (r.ep.write = '0' and e_axi_rvalid = '1'))
+		then
+			v.ep.busy := '0';
+			if r.ep.cpu = '1' then
+				-- (s3)
+				if r.ep.write = '1' then
+					v.axi.bresp := e_axi_bresp;
+					v.axi.bvalid := '1';
+				else
+					v.axi.rdatax := e_axi_rdata;
+					-- (s8) ecc_axi doesn't know if it sits behind an ecc_dma
+					-- instance or not, so bit CAP_DMA is set here
+					if r.axi.raddr(ADB + 2 downto 3) = R_CAPABILITIES then
+						v.axi.rdatax(CAP_DMA) := '1';
+					end if;
+					v.axi.rresp := e_axi_rresp;
+					v.axi.rvalid := '1';
+				end if;
+			else
+				v.eng.data := e_axi_rdata;
+				v.eng.edone := '1';
+			end if;
+		end if;
+
+		-- start of a new transfer
+		if r.ep.busy = '0'
+			and (r.axi.fwdw = '1' or r.axi.fwdr = '1' or r.eng.ereq = '1')
+		then
+			-- the CPU wins if the engine is not requesting, or if it
+			-- was not granted the previous transfer
+			v_cpu := (r.axi.fwdw = '1' or r.axi.fwdr = '1')
+				and (r.eng.ereq = '0' or r.ep.lastcpu = '0');
+			v.ep.busy := '1';
+			if v_cpu then
+				v.ep.cpu := '1';
+				v.ep.lastcpu := '1';
+				if r.axi.fwdw = '1' then
+					v.axi.fwdw := '0';
+					v.ep.write := '1';
+					v.ep.addr := r.axi.waddr;
+					v.ep.wdata := r.axi.wdatax;
+					v.ep.wstrb := r.axi.wstrb;
+				else
+					v.axi.fwdr := '0';
+					v.ep.write := '0';
+					v.ep.addr := r.axi.raddr;
+				end if;
+			else
+				v.eng.ereq := '0';
+				v.ep.cpu := '0';
+				v.ep.lastcpu := '0';
+				v.ep.write := r.eng.ewrite;
+				v.ep.addr := (others => '0');
+				v.ep.addr(ADB + 2 downto 3) := r.eng.eaddr;
+				v.ep.wdata := r.eng.ewdata;
+				v.ep.wstrb := (others => '1');
+			end if;
+			if v.ep.write = '1' then
+				v.ep.awvalid := '1';
+				v.ep.wvalid := '1';
+			else
+				v.ep.arvalid := '1';
+			end if;
+		end if;
+
+		-- ----------------------------------------------------------
+		-- AXI4 master interface (system memory): single-beat bursts
+		-- ----------------------------------------------------------
+
+		if r.mp.awvalid = '1' and m_axi_awready = '1' then
+			v.mp.awvalid := '0';
+		end if;
+		if r.mp.wvalid = '1' and m_axi_wready = '1' then
+			v.mp.wvalid := '0';
+		end if;
+		if r.mp.arvalid = '1' and m_axi_arready = '1' then
+			v.mp.arvalid := '0';
+		end if;
+
+		if r.mp.busy = '1' then
+			if r.mp.write = '1' and m_axi_bvalid = '1' then
+				v.mp.busy := '0';
+				v.eng.mdone := '1';
+				v.eng.merr := m_axi_bresp(1); -- SLVERR or DECERR
+			elsif r.mp.write = '0' and m_axi_rvalid = '1' then
+				v.mp.busy := '0';
+				v.eng.data := m_axi_rdata;
+				v.eng.mdone := '1';
+				v.eng.merr := m_axi_rresp(1);
+			end if;
+		elsif r.eng.mreq = '1' then
+			v.eng.mreq := '0';
+			v.mp.busy := '1';
+			v.mp.write := r.eng.mwrite;
+			v.mp.addr := r.eng.maddr;
+			v.mp.wdata := r.eng.data;
+			if r.eng.mwrite = '1' then
+				v.mp.awvalid := '1';
+				v.mp.wvalid := '1';
+			else
+				v.mp.arvalid := '1';
+			end if;
+		end if;
+
+		-- ------
+		-- Engine
+		-- ------
+
+		if r.eng.step = st_idle then
+			if r.ctl.en = '1' and r.ctl.cons /= r.ctl.prod then
+				v_stepdone := TRUE;
+			end if;
+		elsif r.eng.issued = '0' then
+			-- issue the transfer associated with the current phase
+			v.eng.issued := '1';
+			case r.eng.phase is
+				when ph_poll | ph_word_poll | ph_exec =>
+					v.eng.ereq := '1';
+					v.eng.ewrite := '0';
+					v.eng.eaddr := R_STATUS;
+				when ph_reg =>
+					v.eng.ereq := '1';
+					v.eng.ewrite := '1';
+					v.eng.eaddr := r.eng.reg;
+					v.eng.ewdata := (others => '0');
+					v.eng.ewdata(31 downto 0) := r.eng.regdata;
+				when ph_word_reg =>
+					v.eng.ereq := '1';
+					if r.eng.dirout = '1' then
+						v.eng.ewrite := '0';
+						v.eng.eaddr := R_READ_DATA;
+					else
+						v.eng.ewrite := '1';
+						v.eng.eaddr := W_WRITE_DATA;
+						v.eng.ewdata := r.eng.data;
+					end if;
+				when ph_word_mem =>
+					v.eng.mreq := '1';
+					v.eng.mwrite := r.eng.dirout;
+			end case;
+		elsif r.eng.mdone = '1' and r.eng.merr = '1' then
+			-- bus error: stop the engine
+			v.eng.step := st_idle;
+			v.eng.issued := '0';
+			v.ctl.en := '0';
+			v.ctl.buserr := '1';
+			if r.ctl.irqen = '1' then -- (s6)
+				v.ctl.irqsh(3) := '1';
+				v.ctl.irq := '1';
+			end if;
+		elsif r.eng.edone = '1' or r.eng.mdone = '1' then
+			v.eng.issued := '0';
+			case r.eng.phase is
+				when ph_poll =>
+					if r.eng.data(STATUS_BUSY) = '0' and (r.eng.step /= st_k
+						or r.eng.data(STATUS_ENOUGH_RND_WK) = '0')
+					then
+						v.eng.phase := ph_reg;
+					end if;
+				when ph_reg =>
+					if r.eng.nbxfer = '1' then
+						v.eng.phase := ph_word_poll;
+						v.eng.wcnt := (others => '0');
+					elsif r.eng.step = st_exec then
+						v.eng.phase := ph_exec;
+					else
+						v_stepdone := TRUE;
+					end if;
+				when ph_word_poll =>
+					if r.eng.data(STATUS_BUSY) = '0' then
+						if r.eng.dirout = '1' then
+							v.eng.phase := ph_word_reg;
+						else
+							v.eng.phase := ph_word_mem;
+						end if;
+					end if;
+				when ph_exec =>
+					if r.eng.data(STATUS_BUSY) = '0' then
+						v.eng.yes := r.eng.data(STATUS_YES);
+						v.eng.r1null := r.eng.data(STATUS_R1_IS_NULL);
+						v.eng.errs := r.eng.data(STATUS_ERR_MSB downto STATUS_ERR_LSB);
+						if r.eng.data(STATUS_ERR_MSB downto STATUS_ERR_LSB)
+							= std_logic_vector(to_unsigned(0, 16))
+						then
+							v.eng.err := '0';
+						else
+							v.eng.err := '1';
+						end if;
+						v_stepdone := TRUE;
+					end if;
+				when ph_word_reg =>
+					if r.eng.dirout = '1' then
+						-- word read from R_READ_DATA, now write it to memory
+						v.eng.phase := ph_word_mem;
+					elsif r.eng.wcnt = r.ctl.nbw - 1 then
+						v_stepdone := TRUE;
+					else
+						v.eng.wcnt := r.eng.wcnt + 1;
+						v.eng.maddr := r.eng.maddr + BPW;
+						v.eng.phase := ph_word_poll;
+					end if;
+				when ph_word_mem =>
+					if r.eng.step = st_desc then
+						case to_integer(r.eng.wcnt(1 downto 0)) is
+							when DMA_DESC_CMD =>
+								v.eng.cmd := r.eng.data(31 downto 0);
+							when DMA_DESC_CURVE =>
+								v.eng.curve := unsigned(
+									r.eng.data(C_M_AXI_ADDR_WIDTH - 1 downto 0));
+							when DMA_DESC_IN =>
+								v.eng.inblk := unsigned(
+									r.eng.data(C_M_AXI_ADDR_WIDTH - 1 downto 0));
+							when others =>
+								v.eng.outblk := unsigned(
+									r.eng.data(C_M_AXI_ADDR_WIDTH - 1 downto 0));
+						end case;
+						if r.eng.wcnt = DMA_DESC_OUT then
+							v_stepdone := TRUE;
+						else
+							v.eng.wcnt := r.eng.wcnt + 1;
+							v.eng.maddr := r.eng.maddr + BPW;
+						end if;
+					elsif r.eng.step = st_status then
+						v_stepdone := TRUE;
+						v_jobdone := TRUE;
+					elsif r.eng.dirout = '0' then
+						-- word read from memory, now write it to W_WRITE_DATA
+						v.eng.phase := ph_word_reg;
+					elsif r.eng.wcnt = r.ctl.nbw - 1 then
+						v_stepdone := TRUE;
+					else
+						v.eng.wcnt := r.eng.wcnt + 1;
+						v.eng.maddr := r.eng.maddr + BPW;
+						v.eng.phase := ph_word_poll;
+					end if;
+			end case;
+		end if;
+
+		-- end of a job
+		if v_jobdone then
+			v.ctl.cons := r.ctl.cons + 1;
+			if r.eng.cmd(DMA_CMD_IRQ) = '1' and r.ctl.irqen = '1' then -- (s7)
+				v.ctl.irqsh(3) := '1';
+				v.ctl.irq := '1';
+			end if;
+		end if;
+
+		-- set up the next step
+		if v_stepdone then
+			v.eng.step := next_step(r.eng.step, v.eng.cmd, v.eng.err, v.eng.r1null);
+			v.eng.issued := '0';
+			v.eng.phase := ph_poll;
+			v.eng.nbxfer := '0';
+			v.eng.dirout := '0';
+			v.eng.wcnt := (others => '0');
+			v.eng.regdata := (others => '0');
+			v.eng.reg := W_CTRL;
+			v_slot := 0;
+			case v.eng.step is
+				when st_desc =>
+					v_ringmask := not shift_left(
+						to_unsigned(2**DMA_IDX_SZ - 1, DMA_IDX_SZ),
+						to_integer(r.ctl.log2sz));
+					v.eng.daddr := r.ctl.base + shift_left(resize(
+						r.ctl.cons and v_ringmask, C_M_AXI_ADDR_WIDTH), LOG2DESC);
+					v.eng.maddr := v.eng.daddr;
+					v.eng.phase := ph_word_mem;
+					v.eng.err := '0';
+					v.eng.r1null := '0';
+					v.eng.yes := '0';
+					v.eng.errs := (others => '0');
+				when st_init =>
+					v.eng.reg := W_ERR_ACK;
+					v.eng.regdata(STATUS_ERR_MSB downto STATUS_ERR_LSB) :=
+						(others => '1');
+				when st_crv_p | st_crv_a | st_crv_b | st_crv_q =>
+					v.eng.regdata(CTRL_WRITE_NB) := '1';
+					if v.eng.step = st_crv_p then
+						v_slot := 0;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_P;
+					elsif v.eng.step = st_crv_a then
+						v_slot := 1;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_A;
+					elsif v.eng.step = st_crv_b then
+						v_slot := 2;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_B;
+					else
+						v_slot := 3;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_Q;
+					end if;
+					v.eng.nbxfer := '1';
+					v.eng.maddr := slot_addr(v.eng.curve, v_slot, r.ctl.nbw);
+				when st_token =>
+					v.eng.reg := W_TOKEN;
+					v.eng.regdata(0) := '1'; -- value is indifferent
+				when st_tokrd =>
+					v.eng.regdata(CTRL_READ_NB) := '1';
+					v.eng.regdata(CTRL_RD_TOKEN) := '1';
+					v.eng.nbxfer := '1';
+					v.eng.dirout := '1';
+					v.eng.maddr := slot_addr(v.eng.outblk, 2, r.ctl.nbw);
+				when st_k =>
+					v.eng.regdata(CTRL_WRITE_NB) := '1';
+					v.eng.regdata(CTRL_WRITE_K) := '1';
+					v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+						downto CTRL_NBADDR_LSB) := CST_ADDR_K;
+					v.eng.nbxfer := '1';
+					v.eng.maddr := slot_addr(v.eng.inblk, 4, r.ctl.nbw);
+				when st_x0 | st_y0 =>
+					v.eng.regdata(CTRL_WRITE_NB) := '1';
+					if v.eng.step = st_x0 then
+						v_slot := 0;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_XR0;
+					else
+						v_slot := 1;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_YR0;
+					end if;
+					v.eng.nbxfer := '1';
+					v.eng.maddr := slot_addr(v.eng.inblk, v_slot, r.ctl.nbw);
+				when st_x1 | st_y1 =>
+					-- for [k]P the first (and only) input point goes into R1
+					if is_kp(v.eng.cmd) then
+						v_slot := 0;
+					else
+						v_slot := 2;
+					end if;
+					v.eng.regdata(CTRL_WRITE_NB) := '1';
+					if v.eng.step = st_x1 then
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_XR1;
+					else
+						v_slot := v_slot + 1;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_YR1;
+					end if;
+					v.eng.nbxfer := '1';
+					v.eng.maddr := slot_addr(v.eng.inblk, v_slot, r.ctl.nbw);
+				-- writing coordinates of a point resets its null flag in ecc_axi,
+				-- hence null flags are written after coordinates
+				when st_null0 =>
+					v.eng.reg := W_R0_NULL;
+					v.eng.regdata(WR0_IS_NULL) := v.eng.cmd(DMA_CMD_P_NULL);
+				when st_null1 =>
+					v.eng.reg := W_R1_NULL;
+					if is_kp(v.eng.cmd) then
+						v.eng.regdata(WR1_IS_NULL) := v.eng.cmd(DMA_CMD_P_NULL);
+					else
+						v.eng.regdata(WR1_IS_NULL) := v.eng.cmd(DMA_CMD_Q_NULL);
+					end if;
+				when st_exec =>
+					v.eng.regdata(CTRL_PT_OPP downto CTRL_KP) :=
+						v.eng.cmd(CTRL_PT_OPP downto CTRL_KP);
+				when st_errack =>
+					v.eng.reg := W_ERR_ACK;
+					v.eng.regdata(STATUS_ERR_MSB downto STATUS_ERR_LSB) := v.eng.errs;
+				when st_res_x | st_res_y =>
+					v.eng.regdata(CTRL_READ_NB) := '1';
+					if v.eng.step = st_res_x then
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_XR1;
+					else
+						v_slot := 1;
+						v.eng.regdata(CTRL_NBADDR_LSB + FP_ADDR_MSB - 1
+							downto CTRL_NBADDR_LSB) := CST_ADDR_YR1;
+					end if;
+					v.eng.nbxfer := '1';
+					v.eng.dirout := '1';
+					v.eng.maddr := slot_addr(v.eng.outblk, v_slot, r.ctl.nbw);
+				when st_status =>
+					v.eng.phase := ph_word_mem;
+					v.eng.dirout := '1';
+					v.eng.maddr := v.eng.daddr + DMA_DESC_STATUS * BPW;
+					v.eng.data := (others => '0');
+					v.eng.data(DMA_DST_DONE) := '1';
+					v.eng.data(DMA_DST_YES) := v.eng.yes;
+					v.eng.data(DMA_DST_R1_NULL) := v.eng.r1null;
+					v.eng.data(DMA_DST_ERR) := v.eng.err;
+					v.eng.data(STATUS_ERR_MSB downto STATUS_ERR_LSB) := v.eng.errs;
+				when others => -- st_idle
+					null;
+			end case;
+		end if;
+
+		-- Synchronous (active low) reset
+		if s_axi_aresetn = '0' then
+			v.axi.awpending := '0';
+			v.axi.dwpending := '0';
+			v.axi.awready := '1';
+			v.axi.wready := '1';
+			v.axi.bvalid := '0';
+			v.axi.arready := '1';
+			v.axi.rvalid := '0';
+			v.axi.fwdw := '0';
+			v.axi.fwdr := '0';
+			v.ep.busy := '0';
+			v.ep.lastcpu := '0';
+			v.ep.awvalid := '0';
+			v.ep.wvalid := '0';
+			v.ep.arvalid := '0';
+			v.mp.busy := '0';
+			v.mp.awvalid := '0';
+			v.mp.wvalid := '0';
+			v.mp.arvalid := '0';
+			v.ctl.en := '0';
+			v.ctl.irqen := '0';
+			v.ctl.base := (others => '0');
+			v.ctl.log2sz := (others => '0');
+			v.ctl.nbw := (others => '0');
+			v.ctl.prod := (others => '0');
+			v.ctl.cons := (others => '0');
+			v.ctl.buserr := '0';
+			v.ctl.cpufbd := '0';
+			v.ctl.irq := '0';
+			v.ctl.irqsh := (others => '0');
+			v.eng.step := st_idle;
+			v.eng.issued := '0';
+			v.eng.ereq := '0';
+			v.eng.mreq := '0';
+			v.eng.edone := '0';
+			v.eng.mdone := '0';
+			v.eng.merr := '0';
+		end if;
+
+		rin <= v;
+	end process comb;
+
+	-- registers, clocked by s_axi_aclk
+	regs : process(s_axi_aclk)
+	begin
+		if s_axi_aclk'event and s_axi_aclk = '1' then
+			r <= rin;
+		end if;
+	end process regs;
+
+	-- --------------------
+	-- drive output signals
+	-- --------------------
+
+	-- to CPU
+	s_axi_awready <= r.axi.awready;
+	s_axi_wready <= r.axi.wready;
+	s_axi_bresp <= r.axi.bresp;
+	s_axi_bvalid <= r.axi.bvalid;
+	s_axi_arready <= r.axi.arready;
+	s_axi_rdata <= r.axi.rdatax;
+	s_axi_rresp <= r.axi.rresp;
+	s_axi_rvalid <= r.axi.rvalid;
+
+	-- to ecc_axi
+	e_axi_awaddr <= r.ep.addr;
+	e_axi_awprot <= "000";
+	e_axi_awvalid <= r.ep.awvalid;
+	e_axi_wdata <= r.ep.wdata;
+	e_axi_wstrb <= r.ep.wstrb;
+	e_axi_wvalid <= r.ep.wvalid;
+	e_axi_bready <= '1';
+	e_axi_araddr <= r.ep.addr;
+	e_axi_arprot <= "000";
+	e_axi_arvalid <= r.ep.arvalid;
+	e_axi_rready <= '1';
+
+	-- to system memory
+	m_axi_awaddr <= std_logic_vector(r.mp.addr);
+	m_axi_awlen <= (others => '0');
+	m_axi_awsize <= std_logic_vector(to_unsigned(LOG2BPW, 3));
+	m_axi_awburst <= "01"; -- INCR
+	m_axi_awcache <= "0011"; -- normal non-cacheable bufferable
+	m_axi_awprot <= "000";
+	m_axi_awvalid <= r.mp.awvalid;
+	m_axi_wdata <= r.mp.wdata;
+	m_axi_wstrb <= (others => '1');
+	m_axi_wlast <= '1';
+	m_axi_wvalid <= r.mp.wvalid;
+	m_axi_bready <= '1';
+	m_axi_araddr <= std_logic_vector(r.mp.addr);
+	m_axi_arlen <= (others => '0');
+	m_axi_arsize <= std_logic_vector(to_unsigned(LOG2BPW, 3));
+	m_axi_arburst <= "01"; -- INCR
+	m_axi_arcache <= "0011";
+	m_axi_arprot <= "000";
+	m_axi_arvalid <= r.mp.arvalid;
+	m_axi_rready <= '1';
+
+	-- interrupt
+	irq <= r.ctl.irq;
+
+end architecture rtl;
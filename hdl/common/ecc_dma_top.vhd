@@ -0,0 +1,448 @@
+--
+--  Copyright (C) 2023 - This file is part of IPECC project
+--
+--  Authors:
+--      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+--      Ryad BENADJILA <ryadbenadjila@gmail.com>
+--
+--  Contributors:
+--      Adrian THILLARD
+--      Emmanuel PROUFF
+--
+--  This software is licensed under GPL v2 license.
+--  See LICENSE file at the root folder of the project.
+--
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.ecc_customize.all;
+use work.ecc_pkg.all;
+
+-- Top-level of the IP with the descriptor-ring DMA engine (see ecc_dma.vhd).
+--
+-- Same generics & ports as entity ecc, plus the AXI4 master interface through
+-- which the engine fetches its job descriptors & operands from (and writes
+-- results back to) system memory. Integrations that don't need the engine
+-- keep on instantiating entity ecc, whose interface is left unchanged.
+--
+-- ecc_dma is inserted in between the AXI-lite slave interface of the IP and
+-- the one of ecc: it decodes the DMA registers by itself & forwards all other
+-- accesses to ecc (see ecc_dma.vhd). Parameter 'dma' must be set to TRUE in
+-- ecc_customize.vhd to use this entity.
+
+entity ecc_dma_top is
+	generic(
+		-- width of AXI data bus
+		constant C_S_AXI_DATA_WIDTH : integer := axi32or64; -- in ecc_customize
+		-- width of AXI address bus
+		constant C_S_AXI_ADDR_WIDTH : integer := AXIAW; -- in ecc_pkg
+		-- simulation-only pathnames, default values are set in ecc_customize
+		-- (having them as generics allows to override them from the command
+		-- line of the simulator, e.g to run several simulations in parallel)
+		constant simlog : string := simlogfile;
+		constant simxyshuflog : string := simxyshuflogfile;
+		constant simtrng : string := simtrngfile
+	);
+	port(
+		-- AXI clock
+		s_axi_aclk : in std_logic;
+		-- AXI reset (expected active low, async asserted, sync deasserted) 
+		s_axi_aresetn : in std_logic;
+		-- AXI write-address channel
+		s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+		s_axi_awprot : in std_logic_vector(2 downto 0); -- ignored
+		s_axi_awvalid : in std_logic;
+		s_axi_awready : out std_logic;
+		-- AXI write-data channel
+		s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		s_axi_wvalid : in std_logic;
+		s_axi_wready : out std_logic;
+		-- AXI write-response channel
+		s_axi_bresp : out std_logic_vector(1 downto 0);
+		s_axi_bvalid : out std_logic;
+		s_axi_bready : in std_logic;
+		-- AXI read-address channel
+		s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+		s_axi_arprot : in std_logic_vector(2 downto 0); -- ignored
+		s_axi_arvalid : in std_logic;
+		s_axi_arready : out std_logic;
+		-- AXI read-data channel
+		s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		s_axi_rresp : out std_logic_vector(1 downto 0);
+		s_axi_rvalid : out std_logic;
+		s_axi_rready : in std_logic;
+		-- clock for Montgomery multipliers in the async case
+		clkmm : in std_logic;
+		-- interrupt
+		irq : out std_logic;
+		-- busy signal for [k]P computation
+		busy : out std_logic;
+		-- HW unsecure/Side-Channel analysis features
+		--   off-chip trigger
+		dbgtrigger : out std_logic;
+		dbghalted : out std_logic;
+		--   pseudo-trng port
+		dbgptdata : in std_logic_vector(7 downto 0);
+		dbgptvalid : in std_logic;
+		dbgptrdy : out std_logic;
+		-- clk & clkmm division & out feature
+		clkdivo : out std_logic;
+		clkmmdivo : out std_logic;
+		-- AXI4 master interface of the DMA engine (to system memory)
+		m_axi_awaddr : out std_logic_vector(dmaaw - 1 downto 0);
+		m_axi_awlen : out std_logic_vector(7 downto 0);
+		m_axi_awsize : out std_logic_vector(2 downto 0);
+		m_axi_awburst : out std_logic_vector(1 downto 0);
+		m_axi_awcache : out std_logic_vector(3 downto 0);
+		m_axi_awprot : out std_logic_vector(2 downto 0);
+		m_axi_awvalid : out std_logic;
+		m_axi_awready : in std_logic;
+		m_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		m_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+		m_axi_wlast : out std_logic;
+		m_axi_wvalid : out std_logic;
+		m_axi_wready : in std_logic;
+		m_axi_bresp : in std_logic_vector(1 downto 0);
+		m_axi_bvalid : in std_logic;
+		m_axi_bready : out std_logic;
+		m_axi_araddr : out std_logic_vector(dmaaw - 1 downto 0);
+		m_axi_arlen : out std_logic_vector(7 downto 0);
+		m_axi_arsize : out std_logic_vector(2 downto 0);
+		m_axi_arburst : out std_logic_vector(1 downto 0);
+		m_axi_arcache : out std_logic_vector(3 downto 0);
+		m_axi_arprot : out std_logic_vector(2 downto 0);
+		m_axi_arvalid : out std_logic;
+		m_axi_arready : in std_logic;
+		m_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+		m_axi_rresp : in std_logic_vector(1 downto 0);
+		m_axi_rlast : in std_logic;
+		m_axi_rvalid : in std_logic;
+		m_axi_rready : out std_logic
+	);
+end entity ecc_dma_top;
+
+architecture struct of ecc_dma_top is
+
+	component ecc is
+		generic(
+			-- width of AXI data bus
+			constant C_S_AXI_DATA_WIDTH : integer := axi32or64; -- in ecc_customize
+			-- width of AXI address bus
+			constant C_S_AXI_ADDR_WIDTH : integer := AXIAW; -- in ecc_pkg
+			-- simulation-only pathnames, default values are set in ecc_customize
+			-- (having them as generics allows to override them from the command
+			-- line of the simulator, e.g to run several simulations in parallel)
+			constant simlog : string := simlogfile;
+			constant simxyshuflog : string := simxyshuflogfile;
+			constant simtrng : string := simtrngfile
+		);
+		port(
+			-- AXI clock
+			s_axi_aclk : in std_logic;
+			-- AXI reset (expected active low, async asserted, sync deasserted) 
+			s_axi_aresetn : in std_logic;
+			-- AXI write-address channel
+			s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+			s_axi_awprot : in std_logic_vector(2 downto 0); -- ignored
+			s_axi_awvalid : in std_logic;
+			s_axi_awready : out std_logic;
+			-- AXI write-data channel
+			s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+			s_axi_wvalid : in std_logic;
+			s_axi_wready : out std_logic;
+			-- AXI write-response channel
+			s_axi_bresp : out std_logic_vector(1 downto 0);
+			s_axi_bvalid : out std_logic;
+			s_axi_bready : in std_logic;
+			-- AXI read-address channel
+			s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+			s_axi_arprot : in std_logic_vector(2 downto 0); -- ignored
+			s_axi_arvalid : in std_logic;
+			s_axi_arready : out std_logic;
+			-- AXI read-data channel
+			s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			s_axi_rresp : out std_logic_vector(1 downto 0);
+			s_axi_rvalid : out std_logic;
+			s_axi_rready : in std_logic;
+			-- clock for Montgomery multipliers in the async case
+			clkmm : in std_logic;
+			-- interrupt
+			irq : out std_logic;
+			-- busy signal for [k]P computation
+			busy : out std_logic;
+			-- HW unsecure/Side-Channel analysis features
+			--   off-chip trigger
+			dbgtrigger : out std_logic;
+			dbghalted : out std_logic;
+			--   pseudo-trng port
+			dbgptdata : in std_logic_vector(7 downto 0);
+			dbgptvalid : in std_logic;
+			dbgptrdy : out std_logic;
+			-- clk & clkmm division & out feature
+			clkdivo : out std_logic;
+			clkmmdivo : out std_logic
+		);
+	end component ecc;
+
+	component ecc_dma is
+		generic(
+			C_S_AXI_DATA_WIDTH : integer := axi32or64;
+			C_S_AXI_ADDR_WIDTH : integer := AXIAW;
+			C_M_AXI_ADDR_WIDTH : integer := dmaaw);
+		port(
+			s_axi_aclk : in std_logic;
+			s_axi_aresetn : in std_logic;
+			-- AXI-lite slave interface (from CPU)
+			s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+			s_axi_awprot : in std_logic_vector(2 downto 0);
+			s_axi_awvalid : in std_logic;
+			s_axi_awready : out std_logic;
+			s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+			s_axi_wvalid : in std_logic;
+			s_axi_wready : out std_logic;
+			s_axi_bresp : out std_logic_vector(1 downto 0);
+			s_axi_bvalid : out std_logic;
+			s_axi_bready : in std_logic;
+			s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+			s_axi_arprot : in std_logic_vector(2 downto 0);
+			s_axi_arvalid : in std_logic;
+			s_axi_arready : out std_logic;
+			s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			s_axi_rresp : out std_logic_vector(1 downto 0);
+			s_axi_rvalid : out std_logic;
+			s_axi_rready : in std_logic;
+			-- AXI-lite master interface (to ecc)
+			e_axi_awaddr : out std_logic_vector(C_S_AXI_ADDR_WIDTH - 1  downto 0);
+			e_axi_awprot : out std_logic_vector(2 downto 0);
+			e_axi_awvalid : out std_logic;
+			e_axi_awready : in std_logic;
+			e_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			e_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+			e_axi_wvalid : out std_logic;
+			e_axi_wready : in std_logic;
+			e_axi_bresp : in std_logic_vector(1 downto 0);
+			e_axi_bvalid : in std_logic;
+			e_axi_bready : out std_logic;
+			e_axi_araddr : out std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+			e_axi_arprot : out std_logic_vector(2 downto 0);
+			e_axi_arvalid : out std_logic;
+			e_axi_arready : in std_logic;
+			e_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			e_axi_rresp : in std_logic_vector(1 downto 0);
+			e_axi_rvalid : in std_logic;
+			e_axi_rready : out std_logic;
+			-- AXI4 master interface (to system memory)
+			m_axi_awaddr : out std_logic_vector(C_M_AXI_ADDR_WIDTH - 1 downto 0);
+			m_axi_awlen : out std_logic_vector(7 downto 0);
+			m_axi_awsize : out std_logic_vector(2 downto 0);
+			m_axi_awburst : out std_logic_vector(1 downto 0);
+			m_axi_awcache : out std_logic_vector(3 downto 0);
+			m_axi_awprot : out std_logic_vector(2 downto 0);
+			m_axi_awvalid : out std_logic;
+			m_axi_awready : in std_logic;
+			m_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			m_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+			m_axi_wlast : out std_logic;
+			m_axi_wvalid : out std_logic;
+			m_axi_wready : in std_logic;
+			m_axi_bresp : in std_logic_vector(1 downto 0);
+			m_axi_bvalid : in std_logic;
+			m_axi_bready : out std_logic;
+			m_axi_araddr : out std_logic_vector(C_M_AXI_ADDR_WIDTH - 1 downto 0);
+			m_axi_arlen : out std_logic_vector(7 downto 0);
+			m_axi_arsize : out std_logic_vector(2 downto 0);
+			m_axi_arburst : out std_logic_vector(1 downto 0);
+			m_axi_arcache : out std_logic_vector(3 downto 0);
+			m_axi_arprot : out std_logic_vector(2 downto 0);
+			m_axi_arvalid : out std_logic;
+			m_axi_arready : in std_logic;
+			m_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			m_axi_rresp : in std_logic_vector(1 downto 0);
+			m_axi_rlast : in std_logic;
+			m_axi_rvalid : in std_logic;
+			m_axi_rready : out std_logic;
+			-- interrupt
+			irq : out std_logic
+		);
+	end component ecc_dma;
+
+	-- AXI-lite interface of ecc (driven by ecc_dma)
+	signal ea_awaddr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+	signal ea_awprot : std_logic_vector(2 downto 0);
+	signal ea_awvalid : std_logic;
+	signal ea_awready : std_logic;
+	signal ea_wdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+	signal ea_wstrb : std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+	signal ea_wvalid : std_logic;
+	signal ea_wready : std_logic;
+	signal ea_bresp : std_logic_vector(1 downto 0);
+	signal ea_bvalid : std_logic;
+	signal ea_bready : std_logic;
+	signal ea_araddr : std_logic_vector(C_S_AXI_ADDR_WIDTH - 1 downto 0);
+	signal ea_arprot : std_logic_vector(2 downto 0);
+	signal ea_arvalid : std_logic;
+	signal ea_arready : std_logic;
+	signal ea_rdata : std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+	signal ea_rresp : std_logic_vector(1 downto 0);
+	signal ea_rvalid : std_logic;
+	signal ea_rready : std_logic;
+
+	signal irq_ecc : std_logic;
+	signal irq_dma : std_logic;
+
+	-- resynchronization of input reset s_axi_aresetn (same as in ecc)
+	signal s_axi_aresetn_rsh : std_logic_vector(2 downto 0);
+	alias s_axi_aresetn_resync : std_logic is s_axi_aresetn_rsh(0);
+
+begin
+
+	assert dma
+		report "entity ecc_dma_top requires parameter 'dma' to be set to TRUE "
+		     & "in ecc_customize.vhd (otherwise instantiate entity ecc)"
+			severity FAILURE;
+
+	-- force resynchronization of input reset s_axi_aresetn in the
+	-- s_axi_aclk clock domain
+	process(s_axi_aclk, s_axi_aresetn)
+	begin
+		if (s_axi_aresetn = '0') then
+			s_axi_aresetn_rsh <= (others => '0');
+		elsif s_axi_aclk'event and s_axi_aclk = '1' then
+			s_axi_aresetn_rsh(s_axi_aresetn_rsh'length - 1 downto 0) <=
+				'1' & s_axi_aresetn_rsh(s_axi_aresetn_rsh'length - 1 downto 1);
+		end if;
+	end process;
+
+	-- descriptor-ring DMA engine
+	d0: ecc_dma
+		generic map(
+			C_S_AXI_DATA_WIDTH => C_S_AXI_DATA_WIDTH,
+			C_S_AXI_ADDR_WIDTH => C_S_AXI_ADDR_WIDTH,
+			C_M_AXI_ADDR_WIDTH => dmaaw)
+		port map(
+			s_axi_aclk => s_axi_aclk,
+			s_axi_aresetn => s_axi_aresetn_resync,
+			-- AXI-lite slave interface (from CPU)
+			s_axi_awaddr => s_axi_awaddr,
+			s_axi_awprot => s_axi_awprot,
+			s_axi_awvalid => s_axi_awvalid,
+			s_axi_awready => s_axi_awready,
+			s_axi_wdata => s_axi_wdata,
+			s_axi_wstrb => s_axi_wstrb,
+			s_axi_wvalid => s_axi_wvalid,
+			s_axi_wready => s_axi_wready,
+			s_axi_bresp => s_axi_bresp,
+			s_axi_bvalid => s_axi_bvalid,
+			s_axi_bready => s_axi_bready,
+			s_axi_araddr => s_axi_araddr,
+			s_axi_arprot => s_axi_arprot,
+			s_axi_arvalid => s_axi_arvalid,
+			s_axi_arready => s_axi_arready,
+			s_axi_rdata => s_axi_rdata,
+			s_axi_rresp => s_axi_rresp,
+			s_axi_rvalid => s_axi_rvalid,
+			s_axi_rready => s_axi_rready,
+			-- AXI-lite master interface (to ecc)
+			e_axi_awaddr => ea_awaddr,
+			e_axi_awprot => ea_awprot,
+			e_axi_awvalid => ea_awvalid,
+			e_axi_awready => ea_awready,
+			e_axi_wdata => ea_wdata,
+			e_axi_wstrb => ea_wstrb,
+			e_axi_wvalid => ea_wvalid,
+			e_axi_wready => ea_wready,
+			e_axi_bresp => ea_bresp,
+			e_axi_bvalid => ea_bvalid,
+			e_axi_bready => ea_bready,
+			e_axi_araddr => ea_araddr,
+			e_axi_arprot => ea_arprot,
+			e_axi_arvalid => ea_arvalid,
+			e_axi_arready => ea_arready,
+			e_axi_rdata => ea_rdata,
+			e_axi_rresp => ea_rresp,
+			e_axi_rvalid => ea_rvalid,
+			e_axi_rready => ea_rready,
+			-- AXI4 master interface (to system memory)
+			m_axi_awaddr => m_axi_awaddr,
+			m_axi_awlen => m_axi_awlen,
+			m_axi_awsize => m_axi_awsize,
+			m_axi_awburst => m_axi_awburst,
+			m_axi_awcache => m_axi_awcache,
+			m_axi_awprot => m_axi_awprot,
+			m_axi_awvalid => m_axi_awvalid,
+			m_axi_awready => m_axi_awready,
+			m_axi_wdata => m_axi_wdata,
+			m_axi_wstrb => m_axi_wstrb,
+			m_axi_wlast => m_axi_wlast,
+			m_axi_wvalid => m_axi_wvalid,
+			m_axi_wready => m_axi_wready,
+			m_axi_bresp => m_axi_bresp,
+			m_axi_bvalid => m_axi_bvalid,
+			m_axi_bready => m_axi_bready,
+			m_axi_araddr => m_axi_araddr,
+			m_axi_arlen => m_axi_arlen,
+			m_axi_arsize => m_axi_arsize,
+			m_axi_arburst => m_axi_arburst,
+			m_axi_arcache => m_axi_arcache,
+			m_axi_arprot => m_axi_arprot,
+			m_axi_arvalid => m_axi_arvalid,
+			m_axi_arready => m_axi_arready,
+			m_axi_rdata => m_axi_rdata,
+			m_axi_rresp => m_axi_rresp,
+			m_axi_rlast => m_axi_rlast,
+			m_axi_rvalid => m_axi_rvalid,
+			m_axi_rready => m_axi_rready,
+			-- interrupt
+			irq => irq_dma
+		);
+
+	-- the IP itself
+	e0: ecc
+		generic map(
+			C_S_AXI_DATA_WIDTH => C_S_AXI_DATA_WIDTH,
+			C_S_AXI_ADDR_WIDTH => C_S_AXI_ADDR_WIDTH,
+			simlog => simlog,
+			simxyshuflog => simxyshuflog,
+			simtrng => simtrng)
+		port map(
+			s_axi_aclk => s_axi_aclk,
+			s_axi_aresetn => s_axi_aresetn,
+			s_axi_awaddr => ea_awaddr,
+			s_axi_awprot => ea_awprot,
+			s_axi_awvalid => ea_awvalid,
+			s_axi_awready => ea_awready,
+			s_axi_wdata => ea_wdata,
+			s_axi_wstrb => ea_wstrb,
+			s_axi_wvalid => ea_wvalid,
+			s_axi_wready => ea_wready,
+			s_axi_bresp => ea_bresp,
+			s_axi_bvalid => ea_bvalid,
+			s_axi_bready => ea_bready,
+			s_axi_araddr => ea_araddr,
+			s_axi_arprot => ea_arprot,
+			s_axi_arvalid => ea_arvalid,
+			s_axi_arready => ea_arready,
+			s_axi_rdata => ea_rdata,
+			s_axi_rresp => ea_rresp,
+			s_axi_rvalid => ea_rvalid,
+			s_axi_rready => ea_rready,
+			clkmm => clkmm,
+			irq => irq_ecc,
+			busy => busy,
+			dbgtrigger => dbgtrigger,
+			dbghalted => dbghalted,
+			dbgptdata => dbgptdata,
+			dbgptvalid => dbgptvalid,
+			dbgptrdy => dbgptrdy,
+			clkdivo => clkdivo,
+			clkmmdivo => clkmmdivo
+		);
+
+	irq <= irq_ecc or irq_dma;
+
+end architecture struct;
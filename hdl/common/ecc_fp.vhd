@@ -30,6 +30,9 @@ use work.ecc_addr.all;
 -- pragma translate_on
 
 entity ecc_fp is
+	generic(
+		-- simulation-only (see 'simlogfile' in ecc_customize.vhd)
+		simlog : string := simlogfile);
 	port(
 		clk : in std_logic;
 		rstn : in std_logic; -- synchronous reset
@@ -41,6 +44,8 @@ entity ecc_fp is
 		-- interface with Montgomery multipliers
 		mmi : out mmi_type;
 		mmo : in mmo_type;
+		-- interface with ecc_axi (performance counters)
+		mmbusy : out std_logic_vector(0 to nbmult - 1);
 		-- interface with ecc_fp_dram
 		fpre : out std_logic;
 		fpraddr : out std_logic_vector(FP_ADDR - 1 downto 0);
@@ -369,6 +374,60 @@ architecture rtl of ecc_fp is
 
 	signal r, rin : reg_type;
 
+	-- (s158)
+	-- Scoreboard on the destination of pending FPREDC operations: returns
+	-- TRUE if the operation driven by ecc_curve on 'op' reads or writes the
+	-- large number that one of the Montgomery multipliers is still computing
+	-- (i.e one for which 'busy' is asserted, see (s146) & (s11)). Such an
+	-- operation must not be accepted until the FPREDC result has been pulled
+	-- back into ecc_fp_dram, see (s159).
+	-- Operand 'a' is read by all opcodes but NNRND, operand 'b' is only read
+	-- by NNADD, NNSUB, NNXOR & FPREDC (NNSRL/NNRNDs use it to select a shift-
+	-- register) and operand 'c' is written by all opcodes but TESTPAR.
+	-- For an extended (',X') opcode, ecc_curve guarantees that operand
+	-- addresses are even and the operation may span the large numbers at
+	-- address & address + 1: the LSbit of addresses is then ignored in the
+	-- comparison, so that both halves are covered.
+	-- The scoreboard is only present if 'nbmult' > 2 (see 'redc_sb' below):
+	-- with 1 or 2 multipliers the microcode synchronizes with FPREDC results
+	-- using BARRIERs only, and opo.rdy is driven as it always was.
+	constant redc_sb : boolean := (nbmult > 2);
+
+	function redc_same_nb(
+		x : stdop; y : stdop; ext : std_logic) return boolean is
+	begin
+		if ext = '1' then
+			return x(x'high downto x'low + 1) = y(y'high downto y'low + 1);
+		else
+			return x = y;
+		end if;
+	end function redc_same_nb;
+
+	function redc_hazard(
+		op : opi_type; busy : std_logic_vector; opc : mm_opc_type)
+		return boolean is
+		variable hz : boolean := FALSE;
+	begin
+		if redc_sb and op.valid = '1' then
+			for i in 0 to nbmult - 1 loop
+				if busy(i) = '1' then
+					if op.rnd = '0' and redc_same_nb(op.a, opc(i), op.extended) then
+						hz := TRUE;
+					end if;
+					if (op.add = '1' or op.sub = '1' or op.xxor = '1' or op.redc = '1')
+						and redc_same_nb(op.b, opc(i), op.extended)
+					then
+						hz := TRUE;
+					end if;
+					if op.par = '0' and redc_same_nb(op.c, opc(i), op.extended) then
+						hz := TRUE;
+					end if;
+				end if;
+			end loop;
+		end if;
+		return hz;
+	end function redc_hazard;
+
 	-- pragma translate_off
 	type blog_reg_type is record
 		b : std_logic;
@@ -882,10 +941,15 @@ begin
 		--            trigger start of overall computation
 		--               (of one opcode execution) (s21)
 		-- -----------------------------------------------------------
-		if r.rdy = '1' and opi.valid = '0' then
+		if r.rdy = '1' and
+			(opi.valid = '0' or redc_hazard(opi, r.mm.busy, r.mm.push.opc))
+		then
 			-- although r.rdy is high by deasserting it we won't cheat ecc_curve in
 			-- believing we're accepting an operation from it, since opi.valid = 0
 			-- means it is not driving us an operation to do
+			-- (s159) same thing if the operation it drives accesses the result of
+			-- a pending FPREDC: opo.rdy is then masked (see (s160)) and we keep
+			-- on pulling REDC results until the hazard disappears (see (s158))
 			v.rdy := '0';
 			-- assert r.trypull to test if there is an FPREDC whose result might be
 			-- ready to be pulled from one of the Montgomery multipliers
@@ -2475,9 +2539,10 @@ begin
 
 	-- pragma translate_off
 	-- (s142) simulation process to log all microcode execution in file which
-	-- pathname is given by constant 'simlogfile' of package ecc_customize.vhd
+	-- pathname is given by generic 'simlog' (defaults to constant 'simlogfile'
+	-- of package ecc_customize.vhd)
 	fplog: process(clk)
-		file output : TEXT open write_mode is simlogfile;
+		file output : TEXT open write_mode is simlog;
 		variable lineout : line;
 		variable vres : std_logic_vector(2*w*ww - 1 downto 0);
 		variable vi : natural range 0 to 2*n - 1;
@@ -3552,7 +3617,13 @@ begin
 
 	-- drive outputs
 	--   to ecc_curve
-	opo.rdy <= r.rdy;
+	sb0: if redc_sb generate
+		opo.rdy <= '0' when redc_hazard(opi, r.mm.busy, r.mm.push.opc) -- (s160)
+		           else r.rdy;
+	end generate;
+	sb1: if not redc_sb generate
+		opo.rdy <= r.rdy;
+	end generate;
 	opo.resultz <= r.ctrl.resultz;
 	opo.resultsn <= r.ctrl.resultsn;
 	opo.resultpar <= r.par.par; -- (s76), see (s75)
@@ -3560,6 +3631,8 @@ begin
 	opo.done <= r.done;
 	--   to multipliers
 	mmi <= r.mm.mmi;
+	--   to ecc_axi
+	mmbusy <= r.mm.busy;
 	--   to ecc_fp_dram
 	fpre <= r.fpram.re;
 	fpraddr <= r.fpram.raddr;
@@ -109,6 +109,10 @@ package ecc_pkg is
 	-- in ecc_customize.vhd
 	constant IRAM_ADDR_SZ : positive := log2(nbopcodes - 1); -- 9
 
+	-- bitwidth of address bus to the microcode execution trace RAM of
+	-- ecc_curve (only used if 'tracedepth' > 0 in ecc_customize.vhd)
+	constant TRACE_ADDR_SZ : positive := log2(max(tracedepth, 2) - 1);
+
 	subtype std_logic_ww is std_logic_vector(ww - 1 downto 0);
 
 	-- types for interface between ecc_curve & ecc_fp
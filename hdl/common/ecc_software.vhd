@@ -58,7 +58,14 @@ package ecc_software is
 	constant W_ERR_ACK : rat := std_nat(10, ADB);            -- 0x050
 	constant W_SMALL_SCALAR : rat := std_nat(11, ADB);       -- 0x058
 	constant W_SOFT_RESET : rat := std_nat(12, ADB);         -- 0x060
-	-- reserved                                              -- 0x060...0x0f8
+	constant W_DMA_CTRL : rat := std_nat(13, ADB);           -- 0x068
+	constant W_DMA_RING_BASE : rat := std_nat(14, ADB);      -- 0x070
+	constant W_DMA_RING_CFG : rat := std_nat(15, ADB);       -- 0x078
+	constant W_DMA_PROD : rat := std_nat(16, ADB);           -- 0x080
+	constant W_CMDQ_PUSH : rat := std_nat(17, ADB);          -- 0x088
+	constant W_CMDQ_CTRL : rat := std_nat(18, ADB);          -- 0x090
+	constant W_PERF_CTRL : rat := std_nat(19, ADB);          -- 0x098
+	-- reserved                                              -- 0x0a0...0x0f8
 	-- (0x100: start of write HW unsecure/SCA features registers)
 	constant W_DBG_HALT : rat := std_nat(32, ADB);           -- 0x100
 	constant W_DBG_BKPT : rat := std_nat(33, ADB);           -- 0x108
@@ -84,7 +91,8 @@ package ecc_software is
 	constant W_ATTACK_CFG_0 : rat := std_nat(53, ADB);       -- 0x1a8
 	constant W_ATTACK_CFG_1 : rat := std_nat(54, ADB);       -- 0x1b0
 	constant W_ATTACK_CFG_2 : rat := std_nat(55, ADB);       -- 0x1b8
-	-- reserved                                              -- 0x1c0...0x1f8
+	constant W_DBG_TRACE_CTRL : rat := std_nat(56, ADB);     -- 0x1c0
+	-- reserved                                              -- 0x1c8...0x1f8
 	-- ----------------------------------------------
 	-- addresses of all AXI-accessible read registers
 	-- ----------------------------------------------
@@ -93,7 +101,13 @@ package ecc_software is
 	constant R_CAPABILITIES : rat := std_nat(2, ADB);        -- 0x010
 	constant R_HW_VERSION : rat := std_nat(3, ADB);          -- 0x018
 	constant R_PRIME_SIZE : rat := std_nat(4, ADB);          -- 0x020
-	-- reserved                                              -- 0x028...0x0f8
+	constant R_DMA_STATUS : rat := std_nat(5, ADB);          -- 0x028
+	constant R_CMDQ_STATUS : rat := std_nat(6, ADB);         -- 0x030
+	constant R_CMDQ_RESULT : rat := std_nat(7, ADB);         -- 0x038
+	constant R_RANDOM : rat := std_nat(8, ADB);              -- 0x040
+	constant R_RANDOM_CNT : rat := std_nat(9, ADB);          -- 0x048
+	constant R_PERF_DATA : rat := std_nat(10, ADB);          -- 0x050
+	-- reserved                                              -- 0x058...0x0f8
 	-- (0x100: start of read HW unsecure/SCA features registers)
 	constant R_DBG_CAPABILITIES_0 : rat := std_nat(32, ADB); -- 0x100
 	constant R_DBG_CAPABILITIES_1 : rat := std_nat(33, ADB); -- 0x108
@@ -113,7 +127,9 @@ package ecc_software is
 	constant R_DBG_CLK_MHZ : rat := std_nat(47, ADB);        -- 0x178
 	constant R_DBG_CLKMM_MHZ : rat := std_nat(48, ADB);      -- 0x180
 	constant R_DBG_XYSHUF_PERM : rat := std_nat(49, ADB);    -- 0x188
-	-- reserved                                              -- 0x190...0x1f8
+	constant R_DBG_TRACE_STATUS : rat := std_nat(50, ADB);   -- 0x190
+	constant R_DBG_TRACE_DATA : rat := std_nat(51, ADB);     -- 0x198
+	-- reserved                                              -- 0x1a0...0x1f8
 	-- end of ECC registers/>
 
 	-- Register bank of pseudo TRNG device (external to the IP), if any.
@@ -140,7 +156,7 @@ package ecc_software is
 	constant CTRL_WRITE_NB : natural := 16;
 	constant CTRL_READ_NB : natural := 17;
 	constant CTRL_WRITE_K : natural := 18;
-	-- bit 19 reserved
+	constant CTRL_SHADOW : natural := 19;
 	constant CTRL_NBADDR_LSB : natural := 20;
 	constant CTRL_NBADDR_SZ : natural := 12;
 	constant CTRL_NBADDR_MSB : natural := CTRL_NBADDR_LSB + CTRL_NBADDR_SZ - 1;
@@ -168,6 +184,55 @@ package ecc_software is
 	-- bit positions in W_ERR_ACK
 	-- same as the ERR_* bits in R_STATUS (see below)
 
+	-- bit positions in W_DMA_CTRL register
+	constant DMA_CTRL_EN : natural := 0;
+	constant DMA_CTRL_IRQ_EN : natural := 4;
+	constant DMA_CTRL_RESET : natural := 8;
+
+	-- bit positions in W_DMA_RING_CFG register
+	constant DMA_CFG_LOG2SZ_LSB : natural := 0;
+	constant DMA_CFG_LOG2SZ_MSB : natural := 3;
+	constant DMA_CFG_NBW_LSB : natural := 16;
+	constant DMA_CFG_NBW_MSB : natural := 27;
+
+	-- bit positions in W_DMA_PROD register
+	constant DMA_IDX_SZ : natural := 12;
+	constant DMA_PROD_LSB : natural := 0;
+	constant DMA_PROD_MSB : natural := DMA_PROD_LSB + DMA_IDX_SZ - 1;
+
+	-- bit positions in W_CMDQ_PUSH register
+	--   (bits 0-6 are the same as the command bits of W_CTRL register)
+
+	-- bit positions in W_CMDQ_CTRL register
+	constant CMDQ_CTRL_FLUSH : natural := 0;
+	constant CMDQ_CTRL_RESUME : natural := 1;
+
+	-- bit positions in W_PERF_CTRL register
+	constant PERF_CTRL_SEL_LSB : natural := 0;
+	constant PERF_CTRL_SEL_MSB : natural := 3;
+	constant PERF_CTRL_CLR : natural := 8;
+	constant PERF_CTRL_FRZ : natural := 9;
+
+	-- performance counters (selected by field SEL of W_PERF_CTRL register
+	-- and read through R_PERF_DATA register)
+	constant PERF_KP : natural := 0;
+	constant PERF_PT_ADD : natural := 1;
+	constant PERF_PT_DBL : natural := 2;
+	constant PERF_PT_CHK : natural := 3;
+	constant PERF_PT_NEG : natural := 4;
+	constant PERF_PT_EQU : natural := 5;
+	constant PERF_PT_OPP : natural := 6;
+	constant PERF_TRNG_STALL : natural := 7;
+	constant PERF_MTY : natural := 8;
+	constant PERF_AXI : natural := 9;
+	constant PERF_MM_USED : natural := 10;
+	constant PERF_MM_AVAIL : natural := 11;
+	constant PERF_CYCLES : natural := 12;
+	constant PERF_KP_SETUP : natural := 13;
+	constant PERF_KP_LADDER : natural := 14;
+	constant PERF_KP_EXIT : natural := 15;
+	constant PERF_NB : natural := 16;
+
 	-- bit positions in W_PRIME_SIZE register
 	constant PMSZ_VALNN_LSB : natural := 0;
 	constant PMSZ_VALNN_SZ : natural := log2(nn);
@@ -260,6 +325,11 @@ package ecc_software is
 	constant CLKMM_DIV_LSB : natural := 16;
 	constant CLKMM_DIV_MSB : natural := 31;
 
+	-- bit positions in W_DBG_TRACE_CTRL register
+	constant DBG_TRACE_EN : natural := 0;
+	constant DBG_TRACE_CLR : natural := 4;
+	constant DBG_TRACE_RWD : natural := 8;
+
 	-- ----------------------------------------------
 	-- bit positions / fields in read registers
 	-- ----------------------------------------------
@@ -276,6 +346,7 @@ package ecc_software is
 	constant STATUS_R0_IS_NULL : natural := 12;
 	constant STATUS_R1_IS_NULL : natural := 13;
 	constant STATUS_TOKEN_GEN : natural := 14;
+	constant STATUS_KP_QUEUED : natural := 15;
 	constant STATUS_ERR_LSB : natural := 16;
 	constant STATUS_ERR_IN_PT_NOT_ON_CURVE : natural := STATUS_ERR_LSB;
 	constant STATUS_ERR_OUT_PT_NOT_ON_CURVE : natural := STATUS_ERR_LSB + 1;
@@ -300,14 +371,75 @@ package ecc_software is
 	-- bit positions in R_CAPABILITIES register
 	constant CAP_DBG_N_PROD : natural := 0;
 	constant CAP_SHF : natural := 4;
+	constant CAP_CMDQ : natural := 5;
+	constant CAP_PERF : natural := 6;
 	constant CAP_NNDYN : natural := 8;
 	constant CAP_W64 : natural := 9;
+	constant CAP_DMA : natural := 10;
+	constant CAP_SHADOW : natural := 11;
 	constant CAP_NNMAX_LSB : natural := 12;
 	constant CAP_NNMAX_MSB : natural := CAP_NNMAX_LSB + log2(nn) - 1;
 
 	-- bit positions in R_PRIME_SIZE
 	--   (same definitions as for W_PRIME_SIZE register, see above)
 
+	-- bit positions in R_DMA_STATUS register
+	constant DMA_STS_EN : natural := 0;
+	constant DMA_STS_RUNNING : natural := 1;
+	constant DMA_STS_BUS_ERR : natural := 2;
+	constant DMA_STS_CPU_FBD : natural := 3;
+	constant DMA_STS_CONS_LSB : natural := 16;
+	constant DMA_STS_CONS_MSB : natural := DMA_STS_CONS_LSB + DMA_IDX_SZ - 1;
+
+	-- bit positions in R_CMDQ_STATUS register
+	constant CMDQ_IDX_SZ : natural := 8;
+	constant CMDQ_STS_OCC_LSB : natural := 0;
+	constant CMDQ_STS_OCC_MSB : natural := CMDQ_STS_OCC_LSB + CMDQ_IDX_SZ - 1;
+	constant CMDQ_STS_DEPTH_LSB : natural := 8;
+	constant CMDQ_STS_DEPTH_MSB : natural := CMDQ_STS_DEPTH_LSB + CMDQ_IDX_SZ - 1;
+	constant CMDQ_STS_NBRES_LSB : natural := 16;
+	constant CMDQ_STS_NBRES_MSB : natural := CMDQ_STS_NBRES_LSB + CMDQ_IDX_SZ - 1;
+	constant CMDQ_STS_OVF : natural := 30;
+	constant CMDQ_STS_HALTED : natural := 31;
+
+	-- bit positions in R_CMDQ_RESULT register
+	constant CMDQ_RES_ID_LSB : natural := 0;
+	constant CMDQ_RES_ID_MSB : natural := CMDQ_RES_ID_LSB + CMDQ_IDX_SZ - 1;
+	constant CMDQ_RES_VALID : natural := 8;
+	constant CMDQ_RES_YES : natural := 9;
+	constant CMDQ_RES_R1_NULL : natural := 10;
+	constant CMDQ_RES_ERR : natural := 11;
+	constant CMDQ_RES_OP_LSB : natural := 16;
+	--   (bits 16-22 are a copy of the command bits of W_CMDQ_PUSH register)
+	constant CMDQ_RES_OP_MSB : natural := 22;
+
+	-- bit positions in R_RANDOM_CNT register
+	constant RNDCNT_IRN_LSB : natural := 0;
+	constant RNDCNT_IRN_MSB : natural := 15;
+	constant RNDCNT_NBW_LSB : natural := 16;
+	constant RNDCNT_NBW_MSB : natural := 23;
+	constant RNDCNT_RDY : natural := 31;
+
+	-- layout of DMA job descriptors (see ecc_dma.vhd), offsets in words
+	constant DMA_DESC_CMD : natural := 0;
+	constant DMA_DESC_CURVE : natural := 1;
+	constant DMA_DESC_IN : natural := 2;
+	constant DMA_DESC_OUT : natural := 3;
+	constant DMA_DESC_STATUS : natural := 4;
+	constant DMA_DESC_WORDS : natural := 8;
+	-- bit positions in CMD word of a DMA job descriptor
+	--   (bits 0-6 are the same as the command bits of W_CTRL register)
+	constant DMA_CMD_P_NULL : natural := 8;
+	constant DMA_CMD_Q_NULL : natural := 9;
+	constant DMA_CMD_LOAD_CURVE : natural := 12;
+	constant DMA_CMD_IRQ : natural := 13;
+	-- bit positions in STATUS word of a DMA job descriptor
+	--   (bits 16-31 are a copy of the error bits of R_STATUS register)
+	constant DMA_DST_DONE : natural := 0;
+	constant DMA_DST_YES : natural := 1;
+	constant DMA_DST_R1_NULL : natural := 2;
+	constant DMA_DST_ERR : natural := 3;
+
 	-- bit positions in R_HW_VERSION
 	constant HW_VERSION_MAJ_LSB : natural := 24;
 	constant HW_VERSION_MAJ_MSB : natural := 31;
@@ -394,4 +526,30 @@ package ecc_software is
 	constant R_DBG_XYSHF_PERM_X1_NEXT : natural := 12;
 	constant R_DBG_XYSHF_PERM_Y1_NEXT : natural := 14;
 
+	-- bit positions in R_DBG_TRACE_STATUS register
+	constant DBG_TRACE_STS_CNT_LSB : natural := 0;
+	constant DBG_TRACE_STS_CNT_MSB : natural := 23;
+	constant DBG_TRACE_STS_LOGD_LSB : natural := 24;
+	constant DBG_TRACE_STS_LOGD_MSB : natural := 28;
+	constant DBG_TRACE_STS_EN : natural := 30;
+	constant DBG_TRACE_STS_OVF : natural := 31;
+
+	-- layout of trace entries read through R_DBG_TRACE_DATA register
+	constant DBG_TRACE_PC_LSB : natural := 0;
+	constant DBG_TRACE_PC_MSB : natural := 11;
+	constant DBG_TRACE_CLASS_LSB : natural := 12;
+	constant DBG_TRACE_CLASS_MSB : natural := 14;
+	constant DBG_TRACE_TAKEN : natural := 15;
+	constant DBG_TRACE_TIME_LSB : natural := 16;
+	constant DBG_TRACE_TIME_MSB : natural := 31;
+	-- values of the class field of trace entries
+	constant DBG_TRACE_CL_NOP : natural := 0;
+	constant DBG_TRACE_CL_ARITH : natural := 1;
+	constant DBG_TRACE_CL_REDC : natural := 2;
+	constant DBG_TRACE_CL_TPAR : natural := 3;
+	constant DBG_TRACE_CL_BRANCH : natural := 4;
+	constant DBG_TRACE_CL_CALL : natural := 5;
+	constant DBG_TRACE_CL_RET : natural := 6;
+	constant DBG_TRACE_CL_STOP : natural := 7;
+
 end package ecc_software;
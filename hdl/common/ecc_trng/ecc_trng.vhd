@@ -28,6 +28,9 @@ use std.textio.all;
 -- pragma translate_on
 
 entity ecc_trng is
+	generic(
+		-- simulation-only (see 'simtrngfile' in ecc_customize.vhd)
+		simtrng : string := simtrngfile);
 	port(
 		clk : in std_logic;
 		rstn : in std_logic;
@@ -107,6 +110,7 @@ architecture rtl of ecc_trng is
 
 	-- pragma translate_off
 	component es_trng_sim is
+		generic(simtrng : string);
 		port(
 			clk : in std_logic;
 			rstn : in std_logic;
@@ -233,6 +237,7 @@ begin
 		-- 'es_trng_sim' reads randomness from local file
 		-- and provides them to 'ecc_trng_pp'
 		t0: es_trng_sim
+			generic map(simtrng => simtrng)
 			port map(
 				clk => clk,
 				rstn => rstn,
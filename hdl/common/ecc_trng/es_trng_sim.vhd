@@ -28,6 +28,7 @@ use std.textio.all;
 -- pragma translate_on
 
 entity es_trng_sim is
+	generic(simtrng : string := simtrngfile);
 	port(
 		clk : in std_logic;
 		rstn : in std_logic;
@@ -56,8 +57,9 @@ architecture struct of es_trng_sim is
 	signal r_valid_t : std_logic;
 	signal r_oor : std_logic;
 
-	-- This is where the file whose name is set in 'ecc_customize' is read.
-	file fr: text is simtrngfile;
+	-- This is where the file whose name is set in 'ecc_customize' (or else
+	-- overridden through generic 'simtrng') is read.
+	file fr: text is simtrng;
 
 begin
 
@@ -0,0 +1,1520 @@
+/*
+ *  Copyright (C) 2023 - This file is part of IPECC project
+ *
+ *  Authors:
+ *      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+ *      Ryad BENADJILA <ryadbenadjila@gmail.com>
+ *
+ *  Contributors:
+ *      Adrian THILLARD
+ *      Emmanuel PROUFF
+ *
+ *  This software is licensed under GPL v2 license.
+ *  See LICENSE file at the root folder of the project.
+ */
+
+/*
+ * Native (C/GMP) equivalent of generate-tests.sage: draws random curves
+ * and prints test-vectors for them on standard output, in the very same
+ * format (the one of sim/std-curves-test-vectors.txt, read by ecc_tb and
+ * by ecc-test-linux): [k]P, P+Q, [2]P, -P, isPoncurve, isP==Q & isP==-Q
+ * tests, including the "# EXCEPTION" tests, null points, random blinding
+ * ("nbbld=") & the decreasing [nnmin : nnmax] range of dynamic values
+ * of nn. The parameters of the configuration frame of generate-tests.sage
+ * are options here (same names & same defaults, see usage()).
+ *
+ * Differences with generate-tests.sage:
+ *
+ *   - Sage computes the order q of the curve with SEA, here it is computed
+ *     with baby-step giant-step (whose cost grows as p^(1/4)), so q is only
+ *     computed for curves with nn <= NN_LIMIT_COMPUTE_Q (option -q, 64 by
+ *     default & at most 72). Curves beyond that limit get q = 1, no blinding
+ *     & none of the exception tests which need q (same as in the Sage script
+ *     when NN_LIMIT_COMPUTE_Q is set).
+ *
+ *   - Each curve is generated from its own random state, derived from the
+ *     seed (option -s) & from the index of the curve only. The output is
+ *     hence the same whatever the nb of threads (option -j), and shard i of
+ *     N (option -S i/N, curves whose index is equal to i modulo N) contains
+ *     exactly the same curves & tests as the complete run. Test numbers
+ *     ("#curve.test") being a running count, they are local to a shard.
+ *
+ *   - When the order of the exception point P is prime, Sage skips all the
+ *     remaining exception tests of the curve; only the tests based on the
+ *     factors of that order are skipped here.
+ */
+
+#include <errno.h>
+#include <gmp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Schedule of the [nnmin : nnmax] range (see generate-tests.sage) */
+#define NNMINMOD   3
+#define NNMINDECR  8
+#define NNMAXMOD   6
+#define NNMAXDECR  4
+
+/* Largest value accepted for NN_LIMIT_COMPUTE_Q (memory of the baby-step
+ * table is in p^(1/4), 16 MB per thread for nn = 72) */
+#define NN_LIMIT_COMPUTE_Q_MAX  72
+#define NN_SMALLEST  16
+
+#define MAX_FACTORS  48
+
+typedef struct {
+	unsigned long nbcurv;
+	unsigned int nnmaxabsolute;
+	unsigned int nnminmin;
+	unsigned int nnmaxmin;
+	unsigned int nn_constant;
+	unsigned int nn_limit_compute_q;
+	bool only_kp_and_no_blinding;
+	bool no_exceptions;
+	unsigned int nbkp, nbadd, nbdbl, nbneg, nbchk, nbequ, nbopp;
+	unsigned long seed;
+	unsigned int nbthreads;
+	unsigned int shard, nbshards;
+} gen_cfg_t;
+
+typedef struct {
+	mpz_t x, y;
+	bool inf;
+} pt_t;
+
+typedef struct {
+	mpz_t f[MAX_FACTORS];
+	unsigned int e[MAX_FACTORS];
+	unsigned int nb;
+} fac_t;
+
+typedef struct {
+	unsigned int nn;
+	mpz_t p, a, b, q;
+	bool hasq;
+	/* scratch registers of point operations */
+	mpz_t t0, t1, t2, t3;
+	gmp_randstate_t rnd;
+} crv_t;
+
+static gen_cfg_t cfg = {
+	.nbcurv = 10,
+	.nnmaxabsolute = 256,
+	.nnminmin = 32,
+	.nnmaxmin = 128,
+	.nn_constant = 0,
+	.nn_limit_compute_q = 64,
+	.only_kp_and_no_blinding = false,
+	.no_exceptions = false,
+	.nbkp = 100, .nbadd = 10, .nbdbl = 10, .nbneg = 10, .nbchk = 10, .nbequ = 10, .nbopp = 10,
+	.seed = 0,
+	.nbthreads = 0,
+	.shard = 0, .nbshards = 1,
+};
+
+static unsigned int small_primes[168];
+
+static void init_small_primes(void)
+{
+	unsigned int n, i, nb = 0;
+
+	for (n = 2; nb < sizeof(small_primes) / sizeof(small_primes[0]); n++) {
+		for (i = 0; (i < nb) && (small_primes[i] * small_primes[i] <= n); i++) {
+			if ((n % small_primes[i]) == 0) {
+				break;
+			}
+		}
+		if ((i == nb) || (small_primes[i] * small_primes[i] > n)) {
+			small_primes[nb++] = n;
+		}
+	}
+}
+
+static unsigned long rnd_int(crv_t *c, unsigned long lo, unsigned long hi)
+{
+	return lo + gmp_urandomm_ui(c->rnd, hi - lo + 1);
+}
+
+static bool toss_a_coin(crv_t *c)
+{
+	return (gmp_urandomb_ui(c->rnd, 1) == 1);
+}
+
+/* ------------------------------------------------------------------
+ * Points (affine coordinates, 'inf' for the null point)
+ * ------------------------------------------------------------------ */
+
+static void pt_init(pt_t *P)
+{
+	mpz_inits(P->x, P->y, NULL);
+	P->inf = true;
+}
+
+static void pt_clear(pt_t *P)
+{
+	mpz_clears(P->x, P->y, NULL);
+}
+
+static void pt_set(pt_t *R, const pt_t *P)
+{
+	mpz_set(R->x, P->x);
+	mpz_set(R->y, P->y);
+	R->inf = P->inf;
+}
+
+static void pt_neg(crv_t *c, pt_t *R, const pt_t *P)
+{
+	mpz_set(R->x, P->x);
+	if (mpz_sgn(P->y) == 0) {
+		mpz_set_ui(R->y, 0);
+	} else {
+		mpz_sub(R->y, c->p, P->y);
+	}
+	R->inf = P->inf;
+}
+
+static bool pt_eq(const pt_t *P, const pt_t *Q)
+{
+	if (P->inf || Q->inf) {
+		return (P->inf && Q->inf);
+	}
+	return ((mpz_cmp(P->x, Q->x) == 0) && (mpz_cmp(P->y, Q->y) == 0));
+}
+
+/* P == -Q */
+static bool pt_opp(crv_t *c, const pt_t *P, const pt_t *Q)
+{
+	if (P->inf || Q->inf) {
+		return (P->inf && Q->inf);
+	}
+	if (mpz_cmp(P->x, Q->x) != 0) {
+		return false;
+	}
+	mpz_add(c->t0, P->y, Q->y);
+	return mpz_divisible_p(c->t0, c->p);
+}
+
+static void pt_dbl(crv_t *c, pt_t *R, const pt_t *P)
+{
+	if (P->inf || (mpz_sgn(P->y) == 0)) {
+		R->inf = true;
+		return;
+	}
+	/* lambda = (3x^2 + a) / 2y */
+	mpz_mul_2exp(c->t0, P->y, 1);
+	mpz_invert(c->t0, c->t0, c->p);
+	mpz_mul(c->t1, P->x, P->x);
+	mpz_mul_ui(c->t1, c->t1, 3);
+	mpz_add(c->t1, c->t1, c->a);
+	mpz_mul(c->t2, c->t1, c->t0);
+	mpz_mod(c->t2, c->t2, c->p);
+	/* x3 = lambda^2 - 2x, y3 = lambda (x - x3) - y */
+	mpz_mul(c->t3, c->t2, c->t2);
+	mpz_submul_ui(c->t3, P->x, 2);
+	mpz_mod(c->t3, c->t3, c->p);
+	mpz_sub(c->t1, P->x, c->t3);
+	mpz_mul(c->t1, c->t1, c->t2);
+	mpz_sub(c->t1, c->t1, P->y);
+	mpz_mod(R->y, c->t1, c->p);
+	mpz_swap(R->x, c->t3);
+	R->inf = false;
+}
+
+static void pt_add(crv_t *c, pt_t *R, const pt_t *P, const pt_t *Q)
+{
+	if (P->inf) {
+		pt_set(R, Q);
+		return;
+	}
+	if (Q->inf) {
+		pt_set(R, P);
+		return;
+	}
+	if (mpz_cmp(P->x, Q->x) == 0) {
+		if (mpz_cmp(P->y, Q->y) == 0) {
+			pt_dbl(c, R, P);
+		} else {
+			R->inf = true;
+		}
+		return;
+	}
+	/* lambda = (yQ - yP) / (xQ - xP) */
+	mpz_sub(c->t0, Q->x, P->x);
+	mpz_invert(c->t0, c->t0, c->p);
+	mpz_sub(c->t1, Q->y, P->y);
+	mpz_mul(c->t2, c->t1, c->t0);
+	mpz_mod(c->t2, c->t2, c->p);
+	/* x3 = lambda^2 - xP - xQ, y3 = lambda (xP - x3) - yP */
+	mpz_mul(c->t3, c->t2, c->t2);
+	mpz_sub(c->t3, c->t3, P->x);
+	mpz_sub(c->t3, c->t3, Q->x);
+	mpz_mod(c->t3, c->t3, c->p);
+	mpz_sub(c->t1, P->x, c->t3);
+	mpz_mul(c->t1, c->t1, c->t2);
+	mpz_sub(c->t1, c->t1, P->y);
+	mpz_mod(R->y, c->t1, c->p);
+	mpz_swap(R->x, c->t3);
+	R->inf = false;
+}
+
+/* Jacobian coordinates (X : Y : Z) = (X/Z^2, Y/Z^3), the null point
+ * when Z = 0, only used inside pt_mul() to save the inversions */
+typedef struct {
+	mpz_t X, Y, Z;
+	mpz_t t[6];
+} jac_t;
+
+static void jac_dbl(crv_t *c, jac_t *J)
+{
+	mpz_t *t = J->t;
+
+	if ((mpz_sgn(J->Z) == 0) || (mpz_sgn(J->Y) == 0)) {
+		mpz_set_ui(J->Z, 0);
+		return;
+	}
+	/* S = 4.X.Y^2, M = 3.X^2 + a.Z^4 */
+	mpz_mul(t[0], J->Y, J->Y);
+	mpz_mod(t[0], t[0], c->p);
+	mpz_mul(t[1], J->X, t[0]);
+	mpz_mul_2exp(t[1], t[1], 2);
+	mpz_mod(t[1], t[1], c->p);
+	mpz_mul(t[2], J->Z, J->Z);
+	mpz_mod(t[2], t[2], c->p);
+	mpz_mul(t[2], t[2], t[2]);
+	mpz_mod(t[2], t[2], c->p);
+	mpz_mul(t[2], t[2], c->a);
+	mpz_mul(t[3], J->X, J->X);
+	mpz_addmul_ui(t[2], t[3], 3);
+	mpz_mod(t[2], t[2], c->p);
+	/* Z3 = 2.Y.Z */
+	mpz_mul(J->Z, J->Z, J->Y);
+	mpz_mul_2exp(J->Z, J->Z, 1);
+	mpz_mod(J->Z, J->Z, c->p);
+	/* X3 = M^2 - 2.S, Y3 = M.(S - X3) - 8.Y^4 */
+	mpz_mul(J->X, t[2], t[2]);
+	mpz_submul_ui(J->X, t[1], 2);
+	mpz_mod(J->X, J->X, c->p);
+	mpz_sub(t[1], t[1], J->X);
+	mpz_mul(J->Y, t[2], t[1]);
+	mpz_mul(t[0], t[0], t[0]);
+	mpz_submul_ui(J->Y, t[0], 8);
+	mpz_mod(J->Y, J->Y, c->p);
+}
+
+/* J = J + P, P in affine coordinates & not the null point */
+static void jac_add_affine(crv_t *c, jac_t *J, const pt_t *P)
+{
+	mpz_t *t = J->t;
+
+	if (mpz_sgn(J->Z) == 0) {
+		mpz_set(J->X, P->x);
+		mpz_set(J->Y, P->y);
+		mpz_set_ui(J->Z, 1);
+		return;
+	}
+	/* H = x.Z^2 - X, r = y.Z^3 - Y */
+	mpz_mul(t[0], J->Z, J->Z);
+	mpz_mod(t[0], t[0], c->p);
+	mpz_mul(t[1], P->x, t[0]);
+	mpz_sub(t[1], t[1], J->X);
+	mpz_mod(t[1], t[1], c->p);
+	mpz_mul(t[2], t[0], J->Z);
+	mpz_mod(t[2], t[2], c->p);
+	mpz_mul(t[2], t[2], P->y);
+	mpz_sub(t[2], t[2], J->Y);
+	mpz_mod(t[2], t[2], c->p);
+	if (mpz_sgn(t[1]) == 0) {
+		if (mpz_sgn(t[2]) == 0) {
+			jac_dbl(c, J);
+		} else {
+			mpz_set_ui(J->Z, 0);
+		}
+		return;
+	}
+	/* Z3 = Z.H, V = X.H^2, X3 = r^2 - H^3 - 2.V, Y3 = r.(V - X3) - Y.H^3 */
+	mpz_mul(J->Z, J->Z, t[1]);
+	mpz_mod(J->Z, J->Z, c->p);
+	mpz_mul(t[3], t[1], t[1]);
+	mpz_mod(t[3], t[3], c->p);
+	mpz_mul(t[4], t[3], t[1]);
+	mpz_mod(t[4], t[4], c->p);
+	mpz_mul(t[5], J->X, t[3]);
+	mpz_mod(t[5], t[5], c->p);
+	mpz_mul(J->X, t[2], t[2]);
+	mpz_sub(J->X, J->X, t[4]);
+	mpz_submul_ui(J->X, t[5], 2);
+	mpz_mod(J->X, J->X, c->p);
+	mpz_sub(t[5], t[5], J->X);
+	mpz_mul(t[5], t[5], t[2]);
+	mpz_mul(t[4], t[4], J->Y);
+	mpz_sub(J->Y, t[5], t[4]);
+	mpz_mod(J->Y, J->Y, c->p);
+}
+
+/* [k]P (k >= 0), double-and-add */
+static void pt_mul(crv_t *c, pt_t *R, const mpz_t k, const pt_t *P)
+{
+	jac_t J;
+	long i;
+	unsigned int j;
+
+	if (P->inf || (mpz_sgn(k) == 0)) {
+		R->inf = true;
+		return;
+	}
+	mpz_inits(J.X, J.Y, J.Z, NULL);
+	for (j = 0; j < 6; j++) {
+		mpz_init(J.t[j]);
+	}
+	for (i = (long)mpz_sizeinbase(k, 2) - 1; i >= 0; i--) {
+		jac_dbl(c, &J);
+		if (mpz_tstbit(k, (mp_bitcnt_t)i)) {
+			jac_add_affine(c, &J, P);
+		}
+	}
+	if (mpz_sgn(J.Z) == 0) {
+		R->inf = true;
+	} else {
+		/* back to affine coordinates */
+		mpz_invert(J.t[0], J.Z, c->p);
+		mpz_mul(J.t[1], J.t[0], J.t[0]);
+		mpz_mod(J.t[1], J.t[1], c->p);
+		mpz_mul(R->x, J.X, J.t[1]);
+		mpz_mod(R->x, R->x, c->p);
+		mpz_mul(J.t[1], J.t[1], J.t[0]);
+		mpz_mul(R->y, J.Y, J.t[1]);
+		mpz_mod(R->y, R->y, c->p);
+		R->inf = false;
+	}
+	for (j = 0; j < 6; j++) {
+		mpz_clear(J.t[j]);
+	}
+	mpz_clears(J.X, J.Y, J.Z, NULL);
+}
+
+static void pt_mul_ui(crv_t *c, pt_t *R, unsigned long k, const pt_t *P)
+{
+	mpz_t kk;
+
+	mpz_init_set_ui(kk, k);
+	pt_mul(c, R, kk, P);
+	mpz_clear(kk);
+}
+
+/* Random point of the curve (the null point is drawn with
+ * probability 1/(p+1), as with SageMath's random_element()) */
+static void pt_random(crv_t *c, pt_t *R)
+{
+	for (;;) {
+		mpz_add_ui(c->t1, c->p, 1);
+		mpz_urandomm(R->x, c->rnd, c->t1);
+		if (mpz_cmp(R->x, c->p) == 0) {
+			R->inf = true;
+			return;
+		}
+		/* x^3 + ax + b */
+		mpz_mul(c->t0, R->x, R->x);
+		mpz_add(c->t0, c->t0, c->a);
+		mpz_mul(c->t0, c->t0, R->x);
+		mpz_add(c->t0, c->t0, c->b);
+		mpz_mod(c->t0, c->t0, c->p);
+		if (mpz_sgn(c->t0) == 0) {
+			mpz_set_ui(R->y, 0);
+			R->inf = false;
+			return;
+		}
+		if (mpz_jacobi(c->t0, c->p) == 1) {
+			/* p is a safe prime, hence p = 3 mod 4 */
+			mpz_add_ui(c->t1, c->p, 1);
+			mpz_fdiv_q_2exp(c->t1, c->t1, 2);
+			mpz_powm(R->y, c->t0, c->t1, c->p);
+			if (toss_a_coin(c)) {
+				mpz_sub(R->y, c->p, R->y);
+			}
+			R->inf = false;
+			return;
+		}
+	}
+}
+
+static bool pt_oncurve(crv_t *c, const mpz_t x, const mpz_t y)
+{
+	mpz_mul(c->t0, x, x);
+	mpz_add(c->t0, c->t0, c->a);
+	mpz_mul(c->t0, c->t0, x);
+	mpz_add(c->t0, c->t0, c->b);
+	mpz_submul(c->t0, y, y);
+	return mpz_divisible_p(c->t0, c->p);
+}
+
+/* ------------------------------------------------------------------
+ * Factorization (trial division & Pollard-Brent rho), only ever used
+ * on numbers of at most NN_LIMIT_COMPUTE_Q_MAX + 2 bits
+ * ------------------------------------------------------------------ */
+
+static void fac_init(fac_t *F)
+{
+	unsigned int i;
+
+	for (i = 0; i < MAX_FACTORS; i++) {
+		mpz_init(F->f[i]);
+	}
+	F->nb = 0;
+}
+
+static void fac_clear(fac_t *F)
+{
+	unsigned int i;
+
+	for (i = 0; i < MAX_FACTORS; i++) {
+		mpz_clear(F->f[i]);
+	}
+}
+
+/* Add prime f (with multiplicity e), factors being kept in ascending order */
+static void fac_add(fac_t *F, const mpz_t f, unsigned int e)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < F->nb; i++) {
+		if (mpz_cmp(F->f[i], f) == 0) {
+			F->e[i] += e;
+			return;
+		}
+		if (mpz_cmp(F->f[i], f) > 0) {
+			break;
+		}
+	}
+	for (j = F->nb; j > i; j--) {
+		mpz_set(F->f[j], F->f[j - 1]);
+		F->e[j] = F->e[j - 1];
+	}
+	mpz_set(F->f[i], f);
+	F->e[i] = e;
+	F->nb++;
+}
+
+static void rho(mpz_t d, const mpz_t n, unsigned long cst)
+{
+	mpz_t x, y, ys, q, t;
+	unsigned long r, k, i, m = 128;
+
+	mpz_inits(x, y, ys, q, t, NULL);
+	mpz_set_ui(y, 2);
+	mpz_set_ui(q, 1);
+	mpz_set_ui(d, 1);
+	for (r = 1; mpz_cmp_ui(d, 1) == 0; r <<= 1) {
+		mpz_set(x, y);
+		for (i = 0; i < r; i++) {
+			mpz_mul(y, y, y);
+			mpz_add_ui(y, y, cst);
+			mpz_mod(y, y, n);
+		}
+		for (k = 0; (k < r) && (mpz_cmp_ui(d, 1) == 0); k += m) {
+			mpz_set(ys, y);
+			for (i = 0; (i < m) && (i < r - k); i++) {
+				mpz_mul(y, y, y);
+				mpz_add_ui(y, y, cst);
+				mpz_mod(y, y, n);
+				mpz_sub(t, x, y);
+				mpz_mul(q, q, t);
+				mpz_mod(q, q, n);
+			}
+			mpz_gcd(d, q, n);
+		}
+	}
+	if (mpz_cmp(d, n) == 0) {
+		/* backtrack from the last saved value */
+		do {
+			mpz_mul(ys, ys, ys);
+			mpz_add_ui(ys, ys, cst);
+			mpz_mod(ys, ys, n);
+			mpz_sub(t, x, ys);
+			mpz_gcd(d, t, n);
+		} while (mpz_cmp_ui(d, 1) == 0);
+	}
+	mpz_clears(x, y, ys, q, t, NULL);
+}
+
+static void factor_rec(fac_t *F, const mpz_t n)
+{
+	mpz_t d, m;
+	unsigned long cst;
+
+	if (mpz_cmp_ui(n, 1) == 0) {
+		return;
+	}
+	if (mpz_probab_prime_p(n, 25)) {
+		fac_add(F, n, 1);
+		return;
+	}
+	mpz_inits(d, m, NULL);
+	for (cst = 1; ; cst++) {
+		rho(d, n, cst);
+		if (mpz_cmp(d, n) != 0) {
+			break;
+		}
+	}
+	mpz_divexact(m, n, d);
+	factor_rec(F, d);
+	factor_rec(F, m);
+	mpz_clears(d, m, NULL);
+}
+
+static void factor(fac_t *F, const mpz_t n)
+{
+	mpz_t m, f;
+	unsigned int i, e;
+
+	mpz_init_set(m, n);
+	mpz_init(f);
+	F->nb = 0;
+	for (i = 0; i < sizeof(small_primes) / sizeof(small_primes[0]); i++) {
+		for (e = 0; mpz_divisible_ui_p(m, small_primes[i]); e++) {
+			mpz_divexact_ui(m, m, small_primes[i]);
+		}
+		if (e) {
+			mpz_set_ui(f, small_primes[i]);
+			fac_add(F, f, e);
+		}
+	}
+	factor_rec(F, m);
+	mpz_clears(m, f, NULL);
+}
+
+/* Order of P knowing a multiple m of it, with factors of the order in F */
+static void pt_order(crv_t *c, mpz_t o, fac_t *F, const pt_t *P, const mpz_t m)
+{
+	fac_t M;
+	mpz_t t;
+	pt_t R;
+	unsigned int i, j;
+
+	fac_init(&M);
+	mpz_init(t);
+	pt_init(&R);
+	factor(&M, m);
+	mpz_set(o, m);
+	F->nb = 0;
+	for (i = 0; i < M.nb; i++) {
+		for (j = 0; j < M.e[i]; j++) {
+			mpz_divexact(t, o, M.f[i]);
+			pt_mul(c, &R, t, P);
+			if (!R.inf) {
+				break;
+			}
+			mpz_set(o, t);
+		}
+		if (j < M.e[i]) {
+			fac_add(F, M.f[i], M.e[i] - j);
+		}
+	}
+	pt_clear(&R);
+	mpz_clear(t);
+	fac_clear(&M);
+}
+
+/* ------------------------------------------------------------------
+ * Order of the curve: baby-step giant-step search of a multiple of the
+ * order of random points in the Hasse interval, until the lcm of these
+ * orders has only one multiple in it
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	uint64_t key;
+	uint32_t j;
+} bsgs_ent_t;
+
+static uint64_t bsgs_key(const mpz_t x)
+{
+	return (mpz_sgn(x) == 0) ? 0 : (uint64_t)mpz_getlimbn(x, 0);
+}
+
+/* Find i in [0, n) such that R + [i]Q = 0 */
+static bool bsgs(crv_t *c, mpz_t i, const pt_t *R, const pt_t *Q, const mpz_t n)
+{
+	bsgs_ent_t *tab;
+	pt_t B, T, S, J;
+	unsigned long s, j, g, sz, h;
+	bool found = false;
+
+	mpz_sqrt(c->t0, n);
+	s = mpz_get_ui(c->t0) + 1;
+	for (sz = 2; sz < 2 * s; sz <<= 1)
+		;
+	tab = calloc(sz, sizeof(bsgs_ent_t));
+	if (tab == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	pt_init(&B);
+	pt_init(&T);
+	pt_init(&S);
+	pt_init(&J);
+	/* baby steps [j]Q, 0 < j < s (j = 0 is the null point) */
+	pt_set(&B, Q);
+	for (j = 1; j < s; j++) {
+		if (!B.inf) {
+			for (h = bsgs_key(B.x) & (sz - 1); tab[h].j; h = (h + 1) & (sz - 1))
+				;
+			tab[h].key = bsgs_key(B.x);
+			tab[h].j = (uint32_t)j;
+		}
+		pt_add(c, &B, &B, Q);
+	}
+	/* giant steps: [j]Q = -R - [g.s]Q */
+	pt_neg(c, &S, &B);
+	pt_neg(c, &T, R);
+	for (g = 0; !found && (mpz_cmp_ui(n, g * s) > 0); g++) {
+		if (T.inf) {
+			mpz_set_ui(i, g * s);
+			found = true;
+			break;
+		}
+		for (h = bsgs_key(T.x) & (sz - 1); tab[h].j; h = (h + 1) & (sz - 1)) {
+			if (tab[h].key != bsgs_key(T.x)) {
+				continue;
+			}
+			pt_mul_ui(c, &J, tab[h].j, Q);
+			if (pt_eq(&J, &T)) {
+				mpz_set_ui(i, g * s + tab[h].j);
+				found = (mpz_cmp(i, n) < 0);
+				break;
+			}
+		}
+		pt_add(c, &T, &T, &S);
+	}
+	pt_clear(&B);
+	pt_clear(&T);
+	pt_clear(&S);
+	pt_clear(&J);
+	free(tab);
+	return found;
+}
+
+static bool crv_order(crv_t *c)
+{
+	mpz_t lo, hi, L, m0, n, i, o;
+	pt_t P, Q, R;
+	fac_t F;
+	unsigned int tries;
+	bool ok = false;
+
+	mpz_inits(lo, hi, L, m0, n, i, o, NULL);
+	pt_init(&P);
+	pt_init(&Q);
+	pt_init(&R);
+	fac_init(&F);
+	/* Hasse interval [p + 1 - 2sqrt(p), p + 1 + 2sqrt(p)] */
+	mpz_mul_2exp(lo, c->p, 2);
+	mpz_sqrt(lo, lo);
+	mpz_add_ui(hi, c->p, 1);
+	mpz_add(hi, hi, lo);
+	mpz_add_ui(m0, c->p, 1);
+	mpz_sub(lo, m0, lo);
+	mpz_set_ui(L, 1);
+	for (tries = 0; tries < 32; tries++) {
+		/* multiples of L in the interval: m0 + i.L, 0 <= i < n */
+		mpz_cdiv_q(m0, lo, L);
+		mpz_mul(m0, m0, L);
+		if (mpz_cmp(m0, hi) > 0) {
+			break;
+		}
+		mpz_sub(n, hi, m0);
+		mpz_fdiv_q(n, n, L);
+		mpz_add_ui(n, n, 1);
+		if (mpz_cmp_ui(n, 1) == 0) {
+			mpz_set(c->q, m0);
+			ok = true;
+			break;
+		}
+		pt_random(c, &P);
+		if (P.inf) {
+			continue;
+		}
+		pt_mul(c, &Q, L, &P);
+		pt_mul(c, &R, m0, &P);
+		if (!bsgs(c, i, &R, &Q, n)) {
+			break;
+		}
+		mpz_addmul(m0, i, L);
+		pt_order(c, o, &F, &P, m0);
+		mpz_lcm(L, L, o);
+	}
+	fac_clear(&F);
+	pt_clear(&P);
+	pt_clear(&Q);
+	pt_clear(&R);
+	mpz_clears(lo, hi, L, m0, n, i, o, NULL);
+	return ok;
+}
+
+/* ------------------------------------------------------------------
+ * Curve
+ * ------------------------------------------------------------------ */
+
+/* Random safe prime of exactly nbits bits (as rdp() of generate-tests.sage) */
+static void rdp(crv_t *c, unsigned int nbits)
+{
+	mpz_t r;
+	unsigned int i, sp;
+
+	mpz_init(r);
+	for (;;) {
+		/* p = 2r + 1, r odd of nbits - 1 bits */
+		mpz_urandomb(r, c->rnd, nbits - 2);
+		mpz_setbit(r, nbits - 2);
+		mpz_setbit(r, 0);
+		for (i = 1; i < sizeof(small_primes) / sizeof(small_primes[0]); i++) {
+			sp = small_primes[i];
+			if ((mpz_cmp_ui(r, sp) > 0) &&
+					((mpz_fdiv_ui(r, sp) == 0) || (mpz_fdiv_ui(r, sp) == (sp - 1) / 2))) {
+				break;
+			}
+		}
+		if (i < sizeof(small_primes) / sizeof(small_primes[0])) {
+			continue;
+		}
+		mpz_mul_2exp(c->p, r, 1);
+		mpz_add_ui(c->p, c->p, 1);
+		if (mpz_probab_prime_p(r, 25) && mpz_probab_prime_p(c->p, 25)) {
+			break;
+		}
+	}
+	mpz_clear(r);
+}
+
+static void crv_init(crv_t *c, unsigned long index)
+{
+	mpz_t s;
+
+	mpz_inits(c->p, c->a, c->b, c->q, c->t0, c->t1, c->t2, c->t3, NULL);
+	/* random state of the curve only depends on the seed & on its index */
+	mpz_init_set_ui(s, cfg.seed);
+	mpz_mul_2exp(s, s, 64);
+	mpz_add_ui(s, s, index);
+	gmp_randinit_mt(c->rnd);
+	gmp_randseed(c->rnd, s);
+	mpz_clear(s);
+}
+
+static void crv_clear(crv_t *c)
+{
+	gmp_randclear(c->rnd);
+	mpz_clears(c->p, c->a, c->b, c->q, c->t0, c->t1, c->t2, c->t3, NULL);
+}
+
+/* Range [nnmin : nnmax] from which nn of curve #index is drawn */
+static void nn_range(unsigned long index, unsigned int *nnmin, unsigned int *nnmax)
+{
+	unsigned long i;
+
+	*nnmax = cfg.nnmaxabsolute;
+	*nnmin = cfg.nnmaxabsolute - 32;
+	for (i = 1; i <= index; i++) {
+		if ((i % NNMAXMOD) == NNMAXMOD - 1) {
+			*nnmax = (*nnmax < cfg.nnmaxmin + NNMAXDECR) ? cfg.nnmaxmin : *nnmax - NNMAXDECR;
+		}
+		if ((i % NNMINMOD) == NNMINMOD - 1) {
+			*nnmin = (*nnmin < cfg.nnminmin + NNMINDECR) ? cfg.nnminmin : *nnmin - NNMINDECR;
+		}
+		if ((*nnmax == cfg.nnmaxmin) && (*nnmin == cfg.nnminmin)) {
+			break;
+		}
+	}
+}
+
+/* ------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------ */
+
+#define WIDTH(c)  ((int)(((c)->nn + 3) / 4))
+
+static void pr_val(FILE *f, crv_t *c, const char *name, const mpz_t v)
+{
+	gmp_fprintf(f, "%s=0x%0*Zx\n", name, WIDTH(c), v);
+}
+
+/* "<name>=0" for the null point, "<name>x=0x..." & "<name>y=0x..." otherwise */
+static void pr_pt(FILE *f, crv_t *c, const char *name, const pt_t *P)
+{
+	if (P->inf) {
+		fprintf(f, "%s=0\n", name);
+	} else {
+		gmp_fprintf(f, "%sx=0x%0*Zx\n%sy=0x%0*Zx\n", name, WIDTH(c), P->x, name, WIDTH(c), P->y);
+	}
+}
+
+/* Test number is left blank, it is filled in by write_curve() */
+static void pr_test(FILE *f, const char *op, unsigned long index)
+{
+	fprintf(f, "== TEST %s #%lu.\n", op, index);
+}
+
+static void pr_bool(FILE *f, bool b)
+{
+	fprintf(f, "%s\n", b ? "true" : "false");
+}
+
+static void pr_nbbld(FILE *f, crv_t *c)
+{
+	if (c->hasq && toss_a_coin(c)) {
+		fprintf(f, "nbbld=%lu\n", rnd_int(c, 1, c->nn - 1));
+	}
+}
+
+/* Exception tests [k]P with k = fac + a random multiple of the power-of-2
+ * just above fac (fsP being a point of order fac) */
+static void gen_kp_factor_cpl(FILE *f, crv_t *c, unsigned long index, const mpz_t fac, const pt_t *fsP)
+{
+	mpz_t cpl, k;
+	pt_t R;
+	unsigned int nbits = (unsigned int)mpz_sizeinbase(fac, 2);
+
+	mpz_inits(cpl, k, NULL);
+	pt_init(&R);
+	pr_test(f, "[k]P", index);
+	fprintf(f, "# EXCEPTION: k = a factor of P's order + a nb aligned on a higher power-of-2\n");
+	mpz_urandomb(cpl, c->rnd, (nbits < c->nn) ? c->nn - nbits : 0);
+	mpz_mul_2exp(cpl, cpl, nbits);
+	mpz_add(k, fac, cpl);
+	gmp_fprintf(f, "#    factor = 0x%0*Zx (%u bits)\n", WIDTH(c), fac, nbits);
+	gmp_fprintf(f, "#complement = 0x%0*Zx\n", WIDTH(c), cpl);
+	gmp_fprintf(f, "#         k = 0x%0*Zx\n", WIDTH(c), k);
+	pr_pt(f, c, "P", fsP);
+	pr_val(f, c, "k", k);
+	pt_mul(c, &R, k, fsP);
+	pr_pt(f, c, "kP", &R);
+	pt_clear(&R);
+	mpz_clears(cpl, k, NULL);
+}
+
+static void gen_exceptions(FILE *f, crv_t *c, unsigned long index)
+{
+	pt_t P, R, fsP;
+	mpz_t k, o, fs, t;
+	fac_t F;
+	unsigned int i;
+
+	pt_init(&P);
+	pt_init(&R);
+	pt_init(&fsP);
+	mpz_inits(k, o, fs, t, NULL);
+	fac_init(&F);
+	pt_random(c, &P);
+	/*
+	 * [k]P exceptions
+	 */
+	if (c->hasq) {
+		/* k = q */
+		pr_test(f, "[k]P", index);
+		fprintf(f, "# EXCEPTION: k = q\n");
+		pr_pt(f, c, "P", &P);
+		pr_val(f, c, "k", c->q);
+		pr_nbbld(f, c);
+		fprintf(f, "kP=0\n");
+		/* k = q + 1 (unless it would not fit in nn bits) */
+		mpz_add_ui(k, c->q, 1);
+		if (mpz_sizeinbase(k, 2) <= c->nn) {
+			pt_mul(c, &R, k, &P);
+			pr_test(f, "[k]P", index);
+			fprintf(f, "# EXCEPTION: k = q + 1\n");
+			pr_pt(f, c, "P", &P);
+			pr_val(f, c, "k", k);
+			pr_nbbld(f, c);
+			pr_pt(f, c, "kP", &R);
+		}
+		/* k = q - 1 */
+		mpz_sub_ui(k, c->q, 1);
+		pt_mul(c, &R, k, &P);
+		pr_test(f, "[k]P", index);
+		fprintf(f, "# EXCEPTION: k = q - 1\n");
+		pr_pt(f, c, "P", &P);
+		pr_val(f, c, "k", k);
+		pr_nbbld(f, c);
+		pr_pt(f, c, "kP", &R);
+		/* factors of the order of P (none if P is the null point) */
+		pt_order(c, o, &F, &P, c->q);
+		if ((F.nb > 1) || ((F.nb == 1) && (F.e[0] > 1))) {
+			/* k = a factor of P's order (no blinding, it would change the
+			 * scalar & the null point wouldn't be met anymore) */
+			for (i = 0; i < F.nb; i++) {
+				mpz_divexact(fs, o, F.f[i]);
+				pt_mul(c, &fsP, fs, &P);
+				pr_test(f, "[k]P", index);
+				fprintf(f, "# EXCEPTION: k = a factor of P's order\n");
+				pr_pt(f, c, "P", &fsP);
+				pr_val(f, c, "k", F.f[i]);
+				fprintf(f, "kP=0\n");
+			}
+			/* k = a factor of P's order + a multiple of the next power-of-2
+			 * (the null point is met but isn't the final result) */
+			for (i = 0; i < F.nb; i++) {
+				mpz_divexact(fs, o, F.f[i]);
+				pt_mul(c, &fsP, fs, &P);
+				gen_kp_factor_cpl(f, c, index, F.f[i], &fsP);
+				if ((F.e[i] > 1) && (mpz_cmp_ui(F.f[i], 2) > 0)) {
+					/* same with the full power of a multiple factor */
+					mpz_pow_ui(t, F.f[i], F.e[i]);
+					mpz_divexact(fs, o, t);
+					pt_mul(c, &fsP, fs, &P);
+					gen_kp_factor_cpl(f, c, index, t, &fsP);
+				}
+			}
+		}
+	}
+	if (rnd_int(c, 1, 16) == 16) {
+		pr_test(f, "[k]P", index);
+		fprintf(f, "# EXCEPTION: k = 0\n");
+		pr_pt(f, c, "P", &P);
+		mpz_set_ui(k, 0);
+		pr_val(f, c, "k", k);
+		fprintf(f, "kP=0\n");
+	}
+	if (rnd_int(c, 1, 16) == 16) {
+		/* k in [1 : 2^(nn - 1)] */
+		mpz_urandomb(k, c->rnd, c->nn - 1);
+		mpz_add_ui(k, k, 1);
+		pr_test(f, "[k]P", index);
+		fprintf(f, "# EXCEPTION: P = 0\n");
+		fprintf(f, "P=0\n");
+		pr_val(f, c, "k", k);
+		fprintf(f, "kP=0\n");
+	}
+	if (rnd_int(c, 1, 16) == 16) {
+		pr_test(f, "[k]P", index);
+		fprintf(f, "# EXCEPTION: k = 0 and P = 0\n");
+		fprintf(f, "P=0\n");
+		mpz_set_ui(k, 0);
+		pr_val(f, c, "k", k);
+		fprintf(f, "kP=0\n");
+	}
+	/*
+	 * P + Q exceptions
+	 */
+	pt_neg(c, &R, &P);
+	if (!P.inf) {
+		pr_test(f, "P+Q", index);
+		fprintf(f, "# EXCEPTION: P = Q\n");
+		pr_pt(f, c, "P", &P);
+		pr_pt(f, c, "Q", &P);
+		pt_dbl(c, &fsP, &P);
+		pr_pt(f, c, "PplusQ", &fsP);
+		pr_test(f, "P+Q", index);
+		fprintf(f, "# EXCEPTION: P = -Q\n");
+		pr_pt(f, c, "P", &P);
+		pr_pt(f, c, "Q", &R);
+		fprintf(f, "PplusQ=0\n");
+		pr_test(f, "P+Q", index);
+		fprintf(f, "# EXCEPTION: P = 0, Q /= 0\n");
+		fprintf(f, "P=0\n");
+		pr_pt(f, c, "Q", &P);
+		pr_pt(f, c, "PplusQ", &P);
+		pr_test(f, "P+Q", index);
+		fprintf(f, "# EXCEPTION: Q = 0, P /= 0\n");
+		pr_pt(f, c, "P", &P);
+		fprintf(f, "Q=0\n");
+		pr_pt(f, c, "PplusQ", &P);
+	}
+	pr_test(f, "P+Q", index);
+	fprintf(f, "# EXCEPTION: P = Q = 0\nP=0\nQ=0\nPplusQ=0\n");
+	/*
+	 * [2]P exceptions
+	 */
+	pr_test(f, "[2]P", index);
+	fprintf(f, "# EXCEPTION: P = 0\nP=0\ntwoP=0\n");
+	if (c->hasq && (F.nb > 0) && (mpz_cmp_ui(F.f[0], 2) == 0)) {
+		/* 2-torsion point */
+		mpz_divexact_ui(fs, o, 2);
+		pt_mul(c, &fsP, fs, &P);
+		pr_test(f, "[2]P", index);
+		fprintf(f, "# EXCEPTION: P = 2-torsion\n");
+		pr_pt(f, c, "P", &fsP);
+		fprintf(f, "twoP=0\n");
+		pr_test(f, "P+Q", index);
+		fprintf(f, "# EXCEPTION: P = Q = 2-torsion\n");
+		pr_pt(f, c, "P", &fsP);
+		pr_pt(f, c, "Q", &fsP);
+		fprintf(f, "PplusQ=0\n");
+		pr_test(f, "isP==-Q", index);
+		fprintf(f, "# EXCEPTION: P = Q = 2-torsion\n");
+		pr_pt(f, c, "P", &fsP);
+		pr_pt(f, c, "Q", &fsP);
+		fprintf(f, "true\n");
+	}
+	/*
+	 * P == Q exceptions
+	 */
+	pr_test(f, "isP==Q", index);
+	fprintf(f, "# EXCEPTION: P = -Q\n");
+	pr_pt(f, c, "P", &P);
+	pr_pt(f, c, "Q", &R);
+	pr_bool(f, pt_eq(&P, &R));
+	if (!P.inf) {
+		pr_test(f, "isP==Q", index);
+		fprintf(f, "# EXCEPTION: P = 0, Q != 0\nP=0\n");
+		pr_pt(f, c, "Q", &P);
+		fprintf(f, "false\n");
+		pr_test(f, "isP==Q", index);
+		fprintf(f, "# EXCEPTION: P != 0, Q = 0\n");
+		pr_pt(f, c, "P", &P);
+		fprintf(f, "Q=0\nfalse\n");
+	}
+	pr_test(f, "isP==Q", index);
+	fprintf(f, "# EXCEPTION: P = Q = 0\nP=0\nQ=0\ntrue\n");
+	/*
+	 * P == -Q exceptions
+	 */
+	if (!P.inf && !pt_eq(&P, &R)) {
+		pr_test(f, "isP==-Q", index);
+		fprintf(f, "# EXCEPTION: P = Q & P != -Q\n");
+		pr_pt(f, c, "P", &P);
+		pr_pt(f, c, "Q", &P);
+		fprintf(f, "false\n");
+		pr_test(f, "isP==-Q", index);
+		fprintf(f, "# EXCEPTION: P = -Q & P != Q\n");
+		pr_pt(f, c, "P", &P);
+		pr_pt(f, c, "Q", &R);
+		fprintf(f, "true\n");
+	}
+	if (!P.inf) {
+		pr_test(f, "isP==-Q", index);
+		fprintf(f, "# EXCEPTION: P = 0, Q != 0\nP=0\n");
+		pr_pt(f, c, "Q", &P);
+		fprintf(f, "false\n");
+		pr_test(f, "isP==-Q", index);
+		fprintf(f, "# EXCEPTION: P != 0, Q = 0\n");
+		pr_pt(f, c, "P", &P);
+		fprintf(f, "Q=0\nfalse\n");
+	}
+	pr_test(f, "isP==-Q", index);
+	fprintf(f, "# EXCEPTION: P = Q = 0\nP=0\nQ=0\ntrue\n");
+	/*
+	 * -P exceptions
+	 */
+	pr_test(f, "-P", index);
+	fprintf(f, "# EXCEPTION: P = 0\nP=0\nnegP=0\n");
+	fac_clear(&F);
+	mpz_clears(k, o, fs, t, NULL);
+	pt_clear(&P);
+	pt_clear(&R);
+	pt_clear(&fsP);
+}
+
+/* Curve #index along with all its tests */
+static void gen_curve(FILE *f, unsigned long index)
+{
+	crv_t c;
+	pt_t P, Q, R;
+	mpz_t k;
+	unsigned int i, nnmin, nnmax, nn;
+	bool b;
+
+	crv_init(&c, index);
+	pt_init(&P);
+	pt_init(&Q);
+	pt_init(&R);
+	mpz_init(k);
+	if (cfg.nn_constant) {
+		nn = cfg.nn_constant;
+	} else if (index == 0) {
+		/* the first curve is forced to nn = nnmaxabsolute */
+		nn = cfg.nnmaxabsolute;
+	} else {
+		nn_range(index, &nnmin, &nnmax);
+		nn = (unsigned int)rnd_int(&c, nnmin, nnmax);
+	}
+	c.hasq = (cfg.nn_limit_compute_q != 0) && (nn <= cfg.nn_limit_compute_q);
+	for (;;) {
+		rdp(&c, nn);
+		/* 4a^3 + 27b^2 != 0 */
+		do {
+			mpz_urandomm(c.a, c.rnd, c.p);
+			mpz_urandomm(c.b, c.rnd, c.p);
+			mpz_powm_ui(c.t0, c.a, 3, c.p);
+			mpz_mul_ui(c.t0, c.t0, 4);
+			mpz_mul(c.t1, c.b, c.b);
+			mpz_addmul_ui(c.t0, c.t1, 27);
+		} while (mpz_divisible_p(c.t0, c.p));
+		if (!c.hasq) {
+			mpz_set_ui(c.q, 1);
+			break;
+		}
+		if (!crv_order(&c)) {
+			/* (non-cyclic group of too small exponent) */
+			continue;
+		}
+		/* nn must be equal to max(log2(p), log2(q)) */
+		mpz_sub_ui(c.t0, c.q, 1);
+		if ((unsigned int)mpz_sizeinbase(c.t0, 2) <= cfg.nnmaxabsolute) {
+			break;
+		}
+	}
+	c.nn = nn;
+	if (c.hasq) {
+		mpz_sub_ui(c.t0, c.q, 1);
+		if ((unsigned int)mpz_sizeinbase(c.t0, 2) > c.nn) {
+			c.nn = (unsigned int)mpz_sizeinbase(c.t0, 2);
+		}
+	}
+	fprintf(f, "== NEW CURVE #%lu\nnn=%u\n", index, c.nn);
+	pr_val(f, &c, "p", c.p);
+	pr_val(f, &c, "a", c.a);
+	pr_val(f, &c, "b", c.b);
+	pr_val(f, &c, "q", c.q);
+	/* [k]P */
+	for (i = 0; i < cfg.nbkp; i++) {
+		pt_random(&c, &P);
+		mpz_urandomb(k, c.rnd, c.nn);
+		pt_mul(&c, &R, k, &P);
+		pr_test(f, "[k]P", index);
+		pr_pt(f, &c, "P", &P);
+		pr_val(f, &c, "k", k);
+		if (!cfg.only_kp_and_no_blinding) {
+			pr_nbbld(f, &c);
+		}
+		pr_pt(f, &c, "kP", &R);
+	}
+	if (cfg.only_kp_and_no_blinding) {
+		goto end;
+	}
+	/* P + Q */
+	for (i = 0; i < cfg.nbadd; i++) {
+		pt_random(&c, &P);
+		pt_random(&c, &Q);
+		pt_add(&c, &R, &P, &Q);
+		pr_test(f, "P+Q", index);
+		pr_pt(f, &c, "P", &P);
+		pr_pt(f, &c, "Q", &Q);
+		pr_pt(f, &c, "PplusQ", &R);
+	}
+	/* [2]P */
+	for (i = 0; i < cfg.nbdbl; i++) {
+		pt_random(&c, &P);
+		pt_dbl(&c, &R, &P);
+		pr_test(f, "[2]P", index);
+		pr_pt(f, &c, "P", &P);
+		pr_pt(f, &c, "twoP", &R);
+	}
+	/* -P */
+	for (i = 0; i < cfg.nbneg; i++) {
+		pt_random(&c, &P);
+		pt_neg(&c, &R, &P);
+		pr_test(f, "-P", index);
+		pr_pt(f, &c, "P", &P);
+		pr_pt(f, &c, "negP", &R);
+	}
+	/* is P on curve (half of the points being random couples) */
+	for (i = 0; i < cfg.nbchk; i++) {
+		pr_test(f, "isPoncurve", index);
+		if (toss_a_coin(&c)) {
+			pt_random(&c, &P);
+			pr_pt(f, &c, "P", &P);
+			b = true;
+		} else {
+			mpz_urandomm(P.x, c.rnd, c.p);
+			mpz_urandomm(P.y, c.rnd, c.p);
+			P.inf = false;
+			pr_pt(f, &c, "P", &P);
+			b = pt_oncurve(&c, P.x, P.y);
+		}
+		pr_bool(f, b);
+	}
+	/* P == Q (half of the tests with P = Q) */
+	for (i = 0; i < cfg.nbequ; i++) {
+		pr_test(f, "isP==Q", index);
+		pt_random(&c, &P);
+		if (toss_a_coin(&c)) {
+			pt_random(&c, &Q);
+		} else {
+			pt_set(&Q, &P);
+		}
+		pr_pt(f, &c, "P", &P);
+		pr_pt(f, &c, "Q", &Q);
+		pr_bool(f, pt_eq(&P, &Q));
+	}
+	/* P == -Q (half of the tests with P = -Q) */
+	for (i = 0; i < cfg.nbopp; i++) {
+		pr_test(f, "isP==-Q", index);
+		pt_random(&c, &P);
+		if (toss_a_coin(&c)) {
+			pt_random(&c, &Q);
+		} else {
+			pt_neg(&c, &Q, &P);
+		}
+		pr_pt(f, &c, "P", &P);
+		pr_pt(f, &c, "Q", &Q);
+		pr_bool(f, pt_opp(&c, &P, &Q));
+	}
+	if (!cfg.no_exceptions) {
+		gen_exceptions(f, &c, index);
+	}
+end:
+	fprintf(f, "\n");
+	mpz_clear(k);
+	pt_clear(&P);
+	pt_clear(&Q);
+	pt_clear(&R);
+	crv_clear(&c);
+}
+
+/* ------------------------------------------------------------------
+ * Threads: curves are generated in memory by the workers & written in
+ * order by the main thread
+ * ------------------------------------------------------------------ */
+
+typedef struct {
+	char *buf;
+	size_t sz;
+	bool ready;
+} slot_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static slot_t *slots;
+static unsigned int nbslots;
+/* ranks (in the shard) of the next curve to generate & to write */
+static unsigned long next_gen, next_out, nb_ranks;
+static bool stop;
+
+static unsigned long rank_to_index(unsigned long r)
+{
+	return cfg.shard + (r * cfg.nbshards);
+}
+
+static void *worker(void *arg)
+{
+	unsigned long r;
+	FILE *f;
+	slot_t s;
+
+	(void)arg;
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		while (!stop && (next_gen < nb_ranks) && (next_gen >= next_out + nbslots)) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		if (stop || (next_gen >= nb_ranks)) {
+			pthread_mutex_unlock(&lock);
+			return NULL;
+		}
+		r = next_gen++;
+		pthread_mutex_unlock(&lock);
+		f = open_memstream(&s.buf, &s.sz);
+		if (f == NULL) {
+			perror("open_memstream");
+			exit(EXIT_FAILURE);
+		}
+		gen_curve(f, rank_to_index(r));
+		fclose(f);
+		pthread_mutex_lock(&lock);
+		s.ready = true;
+		slots[r % nbslots] = s;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/* Write a curve, numbering its tests */
+static int write_curve(const slot_t *s, unsigned long *nbtest)
+{
+	const char *l = s->buf, *eol, *end = s->buf + s->sz;
+
+	for (; l < end; l = eol + 1) {
+		eol = memchr(l, '\n', (size_t)(end - l));
+		if (strncmp(l, "== TEST ", strlen("== TEST ")) == 0) {
+			fwrite(l, 1, (size_t)(eol - l), stdout);
+			printf("%lu\n", (*nbtest)++);
+		} else {
+			fwrite(l, 1, (size_t)(eol - l + 1), stdout);
+		}
+	}
+	fflush(stdout);
+	return ferror(stdout) ? -1 : 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -c NBCURV    nb of curves (all shards included), 0 for no end (default: %lu)\n"
+		"  -s SEED      seed (default: %lu)\n"
+		"  -j NB        nb of threads (default: nb of cores)\n"
+		"  -S I/N       only generate shard I of N (curves #c with c = I modulo N)\n"
+		"  -n NN        constant value of nn (default: dynamic range, see -x, -m & -M)\n"
+		"  -x NN        nnmaxabsolute, largest value of nn (default: %u)\n"
+		"  -m NN        nnminmin, smallest value of nnmin (default: %u)\n"
+		"  -M NN        nnmaxmin, smallest value of nnmax (default: %u)\n"
+		"  -t TYPE=NB   nb of tests per curve for TYPE = kp|add|dbl|neg|chk|equ|opp\n"
+		"               (default: kp=%u, others=%u)\n"
+		"  -q NN        NN_LIMIT_COMPUTE_Q, q (hence blinding & exceptions on [k]P) is only\n"
+		"               computed for curves of at most NN bits, at most %u, 0 for never\n"
+		"               (default: %u)\n"
+		"  -K           only [k]P tests, without blinding (only_kp_and_no_blinding)\n"
+		"  -E           no exception tests (NO_EXCEPTIONS)\n",
+		prog, cfg.nbcurv, cfg.seed, cfg.nnmaxabsolute, cfg.nnminmin, cfg.nnmaxmin,
+		cfg.nbkp, cfg.nbadd, NN_LIMIT_COMPUTE_Q_MAX, cfg.nn_limit_compute_q);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long get_ul(const char *prog, const char *s)
+{
+	char *end;
+	unsigned long v;
+
+	errno = 0;
+	v = strtoul(s, &end, 0);
+	if (errno || (end == s) || (*end != '\0')) {
+		usage(prog);
+	}
+	return v;
+}
+
+static void set_nbtests(const char *prog, char *s)
+{
+	static const char *names[] = { "kp", "add", "dbl", "neg", "chk", "equ", "opp" };
+	unsigned int *nbs[] = { &cfg.nbkp, &cfg.nbadd, &cfg.nbdbl, &cfg.nbneg, &cfg.nbchk, &cfg.nbequ, &cfg.nbopp };
+	char *eq = strchr(s, '=');
+	unsigned int i;
+
+	if (eq == NULL) {
+		usage(prog);
+	}
+	*eq = '\0';
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strcmp(s, names[i]) == 0) {
+			*nbs[i] = (unsigned int)get_ul(prog, eq + 1);
+			return;
+		}
+	}
+	usage(prog);
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t *th;
+	unsigned long r, nbtest = 0;
+	unsigned int i, nnmin, nnmax, prev_nnmin = 0, prev_nnmax = 0;
+	char *sl;
+	slot_t s;
+	int opt, ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "c:s:j:S:n:x:m:M:t:q:KEh")) != -1) {
+		switch (opt) {
+			case 'c': cfg.nbcurv = get_ul(argv[0], optarg); break;
+			case 's': cfg.seed = get_ul(argv[0], optarg); break;
+			case 'j': cfg.nbthreads = (unsigned int)get_ul(argv[0], optarg); break;
+			case 'S':
+				sl = strchr(optarg, '/');
+				if (sl == NULL) {
+					usage(argv[0]);
+				}
+				*sl = '\0';
+				cfg.shard = (unsigned int)get_ul(argv[0], optarg);
+				cfg.nbshards = (unsigned int)get_ul(argv[0], sl + 1);
+				break;
+			case 'n': cfg.nn_constant = (unsigned int)get_ul(argv[0], optarg); break;
+			case 'x': cfg.nnmaxabsolute = (unsigned int)get_ul(argv[0], optarg); break;
+			case 'm': cfg.nnminmin = (unsigned int)get_ul(argv[0], optarg); break;
+			case 'M': cfg.nnmaxmin = (unsigned int)get_ul(argv[0], optarg); break;
+			case 't': set_nbtests(argv[0], optarg); break;
+			case 'q': cfg.nn_limit_compute_q = (unsigned int)get_ul(argv[0], optarg); break;
+			case 'K': cfg.only_kp_and_no_blinding = true; break;
+			case 'E': cfg.no_exceptions = true; break;
+			default: usage(argv[0]);
+		}
+	}
+	if ((optind != argc) || (cfg.nbshards == 0) || (cfg.shard >= cfg.nbshards)
+			|| (cfg.nn_limit_compute_q > NN_LIMIT_COMPUTE_Q_MAX)
+			|| (cfg.nn_constant && ((cfg.nn_constant < NN_SMALLEST) || (cfg.nn_constant > cfg.nnmaxabsolute)))
+			|| (cfg.nnmaxabsolute < NN_SMALLEST + 32)
+			|| (cfg.nnminmin < NN_SMALLEST) || (cfg.nnminmin > cfg.nnmaxabsolute - 32)
+			|| (cfg.nnmaxmin < cfg.nnminmin) || (cfg.nnmaxmin > cfg.nnmaxabsolute)) {
+		usage(argv[0]);
+	}
+	if (cfg.only_kp_and_no_blinding) {
+		cfg.no_exceptions = true;
+	}
+	if (cfg.nbthreads == 0) {
+		cfg.nbthreads = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+		if (cfg.nbthreads == 0) {
+			cfg.nbthreads = 1;
+		}
+	}
+	if (cfg.nbcurv == 0) {
+		nb_ranks = ~0UL;
+	} else {
+		nb_ranks = (cfg.nbcurv > cfg.shard) ? ((cfg.nbcurv - cfg.shard + cfg.nbshards - 1) / cfg.nbshards) : 0;
+	}
+	/* a reader closing the pipe simply ends the generation */
+	signal(SIGPIPE, SIG_IGN);
+	init_small_primes();
+
+	nbslots = 4 * cfg.nbthreads;
+	slots = calloc(nbslots, sizeof(slot_t));
+	th = calloc(cfg.nbthreads, sizeof(pthread_t));
+	if ((slots == NULL) || (th == NULL)) {
+		fprintf(stderr, "Error: out of memory\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < cfg.nbthreads; i++) {
+		if (pthread_create(&th[i], NULL, worker, NULL)) {
+			perror("pthread_create");
+			return EXIT_FAILURE;
+		}
+	}
+	if (cfg.nn_constant) {
+		fprintf(stderr, "Generating curves for nn = %u\n", cfg.nn_constant);
+	}
+	for (r = 0; r < nb_ranks; r++) {
+		pthread_mutex_lock(&lock);
+		while (!slots[r % nbslots].ready) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		s = slots[r % nbslots];
+		slots[r % nbslots].ready = false;
+		next_out++;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+		if ((cfg.nn_constant == 0) && (rank_to_index(r) == 0)) {
+			fprintf(stderr, "Generating first curve for nn = %u\n", cfg.nnmaxabsolute);
+		} else if (cfg.nn_constant == 0) {
+			nn_range(rank_to_index(r), &nnmin, &nnmax);
+			if ((nnmin != prev_nnmin) || (nnmax != prev_nnmax)) {
+				fprintf(stderr, "Generating curves from nn = %u to %u\n", nnmin, nnmax);
+				prev_nnmin = nnmin;
+				prev_nnmax = nnmax;
+			}
+		}
+		if (write_curve(&s, &nbtest)) {
+			if (errno != EPIPE) {
+				perror("stdout");
+				ret = EXIT_FAILURE;
+			}
+			free(s.buf);
+			break;
+		}
+		free(s.buf);
+	}
+	pthread_mutex_lock(&lock);
+	stop = true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	for (i = 0; i < cfg.nbthreads; i++) {
+		pthread_join(th[i], NULL);
+	}
+	for (i = 0; i < nbslots; i++) {
+		if (slots[i].ready) {
+			free(slots[i].buf);
+		}
+	}
+	free(slots);
+	free(th);
+	return ret;
+}
@@ -0,0 +1,248 @@
+--
+--  Copyright (C) 2023 - This file is part of IPECC project
+--
+--  Authors:
+--      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+--      Ryad BENADJILA <ryadbenadjila@gmail.com>
+--
+--  Contributors:
+--      Adrian THILLARD
+--      Emmanuel PROUFF
+--
+--  This software is licensed under GPL v2 license.
+--  See LICENSE file at the root folder of the project.
+--
+
+-- Co-simulation bridge between the C software driver & the RTL of the IP.
+--
+-- Instead of reading test-vectors as ecc_tb does, this testbench waits
+-- for a driver (any program built with the driver compiled with
+-- -DWITH_EC_HW_COSIM, e.g 'make ecc-test-linux-cosim' in folder driver/)
+-- to connect on TCP port 'cosimport' of the loopback interface, and
+-- replays each of its register accesses as an AXI-lite transfer on the
+-- IP. Simulated time only moves forward during these transfers, so the
+-- cycles seen by the driver are the ones of a CPU issuing its accesses
+-- back-to-back (the polling loops of the driver included).
+--
+-- When the driver disconnects the testbench prints the nb of accesses
+-- of the session and waits for the next one (the IP keeping its state,
+-- as it would on a board).
+--
+-- Build & run (GHDL):  make cosim && ./ecc_cosim --ieee-asserts=disable
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.ecc_customize.all;
+use work.ecc_utils.all;
+use work.ecc_pkg.all;
+use work.ecc_tb_pkg.all;
+use work.ecc_cosim_pkg.all;
+
+entity ecc_cosim is
+	generic(
+		-- TCP port the driver connects to (see IPECC_COSIM_PORT in
+		-- driver/hw_accelerator_driver_ipecc_platform.c)
+		cosimport : natural := 9000;
+		-- Pathnames of the files read or written by the simulation
+		simlog : string := simlogfile;
+		simxyshuflog : string := simxyshuflogfile;
+		simtrng : string := simtrngfile
+	);
+end entity ecc_cosim;
+
+architecture sim of ecc_cosim is
+
+	-- DuT component declaration
+	component ecc is
+		generic(
+			C_S_AXI_DATA_WIDTH : integer := axi32or64;
+			C_S_AXI_ADDR_WIDTH : integer := AXIAW;
+			simlog : string := simlogfile;
+			simxyshuflog : string := simxyshuflogfile;
+			simtrng : string := simtrngfile
+			);
+		port(
+			s_axi_aclk : in  std_logic;
+			s_axi_aresetn : in std_logic;
+			s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+			s_axi_awprot : in std_logic_vector(2 downto 0);
+			s_axi_awvalid : in std_logic;
+			s_axi_awready : out std_logic;
+			s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+			s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8)-1 downto 0);
+			s_axi_wvalid : in std_logic;
+			s_axi_wready : out std_logic;
+			s_axi_bresp : out std_logic_vector(1 downto 0);
+			s_axi_bvalid : out std_logic;
+			s_axi_bready : in std_logic;
+			s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+			s_axi_arprot : in std_logic_vector(2 downto 0);
+			s_axi_arvalid : in std_logic;
+			s_axi_arready : out std_logic;
+			s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+			s_axi_rresp : out std_logic_vector(1 downto 0);
+			s_axi_rvalid : out std_logic;
+			s_axi_rready : in std_logic;
+			clkmm : in std_logic;
+			irq : out std_logic;
+			busy : out std_logic;
+			dbgtrigger : out std_logic;
+			dbghalted : out std_logic;
+			dbgptdata : in std_logic_vector(7 downto 0);
+			dbgptvalid : in std_logic;
+			dbgptrdy : out std_logic;
+			clkdivo : out std_logic;
+			clkmmdivo : out std_logic
+		);
+	end component ecc;
+
+	-- AXI signal buses (DuT)
+	signal axi0 : axi_in_type;
+	signal axo0 : axi_out_type;
+
+	signal s_axi_aclk, s_axi_aresetn : std_logic;
+	-- nb of s_axi_aclk cycles since time 0 (wraps around at natural'high,
+	-- the driver side only uses differences)
+	signal cycles : natural := 0;
+
+	signal clkmm : std_logic;
+
+	-- Tied-off inputs of the DuT (no pseudo TRNG device)
+	signal tied0 : std_logic := '0';
+	signal dbgptdata : std_logic_vector(7 downto 0) := (others => '0');
+
+begin
+
+	-- Emulate AXI reset.
+	process
+	begin
+		s_axi_aresetn <= '0';
+		wait for 333 ns;
+		s_axi_aresetn <= '1';
+		wait;
+	end process;
+
+	-- Emulate AXI clock (150 MHz).
+	process
+	begin
+		s_axi_aclk <= '0';
+		wait for 3.333 ns;
+		s_axi_aclk <= '1';
+		wait for 3.333 ns;
+	end process;
+
+	-- Count AXI clock cycles.
+	process(s_axi_aclk)
+	begin
+		if s_axi_aclk'event and s_axi_aclk = '1' then
+			if cycles = natural'high then
+				cycles <= 0;
+			else
+				cycles <= cycles + 1;
+			end if;
+		end if;
+	end process;
+
+	-- Emulate clkmm clock (374 MHz).
+	process
+	begin
+		clkmm <= '0';
+		wait for 1.336 ns;
+		clkmm <= '1';
+		wait for 1.336 ns;
+	end process;
+
+	-- DuT instance (no DMA memory model & no pseudo TRNG device here)
+	e0: ecc
+		generic map(
+			C_S_AXI_DATA_WIDTH => AXIDW,
+			C_S_AXI_ADDR_WIDTH => AXIAW,
+			simlog => simlog,
+			simxyshuflog => simxyshuflog,
+			simtrng => simtrng)
+		port map(
+			s_axi_aclk => s_axi_aclk,
+			s_axi_aresetn => s_axi_aresetn,
+			s_axi_awaddr => axi0.awaddr,
+			s_axi_awprot => axi0.awprot,
+			s_axi_awvalid => axi0.awvalid,
+			s_axi_awready => axo0.awready,
+			s_axi_wdata => axi0.wdata,
+			s_axi_wstrb => axi0.wstrb,
+			s_axi_wvalid => axi0.wvalid,
+			s_axi_wready => axo0.wready,
+			s_axi_bresp => axo0.bresp,
+			s_axi_bvalid => axo0.bvalid,
+			s_axi_bready => axi0.bready,
+			s_axi_araddr => axi0.araddr,
+			s_axi_arprot => axi0.arprot,
+			s_axi_arvalid => axi0.arvalid,
+			s_axi_arready => axo0.arready,
+			s_axi_rdata => axo0.rdata,
+			s_axi_rresp => axo0.rresp,
+			s_axi_rvalid => axo0.rvalid,
+			s_axi_rready => axi0.rready,
+			clkmm => clkmm,
+			irq => open,
+			busy => open,
+			dbgtrigger => open,
+			dbghalted => open,
+			dbgptdata => dbgptdata,
+			dbgptvalid => tied0,
+			dbgptrdy => open,
+			clkdivo => open,
+			clkmmdivo => open
+		);
+
+	-- --------------------------------------------------------
+	-- Replay the register accesses of the driver on the DuT
+	-- --------------------------------------------------------
+	bridge: process
+		variable op, addr, data : integer;
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+		variable nbrd, nbwr : natural;
+	begin
+		axi0.awvalid <= '0';
+		axi0.wvalid <= '0';
+		axi0.wstrb <= (others => '1');
+		axi0.awprot <= "000";
+		axi0.arprot <= "000";
+		axi0.bready <= '1';
+		axi0.arvalid <= '0';
+		axi0.rready <= '1';
+
+		wait until s_axi_aresetn = '1';
+		wait for 333 ns;
+		wait until s_axi_aclk'event and s_axi_aclk = '1';
+		-- let the IP do its (possible) init stuff
+		poll_until_ready(s_axi_aclk, axi0, axo0);
+
+		cosim_open(cosimport);
+		echol("[  ecc_cosim.vhd ]: Waiting for a driver on port "
+			& integer'image(cosimport));
+		nbrd := 0;
+		nbwr := 0;
+		loop
+			cosim_recv(op, addr, data);
+			if op = COSIM_READ then
+				axi_read(s_axi_aclk, axi0, axo0, addr, dw);
+				nbrd := nbrd + 1;
+				cosim_send(to_integer(signed(dw)), cycles);
+			elsif op = COSIM_WRITE then
+				axi_write(s_axi_aclk, axi0, axo0, addr,
+					std_logic_vector(to_signed(data, AXIDW)));
+				nbwr := nbwr + 1;
+				cosim_send(0, cycles);
+			else -- COSIM_DISCONNECT
+				echol("[  ecc_cosim.vhd ]: Driver disconnected ("
+					& integer'image(nbrd) & " reads, " & integer'image(nbwr)
+					& " writes)");
+				nbrd := 0;
+				nbwr := 0;
+			end if;
+		end loop;
+	end process bridge;
+
+end architecture sim;
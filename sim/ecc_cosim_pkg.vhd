@@ -0,0 +1,62 @@
+--
+--  Copyright (C) 2023 - This file is part of IPECC project
+--
+--  Authors:
+--      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+--      Ryad BENADJILA <ryadbenadjila@gmail.com>
+--
+--  Contributors:
+--      Adrian THILLARD
+--      Emmanuel PROUFF
+--
+--  This software is licensed under GPL v2 license.
+--  See LICENSE file at the root folder of the project.
+--
+
+-- Foreign (GHDL VHPIDIRECT) subprograms of the co-simulation bridge,
+-- implemented in C in ecc_cosim_vhpi.c (see ecc_cosim.vhd)
+
+package ecc_cosim_pkg is
+
+	-- kinds of requests returned by 'cosim_recv'
+	constant COSIM_DISCONNECT : integer := 0;
+	constant COSIM_READ : integer := 1;
+	constant COSIM_WRITE : integer := 2;
+
+	-- Listen on TCP port 'port_nb' (of the loopback interface)
+	procedure cosim_open(port_nb : in integer);
+	attribute foreign of cosim_open : procedure is "VHPIDIRECT cosim_open";
+
+	-- Wait for the next register access of the driver ('addr' is the byte
+	-- offset of the register, 'data' is only relevant for a write). Blocks
+	-- until a driver is connected if there is none.
+	procedure cosim_recv(op : out integer; addr : out integer; data : out integer);
+	attribute foreign of cosim_recv : procedure is "VHPIDIRECT cosim_recv";
+
+	-- Complete the current access ('data' is only relevant for a read,
+	-- 'cycles' is the value of the cycle counter of the testbench)
+	procedure cosim_send(data : in integer; cycles : in integer);
+	attribute foreign of cosim_send : procedure is "VHPIDIRECT cosim_send";
+
+end package ecc_cosim_pkg;
+
+package body ecc_cosim_pkg is
+
+	-- (bodies are never called, GHDL links the C functions instead)
+
+	procedure cosim_open(port_nb : in integer) is
+	begin
+		assert FALSE report "VHPIDIRECT cosim_open" severity failure;
+	end procedure cosim_open;
+
+	procedure cosim_recv(op : out integer; addr : out integer; data : out integer) is
+	begin
+		assert FALSE report "VHPIDIRECT cosim_recv" severity failure;
+	end procedure cosim_recv;
+
+	procedure cosim_send(data : in integer; cycles : in integer) is
+	begin
+		assert FALSE report "VHPIDIRECT cosim_send" severity failure;
+	end procedure cosim_send;
+
+end package body ecc_cosim_pkg;
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (C) 2023 - This file is part of IPECC project
+ *
+ *  Authors:
+ *      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+ *      Ryad BENADJILA <ryadbenadjila@gmail.com>
+ *
+ *  Contributors:
+ *      Adrian THILLARD
+ *      Emmanuel PROUFF
+ *
+ *  This software is licensed under GPL v2 license.
+ *  See LICENSE file at the root folder of the project.
+ */
+
+/* Simulator side of the co-simulation bridge: the foreign (GHDL
+ * VHPIDIRECT) procedures declared in ecc_cosim_pkg.vhd.
+ *
+ * Protocol (all fields big endian, one TCP connection per session of
+ * the driver, see driver/hw_accelerator_driver_ipecc_platform.c):
+ *
+ *   request  (driver -> simulator): op (1 byte, 'R' or 'W'),
+ *                                   address (4 bytes, byte offset of the register),
+ *                                   data (4 bytes, ignored for a read)
+ *   response (simulator -> driver): data (4 bytes, 0 for a write),
+ *                                   cycle counter of the testbench (4 bytes)
+ *
+ * The response is only sent once the AXI transfer is over, so the
+ * driver is stalled for as long as the simulation of it takes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/* Must match constants COSIM_* of ecc_cosim_pkg.vhd */
+#define COSIM_DISCONNECT 0
+#define COSIM_READ       1
+#define COSIM_WRITE      2
+
+static int listenfd = -1;
+static int clientfd = -1;
+
+static int recv_all(int fd, unsigned char *buf, size_t sz)
+{
+	ssize_t n;
+
+	while (sz) {
+		n = recv(fd, buf, sz, 0);
+		if (n <= 0) {
+			return -1;
+		}
+		buf += n;
+		sz -= (size_t)n;
+	}
+	return 0;
+}
+
+static int send_all(int fd, const unsigned char *buf, size_t sz)
+{
+	ssize_t n;
+
+	while (sz) {
+		n = send(fd, buf, sz, 0);
+		if (n <= 0) {
+			return -1;
+		}
+		buf += n;
+		sz -= (size_t)n;
+	}
+	return 0;
+}
+
+static uint32_t get_be32(const unsigned char *b)
+{
+	return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+
+static void put_be32(unsigned char *b, uint32_t v)
+{
+	b[0] = (unsigned char)(v >> 24);
+	b[1] = (unsigned char)(v >> 16);
+	b[2] = (unsigned char)(v >> 8);
+	b[3] = (unsigned char)v;
+}
+
+void cosim_open(int32_t port)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+
+	listenfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenfd < 0) {
+		perror("[ ecc_cosim_vhpi.c ]: socket");
+		exit(EXIT_FAILURE);
+	}
+	setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((bind(listenfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) || (listen(listenfd, 1) < 0)) {
+		perror("[ ecc_cosim_vhpi.c ]: bind/listen");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void cosim_recv(int32_t *op, int32_t *addr, int32_t *data)
+{
+	unsigned char req[9];
+	int one = 1;
+
+	if (clientfd < 0) {
+		clientfd = accept(listenfd, NULL, NULL);
+		if (clientfd < 0) {
+			perror("[ ecc_cosim_vhpi.c ]: accept");
+			exit(EXIT_FAILURE);
+		}
+		/* Requests are tiny & strictly alternate with responses */
+		setsockopt(clientfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	if (recv_all(clientfd, req, sizeof(req)) || ((req[0] != 'R') && (req[0] != 'W'))) {
+		close(clientfd);
+		clientfd = -1;
+		*op = COSIM_DISCONNECT;
+		*addr = 0;
+		*data = 0;
+		return;
+	}
+	*op = (req[0] == 'R') ? COSIM_READ : COSIM_WRITE;
+	*addr = (int32_t)get_be32(req + 1);
+	*data = (int32_t)get_be32(req + 5);
+}
+
+void cosim_send(int32_t data, int32_t cycles)
+{
+	unsigned char resp[8];
+
+	put_be32(resp, (uint32_t)data);
+	put_be32(resp + 4, (uint32_t)cycles);
+	if ((clientfd >= 0) && send_all(clientfd, resp, sizeof(resp))) {
+		/* The driver is gone, next call to cosim_recv() will tell */
+		shutdown(clientfd, SHUT_RDWR);
+	}
+}
@@ -0,0 +1,146 @@
+#
+#  Copyright (C) 2023 - This file is part of IPECC project
+#
+#  Authors:
+#      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+#      Ryad BENADJILA <ryadbenadjila@gmail.com>
+#
+#  Contributors:
+#      Adrian THILLARD
+#      Emmanuel PROUFF
+#
+#  This software is licensed under GPL v2 license.
+#  See LICENSE file at the root folder of the project.
+#
+
+# Performance regression gate on the cycle counts logged by ecc_tb.
+#
+# ecc_tb writes one CSV line per test (see 'simcsvfile' in
+# ecc_customize.vhd):
+#
+#   op,test,curve,nn,nbbld,config,cycles,busy,setup,ladder,exit
+#
+# The [k]P emulator of ipecc_assembler.py (-k option) writes the same
+# lines with the counts of its cycle model.
+#
+# This script compares such a file (or the concatenation of several
+# ones, e.g the ones of the shards of ecc_tb_regress.py) with a
+# reference one, test by test. Tests are matched on their key (op,
+# test, curve, nn & nbbld), the measure being compared is 'busy' (nb
+# of cycles the IP was busy with the command, only there if the IP has
+# performance counters) if both files have it, otherwise 'cycles' (as
+# measured by the testbench). Phases 'setup', 'ladder' and 'exit' of a
+# [k]P are compared too when both files have them. The 'config' of a
+# test (synthesis parameters its cycles depend on) must be the same in
+# both files: the comparison is meaningless otherwise.
+#
+# Exit status is 1 if at least one test is slower than its reference
+# by more than the tolerance (in percent), if a test was run with
+# another config than its reference, if a test of the reference is
+# missing, or if no test could be compared at all; 0 otherwise. Tests
+# which are only in the new files are reported but are not an error.
+#
+# Usage:
+#   python3 ecc_cycles_compare.py [-t TOL] BASELINE CSV [CSV ...]
+#   python3 ecc_cycles_compare.py -m OUT CSV [CSV ...]   (merge only)
+
+import sys, csv, argparse
+
+KEY = ("op", "test", "curve", "nn", "nbbld")
+COLUMNS = KEY + ("config", "cycles", "busy")
+PHASES = ("setup", "ladder", "exit")
+
+def load(filenames):
+    rows = {}
+    for fn in filenames:
+        with open(fn, "r", newline="") as f:
+            for r in csv.DictReader(f):
+                k = tuple(r[c] for c in KEY)
+                # a test which appears several times (e.g the same vector
+                # file simulated twice) keeps its worst case
+                if k in rows and measure(rows[k], r)[0] >= measure(r, rows[k])[0]:
+                    continue
+                rows[k] = r
+    return rows
+
+def value(r, c):
+    v = r.get(c, "")
+    return int(v) if v not in (None, "") else None
+
+# (new, reference, name) of the measure compared for a test
+def measure(new, ref):
+    if value(new, "busy") is not None and value(ref, "busy") is not None:
+        return value(new, "busy"), value(ref, "busy"), "busy"
+    return value(new, "cycles"), value(ref, "cycles"), "cycles"
+
+def merge(out, filenames):
+    rows = load(filenames)
+    with open(out, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(COLUMNS + PHASES)
+        for k in sorted(rows):
+            w.writerow([rows[k][c] for c in COLUMNS + PHASES])
+
+def label(k):
+    return "%s %s (curve %s, nn=%s, nbbld=%s)" % (k[0], k[1], k[2], k[3], k[4])
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare cycle counts logged by ecc_tb with a baseline")
+    parser.add_argument("-t", "--tol", type=float, default=1.0,
+            help="tolerance in percent (default: 1.0)")
+    parser.add_argument("-m", "--merge", metavar="OUT",
+            help="only merge the CSV files into OUT")
+    parser.add_argument("files", nargs="+", help="BASELINE CSV [CSV ...] (or CSV [CSV ...] with -m)")
+    args = parser.parse_args()
+
+    if args.merge is not None:
+        merge(args.merge, args.files)
+        return 0
+    if len(args.files) < 2:
+        parser.error("need a baseline and at least one CSV file")
+
+    ref = load(args.files[:1])
+    new = load(args.files[1:])
+    slower = faster = same = badconfig = 0
+    for k in sorted(new):
+        if k not in ref:
+            print("NEW       %s: %s cycles" % (label(k), new[k]["cycles"]))
+            continue
+        if new[k]["config"] != ref[k]["config"]:
+            print("CONFIG    %s: %s -> %s" % (label(k), ref[k]["config"], new[k]["config"]))
+            badconfig += 1
+            continue
+        cmp = [measure(new[k], ref[k])]
+        for ph in PHASES:
+            if value(new[k], ph) is not None and value(ref[k], ph) is not None:
+                cmp.append((value(new[k], ph), value(ref[k], ph), ph))
+        worst = "same"
+        for n, r, name in cmp:
+            delta = 100.0 * (n - r) / max(r, 1)
+            if delta > args.tol:
+                print("SLOWER    %s: %s %d -> %d (%+.2f%%)" % (label(k), name, r, n, delta))
+                worst = "slower"
+            elif delta < -args.tol:
+                print("faster    %s: %s %d -> %d (%+.2f%%)" % (label(k), name, r, n, delta))
+                if worst == "same":
+                    worst = "faster"
+        if worst == "slower":
+            slower += 1
+        elif worst == "faster":
+            faster += 1
+        else:
+            same += 1
+    missing = [k for k in ref if k not in new]
+    for k in sorted(missing):
+        print("MISSING   %s" % label(k))
+    compared = slower + faster + same
+    print("%d test(s) compared: %d slower, %d faster, %d within %.2f%%, "
+            "%d new, %d missing, %d with another config" % (compared, slower,
+                faster, same, args.tol, len([k for k in new if k not in ref]),
+                len(missing), badconfig))
+    if compared == 0:
+        print("No test could be compared with the baseline")
+    return 1 if (slower > 0 or badconfig > 0 or len(missing) > 0 or compared == 0) else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,301 @@
+#
+#  Copyright (C) 2023 - This file is part of IPECC project
+#
+#  Authors:
+#      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+#      Ryad BENADJILA <ryadbenadjila@gmail.com>
+#
+#  Contributors:
+#      Adrian THILLARD
+#      Emmanuel PROUFF
+#
+#  This software is licensed under GPL v2 license.
+#  See LICENSE file at the root folder of the project.
+#
+
+# Configuration sweep over the parameters of ecc_customize.vhd.
+#
+# Each "-p NAME=V1,V2,..." option gives a list of values for constant
+# NAME of ecc_customize.vhd, and all the combinations of these values
+# (the cartesian product) are generated, each one in its own copy of
+# ecc_customize.vhd (in DIR/<variant>/, DIR being 'sweep' by default).
+# The same [k]P workload (the [k]P tests of the vector file, plus
+# possibly random ones) is then run on each variant, variants being
+# run in parallel, and a table of the average nb of cycles per [k]P
+# for each value of nn is printed (and written in DIR/sweep.csv).
+#
+# Two backends can be used to count cycles:
+#
+#   - 'emulate' (default) uses the microcode emulator & cycle model of
+#     ipecc_assembler.py (option -k). It is fast (a few seconds per
+#     variant) and its cycles match the ones of the hardware within
+#     the accuracy of the model (see 'make profile' in folder
+#     hdl/common/ecc_curve_iram). Only the parameters the model knows
+#     of (nbmult, nbdsp, multwidth, sramlat, hwsecure, shuffle,
+#     shuffle_type, blinding & zremask) have an effect on it.
+#
+#   - 'ghdl' elaborates ecc_tb for each variant (in DIR/<variant>/,
+#     see variables HDL & SIMDIR of the Makefile) and runs it with
+#     ecc_tb_regress.py (see 'make regress'). This is the cycle-exact
+#     way, and the one to use for parameters the model ignores (e.g
+#     axi32or64 or nn_dynamic), but it takes hours for large curves.
+#
+# With option --synth PART, and if Vivado is found in the PATH, each
+# variant is also synthesized (out-of-context, for Xilinx part PART)
+# and its resources (LUT, FF, BRAM & DSP) are added to the table.
+#
+# Usage:
+#   python3 ecc_sweep.py [-p NAME=V1,V2,...]... [-b emulate|ghdl] [-j N]
+#                        [-o DIR] [-r NBRANDOM] [-s SEED] [--synth PART]
+#                        [VECFILE]
+
+import re, sys, os, csv, shutil, argparse, itertools, subprocess
+from multiprocessing.pool import ThreadPool
+import ecc_tb_regress
+from ecc_tb_regress import print_info, bcolors
+
+SIMDIR = os.path.dirname(os.path.abspath(__file__))
+HDL = os.path.normpath(os.path.join(SIMDIR, "..", "hdl"))
+IRAM = os.path.join(HDL, "common", "ecc_curve_iram")
+CUSTOMIZE = os.path.join(HDL, "common", "ecc_customize.vhd")
+
+# Parameters ignored by the cycle model of ipecc_assembler.py
+NOT_MODELED = ("nn_dynamic", "axi32or64", "async", "techno", "dma", "dmaaw",
+        "shadow", "cmdqdepth", "perfcnt", "tracedepth")
+
+def constant_re(name):
+    return re.compile(r"^(\s*constant\s+" + name + r"\s*:[^:]*:=\s*)([^;]+?)(\s*;)", re.M)
+
+# Value of a parameter as written in VHDL (booleans in upper case,
+# everything else, e.g enumerated values of 'shuffle_type', verbatim)
+def vhdl_value(v):
+    return v.upper() if v.lower() in ("true", "false") else v
+
+# Copy of ecc_customize.vhd with the parameters of one variant
+def customize(vhdl, params):
+    for name, v in params:
+        vhdl = constant_re(name).sub(lambda m: m.group(1) + vhdl_value(v) + m.group(3), vhdl, count=1)
+    return vhdl
+
+def variant_name(params):
+    return "_".join("%s-%s" % (name, v) for name, v in params) if len(params) > 0 else "default"
+
+def get_constant(vhdl, name):
+    m = constant_re(name).search(vhdl)
+    return None if m is None else m.group(2).strip()
+
+# [k]P tests of a vector file (other tests are dropped), along with
+# the value of nn of each curve
+def kp_vectors(vecfile):
+    with open(vecfile, "r") as f:
+        header, curves = ecc_tb_regress.split_curves(f.readlines())
+    out = list(header)
+    nns = {}
+    for block in curves:
+        name = block[0][2:].strip()
+        keep = True
+        for l in block:
+            if l.startswith("== TEST"):
+                keep = re.match(r"^==\s*TEST \[k\]P", l) is not None
+            else:
+                m = re.match(r"^nn=([0-9]+)", l)
+                if m is not None:
+                    nns[name] = int(m.group(1))
+            if keep:
+                out.append(l)
+    return out, nns
+
+# Vector file restricted to the curves of at most nn bits (the others
+# cannot be computed by a variant synthesized for a smaller nn)
+def write_vectors(fn, lines, nnmax):
+    header, curves = ecc_tb_regress.split_curves(lines)
+    with open(fn, "w") as f:
+        f.writelines(header)
+        for block in curves:
+            nn = [int(m.group(1)) for m in (re.match(r"^nn=([0-9]+)", l) for l in block) if m is not None]
+            if len(nn) == 0 or nn[0] <= nnmax:
+                f.writelines(block)
+
+def run(cmd, logfile, cwd=None):
+    with open(logfile, "w") as log:
+        return subprocess.call(cmd, cwd=cwd, stdout=log, stderr=subprocess.STDOUT)
+
+class Variant:
+    def __init__(self, params, outdir, vhdl):
+        self.params = params
+        self.name = variant_name(params)
+        self.workdir = os.path.abspath(os.path.join(outdir, self.name))
+        self.customize = os.path.join(self.workdir, "ecc_customize.vhd")
+        self.vhdl = customize(vhdl, params)
+        self.nn = int(get_constant(self.vhdl, "nn"))
+        self.cycles = {}    # nn -> average nb of cycles of a [k]P
+        self.resources = {}
+        self.error = None
+
+    def setup(self, lines):
+        os.makedirs(self.workdir, exist_ok=True)
+        with open(self.customize, "w") as f:
+            f.write(self.vhdl)
+        self.vecfile = os.path.join(self.workdir, "ecc_vec_in.txt")
+        write_vectors(self.vecfile, lines, self.nn)
+
+    def emulate(self, nns, nbrandom, seed):
+        log = os.path.join(self.workdir, "emulate.out")
+        ret = run(["python3", "ipecc_assembler.py", "-k", "ecc_curve_iram.s", "../ecc_pkg.vhd",
+                self.customize, "asm_src/vardefs.csv", self.vecfile, str(nbrandom), str(seed)], log, cwd=IRAM)
+        sums = {}
+        with open(log, "r") as f:
+            for l in f:
+                m = re.match(r"^\s*(.*?)\s+([0-9]+) \[k\]P,\s+([0-9]+) cycles on average", l)
+                if m is not None and m.group(1) in nns:
+                    s = sums.setdefault(nns[m.group(1)], [0, 0])
+                    s[0] += int(m.group(2)) * int(m.group(3))
+                    s[1] += int(m.group(2))
+        self.cycles = {nn: s[0] // s[1] for nn, s in sums.items()}
+        if ret != 0:
+            self.error = "emulation failed (see %s)" % log
+
+    def ghdl(self, trng):
+        log = os.path.join(self.workdir, "make.out")
+        if run(["make", "-C", self.workdir, "-f", os.path.join(SIMDIR, "Makefile"),
+                "HDL=" + HDL, "SIMDIR=" + SIMDIR, "elaborate"], log) != 0:
+            self.error = "elaboration failed (see %s)" % log
+            return
+        regress = os.path.join(self.workdir, "regress")
+        if run(["python3", os.path.join(SIMDIR, "ecc_tb_regress.py"), "--tb", os.path.join(self.workdir, "ecc_tb"),
+                "-o", regress, "-j", "1", "-c", "-t", trng, self.vecfile],
+                os.path.join(self.workdir, "regress.out")) != 0:
+            self.error = "simulation failed (see %s)" % os.path.join(self.workdir, "regress.out")
+        fn = os.path.join(regress, "ecc_cycles.csv")
+        if not os.path.exists(fn):
+            return
+        sums = {}
+        with open(fn, "r", newline="") as f:
+            for r in csv.DictReader(f):
+                if r["op"] != "kp":
+                    continue
+                # 'busy' (perf. counters) if the IP has them, otherwise
+                # the count of the testbench (which includes the AXI accesses)
+                v = r["busy"] if r["busy"] != "" else r["cycles"]
+                s = sums.setdefault(int(r["nn"]), [0, 0])
+                s[0] += int(v)
+                s[1] += 1
+        self.cycles = {nn: s[0] // s[1] for nn, s in sums.items()}
+
+    def synth(self, part):
+        tcl = os.path.join(self.workdir, "synth.tcl")
+        srcs = []
+        for d in ("common", "common/ecc_trng", "common/ecc_curve_iram", "techno-specific/xilinxa/series7"):
+            for fn in sorted(os.listdir(os.path.join(HDL, d))):
+                if fn.endswith(".vhd") and fn not in ("ecc_customize.vhd", "es_trng_sim.vhd"):
+                    srcs.append(os.path.join(HDL, d, fn))
+        with open(tcl, "w") as f:
+            f.write("read_vhdl %s\n" % self.customize)
+            for s in srcs:
+                f.write("read_vhdl %s\n" % s)
+            f.write("synth_design -top ecc -part %s -mode out_of_context\n" % part)
+            f.write("report_utilization -file %s\n" % os.path.join(self.workdir, "utilization.rpt"))
+        if run(["vivado", "-mode", "batch", "-nojournal", "-nolog", "-source", tcl],
+                os.path.join(self.workdir, "synth.out"), cwd=self.workdir) != 0:
+            self.error = "synthesis failed (see %s)" % os.path.join(self.workdir, "synth.out")
+            return
+        with open(os.path.join(self.workdir, "utilization.rpt"), "r") as f:
+            for l in f:
+                for res, pattern in (("LUT", r"Slice LUTs\*?"), ("FF", r"Slice Registers"),
+                        ("BRAM", r"Block RAM Tile"), ("DSP", r"DSPs")):
+                    m = re.match(r"^\|\s*" + pattern + r"\s*\|\s*([0-9.]+)\s*\|", l)
+                    if m is not None and res not in self.resources:
+                        self.resources[res] = m.group(1)
+
+def parse_params(specs, vhdl):
+    params = []
+    for spec in specs:
+        m = re.match(r"^([a-zA-Z_][a-zA-Z0-9_]*)=(.+)$", spec)
+        if m is None:
+            print_info("Error: ", "'%s' is not of the form NAME=V1,V2,..." % spec, bcolors.FAIL)
+            sys.exit(1)
+        if get_constant(vhdl, m.group(1)) is None:
+            print_info("Error: ", "no constant '%s' in %s" % (m.group(1), CUSTOMIZE), bcolors.FAIL)
+            sys.exit(1)
+        params.append((m.group(1), [v.strip() for v in m.group(2).split(",") if v.strip() != ""]))
+    return params
+
+def main():
+    parser = argparse.ArgumentParser(description="Sweep of ecc_customize.vhd parameters")
+    parser.add_argument("vecfile", nargs="?", default=os.path.join(SIMDIR, "std-curves-test-vectors.txt"),
+            help="test-vectors file, only its [k]P tests are used (default: std-curves-test-vectors.txt)")
+    parser.add_argument("-p", "--param", action="append", default=[], metavar="NAME=V1,V2,...",
+            help="values of constant NAME of ecc_customize.vhd (can be repeated)")
+    parser.add_argument("-b", "--backend", choices=("emulate", "ghdl"), default="emulate",
+            help="how cycles are counted (default: emulate)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+            help="nb of variants run in parallel (default: nb of cores)")
+    parser.add_argument("-o", "--outdir", default="sweep",
+            help="output directory (one subdirectory per variant, default: sweep)")
+    parser.add_argument("-r", "--random", type=int, default=0, metavar="NBRANDOM",
+            help="nb of [k]P on random points added per curve (emulate backend only)")
+    parser.add_argument("-s", "--seed", type=int, default=1,
+            help="seed of the emulator (default: 1, the same for all variants)")
+    parser.add_argument("-t", "--trng", default="/tmp/random.txt",
+            help="TRNG input file (ghdl backend only, default: /tmp/random.txt)")
+    parser.add_argument("--synth", metavar="PART",
+            help="also synthesize each variant with Vivado for Xilinx part PART")
+    args = parser.parse_args()
+
+    with open(CUSTOMIZE, "r") as f:
+        vhdl = f.read()
+    params = parse_params(args.param, vhdl)
+    if args.backend == "emulate":
+        for name, _ in params:
+            if name in NOT_MODELED:
+                print_info("Warning: ", "'%s' has no effect on the cycle model (use -b ghdl)" % name, bcolors.FAIL)
+    if args.synth is not None and shutil.which("vivado") is None:
+        print_info("Warning: ", "vivado not found in the PATH, no synthesis", bcolors.FAIL)
+        args.synth = None
+
+    lines, nns = kp_vectors(args.vecfile)
+    names = [name for name, _ in params]
+    variants = [Variant(list(zip(names, values)), args.outdir, vhdl)
+            for values in itertools.product(*[values for _, values in params])]
+    for v in variants:
+        v.setup(lines)
+    print_info("Sweep: ", "%d variant(s), %s backend, in %s" % (len(variants), args.backend, args.outdir))
+
+    # the microcode is the same for all variants
+    target = "ecc_curve_iram.s" if args.backend == "emulate" else "all"
+    if run(["make", "-C", IRAM, target], os.path.join(args.outdir, "iram.out")) != 0:
+        print_info("Error: ", "could not build the microcode (see %s)" % os.path.join(args.outdir, "iram.out"), bcolors.FAIL)
+        sys.exit(1)
+
+    def job(v):
+        if args.backend == "emulate":
+            v.emulate(nns, args.random, args.seed)
+        else:
+            v.ghdl(os.path.abspath(args.trng))
+        if args.synth is not None and v.error is None:
+            v.synth(args.synth)
+        print_info("%s: " % v.name, "done" if v.error is None else v.error,
+                bcolors.OKGREEN if v.error is None else bcolors.FAIL)
+    with ThreadPool(max(1, args.jobs)) as pool:
+        pool.map(job, variants, chunksize=1)
+
+    allnn = sorted(set(nn for v in variants for nn in v.cycles))
+    res = ["LUT", "FF", "BRAM", "DSP"] if args.synth is not None else []
+    head = names + ["nn=%d" % nn for nn in allnn] + res
+    table = []
+    for v in variants:
+        table.append([val for _, val in v.params] +
+                [str(v.cycles[nn]) if nn in v.cycles else "-" for nn in allnn] +
+                [v.resources.get(r, "-") for r in res])
+    with open(os.path.join(args.outdir, "sweep.csv"), "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(head)
+        w.writerows(table)
+    width = [max(len(r[i]) for r in [head] + table) for i in range(len(head))]
+    print("Average nb of cycles per [k]P:")
+    for r in [head] + table:
+        print("  " + "  ".join(c.rjust(width[i]) for i, c in enumerate(r)))
+    sys.exit(0 if all(v.error is None for v in variants) else 1)
+
+if __name__ == "__main__":
+    main()
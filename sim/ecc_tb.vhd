@@ -30,28 +30,45 @@ use ieee.std_logic_textio.hread;
 use ieee.std_logic_textio.hwrite;
 
 entity ecc_tb is
+	-- All generics can be overridden from the command line of the simulator
+	-- (e.g with GHDL: ./ecc_tb -gsimvec=/tmp/shard0.txt) which allows to run
+	-- several instances of the testbench in parallel (see ecc_tb_regress.py)
+	generic(
+		-- Parameter 'CONTINUE_ON_ERROR'
+		--
+		-- If TRUE then simulation will continue even if a mismatch is detected
+		-- between the simulated RTL and the expected result from the input
+		-- test-vectors file.
+		--
+		-- If FALSE then the simulation will stop upon the first test where a
+		-- mismatch is detected.
+		--
+		CONTINUE_ON_ERROR : boolean := FALSE;
+		-- Pathnames of the files read or written by the simulation (default
+		-- values are the ones set in ecc_customize.vhd)
+		simvec : string := simvecfile;
+		simlog : string := simlogfile;
+		simxyshuflog : string := simxyshuflogfile;
+		simtrng : string := simtrngfile;
+		-- Pathname of the CSV file where the cycle count of each test is
+		-- logged (see 'simcsvfile' in ecc_customize.vhd)
+		simcsv : string := simcsvfile
+	);
 end entity ecc_tb;
 
 architecture sim of ecc_tb is
 
-	-- Parameter 'CONTINUE_ON_ERROR'
-	--
-	-- If TRUE then simulation will continue even if a mismatch is detected
-	-- between the simulated RTL and the expected result from the input test-
-	-- vectors file.
-	--
-	-- If FALSE then the simulation will stop upon the first test where a
-	-- mismatch is detected.
-	--
-	constant CONTINUE_ON_ERROR: boolean := FALSE;
-
-	-- DuT component declaration
+	-- DuT component declaration (without DMA engine)
 	component ecc is
 		generic(
 			-- Width of S_AXI data bus
 			C_S_AXI_DATA_WIDTH : integer := axi32or64; -- in ecc_customize
 			-- Width of S_AXI address bus
-			C_S_AXI_ADDR_WIDTH : integer := AXIAW -- in ecc_pkg
+			C_S_AXI_ADDR_WIDTH : integer := AXIAW; -- in ecc_pkg
+			-- simulation-only pathnames
+			simlog : string := simlogfile;
+			simxyshuflog : string := simxyshuflogfile;
+			simtrng : string := simtrngfile
 			);
 		port(
 			-- AXI clock & reset
@@ -100,6 +117,95 @@ architecture sim of ecc_tb is
 		);
 	end component ecc;
 
+	-- DuT component declaration, with the descriptor-ring DMA engine
+	component ecc_dma_top is
+		generic(
+			-- Width of S_AXI data bus
+			C_S_AXI_DATA_WIDTH : integer := axi32or64; -- in ecc_customize
+			-- Width of S_AXI address bus
+			C_S_AXI_ADDR_WIDTH : integer := AXIAW; -- in ecc_pkg
+			-- simulation-only pathnames
+			simlog : string := simlogfile;
+			simxyshuflog : string := simxyshuflogfile;
+			simtrng : string := simtrngfile
+			);
+		port(
+			-- AXI clock & reset
+			s_axi_aclk : in  std_logic;
+			s_axi_aresetn : in std_logic; -- asyn asserted, syn deasserted, active low
+			-- AXI write-address channel
+			s_axi_awaddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+			s_axi_awprot : in std_logic_vector(2 downto 0); -- ignored
+			s_axi_awvalid : in std_logic;
+			s_axi_awready : out std_logic;
+			-- AXI write-data channel
+			s_axi_wdata : in std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+			s_axi_wstrb : in std_logic_vector((C_S_AXI_DATA_WIDTH/8)-1 downto 0);
+			s_axi_wvalid : in std_logic;
+			s_axi_wready : out std_logic;
+			-- AXI write-response channel
+			s_axi_bresp : out std_logic_vector(1 downto 0);
+			s_axi_bvalid : out std_logic;
+			s_axi_bready : in std_logic;
+			-- AXI read-address channel
+			s_axi_araddr : in std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+			s_axi_arprot : in std_logic_vector(2 downto 0); -- ignored
+			s_axi_arvalid : in std_logic;
+			s_axi_arready : out std_logic;
+			--  AXI read-data channel
+			s_axi_rdata : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+			s_axi_rresp : out std_logic_vector(1 downto 0);
+			s_axi_rvalid : out std_logic;
+			s_axi_rready : in std_logic;
+			-- clock for Montgomery multipliers in the async case
+			clkmm : in std_logic;
+			-- interrupt
+			irq : out std_logic;
+			-- general busy signal
+			busy : out std_logic;
+			-- HW unsecure/SCA analysis feature (off-chip trigger)
+			dbgtrigger : out std_logic;
+			dbghalted : out std_logic;
+			--   pseudo-trng port
+			dbgptdata : in std_logic_vector(7 downto 0);
+			dbgptvalid : in std_logic;
+			dbgptrdy : out std_logic;
+			-- clk & clkmm division & out feature
+			clkdivo : out std_logic;
+			clkmmdivo : out std_logic;
+			-- AXI4 master interface of the DMA engine
+			m_axi_awaddr : out std_logic_vector(dmaaw - 1 downto 0);
+			m_axi_awlen : out std_logic_vector(7 downto 0);
+			m_axi_awsize : out std_logic_vector(2 downto 0);
+			m_axi_awburst : out std_logic_vector(1 downto 0);
+			m_axi_awcache : out std_logic_vector(3 downto 0);
+			m_axi_awprot : out std_logic_vector(2 downto 0);
+			m_axi_awvalid : out std_logic;
+			m_axi_awready : in std_logic;
+			m_axi_wdata : out std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			m_axi_wstrb : out std_logic_vector((C_S_AXI_DATA_WIDTH/8) - 1 downto 0);
+			m_axi_wlast : out std_logic;
+			m_axi_wvalid : out std_logic;
+			m_axi_wready : in std_logic;
+			m_axi_bresp : in std_logic_vector(1 downto 0);
+			m_axi_bvalid : in std_logic;
+			m_axi_bready : out std_logic;
+			m_axi_araddr : out std_logic_vector(dmaaw - 1 downto 0);
+			m_axi_arlen : out std_logic_vector(7 downto 0);
+			m_axi_arsize : out std_logic_vector(2 downto 0);
+			m_axi_arburst : out std_logic_vector(1 downto 0);
+			m_axi_arcache : out std_logic_vector(3 downto 0);
+			m_axi_arprot : out std_logic_vector(2 downto 0);
+			m_axi_arvalid : out std_logic;
+			m_axi_arready : in std_logic;
+			m_axi_rdata : in std_logic_vector(C_S_AXI_DATA_WIDTH - 1 downto 0);
+			m_axi_rresp : in std_logic_vector(1 downto 0);
+			m_axi_rlast : in std_logic;
+			m_axi_rvalid : in std_logic;
+			m_axi_rready : out std_logic
+		);
+	end component ecc_dma_top;
+
 	-- Pseudo TRNG device
 	component pseudo_trng is
 		generic(
@@ -183,6 +289,8 @@ architecture sim of ecc_tb is
 	signal axo1 : axi1_out_type;
 
 	signal s_axi_aclk, s_axi_aresetn : std_logic;
+	-- nb of s_axi_aclk cycles since time 0 (see procedure cycles_log)
+	signal cycles : natural := 0;
 
 	signal clkmm : std_logic;
 
@@ -201,6 +309,41 @@ architecture sim of ecc_tb is
 	signal clkdivo : std_logic;
 	signal clkmmdivo : std_logic;
 
+	-- Behavioural model of the system memory the DMA engine (if any) talks to.
+	-- Memory map (in words of AXIDW bits, byte address = word index * AXIDW/8):
+	--   DMAMEM_RING  ring of 2**DMA_LOG2SZ descriptors
+	--   DMAMEM_CURVE curve block (p, a, b, q)
+	--   DMAMEM_IN    input block (Px, Py, Qx, Qy, k)
+	--   DMAMEM_OUT   output block (x, y, token)
+	constant DMA_LOG2SZ : natural := 2;
+	constant DMAMEM_NBW : positive := div(nn, AXIDW);
+	constant DMAMEM_RING : natural := 0;
+	constant DMAMEM_CURVE : natural := DMA_DESC_WORDS * (2**DMA_LOG2SZ);
+	constant DMAMEM_IN : natural := DMAMEM_CURVE + (4 * DMAMEM_NBW);
+	constant DMAMEM_OUT : natural := DMAMEM_IN + (5 * DMAMEM_NBW);
+	constant DMAMEM_WORDS : natural := DMAMEM_OUT + (3 * DMAMEM_NBW);
+	type dmamem_type is array(0 to DMAMEM_WORDS - 1)
+		of std_logic_vector(AXIDW - 1 downto 0);
+	shared variable dmamem : dmamem_type;
+
+	signal m_axi_awaddr : std_logic_vector(dmaaw - 1 downto 0);
+	signal m_axi_awvalid : std_logic;
+	signal m_axi_awready : std_logic;
+	signal m_axi_wdata : std_logic_vector(AXIDW - 1 downto 0);
+	signal m_axi_wvalid : std_logic;
+	signal m_axi_wready : std_logic;
+	signal m_axi_bresp : std_logic_vector(1 downto 0);
+	signal m_axi_bvalid : std_logic;
+	signal m_axi_bready : std_logic;
+	signal m_axi_araddr : std_logic_vector(dmaaw - 1 downto 0);
+	signal m_axi_arvalid : std_logic;
+	signal m_axi_arready : std_logic;
+	signal m_axi_rdata : std_logic_vector(AXIDW - 1 downto 0);
+	signal m_axi_rresp : std_logic_vector(1 downto 0);
+	signal m_axi_rlast : std_logic;
+	signal m_axi_rvalid : std_logic;
+	signal m_axi_rready : std_logic;
+
 	-- A 32-bit number needs at most 10 decimal digits to be encoded in base 10.
 	type digit_array_type is array(0 to 9) of integer;
 
@@ -472,6 +615,21 @@ architecture sim of ecc_tb is
 		return so;
 	end function str_low_case;
 
+	-- Synthesis parameters the cycle count of a test depends on (other
+	-- than nn & the nb of blinding bits), to key the lines of CSV file
+	-- 'simcsv' with (see procedure cycles_log)
+	function cycles_config return string is
+	begin
+		return techno_type'image(techno)
+			& ";nbmult=" & integer'image(nbmult)
+			& ";nbdsp=" & integer'image(nbdsp)
+			& ";sramlat=" & integer'image(sramlat)
+			& ";hwsecure=" & boolean'image(hwsecure)
+			& ";shuffle=" & boolean'image(shuffle)
+			& ";shuffle_type=" & shuftype'image(shuffle_type)
+			& ";zremask=" & integer'image(zremask);
+	end function cycles_config;
+
 begin
 
 	-- Emulate AXI reset.
@@ -492,6 +650,14 @@ begin
 		wait for 3.333 ns;
 	end process;
 
+	-- Count AXI clock cycles.
+	process(s_axi_aclk)
+	begin
+		if s_axi_aclk'event and s_axi_aclk = '1' then
+			cycles <= cycles + 1;
+		end if;
+	end process;
+
 	-- Emulate clkmm clock (374 MHz).
 	process
 	begin
@@ -501,56 +667,223 @@ begin
 		wait for 1.336 ns;
 	end process;
 
-	-- DuT instance
-	e0: ecc
-		generic map(
-			C_S_AXI_DATA_WIDTH => AXIDW,
-			C_S_AXI_ADDR_WIDTH => AXIAW)
-		port map(
-			-- AXI clock & reset
-			s_axi_aclk => s_axi_aclk,
-			s_axi_aresetn => s_axi_aresetn,
-			-- AXI write-address channel
-			s_axi_awaddr => axi0.awaddr,
-			s_axi_awprot => axi0.awprot,
-			s_axi_awvalid => axi0.awvalid,
-			s_axi_awready => axo0.awready,
-			-- AXI write-data channel
-			s_axi_wdata => axi0.wdata,
-			s_axi_wstrb => axi0.wstrb,
-			s_axi_wvalid => axi0.wvalid,
-			s_axi_wready => axo0.wready,
-			-- AXI write-response channel
-			s_axi_bresp => axo0.bresp,
-			s_axi_bvalid => axo0.bvalid,
-			s_axi_bready => axi0.bready,
-			-- AXI read-address channel
-			s_axi_araddr => axi0.araddr,
-			s_axi_arprot => axi0.arprot,
-			s_axi_arvalid => axi0.arvalid,
-			s_axi_arready => axo0.arready,
-			--  AXI read-data channel
-			s_axi_rdata => axo0.rdata,
-			s_axi_rresp => axo0.rresp,
-			s_axi_rvalid => axo0.rvalid,
-			s_axi_rready => axi0.rready,
-			-- Clock for Montgomery multipliers in the async case
-			clkmm => clkmm,
-			-- Interrupt
-			irq => open,
-			-- General busy signal
-			busy => open,
-			-- HW secure/SCA analysis feature (off-chip trigger)
-			dbgtrigger => open,
-			dbghalted => open,
-			-- Pseudo-trng port
-			dbgptdata => dbgptdata,
-			dbgptvalid => dbgptvalid,
-			dbgptrdy => dbgptrdy,
-			-- clk & clkmm division & out feature
-			clkdivo => clkdivo,
-			clkmmdivo => clkmmdivo
-		);
+	-- DuT instance (ecc_dma_top only if the DMA engine is to be tested,
+	-- otherwise entity ecc, as integrations not using the engine do)
+	dma_g: if dma generate
+		e0: ecc_dma_top
+			generic map(
+				C_S_AXI_DATA_WIDTH => AXIDW,
+				C_S_AXI_ADDR_WIDTH => AXIAW,
+				simlog => simlog,
+				simxyshuflog => simxyshuflog,
+				simtrng => simtrng)
+			port map(
+				-- AXI clock & reset
+				s_axi_aclk => s_axi_aclk,
+				s_axi_aresetn => s_axi_aresetn,
+				-- AXI write-address channel
+				s_axi_awaddr => axi0.awaddr,
+				s_axi_awprot => axi0.awprot,
+				s_axi_awvalid => axi0.awvalid,
+				s_axi_awready => axo0.awready,
+				-- AXI write-data channel
+				s_axi_wdata => axi0.wdata,
+				s_axi_wstrb => axi0.wstrb,
+				s_axi_wvalid => axi0.wvalid,
+				s_axi_wready => axo0.wready,
+				-- AXI write-response channel
+				s_axi_bresp => axo0.bresp,
+				s_axi_bvalid => axo0.bvalid,
+				s_axi_bready => axi0.bready,
+				-- AXI read-address channel
+				s_axi_araddr => axi0.araddr,
+				s_axi_arprot => axi0.arprot,
+				s_axi_arvalid => axi0.arvalid,
+				s_axi_arready => axo0.arready,
+				--  AXI read-data channel
+				s_axi_rdata => axo0.rdata,
+				s_axi_rresp => axo0.rresp,
+				s_axi_rvalid => axo0.rvalid,
+				s_axi_rready => axi0.rready,
+				-- Clock for Montgomery multipliers in the async case
+				clkmm => clkmm,
+				-- Interrupt
+				irq => open,
+				-- General busy signal
+				busy => open,
+				-- HW secure/SCA analysis feature (off-chip trigger)
+				dbgtrigger => open,
+				dbghalted => open,
+				-- Pseudo-trng port
+				dbgptdata => dbgptdata,
+				dbgptvalid => dbgptvalid,
+				dbgptrdy => dbgptrdy,
+				-- clk & clkmm division & out feature
+				clkdivo => clkdivo,
+				clkmmdivo => clkmmdivo,
+				-- AXI4 master interface of the DMA engine
+				m_axi_awaddr => m_axi_awaddr,
+				m_axi_awlen => open,
+				m_axi_awsize => open,
+				m_axi_awburst => open,
+				m_axi_awcache => open,
+				m_axi_awprot => open,
+				m_axi_awvalid => m_axi_awvalid,
+				m_axi_awready => m_axi_awready,
+				m_axi_wdata => m_axi_wdata,
+				m_axi_wstrb => open,
+				m_axi_wlast => open,
+				m_axi_wvalid => m_axi_wvalid,
+				m_axi_wready => m_axi_wready,
+				m_axi_bresp => m_axi_bresp,
+				m_axi_bvalid => m_axi_bvalid,
+				m_axi_bready => m_axi_bready,
+				m_axi_araddr => m_axi_araddr,
+				m_axi_arlen => open,
+				m_axi_arsize => open,
+				m_axi_arburst => open,
+				m_axi_arcache => open,
+				m_axi_arprot => open,
+				m_axi_arvalid => m_axi_arvalid,
+				m_axi_arready => m_axi_arready,
+				m_axi_rdata => m_axi_rdata,
+				m_axi_rresp => m_axi_rresp,
+				m_axi_rlast => m_axi_rlast,
+				m_axi_rvalid => m_axi_rvalid,
+				m_axi_rready => m_axi_rready
+			);
+	end generate;
+
+	nodma_g: if not dma generate
+		e0: ecc
+			generic map(
+				C_S_AXI_DATA_WIDTH => AXIDW,
+				C_S_AXI_ADDR_WIDTH => AXIAW,
+				simlog => simlog,
+				simxyshuflog => simxyshuflog,
+				simtrng => simtrng)
+			port map(
+				-- AXI clock & reset
+				s_axi_aclk => s_axi_aclk,
+				s_axi_aresetn => s_axi_aresetn,
+				-- AXI write-address channel
+				s_axi_awaddr => axi0.awaddr,
+				s_axi_awprot => axi0.awprot,
+				s_axi_awvalid => axi0.awvalid,
+				s_axi_awready => axo0.awready,
+				-- AXI write-data channel
+				s_axi_wdata => axi0.wdata,
+				s_axi_wstrb => axi0.wstrb,
+				s_axi_wvalid => axi0.wvalid,
+				s_axi_wready => axo0.wready,
+				-- AXI write-response channel
+				s_axi_bresp => axo0.bresp,
+				s_axi_bvalid => axo0.bvalid,
+				s_axi_bready => axi0.bready,
+				-- AXI read-address channel
+				s_axi_araddr => axi0.araddr,
+				s_axi_arprot => axi0.arprot,
+				s_axi_arvalid => axi0.arvalid,
+				s_axi_arready => axo0.arready,
+				--  AXI read-data channel
+				s_axi_rdata => axo0.rdata,
+				s_axi_rresp => axo0.rresp,
+				s_axi_rvalid => axo0.rvalid,
+				s_axi_rready => axi0.rready,
+				-- Clock for Montgomery multipliers in the async case
+				clkmm => clkmm,
+				-- Interrupt
+				irq => open,
+				-- General busy signal
+				busy => open,
+				-- HW secure/SCA analysis feature (off-chip trigger)
+				dbgtrigger => open,
+				dbghalted => open,
+				-- Pseudo-trng port
+				dbgptdata => dbgptdata,
+				dbgptvalid => dbgptvalid,
+				dbgptrdy => dbgptrdy,
+				-- clk & clkmm division & out feature
+				clkdivo => clkdivo,
+				clkmmdivo => clkmmdivo
+			);
+		m_axi_awaddr <= (others => '0');
+		m_axi_awvalid <= '0';
+		m_axi_wdata <= (others => '0');
+		m_axi_wvalid <= '0';
+		m_axi_bready <= '0';
+		m_axi_araddr <= (others => '0');
+		m_axi_arvalid <= '0';
+		m_axi_rready <= '0';
+	end generate;
+
+	-- Behavioural model of system memory (AXI4 slave, single-beat transfers
+	-- as the ones issued by the DMA engine). Out-of-range accesses get a
+	-- SLVERR response.
+	m_axi_rlast <= '1';
+	dmamem0: process(s_axi_aclk)
+		variable awpend, wpend : boolean;
+		variable waddr : natural;
+		variable wdata : std_logic_vector(AXIDW - 1 downto 0);
+		variable raddr : natural;
+	begin
+		if s_axi_aclk'event and s_axi_aclk = '1' then
+			if s_axi_aresetn = '0' then
+				awpend := FALSE;
+				wpend := FALSE;
+				m_axi_awready <= '1';
+				m_axi_wready <= '1';
+				m_axi_bvalid <= '0';
+				m_axi_arready <= '1';
+				m_axi_rvalid <= '0';
+			else
+				-- write channels
+				if m_axi_awvalid = '1' and m_axi_awready = '1' then
+					awpend := TRUE;
+					waddr := to_integer(unsigned(m_axi_awaddr)) / (AXIDW / 8);
+					m_axi_awready <= '0';
+				end if;
+				if m_axi_wvalid = '1' and m_axi_wready = '1' then
+					wpend := TRUE;
+					wdata := m_axi_wdata;
+					m_axi_wready <= '0';
+				end if;
+				if m_axi_bvalid = '1' and m_axi_bready = '1' then
+					m_axi_bvalid <= '0';
+					m_axi_awready <= '1';
+					m_axi_wready <= '1';
+				end if;
+				if awpend and wpend then
+					awpend := FALSE;
+					wpend := FALSE;
+					if waddr < DMAMEM_WORDS then
+						dmamem(waddr) := wdata;
+						m_axi_bresp <= "00";
+					else
+						m_axi_bresp <= "10";
+					end if;
+					m_axi_bvalid <= '1';
+				end if;
+				-- read channels
+				if m_axi_rvalid = '1' and m_axi_rready = '1' then
+					m_axi_rvalid <= '0';
+					m_axi_arready <= '1';
+				end if;
+				if m_axi_arvalid = '1' and m_axi_arready = '1' then
+					raddr := to_integer(unsigned(m_axi_araddr)) / (AXIDW / 8);
+					m_axi_arready <= '0';
+					if raddr < DMAMEM_WORDS then
+						m_axi_rdata <= dmamem(raddr);
+						m_axi_rresp <= "00";
+					else
+						m_axi_rdata <= (others => 'X');
+						m_axi_rresp <= "10";
+					end if;
+					m_axi_rvalid <= '1';
+				end if;
+			end if;
+		end if;
+	end process dmamem0;
 
 	-- Pseudo TRNG device
 	pt0: pseudo_trng
@@ -595,7 +928,7 @@ begin
 	-- --------------------------------------
 	steam: process
 		-- Input file (containing input test-vectors)
-		file fvin : text open read_mode is simvecfile;
+		file fvin : text open read_mode is simvec;
 		variable tline : line;
 		variable rdok : boolean;
 		-- A few strings used while parsing input test-vectors file
@@ -693,6 +1026,43 @@ begin
 		variable stats_ok: natural;
 		variable stats_nok: natural;
 		variable stats_total: natural;
+		-- Cycle counts (see procedures cycles_start & cycles_log)
+		file fcsv : text open write_mode is simcsv;
+		variable csvline : line;
+		variable curve_label : string(1 to 256);
+		variable curve_label_sz : natural := 0;
+		variable cycles_t0 : natural;
+		-- DMA engine (option dma = TRUE in ecc_customize.vhd)
+		variable dma_jobs : natural := 0;
+		variable dma_nbw : natural := 0;
+		variable dma_desc : natural;
+		variable dma_buserr : boolean;
+		variable dma_status : std_logic_vector(AXIDW - 1 downto 0);
+		variable dma_kpx_val : std_logic1024;
+		variable dma_kpy_val : std_logic1024;
+		variable dma_token : std_logic1024;
+
+		-- Store a large number into the behavioural memory (less significant
+		-- word first, as it would be written to W_WRITE_DATA)
+		procedure dma_put_big(
+			constant word : in natural;
+			constant bignb : in std_logic1024) is
+		begin
+			for i in 0 to dma_nbw - 1 loop
+				dmamem(word + i) := bignb((AXIDW * i) + AXIDW - 1 downto AXIDW * i);
+			end loop;
+		end procedure dma_put_big;
+
+		-- Fetch a large number from the behavioural memory
+		procedure dma_get_big(
+			constant word : in natural;
+			variable bignb : out std_logic1024) is
+		begin
+			bignb := (others => '0');
+			for i in 0 to dma_nbw - 1 loop
+				bignb((AXIDW * i) + AXIDW - 1 downto AXIDW * i) := dmamem(word + i);
+			end loop;
+		end procedure dma_get_big;
 
 		procedure print_stats_and_exit is
 		begin
@@ -710,6 +1080,78 @@ begin
 			end if;
 		end procedure print_stats_and_possibly_exit;
 
+		-- Called just before the test (current value of 'op') is submitted
+		-- to the IP.
+		procedure cycles_start is
+		begin
+			if perfcnt then
+				perf_clear(s_axi_aclk, axi0, axo0);
+			end if;
+			cycles_t0 := cycles;
+		end procedure cycles_start;
+
+		-- Called just after the IP has completed the test (current value of
+		-- 'op'): append one line to CSV file 'simcsv' with the nb of cycles
+		-- the test took, as seen by the testbench (from the transfer of the
+		-- operands until the IP is ready again, hence including the AXI
+		-- accesses of the driver) and, if the IP has performance counters
+		-- ('perfcnt' = TRUE), as seen by the IP (the nb of cycles it was busy
+		-- with the command, and for a [k]P the part of them spent in each
+		-- of its three phases: setup, main loop & exit).
+		procedure cycles_log is
+			variable cyc, cnt : natural;
+			variable sel : natural range 0 to PERF_NB - 1;
+			variable i0 : natural;
+		begin
+			cyc := cycles - cycles_t0;
+			case op is
+				when OP_KP => write(csvline, string'("kP")); sel := PERF_KP;
+				when OP_PTADD => write(csvline, string'("PTADD")); sel := PERF_PT_ADD;
+				when OP_PTDBL => write(csvline, string'("PTDBL")); sel := PERF_PT_DBL;
+				when OP_PTNEG => write(csvline, string'("PTNEG")); sel := PERF_PT_NEG;
+				when OP_TST_CHK => write(csvline, string'("CHK")); sel := PERF_PT_CHK;
+				when OP_TST_EQU => write(csvline, string'("EQU")); sel := PERF_PT_EQU;
+				when OP_TST_OPP => write(csvline, string'("OPP")); sel := PERF_PT_OPP;
+				when others => write(csvline, string'("NONE")); sel := PERF_KP;
+			end case;
+			-- test & curve labels (without leading spaces)
+			write(csvline, string'(","));
+			i0 := 1;
+			while i0 <= test_label_sz and test_label(i0) = ' ' loop
+				i0 := i0 + 1;
+			end loop;
+			if i0 <= test_label_sz then
+				write(csvline, test_label(i0 to test_label_sz));
+			end if;
+			write(csvline, string'(","));
+			i0 := 1;
+			while i0 <= curve_label_sz and curve_label(i0) = ' ' loop
+				i0 := i0 + 1;
+			end loop;
+			if i0 <= curve_label_sz then
+				write(csvline, curve_label(i0 to curve_label_sz));
+			end if;
+			write(csvline, "," & integer'image(valnn) & "," & integer'image(nbbld)
+				& "," & cycles_config & "," & integer'image(cyc));
+			if perfcnt then
+				perf_read(s_axi_aclk, axi0, axo0, sel, cnt);
+				write(csvline, "," & integer'image(cnt));
+				if op = OP_KP then
+					perf_read(s_axi_aclk, axi0, axo0, PERF_KP_SETUP, cnt);
+					write(csvline, "," & integer'image(cnt));
+					perf_read(s_axi_aclk, axi0, axo0, PERF_KP_LADDER, cnt);
+					write(csvline, "," & integer'image(cnt));
+					perf_read(s_axi_aclk, axi0, axo0, PERF_KP_EXIT, cnt);
+					write(csvline, "," & integer'image(cnt));
+				else
+					write(csvline, string'(",,,"));
+				end if;
+			else
+				write(csvline, string'(",,,,"));
+			end if;
+			writeline(fcsv, csvline);
+		end procedure cycles_log;
+
 	begin
 
 		--
@@ -760,8 +1202,8 @@ begin
 		-- End of IP initialization & config
 
 		-- -----------------------------------------------------------------
-		-- Main infinite loop, getting lines from input file 'simvecfile'
-		-- (parameter defined in ecc_customize.vhd) to extract:
+		-- Main infinite loop, getting lines from input file 'simvec'
+		-- (generic defaulting to 'simvecfile' in ecc_customize.vhd) to extract:
 		--   - input vectors
 		--   - type of operation
 		--   - expected result,
@@ -770,14 +1212,17 @@ begin
 		-- -----------------------------------------------------------------
 
 		echol("[     ecc_tb.vhd ]: Reading test-vectors from input file: """
-			& simvecfile & """");
+			& simvec & """");
 
 		echol("[     ecc_tb.vhd ]: Execution traced in output file: """
-			& simlogfile & """");
+			& simlog & """");
 
 		nbbld := 0; op := OP_NONE; line_type_expected := EXPECT_NONE;
 		stats_ok := 0; stats_nok := 0; stats_total := 0;
 
+		write(csvline, string'("op,test,curve,nn,nbbld,config,cycles,busy,setup,ladder,exit"));
+		writeline(fcsv, csvline);
+
 		while not endfile(fvin) loop
 			-- Read a new line from input test-vectors file.
 			readline(fvin, tline);
@@ -793,7 +1238,7 @@ begin
 			read(tline, nline(1 to tline'length), rdok);
 			if not rdok then
 				echol("[     ecc_tb.vhd ]: ERROR: While reading one line " &
-						"from" & """" & simvecfile & " file. Aborting.");
+						"from" & """" & simvec & " file. Aborting.");
 				print_stats_and_exit;
 			end if;
 			--
@@ -821,11 +1266,16 @@ begin
 						--
 						echo("[     ecc_tb.vhd ]: ==== NEW CURVE");
 						-- print anything that may follow "NEW CURVE"
+						curve_label_sz := 0;
 						for i in 13 to line_length loop
 							if nline(i) = LF then
 								exit;
 							else
 								echoc(nline(i));
+								if curve_label_sz < curve_label'length then
+									curve_label_sz := curve_label_sz + 1;
+									curve_label(curve_label_sz) := nline(i);
+								end if;
 							end if;
 						end loop;
 						echol("");
@@ -1331,12 +1781,14 @@ begin
 						-- infinity.
 						-- Hence here it is set to 'sw_p_is_null' according to what was given
 						-- in the input test-vectors file.
+						cycles_start;
 						scalar_mult(s_axi_aclk, axi0, axo0, valnn, k_val, px_val, py_val,
 							sw_p_is_null);
 						--
 						-- Poll until IP has completed computation and is ready.
 						--
 						poll_until_ready(s_axi_aclk, axi0, axo0);
+						cycles_log;
 						-- Check & display possible errors.
 						display_errors(s_axi_aclk, axi0, axo0);
 						-- Check if R1 is null.
@@ -1426,12 +1878,14 @@ begin
 							-- infinity.
 							-- Hence here it is set to 'sw_p_is_null' according to what was given
 							-- in the input test-vectors file.
+							cycles_start;
 							scalar_mult(s_axi_aclk, axi0, axo0, valnn, k_val, px_val, py_val,
 								sw_p_is_null);
 							--
 							-- Poll until IP has completed computation and is ready.
 							--
 							poll_until_ready(s_axi_aclk, axi0, axo0);
+							cycles_log;
 							-- Check & display possible errors.
 							display_errors(s_axi_aclk, axi0, axo0);
 							-- Check if R1 is null.
@@ -1472,6 +1926,76 @@ begin
 							end if;
 							-- Acknowledge possible errors.
 							ack_all_errors(s_axi_aclk, axi0, axo0);
+							--
+							-- If the IP embeds the DMA engine, run the same [k]P computation
+							-- again, this time through the descriptor ring (curve parameters
+							-- are reloaded by the engine as part of the job).
+							--
+							if dma then
+								if dma_nbw /= div(valnn, AXIDW) then
+									dma_nbw := div(valnn, AXIDW);
+									dma_configure(s_axi_aclk, axi0, axo0,
+										DMAMEM_RING * (AXIDW / 8), DMA_LOG2SZ, dma_nbw);
+									dma_jobs := 0;
+								end if;
+								dma_put_big(DMAMEM_CURVE + (0 * dma_nbw), p_val);
+								dma_put_big(DMAMEM_CURVE + (1 * dma_nbw), a_val);
+								dma_put_big(DMAMEM_CURVE + (2 * dma_nbw), b_val);
+								dma_put_big(DMAMEM_CURVE + (3 * dma_nbw), q_val);
+								dma_put_big(DMAMEM_IN + (0 * dma_nbw), px_val);
+								dma_put_big(DMAMEM_IN + (1 * dma_nbw), py_val);
+								dma_put_big(DMAMEM_IN + (4 * dma_nbw), k_val);
+								dma_desc := DMAMEM_RING
+									+ ((dma_jobs mod (2**DMA_LOG2SZ)) * DMA_DESC_WORDS);
+								dmamem(dma_desc + DMA_DESC_CMD) := (others => '0');
+								dmamem(dma_desc + DMA_DESC_CMD)(CTRL_KP) := '1';
+								dmamem(dma_desc + DMA_DESC_CMD)(DMA_CMD_LOAD_CURVE) := '1';
+								if sw_p_is_null then
+									dmamem(dma_desc + DMA_DESC_CMD)(DMA_CMD_P_NULL) := '1';
+								end if;
+								dmamem(dma_desc + DMA_DESC_CURVE) :=
+									std_logic_vector(to_unsigned(DMAMEM_CURVE * (AXIDW / 8), AXIDW));
+								dmamem(dma_desc + DMA_DESC_IN) :=
+									std_logic_vector(to_unsigned(DMAMEM_IN * (AXIDW / 8), AXIDW));
+								dmamem(dma_desc + DMA_DESC_OUT) :=
+									std_logic_vector(to_unsigned(DMAMEM_OUT * (AXIDW / 8), AXIDW));
+								dmamem(dma_desc + DMA_DESC_STATUS) := (others => '0');
+								dma_enable(s_axi_aclk, axi0, axo0, TRUE);
+								dma_set_prod(s_axi_aclk, axi0, axo0, dma_jobs + 1);
+								dma_poll_until_consumed(s_axi_aclk, axi0, axo0, dma_jobs + 1,
+									dma_buserr);
+								dma_enable(s_axi_aclk, axi0, axo0, FALSE);
+								dma_jobs := dma_jobs + 1;
+								dma_status := dmamem(dma_desc + DMA_DESC_STATUS);
+								dma_get_big(DMAMEM_OUT + (0 * dma_nbw), dma_kpx_val);
+								dma_get_big(DMAMEM_OUT + (1 * dma_nbw), dma_kpy_val);
+								dma_get_big(DMAMEM_OUT + (2 * dma_nbw), dma_token);
+								echo_test_label(test_label, test_label_sz, "[k]P (DMA)");
+								if dma_buserr then
+									echol(" **** FAILED! **** DMA engine reported a bus error.");
+									stats_nok := stats_nok + 1;
+									assert CONTINUE_ON_ERROR severity FAILURE;
+								elsif dma_status(DMA_DST_DONE) = '0'
+									or dma_status(DMA_DST_ERR) = '1'
+									or dma_status(DMA_DST_R1_NULL) = '1'
+								then
+									echo(" **** FAILED! **** Unexpected descriptor status: 0x");
+									hex_echol(dma_status);
+									stats_nok := stats_nok + 1;
+									assert CONTINUE_ON_ERROR severity FAILURE;
+								elsif compare_two_points_coords(sw_kpx_val, sw_kpy_val,
+									dma_kpx_val xor dma_token, dma_kpy_val xor dma_token, valnn)
+								then
+									echol(" - SUCCESSFULL: [k]P point coordinates match the ones given "
+										& "in the input test-vectors file.");
+									stats_ok := stats_ok + 1;
+								else
+									echol(" **** FAILED! **** Mismatch on points coordinates.");
+									stats_nok := stats_nok + 1;
+									assert CONTINUE_ON_ERROR severity FAILURE;
+								end if;
+								stats_total := stats_total + 1;
+							end if;
 
 						else -- not rdok
 							echol("[     ecc_tb.vhd ]: ERROR: Wrong syntax in input file "
@@ -1523,12 +2047,14 @@ begin
 						-- Hence here they are set to 'sw_p_is_null' (resp. sw_q_is_null)
 						-- according to what was given in the input test-vectors file.
 						--
+						cycles_start;
 						point_add(s_axi_aclk, axi0, axo0, valnn, px_val, py_val, qx_val,
 							qy_val, sw_p_is_null, sw_q_is_null);
 						--
 						-- Poll until IP has completed computation and is ready.
 						--
 						poll_until_ready(s_axi_aclk, axi0, axo0);
+						cycles_log;
 						-- Check & display possible errors.
 						display_errors(s_axi_aclk, axi0, axo0);
 						-- Check if result P + Q (now buffered in R1) is null.
@@ -1580,12 +2106,14 @@ begin
 							-- Hence here they are set to 'sw_p_is_null' (resp. sw_q_is_null)
 							-- according to what was given in the input test-vectors file.
 							--
+							cycles_start;
 							point_add(s_axi_aclk, axi0, axo0, valnn, px_val, py_val, qx_val,
 								qy_val, sw_p_is_null, sw_q_is_null);
 							--
 							-- Poll until IP has completed computation and is ready.
 							--
 							poll_until_ready(s_axi_aclk, axi0, axo0);
+							cycles_log;
 							-- Check & display possible errors.
 							display_errors(s_axi_aclk, axi0, axo0);
 							-- Check if result P + Q (now buffered in R1) is null.
@@ -1686,12 +2214,14 @@ begin
 						-- Hence here it is set to 'sw_p_is_null' according to what was
 						-- given in the input test-vectors file.
 						--
+						cycles_start;
 						point_double(s_axi_aclk, axi0, axo0, valnn, px_val, py_val,
 							sw_p_is_null);
 						--
 						-- Poll until IP has completed computation and is ready.
 						--
 						poll_until_ready(s_axi_aclk, axi0, axo0);
+						cycles_log;
 						-- Check & display possible errors.
 						display_errors(s_axi_aclk, axi0, axo0);
 						-- Check if result [2]P (now buffered in R1) is null.
@@ -1743,12 +2273,14 @@ begin
 							-- Hence it is set to 'sw_p_is_null' according to what was
 							-- given in the input test-vectors file.
 							--
+							cycles_start;
 							point_double(s_axi_aclk, axi0, axo0, valnn, px_val, py_val,
 								sw_p_is_null);
 							--
 							-- Poll until IP has completed computation and is ready.
 							--
 							poll_until_ready(s_axi_aclk, axi0, axo0);
+							cycles_log;
 							-- Check & display possible errors.
 							display_errors(s_axi_aclk, axi0, axo0);
 							-- Check if result [2]P (now buffered in R1) is null.
@@ -1849,12 +2381,14 @@ begin
 						-- Hence here it is set to 'sw_p_is_null' according to what was
 						-- given in the input test-vectors file.
 						--
+						cycles_start;
 						point_negate(s_axi_aclk, axi0, axo0, valnn, px_val, py_val,
 							sw_p_is_null);
 						--
 						-- Poll until IP has completed computation and is ready.
 						--
 						poll_until_ready(s_axi_aclk, axi0, axo0);
+						cycles_log;
 						-- Check & display possible errors.
 						display_errors(s_axi_aclk, axi0, axo0);
 						-- Check if result -P (now buffered in R1) is null.
@@ -1906,12 +2440,14 @@ begin
 							-- Hence it is set to 'sw_p_is_null' according to what was
 							-- given in the input test-vectors file.
 							--
+							cycles_start;
 							point_negate(s_axi_aclk, axi0, axo0, valnn, px_val, py_val,
 								sw_p_is_null);
 							--
 							-- Poll until IP has completed computation and is ready.
 							--
 							poll_until_ready(s_axi_aclk, axi0, axo0);
+							cycles_log;
 							-- Check & display possible errors.
 							display_errors(s_axi_aclk, axi0, axo0);
 							-- Check if result -P (now buffered in R1) is null.
@@ -1993,6 +2529,7 @@ begin
 					-- Set point(s) to do the test on, according to parameters
 					-- extracted from the input test-vectors file.
 					--
+					cycles_start;
 					case op is
 						when OP_TST_CHK =>
 							point_test_on_curve(s_axi_aclk, axi0, axo0, valnn, px_val, py_val,
@@ -2011,6 +2548,7 @@ begin
 					-- Poll until IP has completed computation and is ready.
 					--
 					poll_until_ready(s_axi_aclk, axi0, axo0);
+					cycles_log;
 					-- Check & display possible errors.
 					display_errors(s_axi_aclk, axi0, axo0);
 					-- Get answer to test from DuT.
@@ -2102,8 +2640,8 @@ begin
 	-- it was left here as is.
 	-- ------------------------------------------------------------------
 	process
-		-- Value of 'simtrngfile' is set in 'ecc_customize'.
-		file psfr: text is simtrngfile;
+		-- Value of 'simtrng' defaults to 'simtrngfile' set in 'ecc_customize'.
+		file psfr: text is simtrng;
 		variable tline : line;
 		variable nb : integer;
 		variable nbl : integer := 1;
@@ -694,6 +694,74 @@ package ecc_tb_pkg is
 		signal axi: out axi_in_type;
 		signal axo: in axi_out_type);
 
+	-- Emulate software driver programming the DMA engine & resetting the
+	-- ring indexes (option dma = TRUE in ecc_customize.vhd)
+	procedure dma_configure(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant base : in natural; -- bus address of the descriptor ring
+		constant log2sz : in natural; -- ring holds 2**log2sz descriptors
+		constant nbw : in positive); -- nb of words per large number
+
+	-- Emulate software driver enabling/disabling the DMA engine (software
+	-- can access the nominal registers of the IP only while it is disabled)
+	procedure dma_enable(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant en : in boolean);
+
+	-- Emulate software driver advancing the producer index of the DMA ring
+	procedure dma_set_prod(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant prod : in natural);
+
+	-- Emulate software driver polling R_DMA_STATUS until the consumer index
+	-- of the DMA ring reaches 'cons' (or a bus error is reported)
+	procedure dma_poll_until_consumed(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant cons : in natural;
+		variable buserr : out boolean);
+
+	-- Emulate software driver clearing all performance counters
+	-- (option perfcnt = TRUE in ecc_customize.vhd)
+	procedure perf_clear(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type);
+
+	-- Emulate software driver reading one performance counter
+	-- (option perfcnt = TRUE in ecc_customize.vhd)
+	procedure perf_read(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant sel : in natural range 0 to PERF_NB - 1;
+		variable cnt : out natural);
+
+	-- Write any register ('addr' is the byte offset of the register, as
+	-- issued by the software driver through the co-simulation bridge,
+	-- see ecc_cosim.vhd)
+	procedure axi_write(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant addr : in natural;
+		constant data : in std_logic_vector(AXIDW - 1 downto 0));
+
+	-- Read any register (same remark as for 'axi_write')
+	procedure axi_read(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant addr : in natural;
+		variable data : out std_logic_vector(AXIDW - 1 downto 0));
+
 end package ecc_tb_pkg;
 
 package body ecc_tb_pkg is
@@ -3071,4 +3139,216 @@ package body ecc_tb_pkg is
 		wait until clk'event and clk = '1';
 	end procedure debug_trng_nnrnd_not_deterministic;
 
+
+	procedure dma_configure(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant base : in natural;
+		constant log2sz : in natural;
+		constant nbw : in positive)
+	is
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+	begin
+		-- reset ring indexes (engine is still disabled)
+		wait until clk'event and clk = '1';
+		axi.awaddr <= W_DMA_CTRL & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		dw(DMA_CTRL_RESET) := '1';
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		-- write W_DMA_RING_BASE register
+		wait until clk'event and clk = '1';
+		axi.awaddr <= W_DMA_RING_BASE & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		axi.wdata <= std_logic_vector(to_unsigned(base, AXIDW)); axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		-- write W_DMA_RING_CFG register
+		wait until clk'event and clk = '1';
+		axi.awaddr <= W_DMA_RING_CFG & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		dw(DMA_CFG_LOG2SZ_MSB downto DMA_CFG_LOG2SZ_LSB) :=
+			std_logic_vector(to_unsigned(log2sz, DMA_CFG_LOG2SZ_MSB - DMA_CFG_LOG2SZ_LSB + 1));
+		dw(DMA_CFG_NBW_MSB downto DMA_CFG_NBW_LSB) :=
+			std_logic_vector(to_unsigned(nbw, DMA_CFG_NBW_MSB - DMA_CFG_NBW_LSB + 1));
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+	end procedure dma_configure;
+
+	procedure dma_enable(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant en : in boolean)
+	is
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+	begin
+		-- write W_DMA_CTRL register (IRQ left disabled, the testbench polls)
+		wait until clk'event and clk = '1';
+		axi.awaddr <= W_DMA_CTRL & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		if en then
+			dw(DMA_CTRL_EN) := '1';
+		end if;
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+	end procedure dma_enable;
+
+	procedure dma_set_prod(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant prod : in natural)
+	is
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+	begin
+		wait until clk'event and clk = '1';
+		axi.awaddr <= W_DMA_PROD & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		dw(DMA_PROD_MSB downto DMA_PROD_LSB) :=
+			std_logic_vector(to_unsigned(prod mod (2**DMA_IDX_SZ), DMA_IDX_SZ));
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+	end procedure dma_set_prod;
+
+	procedure dma_poll_until_consumed(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant cons : in natural;
+		variable buserr : out boolean) is
+	begin
+		buserr := FALSE;
+		loop
+			wait until clk'event and clk = '1';
+			-- read R_DMA_STATUS register
+			axi.araddr <= R_DMA_STATUS & "000";
+			axi.arvalid <= '1';
+			wait until clk'event and clk = '1' and axo.arready = '1';
+			axi.araddr <= (others => 'X');
+			axi.arvalid <= '0';
+			axi.rready <= '1';
+			wait until clk'event and clk = '1' and axo.rvalid = '1';
+			axi.rready <= '0';
+			if axo.rdata(DMA_STS_BUS_ERR) = '1' then
+				buserr := TRUE;
+				exit;
+			elsif to_integer(unsigned(axo.rdata(DMA_STS_CONS_MSB downto
+				DMA_STS_CONS_LSB))) = cons mod (2**DMA_IDX_SZ)
+			then
+				exit;
+			end if;
+		end loop;
+	end procedure dma_poll_until_consumed;
+
+	procedure perf_clear(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type)
+	is
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+	begin
+		wait until clk'event and clk = '1';
+		-- write W_PERF_CTRL register
+		axi.awaddr <= W_PERF_CTRL & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		dw(PERF_CTRL_CLR) := '1';
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+	end procedure perf_clear;
+
+	procedure perf_read(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant sel : in natural range 0 to PERF_NB - 1;
+		variable cnt : out natural)
+	is
+		variable dw : std_logic_vector(AXIDW - 1 downto 0);
+	begin
+		wait until clk'event and clk = '1';
+		-- write W_PERF_CTRL register (select counter)
+		axi.awaddr <= W_PERF_CTRL & "000"; axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		dw := (others => '0');
+		dw(PERF_CTRL_SEL_MSB downto PERF_CTRL_SEL_LSB) := std_logic_vector(
+			to_unsigned(sel, PERF_CTRL_SEL_MSB - PERF_CTRL_SEL_LSB + 1));
+		axi.wdata <= dw; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+		-- read R_PERF_DATA register
+		axi.araddr <= R_PERF_DATA & "000";
+		axi.arvalid <= '1';
+		wait until clk'event and clk = '1' and axo.arready = '1';
+		axi.araddr <= (others => 'X');
+		axi.arvalid <= '0';
+		axi.rready <= '1';
+		wait until clk'event and clk = '1' and axo.rvalid = '1';
+		axi.rready <= '0';
+		-- (counters are 32-bit wide & wrap around, they're cleared before
+		-- each test so 31 bits are more than enough here)
+		cnt := to_integer(unsigned(axo.rdata(30 downto 0)));
+		wait until clk'event and clk = '1';
+	end procedure perf_read;
+
+	procedure axi_write(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant addr : in natural;
+		constant data : in std_logic_vector(AXIDW - 1 downto 0)) is
+	begin
+		wait until clk'event and clk = '1';
+		axi.awaddr <= std_logic_vector(to_unsigned(addr, AXIAW));
+		axi.awvalid <= '1';
+		wait until clk'event and clk = '1' and axo.awready = '1';
+		axi.awaddr <= (others => 'X'); axi.awvalid <= '0';
+		axi.wdata <= data; axi.wvalid <= '1';
+		wait until clk'event and clk = '1' and axo.wready = '1';
+		axi.wdata <= (others => 'X'); axi.wvalid <= '0';
+		wait until clk'event and clk = '1';
+	end procedure axi_write;
+
+	procedure axi_read(
+		signal clk: in std_logic;
+		signal axi: out axi_in_type;
+		signal axo: in axi_out_type;
+		constant addr : in natural;
+		variable data : out std_logic_vector(AXIDW - 1 downto 0)) is
+	begin
+		wait until clk'event and clk = '1';
+		axi.araddr <= std_logic_vector(to_unsigned(addr, AXIAW));
+		axi.arvalid <= '1';
+		wait until clk'event and clk = '1' and axo.arready = '1';
+		axi.araddr <= (others => 'X');
+		axi.arvalid <= '0';
+		axi.rready <= '1';
+		wait until clk'event and clk = '1' and axo.rvalid = '1';
+		axi.rready <= '0';
+		data := axo.rdata;
+	end procedure axi_read;
+
 end package body;
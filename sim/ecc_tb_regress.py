@@ -0,0 +1,228 @@
+#
+#  Copyright (C) 2023 - This file is part of IPECC project
+#
+#  Authors:
+#      Karim KHALFALLAH <karim.khalfallah@ssi.gouv.fr>
+#      Ryad BENADJILA <ryadbenadjila@gmail.com>
+#
+#  Contributors:
+#      Adrian THILLARD
+#      Emmanuel PROUFF
+#
+#  This software is licensed under GPL v2 license.
+#  See LICENSE file at the root folder of the project.
+#
+
+# Sharded regression runner for ecc_tb.
+#
+# The input test-vectors file is split at its "== NEW CURVE" lines
+# into N shards (each curve along with all of its tests goes into one
+# and only one shard, shards being balanced according to the nb of
+# tests & to the size of the curves) and N instances of the testbench
+# executable (as elaborated by 'make' in this folder) are run in
+# parallel, each one in its own directory & with its own vector, log
+# and TRNG files, which are passed to it through the generics of
+# ecc_tb (simvec, simlog, simxyshuflog, simtrng & simcsv).
+#
+# When the testbench reaches the end of its vector file it prints
+# the statistics of its tests and waits indefinitely, so the runner
+# stops it at that point. The statistics of all shards are merged,
+# as well as the cycle counts of their tests (into DIR/ecc_cycles.csv,
+# see ecc_cycles_compare.py).
+# Exit status is 0 if all tests of all shards passed, 1 otherwise.
+#
+# Usage:
+#   python3 ecc_tb_regress.py [-j N] [-o DIR] [-t TRNGFILE] [-c]
+#                             [--tb EXE] VECFILE [-- GHDL-RUN-OPTIONS]
+#
+# If TRNGFILE contains "%d" it is replaced by the index of the shard
+# (so that each shard can be fed with its own random file), otherwise
+# all shards read the same file (which is only ever opened read-only).
+
+import re, sys, os, time, argparse, subprocess, threading
+import ecc_cycles_compare
+
+class bcolors:
+    OKCYAN = '\033[96m'
+    OKGREEN = '\033[92m'
+    FAIL = '\033[91m'
+    ENDC = '\033[0m'
+
+def print_info(inf, msg, color=bcolors.OKCYAN):
+    if sys.stdout.isatty():
+        print(color + inf + bcolors.ENDC + msg)
+    else:
+        print(inf + msg)
+    sys.stdout.flush()
+
+# Weight of one test on a curve of 'nn' bits (a [k]P dominates and
+# its cost grows roughly as nn^3: nn iterations of nn^2 multiplies)
+def test_weight(nn):
+    return max(nn, 1) ** 3
+
+# Split the content of a vector file into a header (lines before
+# the first "== NEW CURVE") & a list of curve blocks
+def split_curves(lines):
+    header = []
+    curves = []
+    for l in lines:
+        if l.startswith("== NEW CURVE"):
+            curves.append([l])
+        elif len(curves) == 0:
+            header.append(l)
+        else:
+            curves[-1].append(l)
+    return header, curves
+
+def curve_weight(block):
+    nn = 0
+    nbtests = 0
+    for l in block:
+        m = re.match(r"^nn=([0-9]+)", l)
+        if m is not None:
+            nn = int(m.group(1))
+        elif l.startswith("== TEST"):
+            nbtests += 1
+    return max(nbtests, 1) * test_weight(nn), nbtests
+
+# Distribute curve blocks over (at most) 'nbshards' shards, heaviest
+# ones first, each time in the lightest shard (curves keep their
+# original relative order inside a shard)
+def make_shards(curves, nbshards):
+    nbshards = max(1, min(nbshards, len(curves)))
+    weights = [curve_weight(c) for c in curves]
+    order = sorted(range(len(curves)), key=lambda i: -weights[i][0])
+    shards = [[] for _ in range(nbshards)]
+    load = [0] * nbshards
+    for i in order:
+        s = load.index(min(load))
+        shards[s].append(i)
+        load[s] += weights[i][0]
+    return [(sorted(s), sum(weights[i][1] for i in s)) for s in shards]
+
+# Statistics as printed by ecc_tb, either at end of file or when
+# aborting on error ("Statistics so far: ok = ..., nok = ..., total = ...")
+RE_EOF = re.compile(r"End of testbench simulation \(EOF\)")
+RE_STAT = re.compile(r"^\[\s*ecc_tb\.vhd \]:\s+(ok|nok|total) = ([0-9]+)")
+RE_STAT_SO_FAR = re.compile(r"Statistics so far: ok = ([0-9]+), nok = ([0-9]+), total = ([0-9]+)")
+
+class Shard:
+    def __init__(self, index, workdir):
+        self.index = index
+        self.workdir = workdir
+        self.stats = {"ok": 0, "nok": 0, "total": 0}
+        self.eof = False
+        self.ret = None
+        self.time = 0.0
+        self.nbtests = 0
+        self.cmd = None
+
+    def run(self, cmd):
+        t0 = time.time()
+        with open(os.path.join(self.workdir, "ecc_tb.out"), "w") as out:
+            p = subprocess.Popen(cmd, cwd=self.workdir, stdout=subprocess.PIPE,
+                    stderr=subprocess.STDOUT, universal_newlines=True, errors="replace")
+            for l in p.stdout:
+                out.write(l)
+                if RE_EOF.search(l) is not None:
+                    self.eof = True
+                    continue
+                m = RE_STAT_SO_FAR.search(l)
+                if m is not None:
+                    self.stats = {"ok": int(m.group(1)), "nok": int(m.group(2)), "total": int(m.group(3))}
+                    continue
+                m = RE_STAT.search(l)
+                if self.eof and m is not None:
+                    self.stats[m.group(1)] = int(m.group(2))
+                    if m.group(1) == "total":
+                        # the testbench now waits indefinitely
+                        p.terminate()
+                        break
+            p.stdout.close()
+            self.ret = p.wait()
+        self.time = time.time() - t0
+
+    def passed(self):
+        return self.eof and self.stats["nok"] == 0
+
+def main():
+    parser = argparse.ArgumentParser(description="Sharded parallel regression runner for ecc_tb")
+    parser.add_argument("vecfile", help="input test-vectors file")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+            help="nb of shards run in parallel (default: nb of cores)")
+    parser.add_argument("-o", "--outdir", default="regress",
+            help="output directory (one subdirectory per shard, default: regress)")
+    parser.add_argument("-t", "--trng", default="/tmp/random.txt",
+            help="TRNG input file, %%d is replaced by the shard index (default: /tmp/random.txt)")
+    parser.add_argument("-c", "--continue-on-error", action="store_true",
+            help="do not stop a shard upon its first failed test")
+    parser.add_argument("--tb", default="./ecc_tb",
+            help="testbench executable (default: ./ecc_tb)")
+    parser.add_argument("ghdlopts", nargs="*",
+            help="extra run-time options (default: --ieee-asserts=disable)")
+    args = parser.parse_args()
+
+    with open(args.vecfile, "r") as f:
+        lines = f.readlines()
+    header, curves = split_curves(lines)
+    if len(curves) == 0:
+        print_info("Error: ", "no \"== NEW CURVE\" line in %s" % args.vecfile, bcolors.FAIL)
+        sys.exit(1)
+    tb = os.path.abspath(args.tb)
+    ghdlopts = args.ghdlopts if len(args.ghdlopts) > 0 else ["--ieee-asserts=disable"]
+
+    shards = []
+    for i, (idx, nbtests) in enumerate(make_shards(curves, args.jobs)):
+        workdir = os.path.abspath(os.path.join(args.outdir, "shard%d" % i))
+        os.makedirs(workdir, exist_ok=True)
+        vec = os.path.join(workdir, "ecc_vec_in.txt")
+        with open(vec, "w") as f:
+            f.writelines(header)
+            for c in idx:
+                f.writelines(curves[c])
+        s = Shard(i, workdir)
+        s.nbtests = nbtests
+        trng = args.trng.replace("%d", str(i)) if "%d" in args.trng else args.trng
+        s.cmd = [tb,
+                "-gsimvec=" + vec,
+                "-gsimlog=" + os.path.join(workdir, "ecc.log"),
+                "-gsimxyshuflog=" + os.path.join(workdir, "ecc_xyshuf.log"),
+                "-gsimtrng=" + os.path.abspath(trng),
+                "-gsimcsv=" + os.path.join(workdir, "ecc_cycles.csv"),
+                "-gCONTINUE_ON_ERROR=" + ("true" if args.continue_on_error else "false")] + ghdlopts
+        shards.append(s)
+        print_info("Shard %d: " % i, "%d curve(s), %d test(s) in %s" % (len(idx), nbtests, workdir))
+
+    t0 = time.time()
+    threads = [threading.Thread(target=s.run, args=(s.cmd,)) for s in shards]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    wall = time.time() - t0
+
+    total = {"ok": 0, "nok": 0, "total": 0}
+    for s in shards:
+        for k in total:
+            total[k] += s.stats[k]
+        if s.passed():
+            status = "passed"
+        elif not s.eof:
+            status = "ABORTED (exit status %s, see %s)" % (s.ret, os.path.join(s.workdir, "ecc_tb.out"))
+        else:
+            status = "FAILED (see %s)" % os.path.join(s.workdir, "ecc_tb.out")
+        print_info("Shard %d: " % s.index, "ok = %d, nok = %d, total = %d/%d in %.0f s, %s" %
+                (s.stats["ok"], s.stats["nok"], s.stats["total"], s.nbtests, s.time, status),
+                bcolors.OKGREEN if s.passed() else bcolors.FAIL)
+    csvs = [os.path.join(s.workdir, "ecc_cycles.csv") for s in shards]
+    csvs = [f for f in csvs if os.path.exists(f)]
+    if len(csvs) > 0:
+        ecc_cycles_compare.merge(os.path.join(args.outdir, "ecc_cycles.csv"), csvs)
+    ok = all(s.passed() for s in shards)
+    print_info("Total: ", "ok = %d, nok = %d, total = %d/%d, wall time %.0f s (%.0f s of simulation)" %
+            (total["ok"], total["nok"], total["total"], sum(s.nbtests for s in shards),
+                wall, sum(s.time for s in shards)), bcolors.OKGREEN if ok else bcolors.FAIL)
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()